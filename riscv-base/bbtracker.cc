@@ -1,112 +1,165 @@
 #include <stdlib.h>
 #include <malloc.h>
+#include <math.h>
+#include <assert.h>
+#include <algorithm>
+#include <random>
 #include "bbtracker.h"
 
 bb_tracker_t::bb_tracker_t ()
 {
 
+  bb_hash = NULL;
   bb_id = 0;
 
+  bbtrace = NULL;
+  outdir = NULL;
+  outfile = NULL;
+
+  interval_size = bb_interval;
   first_interval = 1;
-  interval_sum=0; 
-  
+
   dyn_inst=0;
   total_inst= 0;
   total_calls= 0;
 
 }
 
+bb_tracker_t::~bb_tracker_t()
+{
+  if (bbtrace)
+    pclose(bbtrace);
+  for (size_t i = 0; i < arena.size(); i++)
+    free(arena[i]);
+  free(bb_hash);
+}
 
 
 void bb_tracker_t::init_bb_tracker (char* dir_name, char* out_name, uint64_t m_interval_size)
 {
-  int64_t i;
-
   outdir = dir_name;
   outfile = out_name;
   interval_size = m_interval_size;
 
-  /* initialize hash ptr table */
-  for (i=0; i<bb_size; i++)
-    bb_hash[i] = NULL;
+  /* initialize hash table */
+  alloc_bb_hash(BB_TABLE_INIT_SIZE);
 
 }
 
 
-bb_node_ptr bb_tracker_t::create_bb_node (uint64_t pc, uint64_t num_inst)
+void bb_tracker_t::alloc_bb_hash (uint64_t m_size)
 {
-  bb_node_ptr temp;
+  uint64_t size = 16;
+  bb_hash_shift = 60;
+  while (size < m_size) {
+    size <<= 1;
+    bb_hash_shift--;
+  }
 
-  temp = (bb_node_ptr) malloc(sizeof(bb_node));
-  
-  if (temp == NULL) {
+  bb_hash = (uint32_t*) calloc(size, sizeof(uint32_t));
+  if (bb_hash == NULL) {
     fprintf(stderr,"OUT OF MEMORY\n");
     exit(1);
   }
-
-  temp->pc = pc;
-  temp->bb_id = bb_id++;
-  temp->count = num_inst;
-  temp->next = NULL;
-
-  return temp;
+  bb_hash_mask = size - 1;
 }
 
 
-void bb_tracker_t::append_bb_node (bb_node_ptr m_bb_node, bb_node_ptr head)
+void bb_tracker_t::grow_bb_hash ()
 {
-  /* Append assumes head is non null. */
+  uint32_t* old_hash = bb_hash;
+  uint64_t old_size = bb_hash_mask + 1;
+
+  alloc_bb_hash(old_size << 1);
 
-  while (head->next != NULL) 
-    head = head->next;                                              
+  for (uint64_t j = 0; j < old_size; j++) {
+    if (old_hash[j]) {
+      uint64_t i = bb_hash_index(get_bb_node(old_hash[j] - 1)->pc);
+      while (bb_hash[i])
+        i = (i + 1) & bb_hash_mask;
+      bb_hash[i] = old_hash[j];
+    }
+  }
 
-  head->next = m_bb_node;
+  free(old_hash);
 }
 
 
-/* Search for bb_node with pc, if found return 1, otherwise 
-   return 0 */
-int bb_tracker_t::find_bb_node (bb_node_ptr head, uint64_t pc, uint64_t num_inst)
+uint64_t bb_tracker_t::create_bb_node (uint64_t pc)
 {
-
-  if (head != NULL) {
-    while ((head->next != NULL) && (head->pc!=pc)) {
-      head = head->next;
-    }
-    
-    if ((head != NULL) && (head->pc == pc)) {
-      head->count += num_inst;
-      return 1;
+  /* New arena chunk, if the last one is full. */
+  if ((bb_id & (BB_ARENA_CHUNK - 1)) == 0) {
+    bb_node* chunk = (bb_node*) malloc(BB_ARENA_CHUNK * sizeof(bb_node));
+    if (chunk == NULL) {
+      fprintf(stderr,"OUT OF MEMORY\n");
+      exit(1);
     }
+    arena.push_back(chunk);
   }
-  return 0;
-} 
 
-void bb_tracker_t::print_list (bb_node_ptr head, uint64_t array[]) 
-{
-  do {
-    array[head->bb_id] = head->count;
+  bb_node* temp = get_bb_node(bb_id);
+  temp->pc = pc;
+  temp->count = 0;
 
-    /* clear stats */
-    head->count = 0;
-    head = head->next;
-  } while(head != NULL);
+  return bb_id++;
 }
 
-void bb_tracker_t::print_bb_hash (bb_node_ptr hash[])
+
+/* Search for the bb_node with pc, creating it if it is not found, and
+   return its bb_id. */
+uint64_t bb_tracker_t::find_bb_node (uint64_t pc)
 {
-  uint64_t i;
-  uint64_t bb_array[bb_id];
+  uint64_t i = bb_hash_index(pc);
+  while (bb_hash[i]) {
+    uint64_t id = bb_hash[i] - 1;
+    if (get_bb_node(id)->pc == pc)
+      return id;
+    i = (i + 1) & bb_hash_mask;
+  }
 
-  /* initialize array for sorting bb according to bb_id */
-  for(i=0; i<bb_id; i++) {
-    bb_array[i] = 0;
+  /* new bb: keep the table at most half full */
+  if (2 * (bb_id + 1) > bb_hash_mask + 1) {
+    grow_bb_hash();
+    i = bb_hash_index(pc);
+    while (bb_hash[i])
+      i = (i + 1) & bb_hash_mask;
   }
 
-  for(i=0; i<bb_size; i++) {
-    if (hash[i] != NULL)
-      print_list(hash[i], bb_array);
+  uint64_t id = create_bb_node(pc);
+  assert(id < UINT32_MAX);
+  bb_hash[i] = (uint32_t)(id + 1);
+  return id;
+}
+
+
+static inline void put_varint(std::vector<uint8_t>& buf, uint64_t value)
+{
+  while (value >= 0x80) {
+    buf.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
   }
+  buf.push_back((uint8_t)value);
+}
+
+static inline uint64_t get_varint(const std::vector<uint8_t>& buf, uint64_t& pos)
+{
+  uint64_t value = 0;
+  unsigned int shift = 0;
+  uint8_t byte;
+  do {
+    byte = buf[pos++];
+    value |= ((uint64_t)(byte & 0x7f) << shift);
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+
+/* Writes the current interval to the trace and to the sparse vectors, and
+   clears the counts of the blocks it touched. */
+void bb_tracker_t::end_interval ()
+{
+  std::sort(touched.begin(), touched.end());
 
   if (first_interval) {
     first_interval = 0;
@@ -114,48 +167,307 @@ void bb_tracker_t::print_bb_hash (bb_node_ptr hash[])
     bbtrace = popen(finalname,"w");
   }
 
-  fprintf(bbtrace,"T");
- 
-  for(i=0; i<bb_id; i++) { 
-    if(bb_array[i] > 0) {
-      fprintf( bbtrace, ":%" PRIu64 ":%" PRIu64 "   ", i+1, bb_array[i]);
-    }
+  sv_offset.push_back(sv_data.size());
+  sv_start.push_back(total_inst - dyn_inst);
+  sv_length.push_back(dyn_inst);
+
+  if (bbtrace)
+    fprintf(bbtrace,"T");
+
+  uint64_t last = 0;
+  for (size_t i = 0; i < touched.size(); i++) {
+    bb_node* bb = get_bb_node(touched[i]);
+    if (bbtrace)
+      fprintf( bbtrace, ":%" PRIu64 ":%" PRIu64 "   ", (uint64_t)touched[i]+1, bb->count);
+    put_varint(sv_data, touched[i] - last);
+    put_varint(sv_data, bb->count);
+    last = touched[i];
+
+    /* clear stats */
+    bb->count = 0;
   }
 
-  fprintf( bbtrace, "\n");
-  fflush( bbtrace );
+  if (bbtrace) {
+    fprintf( bbtrace, "\n");
+    fflush( bbtrace );
+  }
+
+  touched.clear();
+  dyn_inst = 0;
 }
 
 
-void bb_tracker_t::bb_tracker(uint64_t pc, uint64_t num_inst)
+void bb_tracker_t::decode_interval (uint64_t interval, std::vector<uint32_t>& ids, std::vector<uint64_t>& counts) const
 {
-  /* key into bb-hash based on pc of last inst in bb*/
-  uint64_t bb_key = (pc>>2)%bb_size;
-
-  /* Increment bb with the number of instructions it contains */
-  if (!find_bb_node(bb_hash[bb_key], pc, num_inst)) {
+  uint64_t pos = sv_offset[interval];
+  uint64_t end = ((interval + 1) < sv_offset.size()) ? sv_offset[interval + 1] : sv_data.size();
+  uint64_t id = 0;
+
+  ids.clear();
+  counts.clear();
+  while (pos < end) {
+    id += get_varint(sv_data, pos);
+    ids.push_back((uint32_t)id);
+    counts.push_back(get_varint(sv_data, pos));
+  }
+}
 
-    /* new bb, need to create node for it */
-    bb_node_ptr temp = create_bb_node(pc, num_inst);
 
-    if (bb_hash[bb_key] == NULL) {                                           
-      bb_hash[bb_key] = temp;                                                
-    } else {
-      append_bb_node(temp, bb_hash[bb_key]);                                     
-    } 
-  }
+void bb_tracker_t::bb_tracker(uint64_t pc, uint64_t num_inst)
+{
+  /* Increment bb with the number of instructions it contains */
+  uint64_t id = find_bb_node(pc);
+  bb_node* bb = get_bb_node(id);
+  if (bb->count == 0)
+    touched.push_back((uint32_t)id);
+  bb->count += num_inst;
 
   dyn_inst += num_inst;
   total_inst += num_inst;
+  total_calls++;
 
-  /* if reached end of interval, dump stats and decrement counter */
-  if (dyn_inst > interval_size) {
-    dyn_inst -= interval_size;
-    print_bb_hash(bb_hash);
-  }
+  /* if reached end of interval, dump stats */
+  if (dyn_inst >= interval_size)
+    end_interval();
 }
 
 void bb_tracker_t::set_interval_size(uint64_t m_interval_size)
 {
   interval_size = m_interval_size;
 }
+
+void bb_tracker_t::finish()
+{
+  if (dyn_inst)
+    end_interval();
+  if (bbtrace) {
+    pclose(bbtrace);
+    bbtrace = NULL;
+  }
+}
+
+
+/* Element (bb, dim) of the random projection matrix, uniform in [-1,1].
+   Computed from a hash so that the matrix need not be stored. */
+static inline double bb_projection(uint64_t bb, unsigned int dim)
+{
+  uint64_t z = (bb * BB_PROJ_DIMS + dim + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z = z ^ (z >> 31);
+  return ((double)(z >> 11) / (double)(1ULL << 53)) * 2.0 - 1.0;
+}
+
+static inline double bb_distance(const double* a, const double* b)
+{
+  double d = 0.0;
+  for (unsigned int j = 0; j < BB_PROJ_DIMS; j++)
+    d += (a[j] - b[j]) * (a[j] - b[j]);
+  return d;
+}
+
+
+/* k-means with k-means++ seeding. Returns the total squared distance of the
+   points to their centers. */
+double bb_tracker_t::kmeans(const std::vector<double>& points, uint64_t n, unsigned int k, uint64_t seed,
+                            std::vector<double>& centers, std::vector<unsigned int>& assign) const
+{
+  std::mt19937_64 rng(seed);
+  std::vector<double> dist(n);
+
+  centers.assign(k * BB_PROJ_DIMS, 0.0);
+  assign.assign(n, 0);
+
+  // Seeding.
+  uint64_t first = rng() % n;
+  std::copy(points.begin() + first * BB_PROJ_DIMS, points.begin() + (first + 1) * BB_PROJ_DIMS, centers.begin());
+  for (uint64_t i = 0; i < n; i++)
+    dist[i] = bb_distance(&points[i * BB_PROJ_DIMS], &centers[0]);
+  for (unsigned int c = 1; c < k; c++) {
+    double sum = 0.0;
+    for (uint64_t i = 0; i < n; i++)
+      sum += dist[i];
+    uint64_t pick = rng() % n;
+    if (sum > 0.0) {
+      double r = std::uniform_real_distribution<double>(0.0, sum)(rng);
+      for (pick = 0; pick < n - 1; pick++) {
+        r -= dist[pick];
+        if (r <= 0.0)
+          break;
+      }
+    }
+    std::copy(points.begin() + pick * BB_PROJ_DIMS, points.begin() + (pick + 1) * BB_PROJ_DIMS, centers.begin() + c * BB_PROJ_DIMS);
+    for (uint64_t i = 0; i < n; i++)
+      dist[i] = std::min(dist[i], bb_distance(&points[i * BB_PROJ_DIMS], &centers[c * BB_PROJ_DIMS]));
+  }
+
+  // Lloyd iterations.
+  double distortion = 0.0;
+  std::vector<uint64_t> size(k);
+  for (unsigned int iter = 0; iter < BB_KMEANS_ITERS; iter++) {
+    bool changed = (iter == 0);
+    distortion = 0.0;
+    for (uint64_t i = 0; i < n; i++) {
+      unsigned int best = 0;
+      double best_d = bb_distance(&points[i * BB_PROJ_DIMS], &centers[0]);
+      for (unsigned int c = 1; c < k; c++) {
+        double d = bb_distance(&points[i * BB_PROJ_DIMS], &centers[c * BB_PROJ_DIMS]);
+        if (d < best_d) {
+          best_d = d;
+          best = c;
+        }
+      }
+      if (assign[i] != best) {
+        assign[i] = best;
+        changed = true;
+      }
+      distortion += best_d;
+    }
+    if (!changed)
+      break;
+
+    // Move each center to the mean of its points. Empty clusters keep their center.
+    std::fill(size.begin(), size.end(), 0);
+    std::vector<double> sum(k * BB_PROJ_DIMS, 0.0);
+    for (uint64_t i = 0; i < n; i++) {
+      size[assign[i]]++;
+      for (unsigned int j = 0; j < BB_PROJ_DIMS; j++)
+        sum[assign[i] * BB_PROJ_DIMS + j] += points[i * BB_PROJ_DIMS + j];
+    }
+    for (unsigned int c = 0; c < k; c++)
+      if (size[c])
+        for (unsigned int j = 0; j < BB_PROJ_DIMS; j++)
+          centers[c * BB_PROJ_DIMS + j] = sum[c * BB_PROJ_DIMS + j] / size[c];
+  }
+
+  return distortion;
+}
+
+
+/* Bayesian Information Criterion of a clustering (Pelleg and Moore's X-means
+   formulation, as used by SimPoint). Larger is better. */
+double bb_tracker_t::bic(const std::vector<double>& points, uint64_t n, unsigned int k,
+                         const std::vector<double>& centers, const std::vector<unsigned int>& assign) const
+{
+  const double M = BB_PROJ_DIMS;
+  std::vector<uint64_t> size(k, 0);
+  double distortion = 0.0;
+  for (uint64_t i = 0; i < n; i++) {
+    size[assign[i]]++;
+    distortion += bb_distance(&points[i * BB_PROJ_DIMS], &centers[assign[i] * BB_PROJ_DIMS]);
+  }
+
+  double variance = (n > k) ? (distortion / (double)(n - k)) : 0.0;
+  variance = std::max(variance, 1e-12);
+
+  double loglikelihood = 0.0;
+  for (unsigned int c = 0; c < k; c++) {
+    double Rn = (double)size[c];
+    if (Rn == 0.0)
+      continue;
+    loglikelihood += Rn * log(Rn) - Rn * log((double)n)
+                   - Rn * 0.5 * log(2.0 * M_PI)
+                   - Rn * M * 0.5 * log(variance)
+                   - (Rn - k) * 0.5;
+  }
+
+  double params = (k - 1) + M * k + 1;
+  return loglikelihood - params * 0.5 * log((double)n);
+}
+
+
+unsigned int bb_tracker_t::cluster(unsigned int max_k)
+{
+  // Cluster only full intervals: a short last interval is not representative.
+  uint64_t n = sv_start.size();
+  if ((n > 1) && (2 * sv_length[n - 1] < interval_size))
+    n--;
+  if (n == 0) {
+    fprintf(stderr, "BBV: no complete interval of %" PRIu64 " instructions to cluster\n", interval_size);
+    return 0;
+  }
+
+  // Normalize each interval's vector and project it to BB_PROJ_DIMS dimensions.
+  std::vector<double> points(n * BB_PROJ_DIMS, 0.0);
+  std::vector<uint32_t> ids;
+  std::vector<uint64_t> counts;
+  for (uint64_t i = 0; i < n; i++) {
+    decode_interval(i, ids, counts);
+    for (size_t b = 0; b < ids.size(); b++) {
+      double freq = (double)counts[b] / (double)sv_length[i];
+      for (unsigned int j = 0; j < BB_PROJ_DIMS; j++)
+        points[i * BB_PROJ_DIMS + j] += freq * bb_projection(ids[b], j);
+    }
+  }
+
+  // Cluster for each k, keeping the best of several seeds.
+  max_k = (unsigned int) std::min((uint64_t)std::max(max_k, 1U), n);
+  std::vector<std::vector<double> > best_centers(max_k + 1);
+  std::vector<std::vector<unsigned int> > best_assign(max_k + 1);
+  std::vector<double> score(max_k + 1);
+  std::vector<double> centers;
+  std::vector<unsigned int> assign;
+  for (unsigned int k = 1; k <= max_k; k++) {
+    double best = -1.0;
+    for (unsigned int s = 0; s < BB_KMEANS_SEEDS; s++) {
+      double d = kmeans(points, n, k, BB_KMEANS_SEED + s * max_k + k, centers, assign);
+      if ((best < 0.0) || (d < best)) {
+        best = d;
+        best_centers[k] = centers;
+        best_assign[k] = assign;
+      }
+    }
+    score[k] = bic(points, n, k, best_centers[k], best_assign[k]);
+  }
+
+  // Pick the smallest k whose BIC reaches BB_BIC_THRESHOLD of the BIC range.
+  double min_score = *std::min_element(score.begin() + 1, score.end());
+  double max_score = *std::max_element(score.begin() + 1, score.end());
+  unsigned int k = max_k;
+  for (unsigned int c = 1; c <= max_k; c++) {
+    if (score[c] >= min_score + BB_BIC_THRESHOLD * (max_score - min_score)) {
+      k = c;
+      break;
+    }
+  }
+
+  // The simulation point of each phase is the interval closest to its center.
+  std::vector<uint64_t> rep(k, n);
+  std::vector<double> rep_dist(k, 0.0);
+  std::vector<uint64_t> size(k, 0);
+  for (uint64_t i = 0; i < n; i++) {
+    unsigned int c = best_assign[k][i];
+    double d = bb_distance(&points[i * BB_PROJ_DIMS], &best_centers[k][c * BB_PROJ_DIMS]);
+    size[c]++;
+    if ((rep[c] == n) || (d < rep_dist[c])) {
+      rep[c] = i;
+      rep_dist[c] = d;
+    }
+  }
+
+  std::vector<unsigned int> order;
+  for (unsigned int c = 0; c < k; c++)
+    if (size[c])
+      order.push_back(c);
+  std::sort(order.begin(), order.end(), [&rep](unsigned int a, unsigned int b) { return rep[a] < rep[b]; });
+
+  sprintf(finalname, "%s/%s.simpoints", outdir, outfile);
+  FILE* fp = fopen(finalname, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "BBV: could not open %s\n", finalname);
+    return k;
+  }
+  fprintf(fp, "# %s: %" PRIu64 " instructions, %" PRIu64 " intervals of %" PRIu64 " instructions, %" PRIu64 " basic blocks, %u phases\n",
+          outfile, total_inst, n, interval_size, bb_id, (unsigned int)order.size());
+  fprintf(fp, "# start_insn weight interval phase\n");
+  for (size_t p = 0; p < order.size(); p++) {
+    unsigned int c = order[p];
+    fprintf(fp, "%" PRIu64 " %.6f %" PRIu64 " %zu\n", sv_start[rep[c]], (double)size[c] / (double)n, rep[c], p);
+    fprintf(stderr, "BBV: phase %zu (weight %.4f): -s%" PRIu64 " -e%" PRIu64 "\n",
+            p, (double)size[c] / (double)n, sv_start[rep[c]], interval_size);
+  }
+  fclose(fp);
+  fprintf(stderr, "BBV: wrote %u simulation points to %s\n", (unsigned int)order.size(), finalname);
+
+  return (unsigned int)order.size();
+}
@@ -3,51 +3,95 @@
 
 #include <cinttypes>
 #include <stdio.h>
+#include <vector>
 
-/* Initializes interval size, output directory and output name, 
-   as well as the basic block hash table */
+/* Basic block vector (BBV) profiler for SimPoint-style sampling.
 
-/* Size of basic block hash table. Should be increased for very 
-   large programs (greater than 1 million basic blocks) */
-#define bb_size 1000000
+   Basic blocks are identified by the pc of their last instruction. Block
+   records live in an arena of fixed-size chunks (they are never moved or
+   freed individually) and are found through an open-addressed table of
+   arena indices, so profiling costs one hash probe per basic block.
+
+   At the end of each interval, the blocks touched in that interval are
+   written to <outdir>/<outfile>.bb.gz in the SimPoint "T:id:count" format,
+   and also kept in memory as a sparse vector (delta-encoded block ids and
+   counts, as LEB128 varints). cluster() runs k-means on these vectors and
+   writes <outdir>/<outfile>.simpoints, listing for each phase the
+   instruction count at which its representative interval starts (usable
+   directly with -s) and the phase's weight. */
+
+/* Initial size of the basic block table (grows as needed). */
+#define BB_TABLE_INIT_SIZE 4096
+
+/* Number of basic block records per arena chunk. */
+#define BB_ARENA_CHUNK_LOG 16
+#define BB_ARENA_CHUNK     (1 << BB_ARENA_CHUNK_LOG)
+
+/* Default interval size in instructions. */
 #define bb_interval 100000000
 
-/* basic block element */ 
+/* Clustering: dimensions of the random projection, number of random k-means
+   seeds tried per k, max k-means iterations, and BIC threshold (fraction of
+   the BIC range) used to select k, as in SimPoint 3.0. */
+#define BB_PROJ_DIMS     15
+#define BB_KMEANS_SEEDS  5
+#define BB_KMEANS_ITERS  100
+#define BB_BIC_THRESHOLD 0.9
+#define BB_KMEANS_SEED   493575226
+
+/* basic block element */
 typedef struct node {
-  uint64_t count;
-  uint64_t bb_id;
-  uint64_t pc;
-  struct node * next;
+  uint64_t count;        // instructions in this block during the current interval
+  uint64_t pc;           // pc of the last instruction of the block
 } bb_node;
 
-typedef  bb_node * bb_node_ptr;
-
 class bb_tracker_t{
 
   private:
-    bb_node_ptr bb_hash[bb_size];
-    
-    uint64_t bb_id_pool = bb_size;
-    uint64_t bb_id;
+    uint32_t* bb_hash;                  // open-addressed table of (bb_id + 1), 0: empty
+    uint64_t bb_hash_mask;
+    unsigned int bb_hash_shift;
+
+    std::vector<bb_node*> arena;        // chunks of BB_ARENA_CHUNK records, indexed by bb_id
+    uint64_t bb_id;                     // number of distinct basic blocks seen so far
+
+    std::vector<uint32_t> touched;      // bb_ids with a non-zero count in the current interval
+
+    // Sparse per-interval vectors.
+    std::vector<uint8_t> sv_data;       // varint-encoded (bb_id delta, count) pairs
+    std::vector<uint64_t> sv_offset;    // start of each interval's pairs in sv_data
+    std::vector<uint64_t> sv_start;     // instruction count at the start of each interval
+    std::vector<uint64_t> sv_length;    // instructions in each interval
 
     FILE* bbtrace;
     char finalname[450];
-    char *outdir;                                                                
-    char *outfile;                                                               
-    
-    uint64_t interval_size; 
+    char *outdir;
+    char *outfile;
+
+    uint64_t interval_size;
     uint64_t first_interval;
-    uint64_t interval_sum; 
-    
+
     uint64_t dyn_inst;
     uint64_t total_inst;
     uint64_t total_calls;
 
-    bb_node_ptr create_bb_node (uint64_t pc, uint64_t num_inst);
-    void append_bb_node (bb_node_ptr m_bb_node, bb_node_ptr head);
-    int find_bb_node (bb_node_ptr head, uint64_t pc, uint64_t num_inst);
-    void print_list (bb_node_ptr head, uint64_t array[]);
-    void print_bb_hash (bb_node_ptr hash[]);
+    inline uint64_t bb_hash_index(uint64_t pc) const {
+      return ((pc >> 2) * 0x9e3779b97f4a7c15ULL) >> bb_hash_shift;
+    }
+    inline bb_node* get_bb_node(uint64_t id) {
+      return &arena[id >> BB_ARENA_CHUNK_LOG][id & (BB_ARENA_CHUNK - 1)];
+    }
+
+    void alloc_bb_hash(uint64_t m_size);
+    void grow_bb_hash();
+    uint64_t create_bb_node(uint64_t pc);
+    uint64_t find_bb_node(uint64_t pc);
+    void end_interval();
+    void decode_interval(uint64_t interval, std::vector<uint32_t>& ids, std::vector<uint64_t>& counts) const;
+    double kmeans(const std::vector<double>& points, uint64_t n, unsigned int k, uint64_t seed,
+                  std::vector<double>& centers, std::vector<unsigned int>& assign) const;
+    double bic(const std::vector<double>& points, uint64_t n, unsigned int k,
+               const std::vector<double>& centers, const std::vector<unsigned int>& assign) const;
 
   public:
 
@@ -55,13 +99,22 @@ class bb_tracker_t{
     ~bb_tracker_t();
 
     void init_bb_tracker (char* m_dir_name, char* m_out_name, uint64_t m_interval_size);
-    void set_interval_size(size_t m_interval_size);
- 
+    void set_interval_size(uint64_t m_interval_size);
 
-    /* Called at each CTRL op, marking the end of a basic block.  The pc of the last 
-     instruction indexes into the basic block hash, and the counter is inceremented 
+    /* Called at each CTRL op, marking the end of a basic block.  The pc of the last
+     instruction indexes into the basic block hash, and the counter is inceremented
      by the number of instructions in the basic block. */
     void bb_tracker (uint64_t m_pc, uint64_t m_num_inst);
+
+    /* Closes the last, partial interval and the .bb.gz trace. */
+    void finish();
+
+    /* Clusters the interval vectors into at most max_k phases and writes the
+       simulation points. Returns the number of phases chosen. */
+    unsigned int cluster(unsigned int max_k);
+
+    uint64_t get_num_intervals() const { return sv_start.size(); }
+    uint64_t get_num_bbs() const { return bb_id; }
 };
 
 #endif
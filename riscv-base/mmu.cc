@@ -129,6 +129,34 @@ pte_t mmu_t::walk(reg_t addr)
   return pte;
 }
 
+size_t mmu_t::walk_trace(reg_t addr, reg_t pte_addr[])
+{
+  size_t n = 0;
+
+  if (proc == NULL || !(proc->state.sr & SR_VM))
+    return 0;
+
+  // Same traversal as walk().
+  reg_t base = proc->get_state()->ptbr;
+  int ptshift = (LEVELS-1)*PTIDXBITS;
+  for(reg_t i = 0; i < LEVELS; i++, ptshift -= PTIDXBITS)
+  {
+    reg_t idx = (addr >> (PGSHIFT+ptshift)) & ((1<<PTIDXBITS)-1);
+    reg_t a = base + idx*sizeof(pte_t);
+    if(a >= memsz)
+      break;
+
+    pte_addr[n++] = a;
+
+    pte_t ptd = *(pte_t*)(mem+a);
+    if (!(ptd & PTE_V) || !(ptd & PTE_T)) // invalid, or the actual PTE
+      break;
+    base = (ptd >> PGSHIFT) << PGSHIFT;
+  }
+
+  return n;
+}
+
 void mmu_t::register_memtracer(memtracer_t* t)
 {
   flush_tlb();
@@ -188,6 +188,11 @@ public:
 
   void set_processor(processor_t* p) { proc = p; flush_tlb(); }
 
+  // Physical addresses of the page table entries that a page table walk for
+  // addr reads, in order, for timing models. Returns their number: 0 if
+  // translation is off.
+  size_t walk_trace(reg_t addr, reg_t pte_addr[]);
+
   void flush_tlb();
   void flush_icache();
 
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <algorithm>
+#include "pchist.h"
+
+pc_histogram_t::pc_histogram_t (uint64_t m_size)
+{
+  table = NULL;
+  alloc(m_size);
+}
+
+pc_histogram_t::~pc_histogram_t()
+{
+  free(table);
+}
+
+void pc_histogram_t::alloc(uint64_t m_size)
+{
+  // Round up to a power of two.
+  uint64_t size = 16;
+  shift = 60;
+  while (size < m_size) {
+    size <<= 1;
+    shift--;
+  }
+
+  table = (pchist_entry_t*) malloc(size * sizeof(pchist_entry_t));
+  assert(table);
+  mask = size - 1;
+  used = 0;
+  for (uint64_t i = 0; i <= mask; i++) {
+    table[i].key = PCHIST_EMPTY;
+    table[i].executed = 0;
+    table[i].mispredicted = 0;
+  }
+}
+
+void pc_histogram_t::grow()
+{
+  pchist_entry_t* old_table = table;
+  uint64_t old_size = mask + 1;
+
+  alloc(old_size << 1);
+
+  for (uint64_t j = 0; j < old_size; j++) {
+    if (old_table[j].key == PCHIST_EMPTY)
+      continue;
+    uint64_t i = hash(old_table[j].key);
+    while (table[i].key != PCHIST_EMPTY)
+      i = (i + 1) & mask;
+    table[i] = old_table[j];
+    used++;
+  }
+
+  free(old_table);
+}
+
+void pc_histogram_t::clear()
+{
+  for (uint64_t i = 0; i <= mask; i++) {
+    table[i].key = PCHIST_EMPTY;
+    table[i].executed = 0;
+    table[i].mispredicted = 0;
+  }
+  used = 0;
+}
+
+void pc_histogram_t::top(uint64_t n, bool by_misp, std::vector<pchist_entry_t>& out) const
+{
+  out.clear();
+  out.reserve(used);
+  for (uint64_t i = 0; i <= mask; i++)
+    if (table[i].key != PCHIST_EMPTY)
+      out.push_back(table[i]);
+
+  // Ties are broken by PC so that dumps are deterministic.
+  auto hotter = [by_misp](const pchist_entry_t& a, const pchist_entry_t& b) {
+    uint64_t ca = by_misp ? a.mispredicted : a.executed;
+    uint64_t cb = by_misp ? b.mispredicted : b.executed;
+    if (ca != cb)
+      return ca > cb;
+    return a.key < b.key;
+  };
+
+  if ((n == 0) || (n >= out.size())) {
+    std::sort(out.begin(), out.end(), hotter);
+  }
+  else {
+    std::partial_sort(out.begin(), out.begin() + n, out.end(), hotter);
+    out.resize(n);
+  }
+}
+
+void pc_histogram_t::dump(FILE* fp, uint64_t n, bool branches) const
+{
+  std::vector<pchist_entry_t> sorted;
+  top(n, branches, sorted);
+  for (size_t i = 0; i < sorted.size(); i++) {
+    if (branches)
+      fprintf(fp, "%0" PRIx64 " %" PRIu64 " %" PRIu64 "\n", (sorted[i].key << 2), sorted[i].executed, sorted[i].mispredicted);
+    else
+      fprintf(fp, "%0" PRIx64 " %" PRIu64 "\n", (sorted[i].key << 2), sorted[i].executed);
+  }
+}
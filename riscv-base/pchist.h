@@ -0,0 +1,87 @@
+#ifndef PCHIST_H
+#define PCHIST_H
+
+#include <cinttypes>
+#include <cstddef>
+#include <stdio.h>
+#include <vector>
+
+/* Open-addressing (linear probing) hash table of per-PC counters, used for the
+   PC and branch histograms. Keys are word-aligned PCs (pc >> 2). The table
+   doubles when it is half full, so a lookup is a multiply, a shift and
+   (almost always) a single probe, with no allocation per new PC. */
+
+#define PCHIST_INIT_SIZE 4096
+
+typedef struct pchist_entry {
+  uint64_t key;             // pc >> 2, or PCHIST_EMPTY
+  uint64_t executed;
+  uint64_t mispredicted;
+} pchist_entry_t;
+
+#define PCHIST_EMPTY (~(uint64_t)0)
+
+class pc_histogram_t {
+
+  private:
+    pchist_entry_t* table;
+    uint64_t mask;        // table size - 1 (table size is a power of two)
+    unsigned int shift;   // 64 - log2(table size)
+    uint64_t used;
+
+    inline uint64_t hash(uint64_t key) const {
+      // Fibonacci hashing: the top bits of the product are well mixed even
+      // for the densely clustered keys of a code footprint.
+      return (key * 0x9e3779b97f4a7c15ULL) >> shift;
+    }
+
+    void alloc(uint64_t m_size);
+    void grow();
+
+  public:
+
+    pc_histogram_t (uint64_t m_size = PCHIST_INIT_SIZE);
+    ~pc_histogram_t();
+
+    /* Returns the entry for pc, inserting a zeroed one if it is not present. */
+    inline pchist_entry_t* lookup(uint64_t pc) {
+      uint64_t key = pc >> 2;
+      uint64_t i = hash(key);
+      while (true) {
+        pchist_entry_t* e = &table[i];
+        if (e->key == key)
+          return e;
+        if (e->key == PCHIST_EMPTY) {
+          if (2 * (used + 1) > mask + 1) {
+            grow();
+            return lookup(pc);
+          }
+          used++;
+          e->key = key;
+          return e;
+        }
+        i = (i + 1) & mask;
+      }
+    }
+
+    inline void inc(uint64_t pc) { lookup(pc)->executed++; }
+
+    inline void inc_branch(uint64_t pc, bool misp) {
+      pchist_entry_t* e = lookup(pc);
+      e->executed++;
+      e->mispredicted += misp;
+    }
+
+    inline uint64_t size() const { return used; }
+
+    void clear();
+
+    /* Copies out the n entries with the largest execution (or misprediction)
+       counts, sorted in descending order. n == 0 returns all entries. */
+    void top(uint64_t n, bool by_misp, std::vector<pchist_entry_t>& out) const;
+
+    /* Prints the top n entries as "<pc> <executed>[ <mispredicted>]" lines. */
+    void dump(FILE* fp, uint64_t n, bool branches) const;
+};
+
+#endif
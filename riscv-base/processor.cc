@@ -24,8 +24,13 @@ extern bool logging_on;
 
 processor_t::processor_t(sim_t* _sim, mmu_t* _mmu, uint32_t _id)
   : sim(_sim), mmu(_mmu), ext(NULL), disassembler(new disassembler_t),
-    id(_id), run(false), debug(false), serialized(false)
+    id(_id), run(false), debug(false), checker(false), serialized(false), warming(false), pipe(NULL)
 {
+#ifdef RISCV_ENABLE_SIMPOINT
+  bbt = NULL;
+  bb_num_inst = 0;
+  bbt_name = NULL;
+#endif
   reset(true);
   mmu->set_processor(this);
 
@@ -41,12 +46,15 @@ processor_t::~processor_t()
   if (histogram_enabled)
   {
     fprintf(stderr, "PC Histogram size:%lu\n", pc_histogram.size());
-    for(auto iterator = pc_histogram.begin(); iterator != pc_histogram.end(); ++iterator) {
-      fprintf(stderr, "%0lx %lu\n", (iterator->first << 2), iterator->second);
-    }
+    pc_histogram.dump(stderr, 0, false);
   }
 #endif
 
+#ifdef RISCV_ENABLE_SIMPOINT
+  delete bbt;
+  free(bbt_name);
+#endif
+
   delete disassembler;
 }
 
@@ -142,6 +150,31 @@ void processor_t::set_histogram(bool value)
   histogram_enabled = value;
 }
 
+#ifdef RISCV_ENABLE_SIMPOINT
+void processor_t::set_simpoint(bool enable, size_t interval, const char* name)
+{
+  delete bbt;
+  bbt = NULL;
+  free(bbt_name);
+  bbt_name = NULL;
+  bb_num_inst = 0;
+
+  if (enable) {
+    bbt_name = strdup(name);
+    bbt = new bb_tracker_t();
+    bbt->init_bb_tracker((char*)".", bbt_name, interval);
+  }
+}
+
+void processor_t::finish_simpoint(unsigned int max_k)
+{
+  if (bbt) {
+    bbt->finish();
+    bbt->cluster(max_k);
+  }
+}
+#endif
+
 void processor_t::reset(bool value)
 {
 
@@ -201,8 +234,7 @@ static void commit_log(state_t* state, reg_t pc, insn_t insn)
 inline void processor_t::update_histogram(size_t pc)
 {
 #ifdef RISCV_ENABLE_HISTOGRAM
-  size_t idx = pc >> 2;
-  pc_histogram[idx]++;
+  pc_histogram.inc(pc);
 #endif
 }
 
@@ -227,6 +259,23 @@ inline reg_t processor_t::get_frs(reg_t rs, reg_t pc, operand_t type){
 //Scope of this function is just this file
 static reg_t execute_insn(processor_t* p, reg_t pc, insn_fetch_t fetch)
 {
+  // The effective address is formed before the instruction can overwrite rs1.
+  reg_t warm_addr = 0;
+  if (unlikely(p->get_warming())) {
+    switch (fetch.insn.opcode()) {
+      case OP_LOAD:
+      case OP_LOAD_FP:
+        warm_addr = p->get_state()->XPR[fetch.insn.rs1()] + fetch.insn.i_imm();
+        break;
+      case OP_STORE:
+      case OP_STORE_FP:
+        warm_addr = p->get_state()->XPR[fetch.insn.rs1()] + fetch.insn.s_imm();
+        break;
+      case OP_AMO:
+        warm_addr = p->get_state()->XPR[fetch.insn.rs1()];
+        break;
+    }
+  }
   //#ifdef RISCV_MICRO_CHECKER
   //  if(p->get_checker()){
   //    p->get_pipe()->start();
@@ -237,6 +286,11 @@ static reg_t execute_insn(processor_t* p, reg_t pc, insn_fetch_t fetch)
   //TODO: Push to debug buffer RD value and next PC
   commit_log(p->get_state(), pc, fetch.insn);
   p->update_histogram(pc);
+#ifdef RISCV_ENABLE_SIMPOINT
+  p->update_bbv(pc, fetch.insn);
+#endif
+  if (unlikely(p->get_warming()))
+    p->warm(pc, fetch.insn, npc, warm_addr);
   #ifdef RISCV_MICRO_CHECKER
     if(p->get_checker()){
 	    p->get_pipe()->push_instr_actual(fetch.insn, 0, 0, pc, npc, 0, 0);
@@ -4,6 +4,10 @@
 
 #include "decode.h"
 #include "config.h"
+#include "pchist.h"
+#ifdef RISCV_ENABLE_SIMPOINT
+#include "bbtracker.h"
+#endif
 #include <cstring>
 #include <cstdio>
 #include <vector>
@@ -95,6 +99,31 @@ public:
   extension_t* get_extension() { return ext; }
   void yield_load_reservation() { state.load_reservation = (reg_t)-1; }
   virtual void update_histogram(size_t pc);
+#ifdef RISCV_ENABLE_SIMPOINT
+  void set_simpoint(bool enable, size_t interval, const char* name);
+  void finish_simpoint(unsigned int max_k);
+
+  // Count the instruction in the current basic block, ending the block at
+  // each control transfer (JAL, JALR, conditional branch).
+  inline void update_bbv(reg_t pc, insn_t insn)
+  {
+    if (likely(bbt == NULL))
+      return;
+    bb_num_inst++;
+    uint64_t opcode = insn.bits() & 0x7f;
+    if ((opcode == 0x63) || (opcode == 0x67) || (opcode == 0x6f)) {
+      bbt->bb_tracker(pc, bb_num_inst);
+      bb_num_inst = 0;
+    }
+  }
+#endif
+
+  // Functional warming of a timing model: while enabled, warm() is called
+  // with each executed instruction, its next pc and, for a load, store or
+  // AMO, its effective address (0 otherwise).
+  void set_warming(bool value) { warming = value; }
+  bool get_warming() { return warming; }
+  virtual void warm(reg_t pc, insn_t insn, reg_t npc, reg_t addr) {}
 
   void register_insn(insn_desc_t);
   void register_extension(extension_t*);
@@ -119,10 +148,17 @@ protected:
   bool histogram_enabled;
   bool rv64;
   bool serialized;
+  bool warming;
 
   debug_buffer_t* pipe;
 
-  std::map<size_t,size_t> pc_histogram;
+  pc_histogram_t pc_histogram;
+
+#ifdef RISCV_ENABLE_SIMPOINT
+  bb_tracker_t* bbt;      // basic block vector profiler, NULL if disabled
+  uint64_t bb_num_inst;   // instructions in the current basic block
+  char* bbt_name;
+#endif
 
   void serialize(); // collapse into defined architectural state
   void take_interrupt(); // take a trap if any interrupts are pending
@@ -19,6 +19,13 @@
 #include "pipeline.h"
 #include "stats.h"
 #include "parameters.h"
+#include "coherence.h"
+
+// The byte address of a line, without the thread id folded into it.
+static inline reg_t line_addr(reg_t lineAddr, int lineSize)
+{
+	return((lineAddr & (((reg_t)1 << 30) - 1)) << lineSize);
+}
 
 CacheClass::CacheClass(int sets, int assoc, int _lineSize,
                        int _hitLatency, int _missLatency,
@@ -28,6 +35,8 @@ CacheClass::CacheClass(int sets, int assoc, int _lineSize,
 	: proc(_proc),
     array(sets, assoc),  // Allocate cache array.
     nextLevel(_nextLevel),
+    directory(NULL),
+    core(0),
     lineSize(_lineSize),
     hitLatency(_hitLatency),
     missLatency(_missLatency),
@@ -76,6 +85,15 @@ CacheClass::CacheClass(int sets, int assoc, int _lineSize,
 
   this->stats = proc->get_stats();
 
+	/* No prefetcher until set_prefetcher(). */
+	prefetcher = (prefetcher_t *) NULL;
+	pfMaxDegree = 0;
+	pfVictim.assign(PF_VICTIM_FILTER_SIZE, (reg_t)-1);
+	pf_issued = pf_useful = pf_late = pf_useless = pf_redundant = pf_dropped = pf_pollution = 0;
+	pf_throttle_up = pf_throttle_down = 0;
+	demand_misses = 0;
+	pfi_issued = pfi_useful = pfi_pollution = pfi_misses = 0;
+
   assert(stats);
 
 #if 0
@@ -114,13 +132,14 @@ CacheClass::~CacheClass()
 {
 	delete [] mhsr;
 	delete [] missPortAvail;
+	delete prefetcher;
 
 }
 
 cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
                              cycle_t curCycle, reg_t addr,
                              bool isStore, bool* isHit,
-                             bool probe, bool commit)
+                             bool probe, bool commit, reg_t pc)
 /*------------------------------------------------------------------------*\
  | Access the data cache.  Determines how many cycles access will take.
  |
@@ -134,6 +153,7 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
  |  addr              The address of the word being accessed.
  |  isStore           Indicates whether the access is a store (true) or
  |                     load (false).
+ |  pc                PC of the load or store (0 if unknown).
  |
  | Returns the cycle when the access will complete.  Returns -1 if the
  |  access can not be handled, due to limited miss handleing status
@@ -144,20 +164,18 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
 	reg_t lineAddr;
 	reg_t oldAddr;
 	CacheLineClass* line;
-	CacheLineClass* newLine;
 	int busyMHSR;
 	int newMHSR;
-	int newPort;
-	cycle_t portAvail;
 	cycle_t lineInArray;
+	HOST_PROF_SCOPE(HP_CACHE);
 
 //	assert (curCycle >= lastCycle);
 //	lastCycle = curCycle;
 
 	// ER 11/16/02
 	//lineAddr = addr >> lineSize;
-	assert((Tid < 4) && (lineSize >= 2));
-	lineAddr = ((addr >> lineSize) | (Tid << 30));
+	assert((Tid < MC_MAX_CORES) && (lineSize >= 2));
+	lineAddr = ((addr >> lineSize) | ((reg_t)Tid << 30));
 
 	line = array.lookup(lineAddr, NULL, &hit, &oldAddr, false);
 
@@ -180,6 +198,15 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
 			line->dirty = true;
 		}
 
+		// First demand access to a prefetched line.
+		if (line->prefetched) {
+			line->prefetched = false;
+			pf_useful++;
+			pfi_useful++;
+			if ((line->mhsr != -1) && (mhsr[line->mhsr].resolved > curCycle))
+				pf_late++;
+		}
+
 		// Check if line is currently being loaded (is busy).
 		busyMHSR = line->mhsr;
 		if (busyMHSR != -1) {
@@ -242,16 +269,68 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
 		//	assert(0);
 		//}
 
+		// Was this line evicted by a prefetch?
+		if (prefetcher || pf_issued) {
+			demand_misses++;
+			pfi_misses++;
+			reg_t& victim = pfVictim[lineAddr % PF_VICTIM_FILTER_SIZE];
+			if (victim == lineAddr) {
+				pf_pollution++;
+				pfi_pollution++;
+				victim = (reg_t)-1;
+			}
+		}
+
+		lineInArray = Fill(Tid, curCycle, addr, lineAddr, isStore, newMHSR, commit, false);
+	}
+
+	if (isHit!=NULL) {
+		(*isHit) = (lineInArray == curCycle);
+	}
+
+  //LOG(proc->lsu_log,proc->cycle,uint64_t(0),uint64_t(0),"Executed %s which %s resolve cycle %" PRIcycle "",isStore?"store":"load",isHit?"hit":"miss",(lineInArray+hitLatency));
+
+	// Train the prefetcher and issue its candidates.
+	if (prefetcher && commit) {
+		pfCandidates.clear();
+		prefetcher->train(pc, addr, isStore, hit, pfCandidates);
+		for (size_t i = 0; i < pfCandidates.size(); i++)
+			Prefetch(Tid, curCycle, pfCandidates[i]);
+	}
+
+	return(lineInArray + hitLatency);
+}
+
+cycle_t CacheClass::Fill(unsigned int Tid, cycle_t curCycle, reg_t addr, reg_t lineAddr,
+                         bool isStore, int newMHSR, bool commit, bool prefetch)
+/*------------------------------------------------------------------------*\
+ | Load a missing line using MHSR newMHSR and the next miss port: replace
+ |  the LRU line (writing it back if dirty) and access the next level.
+ |
+ | Returns the cycle when the line is in the array.
+\*------------------------------------------------------------------------*/
+{
+	bool hit;
+	reg_t oldAddr;
+	CacheLineClass* line;
+	CacheLineClass* newLine;
+	int busyMHSR;
+	int newPort;
+	cycle_t portAvail;
+	cycle_t lineInArray;
+
 		// Find the miss port to use for handling the miss.
 		newPort = FindNextPort(curCycle, &portAvail);
 
 		// Allocate a new cache line structure.
+		line = NULL;
 		if (commit) {
 			// Allocate a new cache line structure.
 			newLine = new CacheLineClass;
 			assert(newLine);
 			newLine -> mhsr = newMHSR;
 			newLine -> dirty = isStore;
+			newLine -> prefetched = prefetch;
 
 			// Replace the old line in the cache.
 			line = array.lookup(lineAddr, newLine, &hit, &oldAddr, true);
@@ -269,6 +348,14 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
 
 		// See if line being replaced is itself still being loaded.
 		if (commit && (line !=NULL)) {
+			// Prefetch accounting for the victim.
+			if (line->prefetched) {
+				pf_useless++;
+			}
+			else if (prefetch) {
+				pfVictim[oldAddr % PF_VICTIM_FILTER_SIZE] = oldAddr;
+			}
+
 			busyMHSR = line->mhsr;
 			if (busyMHSR != -1) {
 				// Line being replaced is being loaded.  Must wait until this
@@ -284,7 +371,13 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
 			// See if line is dirty.  Line must be written back, if dirty.
 			if (line->dirty) {
         inc_counter_str((identifier+"_read_access_count").c_str());
-        if(nextLevel == NULL){
+        if(directory){
+          // Writeback of the victim line through the directory.
+				  lineInArray = directory->writeback(core, lineInArray, line_addr(oldAddr, lineSize));
+        } else if((nextLevel == NULL) && (proc->DRAM != NULL)){
+          // Writeback of the victim line to memory.
+				  lineInArray = proc->DRAM->write(lineInArray, (oldAddr << lineSize));
+        } else if(nextLevel == NULL){
 				  lineInArray = lineInArray + missLatency;
         } else {
           // lineInArray is when the next level access will start.
@@ -294,7 +387,7 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
           // Must wait for writeBack to be acknowledged, which happens
           // after accessing the next level. It is assumed that writeback
           // uses a seprate port to next level than the allocate port.
-				  lineInArray = nextLevel->Access(Tid,lineInArray,addr,true,&hit);
+				  lineInArray = AccessNextLevel(Tid,lineInArray,addr,true);
           assert(lineInArray > curCycle);
         }
 			}
@@ -304,7 +397,11 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
 		missPortAvail[newPort] = lineInArray + missSrvLatency;
 
 		// Add miss latency to access time.
-    if(nextLevel == NULL){
+    if(directory){
+  		lineInArray = directory->read(core, lineInArray, addr);
+    } else if((nextLevel == NULL) && (proc->DRAM != NULL)){
+  		lineInArray = proc->DRAM->read(lineInArray, addr);
+    } else if(nextLevel == NULL){
   		lineInArray = lineInArray + missLatency;
     } else {
       // lineInArray is when the next level access will start.
@@ -312,12 +409,8 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
       // as it's access cycle and returns when the line becomes 
       // available for access.
       // This is always a read from the next level as this is a WBWA cache model. 
-  		lineInArray = nextLevel->Access(Tid,lineInArray,addr,false,&hit);
-      // Cannot miss in MHSR in the next level if the next level has
-      // as many or more MHSRs as this level. A miss in this level can
-      // be a hit or a miss in the next level. There can be numMHSR outstanding 
-      // misses in this level and hence fewer than or equal to numMHSR misses
-      // in the next level.
+  		lineInArray = AccessNextLevel(Tid,lineInArray,addr,false);
+      // A miss in this level can be a hit or a miss in the next level.
       assert(lineInArray > curCycle);
     }
 
@@ -333,15 +426,226 @@ cycle_t CacheClass::Access(unsigned int Tid /* ER 11/16/02 */,
 		mhsr[newMHSR].busy = true;
 		mhsr[newMHSR].lineAddress = lineAddr;
     inc_counter_str((identifier+"_write_access_count").c_str());
+
+	return(lineInArray);
+}
+
+cycle_t CacheClass::AccessNextLevel(unsigned int Tid, cycle_t curCycle, reg_t addr, bool isStore)
+/*------------------------------------------------------------------------*\
+ | Access the next level, waiting for one of its MHSRs if all are busy.
+ |  Without prefetching this cannot happen if the next level has as many
+ |  or more MHSRs as this level, but the next level's prefetches also
+ |  occupy its MHSRs.
+\*------------------------------------------------------------------------*/
+{
+	bool hit;
+	cycle_t done;
+	while ((done = nextLevel->Access(Tid, curCycle, addr, isStore, &hit)) == -1) {
+		curCycle = nextLevel->NextFreeMHSR();
 	}
+	return(done);
+}
 
-	if (isHit!=NULL) {
-		(*isHit) = (lineInArray == curCycle);
+bool CacheClass::Prefetch(unsigned int Tid, cycle_t curCycle, reg_t line)
+/*------------------------------------------------------------------------*\
+ | Issue a prefetch for the line (byte address >> lineSize), unless it is
+ |  present or in flight. Prefetches use an MHSR and a miss port like
+ |  demand misses, but leave at least one MHSR free for demand misses.
+\*------------------------------------------------------------------------*/
+{
+	reg_t lineAddr = (line | ((reg_t)Tid << 30));
+
+	if (array.present(lineAddr)) {
+		pf_redundant++;
+		return(true);
 	}
 
-  //LOG(proc->lsu_log,proc->cycle,uint64_t(0),uint64_t(0),"Executed %s which %s resolve cycle %" PRIcycle "",isStore?"store":"load",isHit?"hit":"miss",(lineInArray+hitLatency));
+	if (NumFreeMHSR(curCycle) <= 1) {
+		pf_dropped++;
+		return(false);
+	}
 
-	return(lineInArray + hitLatency);
+	int newMHSR = FindFreeMHSR(curCycle);
+	assert(newMHSR != -1);
+	Fill(Tid, curCycle, (line << lineSize), lineAddr, false, newMHSR, true, true);
+
+	pf_issued++;
+	pfi_issued++;
+	if (prefetcher && PF_THROTTLE && (pfi_issued >= PF_THROTTLE_INTERVAL))
+		Throttle();
+	return(true);
+}
+
+bool CacheClass::IssuePrefetch(unsigned int Tid, cycle_t curCycle, reg_t addr)
+{
+	assert(Tid < MC_MAX_CORES);
+	return(Prefetch(Tid, curCycle, (addr >> lineSize)));
+}
+
+void CacheClass::Warm(unsigned int Tid, reg_t addr, bool isStore)
+{
+	bool hit;
+	reg_t oldAddr;
+	reg_t lineAddr;
+	CacheLineClass* line;
+	CacheLineClass* newLine;
+
+	assert(Tid < MC_MAX_CORES);
+	lineAddr = ((addr >> lineSize) | ((reg_t)Tid << 30));
+
+	line = array.lookup(lineAddr, NULL, &hit, &oldAddr, false);
+	if (hit) {
+		if (isStore)
+			line->dirty = true;
+		return;
+	}
+
+	// Miss: read the line from the next level, and replace the LRU line,
+	// writing it back if dirty.
+	if (directory)
+		directory->warm(core, addr, false);
+	else if (nextLevel)
+		nextLevel->Warm(Tid, addr, false);
+
+	newLine = new CacheLineClass;
+	assert(newLine);
+	newLine -> mhsr = -1;
+	newLine -> mhsrValid = false;
+	newLine -> dirty = isStore;
+	newLine -> prefetched = false;
+
+	line = array.lookup(lineAddr, newLine, &hit, &oldAddr, true);
+	if (line) {
+		if (line->dirty && directory)
+			directory->warm_writeback(core, line_addr(oldAddr, lineSize));
+		else if (line->dirty && nextLevel)
+			nextLevel->Warm(Tid, (oldAddr << lineSize), true);
+		delete line;
+	}
+}
+
+void CacheClass::set_coherence(directory_t* dir, unsigned int core)
+{
+	directory = dir;
+	this->core = core;
+}
+
+void CacheClass::Invalidate(unsigned int Tid, reg_t addr, unsigned int bytes)
+{
+	reg_t first = (addr >> lineSize);
+	reg_t last = ((addr + bytes - 1) >> lineSize);
+
+	for (reg_t l = first; l <= last; l++)
+		delete array.invalidate(l | ((reg_t)Tid << 30));
+}
+
+void CacheClass::Clean(unsigned int Tid, reg_t addr, unsigned int bytes)
+{
+	reg_t first = (addr >> lineSize);
+	reg_t last = ((addr + bytes - 1) >> lineSize);
+	CacheLineClass* line;
+
+	for (reg_t l = first; l <= last; l++) {
+		if ((line = array.peek(l | ((reg_t)Tid << 30))))
+			line->dirty = false;
+	}
+}
+
+void CacheClass::save_warm(std::vector<warm_section_t>& sections)
+{
+	warm_section_t& s = new_warm_section(sections, identifier);
+	s.geometry.push_back(array.size);
+	s.geometry.push_back(array.assoc);
+	s.geometry.push_back(lineSize);
+
+	// Per line: tag, LRU, and flags (1: valid, 2: dirty, 4: prefetched).
+	for (unsigned int set = 0; set < array.size; set++) {
+		for (unsigned int way = 0; way < array.assoc; way++) {
+			CacheLineClass* line = array.get_contents(set, way);
+			s.data.push_back(array.get_tag(set, way));
+			s.data.push_back(array.get_lru(set, way));
+			s.data.push_back(line ? (1 | (line->dirty ? 2 : 0) | (line->prefetched ? 4 : 0)) : 0);
+		}
+	}
+}
+
+bool CacheClass::restore_warm(const warm_section_t& s)
+{
+	if ((s.geometry.size() != 3) || (s.geometry[0] != array.size) || (s.geometry[1] != array.assoc) ||
+	    (s.geometry[2] != (uint64_t)lineSize) || (s.data.size() != (3 * array.size * array.assoc)))
+		return(false);
+
+	size_t i = 0;
+	for (unsigned int set = 0; set < array.size; set++) {
+		for (unsigned int way = 0; way < array.assoc; way++) {
+			CacheLineClass* line = NULL;
+			if (s.data[i+2] & 1) {
+				line = new CacheLineClass;
+				line -> mhsr = -1;
+				line -> mhsrValid = false;
+				line -> dirty = ((s.data[i+2] & 2) != 0);
+				line -> prefetched = ((s.data[i+2] & 4) != 0);
+			}
+			delete array.get_contents(set, way);
+			array.set_entry(set, way, s.data[i], (unsigned int)s.data[i+1], line);
+			i += 3;
+		}
+	}
+	return(true);
+}
+
+void CacheClass::Throttle()
+{
+	double accuracy = (double)pfi_useful / (double)pfi_issued;
+	double pollution = (pfi_misses ? ((double)pfi_pollution / (double)pfi_misses) : 0.0);
+	unsigned int degree = prefetcher->get_degree();
+
+	if ((accuracy < PF_ACCURACY_LOW) || (pollution > PF_POLLUTION_HIGH)) {
+		if (degree > 1) {
+			prefetcher->set_degree(degree / 2);
+			pf_throttle_down++;
+		}
+	}
+	else if (accuracy > PF_ACCURACY_HIGH) {
+		if (degree < pfMaxDegree) {
+			prefetcher->set_degree(degree + 1);
+			pf_throttle_up++;
+		}
+	}
+
+	// Decay, so that recent behavior dominates.
+	pfi_issued /= 2;
+	pfi_useful /= 2;
+	pfi_pollution /= 2;
+	pfi_misses /= 2;
+}
+
+void CacheClass::set_prefetcher(prefetcher_t* pf){
+	delete prefetcher;
+	prefetcher = pf;
+	pfMaxDegree = (pf ? pf->get_degree() : 0);
+}
+
+void CacheClass::dump_stats(FILE* fp){
+	if (!prefetcher && !pf_issued)
+		return;
+
+	if (prefetcher)
+		fprintf(fp, "%s PREFETCHER (%s, degree %u, final degree %u)------------\n",
+		        identifier.c_str(), prefetcher->name(), pfMaxDegree, prefetcher->get_degree());
+	else
+		fprintf(fp, "%s PREFETCHER (fetch-directed)------------\n", identifier.c_str());
+	fprintf(fp, "  issued           = %" PRIu64 "\n", pf_issued);
+	fprintf(fp, "  useful           = %" PRIu64 " (accuracy %.2f%%)\n", pf_useful,
+	        (pf_issued ? 100.0*(double)pf_useful/(double)pf_issued : 0.0));
+	fprintf(fp, "     late          = %" PRIu64 "\n", pf_late);
+	fprintf(fp, "  useless (evicted)= %" PRIu64 "\n", pf_useless);
+	fprintf(fp, "  redundant        = %" PRIu64 "\n", pf_redundant);
+	fprintf(fp, "  dropped (MHSRs)  = %" PRIu64 "\n", pf_dropped);
+	fprintf(fp, "  pollution misses = %" PRIu64 " (%.2f%% of %" PRIu64 " demand misses)\n", pf_pollution,
+	        (demand_misses ? 100.0*(double)pf_pollution/(double)demand_misses : 0.0), demand_misses);
+	if (prefetcher && PF_THROTTLE)
+		fprintf(fp, "  throttle up/down = %" PRIu64 "/%" PRIu64 "\n", pf_throttle_up, pf_throttle_down);
 }
 
 void CacheClass::set_nextLevel(CacheClass* nLevel){
@@ -378,6 +682,27 @@ int CacheClass::FindFreeMHSR(cycle_t curCycle)
 	return(-1);
 }
 
+int CacheClass::NumFreeMHSR(cycle_t curCycle)
+{
+	int n = 0;
+	for (int i=0; i<numMHSR; i++) {
+		if (!mhsr[i].busy || (mhsr[i].resolved < curCycle))
+			n++;
+	}
+	return(n);
+}
+
+/* Earliest cycle at which FindFreeMHSR() will find a free MHSR. */
+cycle_t CacheClass::NextFreeMHSR()
+{
+	cycle_t soonest = mhsr[0].resolved;
+	for (int i=1; i<numMHSR; i++) {
+		if (mhsr[i].resolved < soonest)
+			soonest = mhsr[i].resolved;
+	}
+	return(soonest + 1);
+}
+
 int CacheClass::FindNextPort(cycle_t curCycle, cycle_t* portAvail)
 {
 	int i;
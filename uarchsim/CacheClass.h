@@ -19,15 +19,25 @@
  |  Number of ports to backing store
  |  Backing store port reuse latency
  |
+ | The last level (no next level) uses the DRAM model (dram.h) when the
+ |  pipeline has one, and a flat miss latency otherwise.
+ |
+ | Optional hardware prefetcher (see prefetcher.h), with accuracy- and
+ |  pollution-based throttling of its degree.
+ |
  | Fixed cache parameters:
  |  Replacement policy (LRU)
  |  Write policy (Write Back)
- |  Number of cache ports (unlimited)
+ |  Number of cache ports (unlimited; the LSU arbitrates the L1 D$ ports
+ |   and banks, see lsu::dc_port())
 \*--------------------------------------------------------------------------*/
 #include "decode.h"
 #include "cache.h"
 #include "histogram.h"
+#include "prefetcher.h"
+#include "warm_state.h"
 #include <string.h>
+#include <vector>
 
 /*--------------------------------------------------------------------------*\
  | Miss Handleing Status Register provides multiple outstanding reads and
@@ -48,13 +58,26 @@ public:
 	int mhsr;   /* Index of MHSR that is loading this line.        */
 	bool mhsrValid; /* -1 indicates that the line is not being loaded. */
 	bool dirty; /* Indicates the line is dirty.                    */
+	bool prefetched; /* Brought in by a prefetch and not yet demanded. */
 };
 
+/*--------------------------------------------------------------------------*\
+ | Prefetch throttling: every PF_THROTTLE_INTERVAL issued prefetches, the
+ |  degree is halved if accuracy or pollution is poor, and incremented (up
+ |  to the configured degree) if accuracy is good.
+\*--------------------------------------------------------------------------*/
+#define PF_THROTTLE_INTERVAL   256
+#define PF_ACCURACY_HIGH       0.75
+#define PF_ACCURACY_LOW        0.40
+#define PF_POLLUTION_HIGH      0.05   /* demand misses caused by prefetch evictions */
+#define PF_VICTIM_FILTER_SIZE  1024   /* lines evicted by prefetches, for pollution */
+
 typedef cache<CacheLineClass> CacheArray;
 
 //Forward declaring class
 class pipeline_t;
 class stats_t;
+class directory_t;
 
 class CacheClass {
 public:
@@ -94,7 +117,8 @@ public:
 
 	cycle_t Access(unsigned int Tid /* ER 11/16/02 */,
 	               cycle_t curCycle, reg_t addr, bool isStore,
-	               bool* hit=NULL, bool probe=false, bool commit=true);
+	               bool* hit=NULL, bool probe=false, bool commit=true,
+	               reg_t pc=0);
 	/*------------------------------------------------------------------------*\
 	 | Access the data cache.  Determines how many cycles access will take.
 	 |
@@ -103,6 +127,8 @@ public:
 	 |  addr              The address of the word being accessed.
 	 |  isStore           Indicates whether the access is a store (true) or
 	 |                     load (false).
+	 |  pc                PC of the load or store, for PC-indexed prefetchers
+	 |                     (0 if not from an instruction).
 	 |
 	 | Returns the cycle when the access will complete.  Returns -1 if the
 	 |  access can not be handled, due to limited miss handleing status
@@ -110,16 +136,59 @@ public:
 	\*------------------------------------------------------------------------*/
 
 	bool Probe(unsigned int Tid,cycle_t curCycle, reg_t addr1, unsigned int length);
+	bool Present(reg_t addr) { return array.present(addr >> lineSize); }   /* Thread id 0; no LRU update or stats. */
 	HistogramClass* accessLatency;
 	void set_nextLevel(CacheClass* nLevel);
+	void set_prefetcher(prefetcher_t* pf);   /* Takes ownership. */
+	void dump_stats(FILE* fp);
+	cycle_t NextFreeMHSR();   /* Earliest cycle an access can get an MHSR, when Access() returns -1. */
+	bool IssuePrefetch(unsigned int Tid, cycle_t curCycle, reg_t addr);
+	/*------------------------------------------------------------------------*\
+	 | Prefetch the line containing addr on behalf of an outside agent (e.g.,
+	 |  the fetch unit's FDIP). Returns false if it was dropped for lack of an
+	 |  MHSR, true if it was issued or the line is already present/in flight.
+	\*------------------------------------------------------------------------*/
+	void Warm(unsigned int Tid, reg_t addr, bool isStore);
+	/*------------------------------------------------------------------------*\
+	 | Functional access for warming during fast-skip: update LRU and dirty
+	 |  state, and on a miss, fill the line (and the next levels) at once.
+	 |  No timing, MHSRs, prefetches or stats.
+	\*------------------------------------------------------------------------*/
+	void set_coherence(directory_t* dir, unsigned int core);
+	/*------------------------------------------------------------------------*\
+	 | Multi-core (see coherence.h): the misses and dirty evictions of this
+	 |  private last level go to the directory instead of the next level.
+	\*------------------------------------------------------------------------*/
+	void Invalidate(unsigned int Tid, reg_t addr, unsigned int bytes);
+	void Clean(unsigned int Tid, reg_t addr, unsigned int bytes);
+	/*------------------------------------------------------------------------*\
+	 | Coherence actions on the lines of [addr, addr+bytes): remove them, or
+	 |  clear their dirty bits (the directory has the data written back).
+	\*------------------------------------------------------------------------*/
+	void save_warm(std::vector<warm_section_t>& sections);
+	bool restore_warm(const warm_section_t& section);
+	const std::string& name() { return identifier; }
+	/*------------------------------------------------------------------------*\
+	 | Save or restore the tags, LRU, dirty and prefetched bits (see
+	 |  warm_state.h). restore_warm() returns false, and leaves the cache as it
+	 |  is, if the section's geometry differs.
+	\*------------------------------------------------------------------------*/
 private:
 
   pipeline_t* proc;
 	int FindFreeMHSR(cycle_t curCycle);
 	int FindNextPort(cycle_t curCycle, cycle_t* portAvail);
+	int NumFreeMHSR(cycle_t curCycle);
+	cycle_t AccessNextLevel(unsigned int Tid, cycle_t curCycle, reg_t addr, bool isStore);
+	cycle_t Fill(unsigned int Tid, cycle_t curCycle, reg_t addr, reg_t lineAddr,
+	             bool isStore, int newMHSR, bool commit, bool prefetch);
+	bool Prefetch(unsigned int Tid, cycle_t curCycle, reg_t line);
+	void Throttle();
 
 	CacheArray  array;          /* The D-Cache array.                           */
-  CacheClass* nextLevel; 
+  CacheClass* nextLevel;
+	directory_t* directory;      /* Multi-core: coherent private last level.     */
+	unsigned int core;           /* ...this cache's core.                        */
   std::string identifier;
 	int         lineSize;        /* D-Cache line size.  Must be a power of 2.    */
 //	cycle_t     lastCycle;         /* curCycle of last access.                     */
@@ -135,6 +204,24 @@ private:
 
   stats_t* stats;
 
+	/* Prefetcher. */
+	prefetcher_t* prefetcher;
+	unsigned int  pfMaxDegree;       /* Configured degree: the throttle's ceiling. */
+	std::vector<reg_t> pfCandidates;
+	std::vector<reg_t> pfVictim;     /* Demand lines evicted by prefetches. */
+	uint64_t pf_issued;              /* Prefetches sent to the next level.        */
+	uint64_t pf_useful;              /* Prefetched lines later demanded.          */
+	uint64_t pf_late;                /* ...but demanded while still being loaded. */
+	uint64_t pf_useless;             /* Prefetched lines evicted before use.      */
+	uint64_t pf_redundant;           /* Candidates already present or in flight.  */
+	uint64_t pf_dropped;             /* Candidates dropped for lack of an MHSR.   */
+	uint64_t pf_pollution;           /* Demand misses to lines evicted by prefetches. */
+	uint64_t pf_throttle_up;
+	uint64_t pf_throttle_down;
+	uint64_t demand_misses;
+	/* Throttle interval counters. */
+	uint64_t pfi_issued, pfi_useful, pfi_pollution, pfi_misses;
+
 };
 
 #endif //DCACHE_H
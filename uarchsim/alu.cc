@@ -52,5 +52,8 @@ void pipeline_t::alu(unsigned int index) {
 	insn_t insn = pay_buf.inst;
   auto alu_op_fn = alu_ops.get_alu_op_fn(insn);
   state_t& state = *get_state();
-  alu_op_fn(pay_buf, state);
+  if (pay_buf.fused != FUSE_NONE)
+    alu_ops.execute_fused(pay_buf, PAY.buf[MOD_S(index + 2, PAY.get_size())], state);
+  else
+    alu_op_fn(pay_buf, state);
 }
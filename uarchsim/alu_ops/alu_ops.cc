@@ -33,6 +33,20 @@ alu_op_func_t alu_ops_t::get_alu_op_fn(insn_t insn) {
   return desc->alu_op_fn;
 }
 
+void alu_ops_t::execute_fused(payload_t &head, payload_t &tail, const state_t &state) {
+  unsigned int rd = head.C_log_reg;
+
+  get_alu_op_fn(head.inst)(head, state);
+  head.fused_value = head.C_value.dw;
+
+  // The tail reads the head's result, and its other source from the head's register B.
+  tail.A_value.dw = ((tail.A_valid && (tail.A_log_reg == rd)) ? head.fused_value : head.B_value.dw);
+  tail.B_value.dw = ((tail.B_valid && (tail.B_log_reg == rd)) ? head.fused_value : head.B_value.dw);
+  get_alu_op_fn(tail.inst)(tail, state);
+
+  head.C_value = tail.C_value;
+}
+
 void alu_ops_t::register_insn(alu_op_desc_t desc) {
   assert(desc.mask & 1);
   instructions.push_back(desc);
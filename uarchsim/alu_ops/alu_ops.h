@@ -26,6 +26,11 @@ public:
 
   alu_op_func_t get_alu_op_fn(insn_t insn);
 
+  // Execute a fused pair (see decode): the head's op, then the tail's op with the
+  // head's result forwarded to it. Both payloads get the pair's result (C_value);
+  // the head's own result is kept in its 'fused_value'.
+  void execute_fused(payload_t &head, payload_t &tail, const state_t &state);
+
   void register_insn(alu_op_desc_t desc);
 
   void build_opcode_map();
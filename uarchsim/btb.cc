@@ -7,6 +7,7 @@
 #include "config.h"
 
 #include "fetchunit_types.h"
+#include "warm_state.h"
 #include "btb.h"
 
 
@@ -277,6 +278,82 @@ void btb_t::invalidate(uint64_t pc, uint64_t pos) {
    btb[btb_bank][set][way].lru = assoc - 1;
 }
 
+//
+// pc: The start pc of the fetch bundle.
+// pos: The position of the instruction in the fetch bundle.
+// branch: Whether or not the instruction is a branch.
+//
+// Role of this function: Functional warming during fast-skip (see fetchunit_t::warm()).
+// Train the BTB the way the Fetch2 stage would after the bundle was fetched: a branch is added or its entry is made MRU,
+// and a stale entry for a non-branch is invalidated.
+//
+void btb_t::warm(uint64_t pc, uint64_t pos, insn_t insn, bool branch) {
+   uint64_t btb_bank;
+   uint64_t btb_pc;
+   uint64_t set;
+   uint64_t way;
+   uint64_t target;
+   btb_branch_type_e branch_type;
+
+   convert(pc, pos, btb_bank, btb_pc);	// convert {pc, pos} to {btb_bank, btb_pc}
+   bool btb_hit = search(btb_bank, btb_pc, set, way);
+
+   if (!branch) {
+      if (btb_hit)
+         invalidate(pc, pos);
+      return;
+   }
+
+   branch_type = btb_t::decode(insn, (pc + (pos << 2)), target);
+   if (btb_hit &&
+       (btb[btb_bank][set][way].branch_type == branch_type) &&
+       ((insn.opcode() == OP_JALR) || (btb[btb_bank][set][way].target == target)))
+      update_lru(btb_bank, set, way);
+   else
+      update(pc, pos, insn);
+}
+
+// Save or restore all entries, including their LRU state (see warm_state.h).
+void btb_t::save_warm(std::vector<warm_section_t>& sections) {
+   warm_section_t& s = new_warm_section(sections, "btb");
+   s.geometry.push_back(banks);
+   s.geometry.push_back(sets);
+   s.geometry.push_back(assoc);
+
+   for (uint64_t b = 0; b < banks; b++) {
+      for (uint64_t set = 0; set < sets; set++) {
+         for (uint64_t way = 0; way < assoc; way++) {
+            s.data.push_back(btb[b][set][way].valid);
+            s.data.push_back(btb[b][set][way].tag);
+            s.data.push_back(btb[b][set][way].lru);
+            s.data.push_back(btb[b][set][way].branch_type);
+            s.data.push_back(btb[b][set][way].target);
+         }
+      }
+   }
+}
+
+bool btb_t::restore_warm(const warm_section_t& s) {
+   if ((s.geometry.size() != 3) || (s.geometry[0] != banks) || (s.geometry[1] != sets) || (s.geometry[2] != assoc) ||
+       (s.data.size() != (5 * banks * sets * assoc)))
+      return(false);
+
+   size_t i = 0;
+   for (uint64_t b = 0; b < banks; b++) {
+      for (uint64_t set = 0; set < sets; set++) {
+         for (uint64_t way = 0; way < assoc; way++) {
+            btb[b][set][way].valid = (s.data[i] != 0);
+            btb[b][set][way].tag = s.data[i+1];
+            btb[b][set][way].lru = s.data[i+2];
+            btb[b][set][way].branch_type = (btb_branch_type_e) s.data[i+3];
+            btb[b][set][way].target = s.data[i+4];
+            i += 5;
+         }
+      }
+   }
+   return(true);
+}
+
 ////////////////////////////////////
 // Private utility functions.
 ////////////////////////////////////
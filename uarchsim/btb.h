@@ -44,5 +44,8 @@ public:
         void lookup(uint64_t pc, uint64_t cb_predictions, uint64_t ib_predicted_target, uint64_t ras_predicted_target, fetch_bundle_t bundle[], spec_update_t *update);
 	void update(uint64_t pc, uint64_t pos, insn_t insn);
 	void invalidate(uint64_t pc, uint64_t pos);
+	void warm(uint64_t pc, uint64_t pos, insn_t insn, bool branch);
+	void save_warm(std::vector<warm_section_t>& sections);
+	bool restore_warm(const warm_section_t& section);
 	static btb_branch_type_e decode(insn_t insn, uint64_t pc, uint64_t &target);
 };
@@ -100,6 +100,49 @@ public:
 	          bool replace,
 	          bool use_raw_index = false,
 	          unsigned int raw_index = 0);
+
+	// Direct access to an entry, e.g., for saving and restoring the cache's state.
+	reg_t get_tag(unsigned int set, unsigned int way) { return(C[set][way].tag); }
+	unsigned int get_lru(unsigned int set, unsigned int way) { return(C[set][way].lru); }
+	T* get_contents(unsigned int set, unsigned int way) { return(C[set][way].contents); }
+	void set_entry(unsigned int set, unsigned int way, reg_t tag, unsigned int lru, T* contents) {
+		C[set][way].tag = tag;
+		C[set][way].lru = lru;
+		C[set][way].contents = contents;
+	}
+
+	// Check whether the object is present, without updating LRU state.
+	bool present(reg_t id) {
+		entry* set = C[MOD(id, size)];
+		for (unsigned int i = 0; i < assoc; i++)
+			if (set[i].tag == id)
+				return(true);
+		return(false);
+	}
+
+	// The object's contents, without updating LRU state (NULL if not present).
+	T* peek(reg_t id) {
+		entry* set = C[MOD(id, size)];
+		for (unsigned int i = 0; i < assoc; i++)
+			if (set[i].tag == id)
+				return(set[i].contents);
+		return((T*)NULL);
+	}
+
+	// Remove the object, e.g., for a coherence invalidation. Returns its
+	// contents, for the caller to free (NULL if not present).
+	T* invalidate(reg_t id) {
+		entry* set = C[MOD(id, size)];
+		for (unsigned int i = 0; i < assoc; i++) {
+			if (set[i].tag == id) {
+				T* contents = set[i].contents;
+				set[i].tag = INVALID;
+				set[i].contents = (T*)NULL;
+				return(contents);
+			}
+		}
+		return((T*)NULL);
+	}
 };
 
 
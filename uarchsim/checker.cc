@@ -57,7 +57,93 @@ void pipeline_t::check_state(state_t* micro_state, state_t* isa_state, db_t* act
    }
 }
 
+///////////////////////////////////////////////////////////////////////
+// Checker policies.
+//
+// CHECKER_PERIODIC: fully check the retiring instruction if it falls on
+// a checking boundary (every CHECKER_INTERVAL instructions, or every
+// phase if CHECKER_INTERVAL is 0).
+//
+// CHECKER_SIGNATURE: fold the operands that the full checker would
+// compare into two rolling signatures, one from the pipeline and one
+// from the functional simulator, and compare them every
+// CHECKER_INTERVAL instructions (or every phase).  A mismatch only
+// identifies the window of instructions: rerun with --checker=full
+// to find the offending instruction.
+//
+// No policy, not even CHECKER_OFF, stops the functional simulator
+// from stepping in lockstep with retirement: the oracle (fetch's
+// wrong-path marking, rename's checkpoint placement, perfect branch
+// prediction and disambiguation) reads its debug buffer entries. The
+// lighter policies only save the per-instruction architectural state
+// snapshot and the comparisons. Only --nooracle drops the functional
+// simulator.
+///////////////////////////////////////////////////////////////////////
+
+#define CHECKER_SIG_FOLD(sig,v)	((sig) = (((sig) ^ (uint64_t)(v)) * 0x100000001b3ULL))
+
+static inline uint64_t checker_interval() {
+   return(CHECKER_INTERVAL ? CHECKER_INTERVAL : phase_interval);
+}
+
+bool pipeline_t::check_sample() {
+   uint64_t interval = checker_interval();
+   return((interval == 0) || ((num_insn % interval) == 0));
+}
+
+void pipeline_t::check_signature_fold(db_t* actual) {
+   unsigned int head = PAY.head;
+
+   if (chk_sig_count == 0)
+      chk_sig_start = num_insn;
+
+   CHECKER_SIG_FOLD(chk_sig_micro, PAY.buf[head].pc);
+   CHECKER_SIG_FOLD(chk_sig_isa, actual->a_pc);
+
+   if (actual->a_exception) {
+      CHECKER_SIG_FOLD(chk_sig_micro, REN->get_exception(PAY.buf[head].chkpt_id));
+      CHECKER_SIG_FOLD(chk_sig_isa, true);
+   }
+   else if (!PAY.buf[head].split && (PAY.buf[head].elim == ELIM_NONE)) {
+      if (IS_MEM_OP(PAY.buf[head].flags)) {
+         CHECKER_SIG_FOLD(chk_sig_micro, PAY.buf[head].addr);
+         CHECKER_SIG_FOLD(chk_sig_isa, actual->a_addr);
+         if (IS_LOAD(PAY.buf[head].flags)) {
+            CHECKER_SIG_FOLD(chk_sig_micro, PAY.buf[head].C_value.dw);
+            CHECKER_SIG_FOLD(chk_sig_isa, actual->a_rdst[0].value);
+         }
+      }
+      else if (actual->a_num_rdst > 0) {
+         // The head of a fused pair holds the pair's result; its own is 'fused_value'.
+         CHECKER_SIG_FOLD(chk_sig_micro, ((PAY.buf[head].fused != FUSE_NONE) ? PAY.buf[head].fused_value : PAY.buf[head].C_value.dw));
+         CHECKER_SIG_FOLD(chk_sig_isa, actual->a_rdst[0].value);
+      }
+   }
+
+   chk_sig_count++;
+   if (chk_sig_count >= checker_interval())
+      check_signature();
+}
+
+void pipeline_t::check_signature() {
+   if (chk_sig_count == 0)
+      return;
+
+   inc_counter(checker_signature_count);
+   if (chk_sig_micro != chk_sig_isa) {
+      printf("Instructions %.0f-%.0f, Cycle %.0f: Retire signature mismatch. Pipeline:%016" PRIx64 " vs. isaSim:%016" PRIx64 ".\n",
+             (double)chk_sig_start, (double)(chk_sig_start + chk_sig_count - 1), (double)cycle, chk_sig_micro, chk_sig_isa);
+      printf("Rerun with --checker=full to locate the offending instruction.\n");
+      assert(0);
+   }
+
+   chk_sig_micro = CHECKER_SIG_BASIS;
+   chk_sig_isa = CHECKER_SIG_BASIS;
+   chk_sig_count = 0;
+}
+
 void pipeline_t::checker() {
+   HOST_PROF_SCOPE(HP_CHECKER);
 
    #ifdef RISCV_MICRO_DEBUG
     fflush(0);
@@ -66,6 +152,10 @@ void pipeline_t::checker() {
 	 unsigned int head;	// Index of the head instruction in PAY.
 	 db_t *actual;		// Pointer to corresponding instruction in the functional simulator.
 
+	 // Nothing to check against without the functional simulator.
+	 if (!FUNCTIONAL_ORACLE)
+	    return;
+
 	 // Get the index of the head instruction in PAY.
 	 head = PAY.head;
 
@@ -78,6 +168,20 @@ void pipeline_t::checker() {
 	 else
 	    actual = pipe->pop(PAY.buf[head].db_index);
 
+	 // Apply the checker policy.
+	 // The debug buffer entry was consumed above regardless of the policy,
+	 // so the functional simulator stays in lockstep with retirement.
+	 if (CHECKER_POLICY == CHECKER_OFF)
+	    return;
+	 if (CHECKER_POLICY == CHECKER_SIGNATURE) {
+	    check_signature_fold(actual);
+	    return;
+	 }
+	 if ((CHECKER_POLICY == CHECKER_PERIODIC) && !check_sample())
+	    return;
+
+	 inc_counter(checker_full_count);
+
 	 // Validate the instruction PC.
 	 check_single(PAY.buf[head].pc, actual->a_pc, actual, "PC mismatch.");
 
@@ -92,7 +196,11 @@ void pipeline_t::checker() {
    }
    // If not an architectural exception
    else{
-	   if (PAY.buf[head].split) {
+	   if (PAY.buf[head].elim != ELIM_NONE) {
+	      // An eliminated move or zero idiom never reads or writes registers: its
+	      // shared destination mapping is validated by its consumers' source operands.
+	   }
+	   else if (PAY.buf[head].split) {
 	      switch (PAY.buf[head].inst.opcode()) {
 
 	         default:
@@ -170,7 +278,9 @@ void pipeline_t::checker() {
 	            }
 	            if (actual->a_num_rdst > 0) {
 	               // Validate destination register.
-	               check_single(PAY.buf[head].C_value.dw, actual->a_rdst[0].value, actual, "Destination mismatch.");
+	               // The head of a fused pair holds the pair's result; its own is 'fused_value'.
+	               check_single(((PAY.buf[head].fused != FUSE_NONE) ? PAY.buf[head].fused_value : PAY.buf[head].C_value.dw),
+	                            actual->a_rdst[0].value, actual, "Destination mismatch.");
 	            }
 	            break;
 	      }
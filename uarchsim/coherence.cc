@@ -0,0 +1,317 @@
+#include <cassert>
+#include <algorithm>
+
+#include "coherence.h"
+#include "CacheClass.h"
+#include "pipeline.h"
+
+
+directory_t::directory_t(CacheClass* l3, unsigned int line_size) {
+	this->l3 = l3;
+	this->line_size = line_size;
+	bank_free.assign(COH_L3_BANKS, 0);
+
+	for (unsigned int c = 0; c < MC_MAX_CORES; c++) {
+		n_read[c] = n_fwd[c] = n_write[c] = n_upgrade[c] = n_amo[c] = 0;
+		n_inv_sent[c] = n_inv_recv[c] = n_fwd_supplied[c] = n_writeback[c] = 0;
+		n_lost_rsv[c] = n_coh_cycles[c] = 0;
+	}
+	n_bank_conflict = 0;
+	n_bank_cycles = 0;
+	buffered = false;
+}
+
+directory_t::~directory_t() {
+}
+
+void directory_t::add_core(pipeline_t* core) {
+	assert(cores.size() < MC_MAX_CORES);
+	assert(core->Tid == cores.size());
+	cores.push_back(core);
+}
+
+// The L3 bank of the line is busy for COH_BANK_BUSY cycles per access.
+cycle_t directory_t::l3_access(cycle_t cycle, reg_t addr, bool store) {
+	unsigned int bank = (unsigned int)((addr >> line_size) % COH_L3_BANKS);
+	cycle_t start = std::max(cycle, bank_free[bank]);
+	cycle_t done;
+	bool hit;
+
+	if (start > cycle) {
+		n_bank_conflict++;
+		n_bank_cycles += (start - cycle);
+	}
+	bank_free[bank] = (start + COH_BANK_BUSY);
+
+	// The L3 is shared: no thread id is folded into its line addresses.
+	while ((done = l3->Access(0, start, addr, store, &hit)) == -1)
+		start = l3->NextFreeMHSR();
+	return(done);
+}
+
+// Invalidate the line in the 'sharers' other than 'core'.
+void directory_t::invalidate(unsigned int core, reg_t addr, uint32_t sharers) {
+	for (unsigned int c = 0; c < cores.size(); c++) {
+		if ((c != core) && (sharers & (1U << c))) {
+			cores[c]->coherence_invalidate(addr, (1 << line_size));
+			n_inv_sent[core]++;
+			n_inv_recv[c]++;
+		}
+	}
+}
+
+// The owner of an E or M line keeps a clean shared copy. An M line is written back to the L3.
+void directory_t::downgrade(reg_t addr, dir_entry_t& e) {
+	unsigned int owner = 0;
+
+	while (!(e.sharers & (1U << owner)))
+		owner++;
+	cores[owner]->coherence_downgrade(addr, (1 << line_size));
+	if (e.state == COH_M)
+		l3->Warm(0, addr, true);
+	n_fwd_supplied[owner]++;
+	e.state = COH_S;
+}
+
+cycle_t directory_t::read(unsigned int core, cycle_t cycle, reg_t addr) {
+	return(buffered ? buffer_read(core, cycle, addr) : do_read(core, cycle, addr, true));
+}
+
+cycle_t directory_t::write(unsigned int core, cycle_t cycle, reg_t addr, bool amo) {
+	return(buffered ? buffer_write(core, cycle, addr, amo) : do_write(core, cycle, addr, amo, true));
+}
+
+cycle_t directory_t::writeback(unsigned int core, cycle_t cycle, reg_t addr) {
+	return(buffered ? buffer_writeback(core, cycle, addr) : do_writeback(core, cycle, addr));
+}
+
+cycle_t directory_t::do_read(unsigned int core, cycle_t cycle, reg_t addr, bool timed) {
+	dir_entry_t& e = dir[addr >> line_size];   // I, with no sharers, if new
+	uint32_t me = (1U << core);
+	cycle_t t = (cycle + COH_DIR_LATENCY);
+	cycle_t done;
+
+	n_read[core]++;
+	if (((e.state == COH_E) || (e.state == COH_M)) && (e.sharers != me)) {
+		// Cache-to-cache transfer: to the owner and back.
+		downgrade(addr, e);
+		n_fwd[core]++;
+		if (timed)
+			n_coh_cycles[core] += (COH_DIR_LATENCY + (2 * COH_HOP_LATENCY));
+		done = (t + (2 * COH_HOP_LATENCY));
+	}
+	else {
+		if (timed)
+			n_coh_cycles[core] += COH_DIR_LATENCY;
+		done = l3_access(t, addr, false);
+		if (e.state != COH_M)
+			e.state = ((e.sharers & ~me) ? COH_S : COH_E);
+	}
+	e.sharers |= me;
+	return(done);
+}
+
+cycle_t directory_t::do_write(unsigned int core, cycle_t cycle, reg_t addr, bool amo, bool timed) {
+	dir_entry_t& e = dir[addr >> line_size];
+	uint32_t me = (1U << core);
+	cycle_t t = (cycle + COH_DIR_LATENCY);
+
+	// E to M is silent.
+	if (((e.state == COH_E) || (e.state == COH_M)) && (e.sharers == me)) {
+		e.state = COH_M;
+		return(cycle);
+	}
+
+	n_write[core]++;
+	if (amo)
+		n_amo[core]++;
+	if (e.sharers & me)
+		n_upgrade[core]++;
+	if (e.sharers & ~me) {
+		// Invalidate the other copies, and wait for their acknowledgments.
+		invalidate(core, addr, e.sharers);
+		t += (2 * COH_HOP_LATENCY);
+	}
+	e.state = COH_M;
+	e.sharers = me;
+	if (timed)
+		n_coh_cycles[core] += (t - cycle);
+	return(t);
+}
+
+cycle_t directory_t::do_writeback(unsigned int core, cycle_t cycle, reg_t addr) {
+	auto it = dir.find(addr >> line_size);
+
+	n_writeback[core]++;
+	if (it != dir.end()) {
+		it->second.sharers &= ~(1U << core);
+		if (!it->second.sharers)
+			dir.erase(it);
+		else if (it->second.state != COH_S)
+			it->second.state = COH_S;
+	}
+	return(l3_access(cycle, addr, true));
+}
+
+// An L3 access, without bank conflicts, MHSRs or DRAM queues (the L3 is only read).
+cycle_t directory_t::l3_estimate(reg_t addr) {
+	if (l3->Present(addr))
+		return(L3_HIT_LATENCY);
+	return(L3_HIT_LATENCY + (DRAM_PRESENT ? (DRAM_CTRL_LATENCY + DRAM_tRCD + DRAM_tCAS) : L3_MISS_LATENCY));
+}
+
+cycle_t directory_t::buffer_read(unsigned int core, cycle_t cycle, reg_t addr) {
+	reg_t line = (addr >> line_size);
+	uint32_t me = (1U << core);
+	auto it = dir.find(line);
+	bool others = ((it != dir.end()) && (it->second.sharers & ~me));
+	auto h = held[core].find(line);
+
+	requests[core].push_back({cycle, core, REQ_READ, addr, false});
+	if (h == held[core].end())
+		held[core][line] = (others ? COH_S : COH_E);
+
+	if (others && ((it->second.state == COH_E) || (it->second.state == COH_M))) {
+		n_coh_cycles[core] += (COH_DIR_LATENCY + (2 * COH_HOP_LATENCY));
+		return(cycle + COH_DIR_LATENCY + (2 * COH_HOP_LATENCY));
+	}
+	n_coh_cycles[core] += COH_DIR_LATENCY;
+	return(cycle + COH_DIR_LATENCY + l3_estimate(addr));
+}
+
+cycle_t directory_t::buffer_write(unsigned int core, cycle_t cycle, reg_t addr, bool amo) {
+	reg_t line = (addr >> line_size);
+	uint32_t me = (1U << core);
+	auto it = dir.find(line);
+	auto h = held[core].find(line);
+	coh_state_e state = ((h != held[core].end()) ? h->second :
+	                     ((it != dir.end()) && (it->second.sharers == me)) ? it->second.state : COH_I);
+	cycle_t t = (cycle + COH_DIR_LATENCY);
+
+	if (state == COH_M)
+		return(cycle);
+	requests[core].push_back({cycle, core, REQ_WRITE, addr, amo});
+	held[core][line] = COH_M;
+
+	// E to M is silent.
+	if (state == COH_E)
+		return(cycle);
+	if ((it != dir.end()) && (it->second.sharers & ~me))
+		t += (2 * COH_HOP_LATENCY);
+	n_coh_cycles[core] += (t - cycle);
+	return(t);
+}
+
+cycle_t directory_t::buffer_writeback(unsigned int core, cycle_t cycle, reg_t addr) {
+	held[core].erase(addr >> line_size);
+	requests[core].push_back({cycle, core, REQ_WRITEBACK, addr, false});
+	return(cycle + l3_estimate(addr));
+}
+
+uint64_t directory_t::apply() {
+	std::vector<request_t> all;
+	uint64_t before = 0, after = 0;
+	unsigned int c;
+
+	for (c = 0; c < cores.size(); c++) {
+		before += (n_inv_sent[c] + n_fwd[c]);
+		all.insert(all.end(), requests[c].begin(), requests[c].end());
+		requests[c].clear();
+		held[c].clear();
+	}
+
+	// Cycle order, then core order (stable: ties keep each core's request order).
+	std::stable_sort(all.begin(), all.end(), [](const request_t& a, const request_t& b) {
+		return((a.cycle < b.cycle) || ((a.cycle == b.cycle) && (a.core < b.core)));
+	});
+	for (const request_t& r : all) {
+		if (r.type == REQ_READ)
+			do_read(r.core, r.cycle, r.addr, false);
+		else if (r.type == REQ_WRITE)
+			do_write(r.core, r.cycle, r.addr, r.amo, false);
+		else
+			do_writeback(r.core, r.cycle, r.addr);
+	}
+
+	for (c = 0; c < cores.size(); c++)
+		after += (n_inv_sent[c] + n_fwd[c]);
+	return(after - before);
+}
+
+void directory_t::warm(unsigned int core, reg_t addr, bool write) {
+	dir_entry_t& e = dir[addr >> line_size];
+	uint32_t me = (1U << core);
+
+	if (write) {
+		if (e.sharers & ~me)
+			invalidate(core, addr, e.sharers);
+		e.state = COH_M;
+		e.sharers = me;
+		return;
+	}
+
+	if (((e.state == COH_E) || (e.state == COH_M)) && (e.sharers != me))
+		downgrade(addr, e);
+	else if (e.state != COH_M)
+		e.state = ((e.sharers & ~me) ? COH_S : COH_E);
+	e.sharers |= me;
+	l3->Warm(0, addr, false);
+}
+
+void directory_t::warm_writeback(unsigned int core, reg_t addr) {
+	auto it = dir.find(addr >> line_size);
+
+	if (it != dir.end()) {
+		it->second.sharers &= ~(1U << core);
+		if (!it->second.sharers)
+			dir.erase(it);
+		else
+			it->second.state = COH_S;
+	}
+	l3->Warm(0, addr, true);
+}
+
+void directory_t::dump_core_stats(unsigned int core, FILE* fp) {
+	fprintf(fp, "COHERENCE MEASUREMENTS-----------------------------\n");
+	fprintf(fp, "  core             = %u of %u\n", core, (unsigned int)cores.size());
+	fprintf(fp, "  L2 misses        = %" PRIu64 "\n", n_read[core]);
+	fprintf(fp, "     forwarded     = %" PRIu64 " (from another core's cache)\n", n_fwd[core]);
+	fprintf(fp, "  write requests   = %" PRIu64 " (not silent)\n", n_write[core]);
+	fprintf(fp, "     upgrades      = %" PRIu64 " (from S)\n", n_upgrade[core]);
+	fprintf(fp, "     AMO/SC        = %" PRIu64 "\n", n_amo[core]);
+	fprintf(fp, "  invalidations    = %" PRIu64 " sent, %" PRIu64 " received\n", n_inv_sent[core], n_inv_recv[core]);
+	fprintf(fp, "  lines supplied   = %" PRIu64 " (to other cores)\n", n_fwd_supplied[core]);
+	fprintf(fp, "  writebacks       = %" PRIu64 "\n", n_writeback[core]);
+	fprintf(fp, "  lost reservations= %" PRIu64 "\n", n_lost_rsv[core]);
+	fprintf(fp, "  coherence cycles = %" PRIu64 " (directory and hops)\n", n_coh_cycles[core]);
+}
+
+void directory_t::dump_stats(FILE* fp) {
+	uint64_t insn = 0;
+	uint64_t sum[11] = {0};
+	cycle_t cycles = 0;
+	unsigned int c;
+
+	fprintf(fp, "MULTI-CORE MEASUREMENTS----------------------------\n");
+	fprintf(fp, "  %-4s %12s %12s %6s %10s %10s %10s %10s %8s %10s %10s %10s %10s %8s\n",
+	        "core", "instr", "cycles", "IPC", "L2 misses", "forwarded", "writes", "upgrades", "AMO/SC",
+	        "inv sent", "inv recv", "supplied", "writebacks", "lost rsv");
+	for (c = 0; c < cores.size(); c++) {
+		uint64_t row[11] = {n_read[c], n_fwd[c], n_write[c], n_upgrade[c], n_amo[c],
+		                    n_inv_sent[c], n_inv_recv[c], n_fwd_supplied[c], n_writeback[c], n_lost_rsv[c], n_coh_cycles[c]};
+		fprintf(fp, "  %-4u %12" PRIu64 " %12" PRIu64 " %6.2f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %8" PRIu64 "\n",
+		        c, cores[c]->num_insn, (uint64_t)cores[c]->cycle,
+		        (cores[c]->cycle ? ((double)cores[c]->num_insn / (double)cores[c]->cycle) : 0.0),
+		        row[0], row[1], row[2], row[3], row[4], row[5], row[6], row[7], row[8], row[9]);
+		for (unsigned int i = 0; i < 11; i++)
+			sum[i] += row[i];
+		insn += cores[c]->num_insn;
+		cycles = std::max(cycles, cores[c]->cycle);
+	}
+	fprintf(fp, "  %-4s %12" PRIu64 " %12" PRIu64 " %6.2f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %8" PRIu64 "\n",
+	        "all", insn, (uint64_t)cycles, (cycles ? ((double)insn / (double)cycles) : 0.0),
+	        sum[0], sum[1], sum[2], sum[3], sum[4], sum[5], sum[6], sum[7], sum[8], sum[9]);
+	fprintf(fp, "  coherence cycles = %" PRIu64 " (directory and hops, all cores)\n", sum[10]);
+	fprintf(fp, "  directory entries= %lu (at the end)\n", (unsigned long)dir.size());
+	fprintf(fp, "  L3 bank conflicts= %" PRIu64 " (%" PRIu64 " cycles)\n", n_bank_conflict, n_bank_cycles);
+}
@@ -0,0 +1,168 @@
+#ifndef COHERENCE_H
+#define COHERENCE_H
+
+#include <cstdio>
+#include <cinttypes>
+#include <vector>
+#include <unordered_map>
+#include "decode.h"
+#include "parameters.h"
+
+/*--------------------------------------------------------------------------*\
+ | coherence.h
+ |
+ | Multi-core timing simulation (-p<n> with the timing simulator).
+ |
+ | The cores of a sim_t share its memory image, and are stepped in lockstep,
+ | one cycle at a time. Each core has private L1 I$, L1 D$ and L2; core 0's
+ | L3 and DRAM are shared by all cores. The L3 is split into COH_L3_BANKS
+ | banks (interleaved by line), each busy for COH_BANK_BUSY cycles per
+ | access.
+ |
+ | The private L2s are kept coherent by a full-map directory at the L3, with
+ | the MESI protocol, at the granularity of an L3 line:
+ |
+ | - An L2 miss (a read) costs the directory lookup (COH_DIR_LATENCY), then
+ |   either an L3 access, or, if another core has the line in E or M, two
+ |   interconnect hops (COH_HOP_LATENCY each: to the owner, and from it)
+ |   instead. The owner keeps a clean shared copy; an M line is also
+ |   written back to the L3. The requester gets E if no other core has the
+ |   line, and S otherwise.
+ | - A store, AMO or SC needs the line in M: a store or SC when it executes
+ |   (like a read-for-ownership), an AMO at the head of the Active List.
+ |   From E, it is silent. From S or I, it costs the directory lookup, plus
+ |   two hops (invalidate, and acknowledge, to all sharers in parallel) if
+ |   other cores have the line. The store's D$ access (a read miss,
+ |   possibly) is counted separately.
+ | - An invalidation removes the line from the core's L1 D$ and L2, and
+ |   clears the core's load reservation if it is in the line, so that its
+ |   SC fails.
+ | - Dirty L2 evictions are written back through the directory; clean
+ |   evictions are silent (the directory may invalidate a line the core no
+ |   longer has).
+ |
+ | The directory has an entry for every line a core holds (no directory
+ | evictions). Coherence is of timing only: data is in the shared memory
+ | image, where loads read it at execute and stores write it at retire.
+ | Loads are not squashed by invalidations. The L1 I$ is not kept coherent.
+ | Functional warming (--warm) updates the directory without timing.
+ |
+ | With parallel host threads (see parallel.h), the directory is buffered:
+ | during a quantum, the cores' requests only read the directory and the L3
+ | (their latencies are estimated from the state at the quantum's start, and
+ | from what the core itself requested during the quantum), and are queued.
+ | At the end of the quantum, they are applied in cycle order (then core
+ | order), with their invalidations and downgrades. Bank conflicts and the
+ | L3's MHSRs and DRAM queues are not part of the estimates.
+\*--------------------------------------------------------------------------*/
+
+class CacheClass;
+class pipeline_t;
+
+typedef enum {
+	COH_I,
+	COH_S,
+	COH_E,
+	COH_M
+} coh_state_e;
+
+class directory_t {
+public:
+	// 'l3' is the shared L3, with lines of 2^'line_size' bytes.
+	directory_t(CacheClass* l3, unsigned int line_size);
+	~directory_t();
+
+	// Add the next core (its Tid is its index).
+	void add_core(pipeline_t* core);
+	unsigned int num_cores() { return(cores.size()); }
+
+	// An L2 miss of 'core' at 'cycle': returns when the line is in the L2.
+	cycle_t read(unsigned int core, cycle_t cycle, reg_t addr);
+
+	// A dirty L2 eviction: returns when the L3 has the line.
+	cycle_t writeback(unsigned int core, cycle_t cycle, reg_t addr);
+
+	// Write permission for a store, AMO or SC: returns when 'core' has the line in M.
+	// 'amo': for the stats.
+	cycle_t write(unsigned int core, cycle_t cycle, reg_t addr, bool amo = false);
+
+	// Functional warming: the state changes of a read or write, without timing.
+	void warm(unsigned int core, reg_t addr, bool write);
+	void warm_writeback(unsigned int core, reg_t addr);
+
+	// A load reservation lost to another core's write (for the stats).
+	void lost_reservation(unsigned int core) { n_lost_rsv[core]++; }
+
+	// Parallel host threads: buffer the requests of each quantum, and apply them at its end.
+	// apply() returns the number of invalidations and forwards among them.
+	void set_buffered(bool on) { buffered = on; }
+	uint64_t apply();
+
+	// "COHERENCE MEASUREMENTS" of one core, and the table of all cores.
+	void dump_core_stats(unsigned int core, FILE* fp);
+	void dump_stats(FILE* fp);
+
+private:
+	typedef struct {
+		coh_state_e state;
+		uint32_t sharers;     // bit vector of cores (the owner, in E and M)
+	} dir_entry_t;
+
+	typedef enum {
+		REQ_READ,
+		REQ_WRITE,
+		REQ_WRITEBACK
+	} req_e;
+
+	typedef struct {
+		cycle_t cycle;
+		unsigned int core;
+		req_e type;
+		reg_t addr;
+		bool amo;
+	} request_t;
+
+	// The requests, at once. 'timed': account their coherence cycles (not when applied).
+	cycle_t do_read(unsigned int core, cycle_t cycle, reg_t addr, bool timed);
+	cycle_t do_write(unsigned int core, cycle_t cycle, reg_t addr, bool amo, bool timed);
+	cycle_t do_writeback(unsigned int core, cycle_t cycle, reg_t addr);
+
+	// The requests, buffered: estimated and queued.
+	cycle_t buffer_read(unsigned int core, cycle_t cycle, reg_t addr);
+	cycle_t buffer_write(unsigned int core, cycle_t cycle, reg_t addr, bool amo);
+	cycle_t buffer_writeback(unsigned int core, cycle_t cycle, reg_t addr);
+	cycle_t l3_estimate(reg_t addr);
+
+	cycle_t l3_access(cycle_t cycle, reg_t addr, bool store);
+	void invalidate(unsigned int core, reg_t addr, uint32_t sharers);
+	void downgrade(reg_t addr, dir_entry_t& e);
+
+	CacheClass* l3;
+	unsigned int line_size;
+	std::vector<pipeline_t*> cores;
+
+	std::unordered_map<reg_t, dir_entry_t> dir;   // by line
+	std::vector<cycle_t> bank_free;               // cycle each L3 bank is free
+
+	// Buffered (parallel host threads). Each core's thread uses only the core's entries.
+	bool buffered;
+	std::vector<request_t> requests[MC_MAX_CORES];                  // of this quantum, in program order
+	std::unordered_map<reg_t, coh_state_e> held[MC_MAX_CORES];      // states requested in this quantum, by line
+
+	// Stats, per core (requester, unless noted).
+	uint64_t n_read[MC_MAX_CORES];          // L2 misses
+	uint64_t n_fwd[MC_MAX_CORES];           // ...supplied by another core's cache
+	uint64_t n_write[MC_MAX_CORES];         // write permission requests that were not silent
+	uint64_t n_upgrade[MC_MAX_CORES];       // ...from S
+	uint64_t n_amo[MC_MAX_CORES];           // ...for AMOs and SCs
+	uint64_t n_inv_sent[MC_MAX_CORES];      // invalidations sent to other cores
+	uint64_t n_inv_recv[MC_MAX_CORES];      // invalidations received (target)
+	uint64_t n_fwd_supplied[MC_MAX_CORES];  // lines supplied to other cores (owner)
+	uint64_t n_writeback[MC_MAX_CORES];
+	uint64_t n_lost_rsv[MC_MAX_CORES];      // load reservations lost to invalidations
+	uint64_t n_coh_cycles[MC_MAX_CORES];    // cycles added by the directory and hops
+	uint64_t n_bank_conflict;               // L3 accesses delayed by a busy bank
+	uint64_t n_bank_cycles;                 // ...total delay
+};
+
+#endif //COHERENCE_H
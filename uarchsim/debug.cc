@@ -3,6 +3,7 @@
 #include "sim.h"
 //#include "processor.h"
 #include "pipeline.h"
+#include "trace_file.h"
 extern bool logging_on;
 
 // Checks to see if index 'e' lies between 'head' and 'tail'.
@@ -44,24 +45,61 @@ debug_buffer_t::debug_buffer_t(unsigned int window_size) {
 
    pc_ptr = 0;
    inst_sequence = 0;
+   capture_state = true;
+
+   isa_sim = (sim_t *) NULL;
+   trace_in = (trace_reader_t *) NULL;
+   trace_out = (trace_writer_t *) NULL;
 }
 
 debug_buffer_t::~debug_buffer_t() {
+   // Finishes the trace file.
+   delete trace_out;
+   delete trace_in;
 }
 
 void debug_buffer_t::run_ahead(){
-  fprintf(stderr, "Functional simulator running ahead\n");
-  // Set to debug mode so that simulator single steps
-  isa_sim->set_procs_debug(true);
-  // Set to checker mode so that instructions are pushed to 
-  // debug buffer
-  isa_sim->set_procs_checker(true);
+  if (trace_in) {
+    fprintf(stderr, "Trace running ahead\n");
+  }
+  else {
+    fprintf(stderr, "Functional simulator running ahead\n");
+    // Set to debug mode so that simulator single steps
+    isa_sim->set_procs_debug(true);
+    // Set to checker mode so that instructions are pushed to 
+    // debug buffer
+    isa_sim->set_procs_checker(true);
+  }
+  fill();
+}
+
+void debug_buffer_t::fill(){
+  HOST_PROF_SCOPE(HP_ORACLE);
   while(hungry()){
-    ifprintf(logging_on,stderr, "Functional simulator hungry\n");
-    isa_sim->step();  // Step 1 cycle, which is 1 instruction for isa_sim.
+    if (trace_in) {
+      if (!trace_in->more())
+        break;
+      start();
+      trace_in->read(&db[tail]);
+    }
+    else if (isa_sim && isa_sim->running()) {
+      ifprintf(logging_on,stderr, "Functional simulator hungry\n");
+      unsigned int old_length = length;
+      isa_sim->step();  // Step 1 cycle, which is 1 instruction for isa_sim.
+      if (trace_out && (length > old_length))
+        trace_out->write(&db[tail]);
+    }
+    else {
+      break;
+    }
   }
 }
 
+void debug_buffer_t::reopen_trace(){
+  if (trace_in)
+    trace_in->reopen();
+}
+
 void debug_buffer_t::skip_till_pc(reg_t pc, unsigned int proc_id){
   ifprintf(logging_on,stderr, "Functional simulator skipping till PC %" PRIreg "\n",pc);
   bool old_debug = isa_sim->get_procs_debug();
@@ -226,6 +264,9 @@ void debug_buffer_t::push_exception_actual(reg_t handler_pc){
 
 void debug_buffer_t::push_state_actual(state_t* a_state_ptr,bool checkpoint_state){
 
+  if(!capture_state)
+    return;
+
   // Checkpoint the entire system state
   if(checkpoint_state){
 
@@ -292,10 +333,7 @@ db_t* debug_buffer_t::pop(debug_index_t i) {
    // Fill out the debug buffer
    // Make sure the simulator is still running and is not already 
    // done with the program.
-   while(hungry() && isa_sim->running()){
-    ifprintf(logging_on,stderr, "Functional simulator hungry\n");
-     isa_sim->step();  // Step 1 cycle, which is 1 instruction for isa_sim.
-   }
+   fill();
 
    // Check for underflow and maintain 'length'.
    assert(length > 0);
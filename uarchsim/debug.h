@@ -88,6 +88,8 @@ typedef unsigned int	debug_index_t;
 
 class sim_t;
 class pipeline_t;
+class trace_writer_t;
+class trace_reader_t;
 
 class debug_buffer_t {
 
@@ -111,6 +113,16 @@ private:
 
   sim_t* isa_sim;
 
+  // Instruction traces (see trace_file.h). The debug buffer is filled from
+  // 'trace_in' instead of the functional simulator, if there is one, and the
+  // instructions it is filled with are recorded in 'trace_out'.
+  trace_reader_t* trace_in;
+  trace_writer_t* trace_out;
+
+  // If 'false', the functional simulator's architectural state is not
+  // snapshotted into the debug buffer (no checker policy will read it).
+  bool capture_state;
+
   ///////////////////////
   // PRIVATE FUNCTIONS
   ///////////////////////
@@ -118,6 +130,9 @@ private:
   // Checks to see if index 'e' lies between 'head' and 'tail'.
   bool is_active(unsigned int e);
 
+  // Fill the debug buffer until it is full or the instruction stream ends.
+  void fill();
+
 public:
 	///////////////
 	// INTERFACE
@@ -127,6 +142,12 @@ public:
 	~debug_buffer_t();
 
   void set_isa_sim(sim_t* _isa_sim){ isa_sim = _isa_sim; }
+  void set_capture_state(bool value){ capture_state = value; }
+  void set_trace_in(trace_reader_t* _trace_in){ trace_in = _trace_in; }
+  trace_reader_t* get_trace_in(){ return trace_in; }
+  void set_trace_out(trace_writer_t* _trace_out){ trace_out = _trace_out; }
+  // After fork(): stop sharing the trace file position with the parent.
+  void reopen_trace();
   void run_ahead();
   void skip_till_pc(reg_t pc, unsigned int proc_id);
 
@@ -186,6 +207,11 @@ public:
 	   return(length == 0);
 	}
 
+	// PC of the oldest instruction.
+	inline	reg_t head_pc() {
+	   return(db[head].a_pc);
+	}
+
   db_t* pop(debug_index_t i);
 
 	//////////////////////////////////////////////////////////////
@@ -1,10 +1,141 @@
 #include "pipeline.h"
 
 
+// Classify an integer instruction as a register move or a zero idiom, for
+// move elimination. For a move, 'src' is the source logical register; a zero
+// idiom's source is x0. (A "move" from x0 is a zero idiom.)
+static elim_kind classify_elim(insn_t inst, unsigned int& src) {
+	elim_kind kind = ELIM_NONE;
+
+	switch (inst.opcode()) {
+		case OP_OP_IMM:
+			// addi/ori/xori rd, rs1, 0: move. andi rd, rs1, 0: zero.
+			if (inst.i_imm() == 0) {
+				if ((inst.funct3() == FN3_ADD_SUB) || (inst.funct3() == FN3_OR) || (inst.funct3() == FN3_XOR)) {
+					kind = ELIM_MOVE;
+					src = inst.rs1();
+				}
+				else if (inst.funct3() == FN3_AND) {
+					kind = ELIM_ZERO;
+				}
+			}
+			break;
+
+		case OP_OP:
+			if (inst.funct7() == FN7_ADD) {
+				if ((inst.funct3() == FN3_ADD_SUB) || (inst.funct3() == FN3_OR) || (inst.funct3() == FN3_XOR)) {
+					// add/or/xor rd, rs, x0 (or x0, rs): move.
+					if (inst.rs2() == 0) {
+						kind = ELIM_MOVE;
+						src = inst.rs1();
+					}
+					else if (inst.rs1() == 0) {
+						kind = ELIM_MOVE;
+						src = inst.rs2();
+					}
+				}
+				if ((inst.rs1() == inst.rs2()) && ((inst.funct3() == FN3_OR) || (inst.funct3() == FN3_AND))) {
+					kind = ELIM_MOVE;	// or/and rd, rs, rs
+					src = inst.rs1();
+				}
+				if ((inst.rs1() == inst.rs2()) &&
+				    ((inst.funct3() == FN3_XOR) || (inst.funct3() == FN3_SLT) || (inst.funct3() == FN3_SLTU)))
+					kind = ELIM_ZERO;	// xor/slt/sltu rd, rs, rs
+				if ((inst.funct3() == FN3_AND) && ((inst.rs1() == 0) || (inst.rs2() == 0)))
+					kind = ELIM_ZERO;	// and rd, rs, x0
+			}
+			else if (inst.funct7() == FN7_SUB) {
+				if ((inst.funct3() == FN3_ADD_SUB) && (inst.rs1() == inst.rs2()))
+					kind = ELIM_ZERO;	// sub rd, rs, rs
+				else if ((inst.funct3() == FN3_ADD_SUB) && (inst.rs2() == 0)) {
+					kind = ELIM_MOVE;	// sub rd, rs, x0
+					src = inst.rs1();
+				}
+			}
+			break;
+
+		case OP_OP_32:
+			if ((inst.funct7() == FN7_SUB) && (inst.funct3() == FN3_ADD_SUB) && (inst.rs1() == inst.rs2()))
+				kind = ELIM_ZERO;	// subw rd, rs, rs
+			break;
+
+		case OP_LUI:
+			if (inst.u_imm() == 0)
+				kind = ELIM_ZERO;	// lui rd, 0
+			break;
+
+		default:
+			break;
+	}
+
+	if ((kind == ELIM_MOVE) && (src == 0))
+		kind = ELIM_ZERO;
+	if (kind == ELIM_ZERO)
+		src = 0;
+	return(kind);
+}
+
+
+// A simple integer ALU op with a destination, that goes through the IQ:
+// a candidate for macro-op fusion.
+static bool fusion_candidate(payload_t& p) {
+	return((p.flags == F_ICOMP) && (p.fu == FU_ALU_S) && (p.iq == SEL_IQ) && !p.trap.valid() &&
+	       !p.split && (p.elim == ELIM_NONE) && p.C_valid && !p.D_valid);
+}
+
+// Classify a pair of consecutive instructions for macro-op fusion. They fuse
+// if the second one reads the first one's destination and overwrites it, so
+// that the pair has a single result. The fused op's sources are the first
+// one's source (A), if any, and the second one's other source, if any, which
+// is returned in 'other' (B).
+static fuse_kind classify_fusion(payload_t& first, payload_t& second, bool& other_valid, unsigned int& other) {
+	unsigned int rd = first.C_log_reg;
+	insn_t i1 = first.inst;
+	insn_t i2 = second.inst;
+
+	if (!fusion_candidate(first) || !fusion_candidate(second) || first.B_valid)
+		return(FUSE_NONE);
+	if ((second.pc != INCREMENT_PC(first.pc)) || (first.next_pc != second.pc) || (second.C_log_reg != rd))
+		return(FUSE_NONE);
+
+	other_valid = false;
+	if (second.A_valid && (second.A_log_reg == rd)) {
+		if (second.B_valid && (second.B_log_reg != rd)) {
+			other_valid = true;
+			other = second.B_log_reg;
+		}
+	}
+	else if (second.B_valid && (second.B_log_reg == rd)) {
+		if (second.A_valid) {
+			other_valid = true;
+			other = second.A_log_reg;
+		}
+	}
+	else {
+		return(FUSE_NONE);	// independent
+	}
+
+	if ((i1.opcode() == OP_LUI) && (i2.funct3() == FN3_ADD_SUB) &&
+	    ((i2.opcode() == OP_OP_IMM) || (i2.opcode() == OP_OP_IMM_32)))
+		return(FUSE_LUI_ADDI);
+	if ((i1.opcode() == OP_AUIPC) && (i2.opcode() == OP_OP_IMM) && (i2.funct3() == FN3_ADD_SUB))
+		return(FUSE_AUIPC_ADDI);
+	if ((i1.opcode() == OP_OP_IMM) && (i1.funct3() == FN3_SLL)) {
+		if ((i2.opcode() == OP_OP_IMM) && (i2.funct3() == FN3_SR))
+			return(FUSE_SHIFT_PAIR);
+		if ((i2.opcode() == OP_OP) && (i2.funct7() == FN7_ADD) && (i2.funct3() == FN3_ADD_SUB))
+			return(FUSE_SHIFT_ADD);
+	}
+	return((MACRO_FUSION == FUSION_ANY) ? FUSE_DEPENDENT_ALU : FUSE_NONE);
+}
+
+
 void pipeline_t::decode() {
 	unsigned int i;
 	unsigned int index;
 	insn_t inst;
+	bool fuse_prev = false;		// The previous instruction in the bundle can be a fused pair's head.
+	unsigned int prev_index = 0;
 
 	// Stall the Decode Stage if there is not enough space in the Fetch Queue for 2x the fetch bundle width.
 	// The factor of 2x assumes that each instruction in the fetch bundle is split, in the worst case.
@@ -495,6 +626,31 @@ void pipeline_t::decode() {
   	  PAY.buf[index].C_valid = false;
     }
 
+		// Moves and zero idioms, to be eliminated in the Rename Stage.
+		PAY.buf[index].elim = ELIM_NONE;
+		if (MOVE_ELIMINATION && PAY.buf[index].C_valid && (PAY.buf[index].iq == SEL_IQ) && !PAY.buf[index].trap.valid())
+			PAY.buf[index].elim = classify_elim(inst, PAY.buf[index].elim_log_reg);
+
+		// Macro-op fusion with the previous instruction in the bundle.
+		// The head carries the pair through the pipeline; the tail stays in PAY,
+		// right behind it, but is not inserted into the Fetch Queue.
+		PAY.buf[index].fused = FUSE_NONE;
+		PAY.buf[index].fused_tail = false;
+		if ((MACRO_FUSION != FUSION_NONE) && fuse_prev) {
+			bool other_valid;
+			unsigned int other = 0;
+			fuse_kind kind = classify_fusion(PAY.buf[prev_index], PAY.buf[index], other_valid, other);
+			if (kind != FUSE_NONE) {
+				assert(index == MOD_S(prev_index + 2, PAY.get_size()));
+				PAY.buf[prev_index].fused = kind;
+				PAY.buf[prev_index].B_valid = other_valid;
+				PAY.buf[prev_index].B_log_reg = other;
+				PAY.buf[index].fused_tail = true;
+			}
+		}
+		fuse_prev = !PAY.buf[index].fused_tail;
+		prev_index = index;
+
 		// Decode some details about loads and stores:
 		// size and sign of data, and left/right info.
 		switch (inst.opcode()) {
@@ -514,7 +670,8 @@ void pipeline_t::decode() {
 		}
 
 		// Insert one or two instructions into the Fetch Queue (indices).
-		FQ.push(index);
+		if (!PAY.buf[index].fused_tail)
+			FQ.push(index);
 		if (PAY.buf[index].split) {
       // Should not come here in current 721sim, with unified int/fp pipeline.
       // Will need this functionality for split-stores, however.
@@ -86,6 +86,10 @@ void pipeline_t::dispatch() {
    if (IQ.stall(bundle_inst) || LSU.stall(bundle_load, bundle_store)) {
       return;
    }
+   // With shared SMT resources, the threads' combined occupancy is also limited.
+   if (SMT && SMT->stall_dispatch(Tid, bundle_inst, bundle_load, bundle_store)) {
+      return;
+   }
 
    // FIX_ME #6
    // Fourth stall condition: There aren't enough AL entries for the dispatch bundle.
@@ -204,6 +208,14 @@ void pipeline_t::dispatch() {
          REN->clear_ready(PAY.buf[index].C_phys_reg);
       // FIX_ME #9 END
 
+      // A predicted value is available to consumers right away. The instruction still
+      // executes and overwrites it; a wrong value is detected in the Writeback Stage.
+      // Its consumers are dispatched ready, so it does not wake them up (see execute and register read).
+      if (PAY.buf[index].vp_predicted) {
+         REN->write_predicted(PAY.buf[index].C_phys_reg, PAY.buf[index].vp_value);
+         REN->set_ready(PAY.buf[index].C_phys_reg);
+      }
+
       // FIX_ME #10
       // Dispatch the instruction into the Issue Queue, or circumvent the Issue Queue and immediately update status in the Active List.
       //
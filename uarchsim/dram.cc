@@ -0,0 +1,211 @@
+#include <cinttypes>
+#include <cassert>
+#include <cmath>
+
+#include "processor.h"
+#include "decode.h"
+#include "config.h"
+
+#include "dram.h"
+
+
+dram_t::dram_t(unsigned int channels, unsigned int ranks, unsigned int banks,
+               unsigned int row_size, unsigned int line_size,
+               unsigned int tRCD, unsigned int tCAS, unsigned int tRP,
+               unsigned int bus_bytes,
+               unsigned int rq_size, unsigned int wq_size,
+               unsigned int ctrl_latency) {
+   assert((channels > 0) && (ranks > 0) && (banks > 0) && (bus_bytes > 0));
+   assert(IsPow2(row_size) && IsPow2(line_size) && (row_size >= line_size));
+   assert((rq_size > 0) && (wq_size > 1));
+
+   num_channels = channels;
+   num_ranks = ranks;
+   num_banks = banks;
+   line_shift = (unsigned int) log2((double)line_size);
+   column_bits = (unsigned int) log2((double)(row_size / line_size));
+
+   this->tRCD = tRCD;
+   this->tCAS = tCAS;
+   this->tRP = tRP;
+   tBURST = ((line_size + bus_bytes - 1) / bus_bytes);
+   this->rq_size = rq_size;
+   this->wq_size = wq_size;
+   this->ctrl_latency = ctrl_latency;
+
+   this->channels.resize(channels);
+   for (unsigned int c = 0; c < channels; c++) {
+      channel_t& ch = this->channels[c];
+      ch.banks.resize(ranks * banks);
+      for (unsigned int b = 0; b < ch.banks.size(); b++) {
+         ch.banks[b].open = false;
+         ch.banks[b].row = 0;
+         ch.banks[b].ready = 0;
+      }
+      ch.bus_free = 0;
+      ch.last_rank = 0;
+      ch.last_write = false;
+   }
+
+   n_read = 0;
+   n_write = 0;
+   n_row_hit = 0;
+   n_row_empty = 0;
+   n_row_conflict = 0;
+   n_rq_full = 0;
+   n_drain = 0;
+   read_latency = 0;
+   bus_busy = 0;
+}
+
+
+void dram_t::decode(reg_t addr, unsigned int& channel, request_t& req) {
+   reg_t x = ((addr >> line_shift) >> column_bits);
+   channel = (x % num_channels);
+   x /= num_channels;
+   req.bank = (x % num_banks);
+   x /= num_banks;
+   req.rank = (x % num_ranks);
+   x /= num_ranks;
+   req.row = x;
+   // Permutation-based interleaving.
+   req.bank = ((req.bank ^ (unsigned int) req.row) % num_banks);
+}
+
+
+// Issue the request to its bank no earlier than 'cycle', and return the cycle when its
+// data burst ends.
+cycle_t dram_t::schedule(channel_t& ch, const request_t& req, cycle_t cycle, bool isWrite) {
+   bank_t& b = ch.banks[req.rank * num_banks + req.bank];
+   cycle_t cmd = ((b.ready > cycle) ? b.ready : cycle);
+
+   if (b.open && (b.row == req.row)) {
+      n_row_hit++;
+   }
+   else {
+      if (b.open) {
+         cmd += tRP;
+         n_row_conflict++;
+      }
+      else {
+         n_row_empty++;
+      }
+      cmd += tRCD;
+      b.open = true;
+      b.row = req.row;
+   }
+
+   // Data burst, after the bus is free and turned around if needed.
+   cycle_t bus = ch.bus_free;
+   if (req.rank != ch.last_rank)
+      bus += DRAM_RANK_SWITCH;
+   if (isWrite != ch.last_write)
+      bus += DRAM_RW_TURNAROUND;
+   cycle_t data = cmd + tCAS;
+   if (data < bus)
+      data = bus;
+
+   ch.bus_free = data + tBURST;
+   ch.last_rank = req.rank;
+   ch.last_write = isWrite;
+   bus_busy += tBURST;
+
+   // Next column command to this bank, once this burst is underway.
+   b.ready = (data - tCAS) + tBURST;
+
+   return(data + tBURST);
+}
+
+
+void dram_t::drain(channel_t& ch, cycle_t cycle) {
+   n_drain++;
+   while (ch.writes.size() > (wq_size / 2)) {
+      // FR-FCFS: oldest row hit, else oldest.
+      unsigned int pick = 0;
+      for (unsigned int i = 0; i < ch.writes.size(); i++) {
+         bank_t& b = ch.banks[ch.writes[i].rank * num_banks + ch.writes[i].bank];
+         if (b.open && (b.row == ch.writes[i].row)) {
+            pick = i;
+            break;
+         }
+      }
+      schedule(ch, ch.writes[pick], cycle, true);
+      ch.writes.erase(ch.writes.begin() + pick);
+   }
+}
+
+
+cycle_t dram_t::read(cycle_t cycle, reg_t addr) {
+   unsigned int c;
+   request_t req;
+   decode(addr, c, req);
+   channel_t& ch = channels[c];
+
+   cycle_t arrive = cycle + ctrl_latency;
+
+   // Retire reads that have completed, then wait for a read queue slot.
+   for (unsigned int i = 0; i < ch.reads.size(); ) {
+      if (ch.reads[i] <= arrive) {
+         ch.reads[i] = ch.reads.back();
+         ch.reads.pop_back();
+      }
+      else {
+         i++;
+      }
+   }
+   if (ch.reads.size() >= rq_size) {
+      unsigned int oldest = 0;
+      for (unsigned int i = 1; i < ch.reads.size(); i++) {
+         if (ch.reads[i] < ch.reads[oldest])
+            oldest = i;
+      }
+      arrive = ch.reads[oldest];
+      ch.reads[oldest] = ch.reads.back();
+      ch.reads.pop_back();
+      n_rq_full++;
+   }
+
+   cycle_t done = schedule(ch, req, arrive, false);
+   ch.reads.push_back(done);
+
+   n_read++;
+   read_latency += (done - cycle);
+   return(done);
+}
+
+
+cycle_t dram_t::write(cycle_t cycle, reg_t addr) {
+   unsigned int c;
+   request_t req;
+   decode(addr, c, req);
+   channel_t& ch = channels[c];
+
+   cycle_t arrive = cycle + ctrl_latency;
+   if (ch.writes.size() >= wq_size)
+      drain(ch, arrive);
+   ch.writes.push_back(req);
+
+   n_write++;
+   return(arrive);
+}
+
+
+void dram_t::dump_stats(FILE* fp, cycle_t cycles) {
+   uint64_t accesses = (n_row_hit + n_row_empty + n_row_conflict);
+
+   fprintf(fp, "DRAM MEASUREMENTS----------------------------------\n");
+   fprintf(fp, "  reads            = %" PRIu64 "\n", n_read);
+   fprintf(fp, "     avg. latency   = %.2f cycles\n",
+           (n_read ? (double)read_latency/(double)n_read : 0.0));
+   fprintf(fp, "     read queue full = %" PRIu64 "\n", n_rq_full);
+   fprintf(fp, "  writes           = %" PRIu64 "\n", n_write);
+   fprintf(fp, "     write drains   = %" PRIu64 "\n", n_drain);
+   fprintf(fp, "  row hits         = %" PRIu64 " (%.2f%%)\n", n_row_hit,
+           (accesses ? 100.0*(double)n_row_hit/(double)accesses : 0.0));
+   fprintf(fp, "  row empty        = %" PRIu64 " (%.2f%%)\n", n_row_empty,
+           (accesses ? 100.0*(double)n_row_empty/(double)accesses : 0.0));
+   fprintf(fp, "  row conflicts    = %" PRIu64 " (%.2f%%)\n", n_row_conflict,
+           (accesses ? 100.0*(double)n_row_conflict/(double)accesses : 0.0));
+   fprintf(fp, "  bus utilization  = %.2f%%\n",
+           (cycles ? 100.0*(double)bus_busy/((double)cycles*(double)num_channels) : 0.0));
+}
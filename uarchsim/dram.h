@@ -0,0 +1,106 @@
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <cstdio>
+#include <vector>
+#include "decode.h"
+
+/*--------------------------------------------------------------------------*\
+ | dram.h
+ |
+ | Timing model of the memory controller and DRAM behind the last-level
+ | cache (the cache whose next level is NULL).
+ |
+ | Organization:  channels x ranks x banks, one open-page row buffer per bank.
+ | Address map:   row : rank : bank : channel : column (low to high: column).
+ |                Consecutive lines share a row; the bank index is XORed with
+ |                low row bits to spread row conflicts across banks.
+ | Timing:        tRCD (activate), tCAS (column access), tRP (precharge), and
+ |                tBURST: the cycles a line occupies the channel's data bus,
+ |                which caps each channel's bandwidth. All in CPU cycles.
+ |
+ | CacheClass needs the completion cycle of a miss when the miss is issued,
+ | so requests are timed when they arrive:
+ |
+ |  - Reads enter the channel's read queue, and wait for a slot if it is full
+ |    (i.e., the number of outstanding reads is capped). They are scheduled
+ |    first-come first-served against the bank and bus state left by earlier
+ |    requests; row hits need only tCAS.
+ |  - Writes (writebacks) are acknowledged when they enter the channel's write
+ |    queue. When the queue fills, it is drained down to half full using
+ |    FR-FCFS: the oldest write that hits an open row goes first, otherwise
+ |    the oldest write. Drained writes occupy banks and the bus, delaying the
+ |    reads that follow.
+\*--------------------------------------------------------------------------*/
+
+#define DRAM_RANK_SWITCH    2   // bus idle cycles when consecutive bursts come from different ranks
+#define DRAM_RW_TURNAROUND  6   // bus idle cycles when switching between reads and writes
+
+class dram_t {
+public:
+	dram_t(unsigned int channels, unsigned int ranks, unsigned int banks,
+	       unsigned int row_size,      // bytes per row (per bank)
+	       unsigned int line_size,     // bytes per request
+	       unsigned int tRCD, unsigned int tCAS, unsigned int tRP,
+	       unsigned int bus_bytes,     // data bus bytes per cycle, per channel
+	       unsigned int rq_size, unsigned int wq_size,
+	       unsigned int ctrl_latency); // cycles to reach the controller and return the data
+
+	// Returns the cycle when the line is at the requesting cache.
+	cycle_t read(cycle_t cycle, reg_t addr);
+
+	// Returns the cycle when the writeback is accepted by the controller.
+	cycle_t write(cycle_t cycle, reg_t addr);
+
+	void dump_stats(FILE* fp, cycle_t cycles);
+
+private:
+	typedef struct {
+		bool open;
+		reg_t row;
+		cycle_t ready;       // next cycle a command can be issued to the bank
+	} bank_t;
+
+	typedef struct {
+		unsigned int rank;
+		unsigned int bank;
+		reg_t row;
+	} request_t;
+
+	typedef struct {
+		std::vector<bank_t> banks;        // ranks*banks
+		cycle_t bus_free;                 // data bus free from this cycle
+		unsigned int last_rank;
+		bool last_write;
+		std::vector<cycle_t> reads;       // completion cycles of outstanding reads
+		std::vector<request_t> writes;    // write queue, oldest first
+	} channel_t;
+
+	void decode(reg_t addr, unsigned int& channel, request_t& req);
+	cycle_t schedule(channel_t& ch, const request_t& req, cycle_t cycle, bool isWrite);
+	void drain(channel_t& ch, cycle_t cycle);
+
+	unsigned int num_channels;
+	unsigned int num_ranks;
+	unsigned int num_banks;
+	unsigned int line_shift;      // log2(line size)
+	unsigned int column_bits;     // log2(lines per row)
+	unsigned int tRCD, tCAS, tRP, tBURST;
+	unsigned int rq_size, wq_size;
+	unsigned int ctrl_latency;
+
+	std::vector<channel_t> channels;
+
+	// Stats.
+	uint64_t n_read;
+	uint64_t n_write;
+	uint64_t n_row_hit;
+	uint64_t n_row_empty;
+	uint64_t n_row_conflict;
+	uint64_t n_rq_full;
+	uint64_t n_drain;
+	uint64_t read_latency;        // sum over reads
+	uint64_t bus_busy;            // sum over channels
+};
+
+#endif //DRAM_H
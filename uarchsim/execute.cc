@@ -75,7 +75,8 @@ void pipeline_t::execute(unsigned int lane_number) {
             // FIX_ME #13 BEGIN
             if (PAY.buf[index].C_valid && hit)
             {
-               IQ.wakeup(PAY.buf[index].C_phys_reg);
+               if (!PAY.buf[index].vp_predicted)   // consumers were dispatched ready
+                  IQ.wakeup(PAY.buf[index].C_phys_reg);
                REN->set_ready(PAY.buf[index].C_phys_reg);
                //printf("Load Instruc Execute\n");
                REN->write(PAY.buf[index].C_phys_reg, PAY.buf[index].C_value.dw);
@@ -205,7 +206,8 @@ void pipeline_t::execute(unsigned int lane_number) {
 	      // FIX_ME #11b BEGIN
          if ( PAY.buf[index].C_valid && !(IS_LOAD(PAY.buf[index].flags)) && !(IS_AMO(PAY.buf[index].flags)) )
          {
-            IQ.wakeup(PAY.buf[index].C_phys_reg);
+            if (!PAY.buf[index].vp_predicted)   // consumers were dispatched ready
+               IQ.wakeup(PAY.buf[index].C_phys_reg);
             REN->set_ready(PAY.buf[index].C_phys_reg);
          }
          // FIX_ME #11b END
@@ -261,10 +263,13 @@ void pipeline_t::load_replay() {
          // 2. See #13 (in execute.cc), and implement steps 3a,3b,3c.
       
 	      // FIX_ME #18a BEGIN
-         IQ.wakeup(PAY.buf[index].C_phys_reg);
+         if (!PAY.buf[index].vp_predicted)   // consumers were dispatched ready
+            IQ.wakeup(PAY.buf[index].C_phys_reg);
          REN->set_ready(PAY.buf[index].C_phys_reg);
          //printf("Replay Stalled Load Instruc Execute\n");
          REN->write(PAY.buf[index].C_phys_reg, PAY.buf[index].C_value.dw);
+         if (PRF_PORTS)
+            PRF_PORTS->written(cycle, PAY.buf[index].C_phys_reg);
          // FIX_ME #18a END
       }
 
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <algorithm>
 #include "CacheClass.h"
 #include "pipeline.h"
 
@@ -13,6 +14,7 @@ fetchunit_t::fetchunit_t(uint64_t instr_per_cycle,			// "n"
 			 uint64_t ib_pc_length, uint64_t ib_bhr_length,	// gshare indirect br. predictor: pc length (index size), bhr length
 			 uint64_t ras_size,				// # entries in the RAS
 			 uint64_t bq_size,				// branch queue size (max. number of outstanding branches)
+			 uint64_t ftq_size,				// fetch target queue size (0: no FTQ/FDIP)
 			 bool tc_enable,				// enable trace cache
 			 bool tc_perfect,				// perfect trace cache (only relevant if trace cache is enabled)
 			 bool bp_perfect,				// perfect branch prediction
@@ -46,6 +48,7 @@ fetchunit_t::fetchunit_t(uint64_t instr_per_cycle,			// "n"
               ib_index(ib_pc_length, ib_bhr_length),
               ras(ras_size),
 	      bp_perfect(bp_perfect),
+	      ftq_size(ftq_size),
 	      bq(bq_size) {
 
    // Memory-allocate the fetch bundle from the instruction cache + BTB or from the trace cache.
@@ -58,12 +61,21 @@ fetchunit_t::fetchunit_t(uint64_t instr_per_cycle,			// "n"
    for (uint64_t i = 0; i < cb_index.table_size(); i++)
       cb[i] = 0xaaaaaaaa; // Initialize counters to weakly-taken.
 
+   // The run-ahead predictor needs a real branch predictor: the perfect branch predictor only knows the path at the Fetch1 stage.
+   if (bp_perfect)
+      this->ftq_size = 0;
+   ra_bundle = new fetch_bundle_t[instr_per_cycle];
+   ftq_resync();
+
    // Memory-allocate FETCH2, the pipeline register between the Fetch1 and Fetch2 stages.
    FETCH2 = new pipeline_register[instr_per_cycle];
 
    // Initialize the Fetch2 stage's status.
    fetch2_status.valid = false;
 
+   // No fetch bundle is being formed by functional warming.
+   warm_pos = 0;
+
    // This assertion is required because BTB bank selection assumes a power-of-two number of BTB banks.
    assert(IsPow2(instr_per_cycle));
 
@@ -84,9 +96,15 @@ fetchunit_t::fetchunit_t(uint64_t instr_per_cycle,			// "n"
    meas_jumpind_seq = 0;// # jump-indirect instructions whose targets were the next sequential PC
 
    meas_btbmiss = 0;	// # of btb misses, i.e., number of discarded fetch bundles (idle fetch cycles) due to a btb miss within the bundle
+
+   meas_ic_stall = 0;	// # of cycles the Fetch1 stage waited for an I$ (or ITLB) miss
+   meas_ftq_pred = 0;	// # of fetch bundles predicted into the FTQ
+   meas_ftq_used = 0;	// # of fetch bundles that consumed the FTQ's head
+   meas_ftq_resync = 0;	// # of FTQ flushes
 }
 
 fetchunit_t::~fetchunit_t() {
+   delete [] ra_bundle;
 }
 
 void fetchunit_t::spec_update(spec_update_t *update, uint64_t cb_predictions) {
@@ -143,6 +161,11 @@ void fetchunit_t::transfer_fetch_bundle() {
       // uninitialized chkpt_id could wrongly match RETSTATE.chkpt_id.
       PAY->buf[index].chkpt_id = 0xDEADBEEF;
 
+      // Value prediction happens at rename.
+      PAY->buf[index].vp_lookup = false;
+      PAY->buf[index].vp_predicted = false;
+      PAY->buf[index].vp_misp = false;   // (the tail of a fused pair is never renamed)
+
       // Clear the trap storage before the first time it is used.
       PAY->buf[index].trap.clear();
       assert(!PAY->buf[index].trap.valid());
@@ -188,12 +211,60 @@ void fetchunit_t::squash_fetch2() {
       FETCH2[i].valid = false;
 }
 
+void fetchunit_t::ftq_resync() {
+   ftq.clear();
+   ra_pc = pc;
+   ra_cb_bhr = cb_index.get_bhr();
+   ra_ib_bhr = ib_index.get_bhr();
+   ra_ras.clear();
+}
+
+// Run-ahead predictor: predict one fetch bundle per cycle into the FTQ, and prefetch its lines.
+// It mirrors the Fetch1 stage's real branch predictor (see fetch1() and spec_update()), with its own speculative state.
+void fetchunit_t::ftq_run_ahead(cycle_t cycle) {
+   if (!fetch_active || (ftq.size() >= ftq_size))
+      return;
+
+   uint64_t cb_predictions = cb[cb_index.index(ra_pc, ra_cb_bhr)];
+   uint64_t ib_predicted_target = ib[ib_index.index(ra_pc, ra_ib_bhr)];
+   uint64_t ras_predicted_target = (ra_ras.empty() ? ras.peek() : ra_ras.back());
+   spec_update_t update;
+
+   // The BTB terminates a bundle at an exception; the run-ahead predictor doesn't know about exceptions.
+   for (uint64_t i = 0; i < instr_per_cycle; i++)
+      ra_bundle[i].exception = false;
+   btb.lookup(ra_pc, cb_predictions, ib_predicted_target, ras_predicted_target, ra_bundle, &update);
+
+   ftq.push_back(ra_pc);
+   meas_ftq_pred++;
+   ic.prefetch(cycle, ra_pc);
+
+   // Speculatively update the run-ahead predictor's pc, BHRs, and RAS.
+   ra_pc = update.next_pc;
+   for (uint64_t i = 0; i < update.num_cb; i++) {
+      bool taken = ((cb_predictions & 3) >= 2);
+      cb_predictions = (cb_predictions >> 2);
+      ra_cb_bhr = cb_index.update_my_bhr(ra_cb_bhr, taken);
+      ra_ib_bhr = ib_index.update_my_bhr(ra_ib_bhr, taken);
+   }
+   if (update.pop_ras && !ra_ras.empty())
+      ra_ras.pop_back();
+   if (update.push_ras)
+      ra_ras.push_back(update.push_ras_pc);
+}
+
 // Fetch1 pipeline stage.
 void fetchunit_t::fetch1(cycle_t cycle) {
+   // The run-ahead predictor fills the FTQ whether or not the Fetch1 stage stalls.
+   if (ftq_size)
+      ftq_run_ahead(cycle);
+
    // Stall if any of the following conditions hold:
    // 1. The Fetch2 bundle hasn't advanced.
    // 2. Instruction fetching is disabled until a serializing instruction (fetch exception, amo, or csr instruction) retires.
    // 3. The Fetch1 stage is waiting for an instruction cache miss to resolve.
+   if (ic_miss && (cycle < ic_miss_resolve_cycle) && fetch_active)
+      meas_ic_stall++;
    if (fetch2_status.valid || !fetch_active || (ic_miss && (cycle < ic_miss_resolve_cycle)))
       return;
 
@@ -294,6 +365,20 @@ void fetchunit_t::fetch1(cycle_t cycle) {
       // Speculatively update the pc, BHRs, and RAS.
       ///////////////////////////////////////////////////////////////////////////////////////////////////////////
       spec_update(&update, cb_predictions);
+
+      ///////////////////////////////////////////////////////////////////////////////////////////////////////////
+      // Consume the FTQ's head, or restart the run-ahead predictor after this bundle if the FTQ went astray.
+      ///////////////////////////////////////////////////////////////////////////////////////////////////////////
+      if (ftq_size) {
+         if (!ftq.empty() && (ftq.front() == fetch2_status.pc)) {
+            ftq.pop_front();
+            meas_ftq_used++;
+         }
+         else {
+            ftq_resync();
+            meas_ftq_resync++;
+         }
+      }
    }
 }
 
@@ -629,6 +714,42 @@ void fetchunit_t::mispredict(uint64_t branch_pred_tag, bool taken, uint64_t next
    // 7. Squash the fetch2_status register and FETCH2 pipeline register.
 
    squash_fetch2();
+
+   // The FTQ holds the wrong path: restart the run-ahead predictor from the corrected state.
+   if (ftq_size) {
+      ftq_resync();
+      meas_ftq_resync++;
+   }
+}
+
+
+// Train the 2-bit counter of a conditional branch, given the context that predicted it.
+void fetchunit_t::train_cb(uint64_t fetch_pc, uint64_t fetch_cb_bhr, uint64_t fetch_cb_pos_in_entry, bool taken) {
+   // "m" two-bit counters are packed into a uint64_t.
+   uint64_t *cb_counters = &(  cb[ cb_index.index(fetch_pc, fetch_cb_bhr) ]  );
+
+   // Prepare for reading and writing the 2-bit counter that was used to predict this branch.
+   // We need a shift-amount ("shamt") and a mask ("mask") that can be used to read/write just that counter.
+   // "shamt" = the branch's position in the entry times 2, for 2-bit counters.
+   // "mask" = (3 << shamt).
+   uint64_t shamt = (fetch_cb_pos_in_entry << 1);
+   uint64_t mask = (3 << shamt);
+
+   // Extract a local copy of the 2-bit counter that was used to predict this branch.
+   uint64_t ctr = (((*cb_counters) & mask) >> shamt);
+
+   // Increment or decrement the local copy of the 2-bit counter, based on the branch's outcome.
+   if (taken) {
+      if (ctr < 3)
+         ctr++;
+   }
+   else {
+      if (ctr > 0)
+         ctr--;
+   }
+
+   // Write the modified local copy of the 2-bit counter back into the predictor's entry.
+   *cb_counters = (((*cb_counters) & (~mask)) | (ctr << shamt));
 }
 
 
@@ -645,40 +766,13 @@ void fetchunit_t::commit() {
 
    // Update the conditional branch predictor or indirect branch predictor.
    // Update measurements.
-   uint64_t *cb_counters;	// FYI: The compiler forbids declaring these four local variables inside "case BTB_BRANCH:".
-   uint64_t shamt;
-   uint64_t mask;
-   uint64_t ctr;
    switch (bq.bq[pred_tag].branch_type) {
       case BTB_BRANCH:
 	 // Re-reference the conditional branch predictor, using the same context that was used by
 	 // the fetch bundle that this branch was a part of.
          // Using this original context, we re-reference the same "m" counters from the conditional branch predictor.
          // "m" two-bit counters are packed into a uint64_t.
-	 cb_counters = &(  cb[ cb_index.index(bq.bq[pred_tag].fetch_pc, bq.bq[pred_tag].fetch_cb_bhr) ]  );
-
-	 // Prepare for reading and writing the 2-bit counter that was used to predict this branch.
-	 // We need a shift-amount ("shamt") and a mask ("mask") that can be used to read/write just that counter.
-	 // "shamt" = the branch's position in the entry times 2, for 2-bit counters.
-	 // "mask" = (3 << shamt).
-	 shamt = (bq.bq[pred_tag].fetch_cb_pos_in_entry << 1);
-	 mask = (3 << shamt);
-
-	 // Extract a local copy of the 2-bit counter that was used to predict this branch.
-	 ctr = (((*cb_counters) & mask) >> shamt);
-
-	 // Increment or decrement the local copy of the 2-bit counter, based on the branch's outcome.
-	 if (bq.bq[pred_tag].taken) {
-	    if (ctr < 3)
-	       ctr++;
-	 }
-	 else {
-	    if (ctr > 0)
-	       ctr--;
-	 }
-
-	 // Write the modified local copy of the 2-bit counter back into the predictor's entry.
-	 *cb_counters = (((*cb_counters) & (~mask)) | (ctr << shamt));
+	 train_cb(bq.bq[pred_tag].fetch_pc, bq.bq[pred_tag].fetch_cb_bhr, bq.bq[pred_tag].fetch_cb_pos_in_entry, bq.bq[pred_tag].taken);
 
 	 // Update measurements.
 	 meas_branch_n++;
@@ -735,6 +829,141 @@ void fetchunit_t::commit() {
 }
 
 
+// Functional warming during fast-skip: see fetchunit.h.
+void fetchunit_t::warm(uint64_t pc, insn_t insn, uint64_t next_pc) {
+   uint64_t target;
+   bool taken = (next_pc != INCREMENT_PC(pc));
+   bool end;		// this instruction ends its fetch bundle
+
+   // The stream left the bundle (e.g., it took a trap): start a new one.
+   if ((warm_pos > 0) && (pc != (warm_pc + (warm_pos << 2))))
+      warm_pos = 0;
+
+   // Start a new fetch bundle: warm its I$ lines, and record the BHRs that would predict it.
+   if (warm_pos == 0) {
+      warm_pc = pc;
+      warm_num_cb = 0;
+      warm_cb_bhr = cb_index.get_bhr();
+      warm_ib_bhr = ib_index.get_bhr();
+      ic.warm(pc);
+   }
+
+   // The bundle ends at the maximum length, at any taken branch, at the m'th conditional branch,
+   // at any other kind of branch, and at a serializing instruction.
+   end = (taken || ((warm_pos + 1) == instr_per_cycle));
+
+   switch (insn.opcode()) {
+      case OP_JAL:
+      case OP_JALR:
+      case OP_BRANCH:
+         btb.warm(warm_pc, warm_pos, insn, true);
+         switch (btb_t::decode(insn, pc, target)) {
+            case BTB_BRANCH:
+               train_cb(warm_pc, warm_cb_bhr, warm_num_cb, taken);
+               cb_index.update_bhr(taken);
+               ib_index.update_bhr(taken);
+               warm_num_cb++;
+               if (warm_num_cb == cond_branch_per_cycle)
+                  end = true;
+               break;
+
+            case BTB_JUMP_DIRECT:
+               end = true;
+               break;
+
+            case BTB_CALL_DIRECT:
+               ras.push(INCREMENT_PC(pc));
+               end = true;
+               break;
+
+            case BTB_JUMP_INDIRECT:
+               ib[ ib_index.index(warm_pc, warm_ib_bhr) ] = next_pc;
+               end = true;
+               break;
+
+            case BTB_CALL_INDIRECT:
+               ib[ ib_index.index(warm_pc, warm_ib_bhr) ] = next_pc;
+               ras.push(INCREMENT_PC(pc));
+               end = true;
+               break;
+
+            case BTB_RETURN:
+               ras.pop();
+               end = true;
+               break;
+
+            default:
+               assert(0);
+               break;
+         }
+         break;
+
+      case OP_AMO:
+      case OP_SYSTEM:
+         btb.warm(warm_pc, warm_pos, insn, false);
+         end = true;
+         break;
+
+      default:
+         btb.warm(warm_pc, warm_pos, insn, false);
+         break;
+   }
+
+   warm_pos = (end ? 0 : (warm_pos + 1));
+}
+
+
+// Save or restore the warm state: see fetchunit.h.
+void fetchunit_t::save_warm(std::vector<warm_section_t>& sections) {
+   if (!ic.is_perfect())
+      ic.get_cache()->save_warm(sections);
+   btb.save_warm(sections);
+   ras.save_warm(sections);
+
+   // The gshare tables. The BHR is the first word, followed by the table.
+   // The conditional branch predictor's entries pack "m" counters.
+   warm_section_t& c = new_warm_section(sections, "gshare_cb");
+   cb_index.geometry(c.geometry);
+   c.geometry.push_back(cond_branch_per_cycle);
+   c.data.push_back(cb_index.get_bhr());
+   c.data.insert(c.data.end(), cb, (cb + cb_index.table_size()));
+
+   warm_section_t& i = new_warm_section(sections, "gshare_ib");
+   ib_index.geometry(i.geometry);
+   i.data.push_back(ib_index.get_bhr());
+   i.data.insert(i.data.end(), ib, (ib + ib_index.table_size()));
+}
+
+bool fetchunit_t::restore_warm(const warm_section_t& s) {
+   if (!ic.is_perfect() && (s.name == ic.get_cache()->name()))
+      return(ic.get_cache()->restore_warm(s));
+   if (s.name == "btb")
+      return(btb.restore_warm(s));
+   if (s.name == "ras")
+      return(ras.restore_warm(s));
+
+   std::vector<uint64_t> g;
+   if (s.name == "gshare_cb") {
+      cb_index.geometry(g);
+      g.push_back(cond_branch_per_cycle);
+      if ((s.geometry != g) || (s.data.size() != (cb_index.table_size() + 1)))
+         return(false);
+      cb_index.set_bhr(s.data[0]);
+      std::copy(s.data.begin() + 1, s.data.end(), cb);
+      return(true);
+   }
+   if (s.name == "gshare_ib") {
+      ib_index.geometry(g);
+      if ((s.geometry != g) || (s.data.size() != (ib_index.table_size() + 1)))
+         return(false);
+      ib_index.set_bhr(s.data[0]);
+      std::copy(s.data.begin() + 1, s.data.end(), ib);
+      return(true);
+   }
+   return(false);
+}
+
+
 // Complete squash.
 // 1. Roll-back the branch queue to the head entry.
 // 2. Restore checkpointed global histories and the RAS (as best we can for RAS).
@@ -764,6 +993,12 @@ void fetchunit_t::flush(uint64_t pc) {
 
    // 6. Reset ic_miss (discard pending I$ misses).
    ic_miss = false;
+
+   // The FTQ holds the wrong path: restart the run-ahead predictor from the restored state.
+   if (ftq_size) {
+      ftq_resync();
+      meas_ftq_resync++;
+   }
 }
 
 
@@ -787,6 +1022,13 @@ void fetchunit_t::output(uint64_t num_instr, uint64_t num_cycles, FILE *fp) {
    fprintf(fp, "(Number of Jump Indirects whose target was the next sequential PC = %lu)\n", meas_jumpind_seq);
    fprintf(fp, "BTB MEASUREMENTS-----------------------------------\n");
    fprintf(fp, "BTB misses (fetch cycles squashed due to a BTB miss) = %lu (%.2f%% of all cycles)\n", meas_btbmiss, 100.0*((double)meas_btbmiss/(double)num_cycles));
+   fprintf(fp, "FETCH MEASUREMENTS---------------------------------\n");
+   fprintf(fp, "I$ miss stall cycles = %lu (%.2f%% of all cycles)\n", meas_ic_stall, 100.0*((double)meas_ic_stall/(double)num_cycles));
+   if (ftq_size) {
+      fprintf(fp, "FTQ bundles predicted = %lu, consumed by fetch = %lu (%.2f%%), resyncs = %lu\n", meas_ftq_pred, meas_ftq_used,
+              (meas_ftq_pred ? 100.0*((double)meas_ftq_used/(double)meas_ftq_pred) : 0.0), meas_ftq_resync);
+      ic.dump_stats(fp);
+   }
 }
 
 void fetchunit_t::setPC(uint64_t pc) {
@@ -1,4 +1,7 @@
 
+#include <deque>
+#include <vector>
+#include "warm_state.h"
 #include "fetchunit_types.h"
 #include "btb.h"
 #include "bq.h"
@@ -79,6 +82,26 @@ private:
 	// Perfect branch predictor. Note: PAY->predict() serves as the perfect branch predictor.
 	bool bp_perfect;
 
+	// Fetch Target Queue (FTQ) and fetch-directed instruction prefetching (FDIP).
+	//
+	// A run-ahead copy of the branch prediction unit walks the predicted path, one fetch bundle per cycle,
+	// up to ftq_size bundles ahead of the Fetch1 stage, and prefetches each bundle's lines into the I$ (or the
+	// L2$ when the I$ has no free MHSR). It keeps running while the Fetch1 stage is stalled, e.g., on an I$ miss,
+	// so that the misses further down the predicted path overlap with it.
+	//
+	// The run-ahead predictor reads the same BTB and gshare tables as the Fetch1 stage, with its own BHRs and a
+	// small RAS of its own pushes (falling back to the real RAS's top). The Fetch1 stage still predicts each
+	// bundle itself, so the branch queue's checkpoints and misfetch recovery are unchanged: a fetched bundle
+	// consumes the FTQ's head if their start PCs agree, and otherwise (misprediction, misfetch, run-ahead
+	// predictor disagreed) the FTQ is flushed and the run-ahead restarts from the Fetch1 stage's state.
+	uint64_t ftq_size;			// 0: no FTQ (coupled front end)
+	std::deque<uint64_t> ftq;		// start PCs of the predicted fetch bundles, oldest first
+	uint64_t ra_pc;				// run-ahead predictor: start PC of the next bundle to predict
+	uint64_t ra_cb_bhr;			// run-ahead predictor: BHRs
+	uint64_t ra_ib_bhr;
+	std::vector<uint64_t> ra_ras;		// run-ahead predictor: return addresses pushed since the last resync
+	fetch_bundle_t *ra_bundle;		// run-ahead predictor: scratch bundle for the BTB
+
 	////////////////////////////////////////////////////////////////
 	// Fetch2 Stage.
 	////////////////////////////////////////////////////////////////
@@ -92,6 +115,13 @@ private:
 	// Branch queue for keeping track of all outstanding branch predictions.
 	bq_t bq;
 
+	// Functional warming (see warm()): the correct-path fetch bundle being formed.
+	uint64_t warm_pc;		// start pc of the bundle
+	uint64_t warm_pos;		// position of the next instruction in the bundle (0: start a new bundle)
+	uint64_t warm_num_cb;		// conditional branches in the bundle so far
+	uint64_t warm_cb_bhr;		// BHRs prior to the bundle
+	uint64_t warm_ib_bhr;
+
 	// Measurements.
 	uint64_t meas_branch_n;		// # branches
 	uint64_t meas_jumpdir_n;	// # jumps, direct
@@ -109,10 +139,18 @@ private:
 
 	uint64_t meas_btbmiss;		// # of btb misses, i.e., number of discarded fetch bundles (idle fetch cycles) due to a btb miss within the bundle
 
+	uint64_t meas_ic_stall;		// # of cycles the Fetch1 stage waited for an I$ (or ITLB) miss
+	uint64_t meas_ftq_pred;		// # of fetch bundles predicted into the FTQ
+	uint64_t meas_ftq_used;		// # of fetch bundles that consumed the FTQ's head
+	uint64_t meas_ftq_resync;	// # of FTQ flushes (Fetch1 stage diverged from the FTQ)
+
 	////////////////////////////
 	// Private functions.
 	////////////////////////////
 
+	// Function for training the 2-bit counter of a conditional branch, given the context that predicted it.
+	void train_cb(uint64_t fetch_pc, uint64_t fetch_cb_bhr, uint64_t fetch_cb_pos_in_entry, bool taken);
+
 	// Function for speculatively updating the pc, BHRs, and RAS, based on the assembled fetch bundle.
 	void spec_update(spec_update_t *update, uint64_t cb_predictions);
 
@@ -122,6 +160,11 @@ private:
 	// Function for squashing the Fetch2 stage, i.e., invalidate all instructions in the FETCH2 pipeline register and reset fetch2_status.
 	void squash_fetch2();
 
+	// FTQ functions: flush the FTQ and restart the run-ahead predictor from the Fetch1 stage's pc, BHRs, and RAS;
+	// predict and prefetch the next fetch bundle into the FTQ.
+	void ftq_resync();
+	void ftq_run_ahead(cycle_t cycle);
+
 public:
 	fetchunit_t(uint64_t instr_per_cycle,				// "n"
 	            uint64_t cond_branch_per_cycle,			// "m"
@@ -131,6 +174,7 @@ public:
 	            uint64_t ib_pc_length, uint64_t ib_bhr_length,	// gshare indirect br. predictor: pc length (index size), bhr length
 	            uint64_t ras_size,					// # entries in the RAS
 	            uint64_t bq_size,					// branch queue size (max. number of outstanding branches)
+	            uint64_t ftq_size,					// fetch target queue size (0: no FTQ/FDIP)
 	            bool tc_enable,					// enable trace cache
 	            bool tc_perfect,					// perfect trace cache (only relevant if trace cache is enabled)
 		    bool bp_perfect,					// perfect branch prediction
@@ -197,6 +241,17 @@ public:
 	// 6. Reset ic_miss (discard pending I$ misses).
 	void flush(uint64_t pc);
 
+	// Functional warming during fast-skip (see pipeline_t::warm()).
+	// The retired instruction stream is cut into the fetch bundles that the Fetch1 stage would form on the correct path.
+	// Each bundle warms the I$ and ITLB, and its branches train the BTB, conditional and indirect branch predictors,
+	// BHRs and RAS with their outcomes, as fetch2() and commit() would. No measurements are updated.
+	void warm(uint64_t pc, insn_t insn, uint64_t next_pc);
+
+	// Save or restore the warm state of the I$, BTB, branch predictors (tables and BHRs) and RAS (see warm_state.h).
+	// restore_warm() returns false if the section is not the fetch unit's, or its geometry differs.
+	void save_warm(std::vector<warm_section_t>& sections);
+	bool restore_warm(const warm_section_t& section);
+
 	// Output all branch prediction measurements.
 	void output(uint64_t num_instr, uint64_t num_cycles, FILE *fp);
 
@@ -206,4 +261,11 @@ public:
 
 	// Public function for querying fetch_active.
 	bool active();
+
+	// Attach the ITLB timing model (see tlb.h).
+	void set_tlb(tlb_hierarchy_t *tlb) { ic.set_tlb(tlb); }
+
+	// Share another SMT thread's I$ (see smt.h).
+	void share_icache(CacheClass *IC, CacheClass *L2C, unsigned int Tid) { ic.share(IC, L2C, Tid); }
+	CacheClass *get_icache() { return ic.get_cache(); }
 };
@@ -1,4 +1,5 @@
 #include <cinttypes>
+#include <vector>
 #include "gshare.h"
 
 gshare_index_t::gshare_index_t(uint64_t pc_length, uint64_t bhr_length) {
@@ -55,3 +56,11 @@ uint64_t gshare_index_t::get_bhr() {
 void gshare_index_t::set_bhr(uint64_t bhr) {
    this->bhr = bhr;
 }
+
+// The parameters that give the predictor's entries their meaning (see warm_state.h).
+void gshare_index_t::geometry(std::vector<uint64_t>& g) {
+   g.push_back(size);
+   g.push_back(pc_mask);
+   g.push_back(bhr_msb);
+   g.push_back(bhr_shamt);
+}
@@ -31,4 +31,7 @@ public:
 	// Functions to get and set the bhr, e.g., for checkpoint/restore purposes.
 	uint64_t get_bhr();
 	void set_bhr(uint64_t bhr);
+
+	// The parameters that give the predictor's entries their meaning (see warm_state.h).
+	void geometry(std::vector<uint64_t>& g);
 };
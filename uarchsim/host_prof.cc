@@ -0,0 +1,111 @@
+#include <cstring>
+
+#include "host_prof.h"
+#include "stats.h"
+
+
+host_prof_t* HOST_PROF = NULL;
+__thread host_prof_t* HOST_PROF_THREAD = NULL;
+
+static const char* hp_name[HP_NUM] = {
+   "retire", "writeback", "load replay", "execute", "register read",
+   "schedule", "dispatch", "rename", "decode", "fetch",
+   "IQ wakeup", "LSU disambiguate", "cache access", "checker", "oracle (DB fill)", "HTIF tick",
+   "total"
+};
+
+// Phase counters (see register_phase_stats()).
+static const char* hp_counter[HP_NUM] = {
+   "host_ns_retire", "host_ns_writeback", "host_ns_load_replay", "host_ns_execute", "host_ns_register_read",
+   "host_ns_schedule", "host_ns_dispatch", "host_ns_rename", "host_ns_decode", "host_ns_fetch",
+   "host_ns_iq_wakeup", "host_ns_lsu_disambig", "host_ns_cache", "host_ns_checker", "host_ns_oracle", "host_ns_htif",
+   "host_ns"
+};
+
+host_prof_t::host_prof_t() {
+   for (unsigned int b = 0; b < HP_NUM; b++) {
+      ticks[b] = 0;
+      calls[b] = 0;
+      start[b] = 0;
+      depth[b] = 0;
+      phase_ticks[b] = 0;
+   }
+   tick0 = now();
+   time0 = std::chrono::steady_clock::now();
+}
+
+host_prof_t::~host_prof_t() {
+}
+
+void host_prof_t::absorb(host_prof_t& other) {
+   for (unsigned int b = 0; b < HP_NUM; b++) {
+      ticks[b] += other.ticks[b];
+      calls[b] += other.calls[b];
+      other.ticks[b] = 0;
+      other.calls[b] = 0;
+   }
+}
+
+double host_prof_t::ns_per_tick() {
+   uint64_t t = (now() - tick0);
+   double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - time0).count();
+   return(t ? (ns / (double)t) : 1.0);
+}
+
+void host_prof_t::dump_stats(FILE* fp, uint64_t insn, uint64_t cycles) {
+   double total = seconds(ticks[HP_TOTAL]);
+   double kips = (total > 0.0 ? (1e-3 * (double)insn / total) : 0.0);
+   double khz = (total > 0.0 ? (1e-3 * (double)cycles / total) : 0.0);
+   uint64_t stages = 0;
+   unsigned int b;
+
+   fprintf(fp, "HOST TIME MEASUREMENTS-----------------------------\n");
+   fprintf(fp, "  host time        = %.3f s (timing simulation)\n", total);
+   fprintf(fp, "  speed            = %.1f KIPS (%.3f MIPS), %.1f KHz\n", kips, (1e-3 * kips), khz);
+   fprintf(fp, "  host ns/cycle    = %.1f\n", (cycles ? (1e9 * total / (double)cycles) : 0.0));
+   fprintf(fp, "  per stage:\n");
+   for (b = 0; b < HP_NUM_STAGES; b++) {
+      fprintf(fp, "     %-17s= %9.3f s (%5.2f%%)\n", hp_name[b], seconds(ticks[b]),
+              (ticks[HP_TOTAL] ? (100.0 * (double)ticks[b] / (double)ticks[HP_TOTAL]) : 0.0));
+      stages += ticks[b];
+   }
+   stages = ((ticks[HP_TOTAL] > stages) ? (ticks[HP_TOTAL] - stages) : 0);
+   fprintf(fp, "     %-17s= %9.3f s (%5.2f%%)\n", "other", seconds(stages),
+           (ticks[HP_TOTAL] ? (100.0 * (double)stages / (double)ticks[HP_TOTAL]) : 0.0));
+   fprintf(fp, "  per structure (included in the above):\n");
+   for (b = HP_NUM_STAGES; b < HP_TOTAL; b++) {
+      fprintf(fp, "     %-17s= %9.3f s (%5.2f%%), %" PRIu64 " calls, %.1f ns/call\n", hp_name[b], seconds(ticks[b]),
+              (ticks[HP_TOTAL] ? (100.0 * (double)ticks[b] / (double)ticks[HP_TOTAL]) : 0.0),
+              calls[b], (calls[b] ? (1e9 * seconds(ticks[b]) / (double)calls[b]) : 0.0));
+   }
+}
+
+void host_prof_t::print_summary(uint64_t insn, uint64_t cycles) {
+   double total = seconds(ticks[HP_TOTAL]);
+   fprintf(stderr, "Host time: %.3f s for %" PRIu64 " instructions, %" PRIu64 " cycles (%.1f KIPS, %.1f KHz)\n",
+           total, insn, cycles,
+           (total > 0.0 ? (1e-3 * (double)insn / total) : 0.0),
+           (total > 0.0 ? (1e-3 * (double)cycles / total) : 0.0));
+}
+
+void host_prof_t::register_phase_stats(stats_t* stats) {
+   for (unsigned int b = 0; b < HP_NUM; b++)
+      stats->register_phase_counter(hp_counter[b], "host");
+   DECLARE_PHASE_RATE(stats, host_kips, host, commit_count, host_ns, 1e6);
+   DECLARE_PHASE_RATE(stats, host_khz, host, cycle_count, host_ns, 1e6);
+   stats->set_phase_hook(phase_hook);
+}
+
+void host_prof_t::flush_phase(stats_t* stats) {
+   double r = ns_per_tick();
+   for (unsigned int b = 0; b < HP_NUM; b++) {
+      stats->add_counter(hp_counter[b], (uint64_t)(r * (double)(ticks[b] - phase_ticks[b])));
+      phase_ticks[b] = ticks[b];
+   }
+}
+
+// Called at the end of each phase, before its counters are recorded.
+void host_prof_t::phase_hook(stats_t* stats) {
+   if (HOST_PROF)
+      HOST_PROF->flush_phase(stats);
+}
@@ -0,0 +1,138 @@
+#ifndef HOST_PROF_H
+#define HOST_PROF_H
+
+#include <cstdio>
+#include <cinttypes>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*--------------------------------------------------------------------------*\
+ | host_prof.h
+ |
+ | Self-profiling of the simulator's host time (--hostprof).
+ |
+ | The timing simulator's cycle (sim_t::step()) is timed as a whole and per
+ | pipeline stage; the stages and "other" (the HTIF tick, cycle bookkeeping)
+ | partition it. Some structures are also timed wherever they are used; their
+ | time is included in the stages' (or other's) time.
+ |
+ | Time is read with rdtsc where available (steady_clock otherwise), and
+ | converted to seconds with the tick rate measured over the whole run.
+ | With SMT, all threads' time is accumulated together. With parallel host
+ | threads (see parallel.h), each host thread times into its own host_prof_t,
+ | which is added to HOST_PROF at every synchronization: the stages' time is
+ | then the sum over the host threads, and can exceed the total (wall) time.
+ |
+ | Nothing is timed unless HOST_PROF exists: a disabled scope costs one
+ | test of a global pointer.
+\*--------------------------------------------------------------------------*/
+
+class stats_t;
+
+typedef enum {
+   // Pipeline stages, in the order step_micro() runs them.
+   HP_RETIRE,
+   HP_WRITEBACK,
+   HP_LOAD_REPLAY,
+   HP_EXECUTE,
+   HP_REGISTER_READ,
+   HP_SCHEDULE,
+   HP_DISPATCH,
+   HP_RENAME,
+   HP_DECODE,
+   HP_FETCH,
+
+   // Structures (nested in the above).
+   HP_IQ_WAKEUP,
+   HP_LSU_DISAMBIG,
+   HP_CACHE,           // CacheClass::Access(), all levels
+   HP_CHECKER,
+   HP_ORACLE,          // filling the debug buffer: functional simulator or trace
+   HP_HTIF,            // the timing simulator's HTIF tick
+
+   HP_TOTAL,           // sim_t::step() of a timing simulator
+   HP_NUM
+} host_prof_e;
+
+#define HP_NUM_STAGES   (HP_FETCH + 1)
+
+class host_prof_t {
+public:
+   host_prof_t();
+   ~host_prof_t();
+
+   static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+      return(__rdtsc());
+#else
+      return(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+   }
+
+   // A bucket nests in itself when its structure recurses (e.g., a cache
+   // accessing the next level): only the outermost scope is timed.
+   inline void begin(host_prof_e b) {
+      if (depth[b]++ == 0)
+         start[b] = now();
+      calls[b]++;
+   }
+   inline void end(host_prof_e b) {
+      if (--depth[b] == 0)
+         ticks[b] += (now() - start[b]);
+   }
+
+   // Add 'other's time and calls to this one's, and clear 'other's.
+   void absorb(host_prof_t& other);
+
+   // "HOST TIME MEASUREMENTS" for 'insn' instructions in 'cycles' cycles.
+   void dump_stats(FILE* fp, uint64_t insn, uint64_t cycles);
+   void print_summary(uint64_t insn, uint64_t cycles);   // one line, to stderr
+
+   // Register the host_ns_* phase counters and host_kips/host_khz phase rates
+   // with 'stats', and flush the time of each phase into them.
+   void register_phase_stats(stats_t* stats);
+   void flush_phase(stats_t* stats);   // add the time since the last flush to the counters
+
+private:
+   static void phase_hook(stats_t* stats);
+
+   double ns_per_tick();
+   double seconds(uint64_t t) { return(1e-9 * ns_per_tick() * (double)t); }
+
+   uint64_t ticks[HP_NUM];
+   uint64_t calls[HP_NUM];
+   uint64_t start[HP_NUM];
+   unsigned int depth[HP_NUM];
+
+   uint64_t phase_ticks[HP_NUM];   // ticks at the last phase
+
+   // Calibration.
+   uint64_t tick0;
+   std::chrono::steady_clock::time_point time0;
+};
+
+extern host_prof_t* HOST_PROF;   // NULL: not profiling
+extern __thread host_prof_t* HOST_PROF_THREAD;   // the calling host thread's (HOST_PROF on the main thread)
+
+class host_prof_scope_t {
+public:
+   host_prof_scope_t(host_prof_e b, bool on = true) : b(b), prof(on ? HOST_PROF_THREAD : NULL) {
+      if (prof)
+         prof->begin(b);
+   }
+   ~host_prof_scope_t() {
+      if (prof)
+         prof->end(b);
+   }
+
+private:
+   host_prof_e b;
+   host_prof_t* prof;
+};
+
+// Time the rest of the enclosing block (at most one per block).
+#define HOST_PROF_SCOPE(b)   host_prof_scope_t host_prof_scope(b)
+
+#endif //HOST_PROF_H
@@ -4,6 +4,7 @@
 #include "CacheClass.h"
 #include "fetchunit_types.h"
 #include "ic.h"
+#include "tlb.h"
 
 
 ic_t::ic_t(bool perfect,
@@ -21,7 +22,11 @@ ic_t::ic_t(bool perfect,
 	   CacheClass *L2C) {
    this->perfect = perfect;
    this->mmu = mmu;
+   this->TLB = (tlb_hierarchy_t *) NULL;
+   this->L2C = L2C;
    IC = new CacheClass(sets, assoc, line_size, hit_latency, miss_latency, num_MHSRs, miss_srv_ports, miss_srv_latency, proc, "l1_ic", L2C);
+   this->shared = false;
+   this->Tid = 0;
    this->line_size = line_size;
    this->fetch_width = fetch_width;
 
@@ -38,6 +43,16 @@ ic_t::ic_t(bool perfect,
 ic_t::~ic_t() {
 }
 
+// Use another SMT thread's I$ and L2$ (see smt.h). Accesses are tagged with this thread's id.
+void ic_t::share(CacheClass *IC, CacheClass *L2C, unsigned int Tid) {
+   if (!shared)
+      delete this->IC;
+   this->IC = IC;
+   this->L2C = L2C;
+   this->Tid = Tid;
+   shared = true;
+}
+
 // Inputs:
 // 1. cycle: This is the current cycle.
 // 2. pc: This is the start PC of the fetch bundle.
@@ -52,6 +67,18 @@ bool ic_t::lookup(cycle_t cycle, uint64_t pc, fetch_bundle_t bundle[], cycle_t &
    bool hit1, hit2;
    cycle_t resolve_cycle1, resolve_cycle2;
 
+   //////////////////////////////////////////////////////
+   // Model ITLB misses.
+   //////////////////////////////////////////////////////
+
+   if (TLB) {
+      cycle_t ready = TLB->translate(cycle, pc, true);
+      if (ready > cycle) {
+         miss_resolve_cycle = ready;
+         return(false);	// Retry when the translation is available.
+      }
+   }
+
    //////////////////////////////////////////////////////
    // Model I$ misses.
    //////////////////////////////////////////////////////
@@ -60,8 +87,8 @@ bool ic_t::lookup(cycle_t cycle, uint64_t pc, fetch_bundle_t bundle[], cycle_t &
       // Model an interleaved I$ with two banks: fetch two consecutive lines, starting with the line that the pc falls within.
       line1 = (pc >> line_size);
       line2 = (pc >> line_size) + 1;
-      resolve_cycle1 = IC->Access(0, cycle, (line1 << line_size), false, &hit1);
-      resolve_cycle2 = IC->Access(0, cycle, (line2 << line_size), false, &hit2);
+      resolve_cycle1 = IC->Access(Tid, cycle, (line1 << line_size), false, &hit1);
+      resolve_cycle2 = IC->Access(Tid, cycle, (line2 << line_size), false, &hit2);
 
       if (!hit1 || !hit2) {
          miss_resolve_cycle = MAX((hit1 ? (cycle_t)0 : resolve_cycle1), (hit2 ? (cycle_t)0 : resolve_cycle2));
@@ -93,3 +120,35 @@ bool ic_t::lookup(cycle_t cycle, uint64_t pc, fetch_bundle_t bundle[], cycle_t &
 
    return(true);	// I$ hit, and the miss_resolve_cycle is a dont-care.
 }
+
+// Inputs:
+// 1. cycle: This is the current cycle.
+// 2. pc: This is the start PC of a predicted fetch bundle in the fetch target queue.
+//
+// Prefetch the two lines that ic_t::lookup() will access for this fetch bundle.
+// A line that can't get an I$ MHSR is prefetched into the L2$ instead, so that the eventual I$ miss is short.
+// With TLB timing, the prefetch is issued when its translation is available.
+void ic_t::prefetch(cycle_t cycle, uint64_t pc) {
+   if (perfect)
+      return;
+
+   if (TLB)
+      cycle = TLB->translate(cycle, pc, true);
+
+   for (uint64_t line = (pc >> line_size); line <= ((pc >> line_size) + 1); line++) {
+      if (!IC->IssuePrefetch(Tid, cycle, (line << line_size)) && L2C)
+         L2C->IssuePrefetch(Tid, cycle, (line << line_size));
+   }
+}
+
+// Warm the ITLB and the two lines that ic_t::lookup() will access for the fetch bundle starting at pc.
+void ic_t::warm(uint64_t pc) {
+   if (TLB)
+      TLB->warm(pc, true);
+
+   if (perfect)
+      return;
+
+   for (uint64_t line = (pc >> line_size); line <= ((pc >> line_size) + 1); line++)
+      IC->Warm(Tid, (line << line_size), false);
+}
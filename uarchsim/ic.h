@@ -1,9 +1,15 @@
 
+class tlb_hierarchy_t;
+
 class ic_t {
 private:
 	bool perfect;		// If true, I$ always hits.
 	mmu_t *mmu;		// Currently, IC does not actually hold the instructions; it just models timing. Thus, we get instructions from the mmu.
 	CacheClass *IC;		// Instruction cache.
+	CacheClass *L2C;	// L2 cache that backs the instruction cache (NULL if none).
+	bool shared;		// If true, IC belongs to another SMT thread.
+	unsigned int Tid;	// Thread id of accesses to a shared IC.
+	tlb_hierarchy_t *TLB;	// ITLB timing (NULL: translation is free).
 	uint64_t line_size;	// Log2 of line size (where line size is in bytes).
 	uint64_t fetch_width;	// Number of instructions in a full fetch bundle. We assert that (fetch_width == (1 << (line_size - 2))). The 2 is for a 4-byte instr.
 
@@ -23,5 +29,20 @@ public:
 	     CacheClass *L2C);
 	~ic_t();
 
+	void set_tlb(tlb_hierarchy_t *tlb) { TLB = tlb; }
+
+	// Share another SMT thread's I$ and L2$.
+	void share(CacheClass *IC, CacheClass *L2C, unsigned int Tid);
+	CacheClass *get_cache() { return IC; }
+	bool is_perfect() { return perfect; }
+
 	bool lookup(cycle_t cycle, uint64_t pc, fetch_bundle_t bundle[], cycle_t &miss_resolve_cycle);
+
+	// Functional warming of the ITLB and the two lines that lookup() would access (see fetchunit_t::warm()).
+	void warm(uint64_t pc);
+	// Fetch-directed prefetch of the fetch bundle starting at pc (see fetchunit.h).
+	void prefetch(cycle_t cycle, uint64_t pc);
+
+	// Output the I$'s prefetch measurements, if any.
+	void dump_stats(FILE *fp) { if (!shared) IC->dump_stats(fp); }
 };
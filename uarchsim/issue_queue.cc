@@ -96,6 +96,7 @@ void issue_queue::wakeup(unsigned int tag) {
 	// (2) Set the ready bit.
   
 
+  HOST_PROF_SCOPE(HP_IQ_WAKEUP);
   inc_counter(wakeup_cam_read_count);
 
 	for (unsigned int i = 0; i < size; i++) {
@@ -129,18 +130,19 @@ void issue_queue::wakeup(unsigned int tag) {
 	}
 }
 
-void issue_queue::select_and_issue(unsigned int num_lanes, lane* Execution_Lanes) {
+unsigned int issue_queue::select_and_issue(unsigned int num_lanes, lane* Execution_Lanes, unsigned int busy_lanes) {
    unsigned int i, j;
    bool issue;
    unsigned int dyn_lane_id;
    bool issuedThisCycle = false;
+   unsigned int issued_lanes = 0;
 
    // Set up the first IQ index to be examined this cycle.
    if (IDEAL_AGE_BASED) {
       if (oldest == -1) { // IQ empty, so no age-based list to sequence through.
          assert(youngest == -1);
 	 assert(length == 0);
-         return;
+         return(0);
       }
       else {
          i = (unsigned int)oldest;  // Start sequencing at oldest instruction in the IQ.
@@ -160,14 +162,14 @@ void issue_queue::select_and_issue(unsigned int num_lanes, lane* Execution_Lanes
       if (q[i].valid && (!q[i].A_valid || q[i].A_ready) && (!q[i].B_valid || q[i].B_ready) && (!q[i].D_valid || q[i].D_ready)) {
          if (PRESTEER) {
             // Check if the instruction's desired Execution Lane is free.
-	    issue = !Execution_Lanes[q[i].lane_id].rr.valid;
+	    issue = (!Execution_Lanes[q[i].lane_id].rr.valid && !(busy_lanes & (1 << q[i].lane_id)));
 	 }
 	 else {
 	    // Check if there is a free Execution Lane among all candidate lanes.
             issue = false;
 	    dyn_lane_id = 0;
 	    while (!issue && (dyn_lane_id < num_lanes)) {
-	       if ((q[i].lane_id & (1 << dyn_lane_id)) && !Execution_Lanes[dyn_lane_id].rr.valid) {
+	       if ((q[i].lane_id & (1 << dyn_lane_id)) && !Execution_Lanes[dyn_lane_id].rr.valid && !(busy_lanes & (1 << dyn_lane_id))) {
 		  issue = true;
                   q[i].lane_id = dyn_lane_id;
 	       }
@@ -185,6 +187,7 @@ void issue_queue::select_and_issue(unsigned int num_lanes, lane* Execution_Lanes
             Execution_Lanes[q[i].lane_id].rr.valid = true;
             Execution_Lanes[q[i].lane_id].rr.index = q[i].index;
             Execution_Lanes[q[i].lane_id].rr.chkpt_id = q[i].chkpt_id;
+            issued_lanes |= (1 << q[i].lane_id);
 
             // Remove the instruction from the issue queue.
             remove(i);
@@ -217,6 +220,8 @@ void issue_queue::select_and_issue(unsigned int num_lanes, lane* Execution_Lanes
    part_next += part_size;
    if (part_next == size)
       part_next = 0;
+
+   return(issued_lanes);
 }
 
 void issue_queue::remove(unsigned int i) {
@@ -71,12 +71,15 @@ private:
 public:
 	issue_queue(unsigned int size, unsigned int num_parts, pipeline_t* _proc=NULL);	// constructor
 	bool stall(unsigned int bundle_inst);
+	unsigned int get_length() { return(length); }
 	void dispatch(unsigned int index, unsigned long long chkpt_id, unsigned int lane_id,
 	              bool A_valid, bool A_ready, unsigned int A_tag,
 	              bool B_valid, bool B_ready, unsigned int B_tag,
 	              bool D_valid, bool D_ready, unsigned int D_tag);
 	void wakeup(unsigned int tag);
-	void select_and_issue(unsigned int num_lanes, lane* Execution_Lanes);
+	// busy_lanes: bit vector of lanes that other SMT threads issued to this cycle.
+	// Returns the bit vector of lanes issued to.
+	unsigned int select_and_issue(unsigned int num_lanes, lane* Execution_Lanes, unsigned int busy_lanes);
 	void flush();
 	void clear_branch_bit(unsigned int branch_ID);
 	void squash(uint64_t squash_mask);
@@ -15,6 +15,7 @@ bool lsu::disambiguate(unsigned int lq_index,
 	bool stall;		// return value
 	uint64_t max_size;
 	uint64_t mask;
+	HOST_PROF_SCOPE(HP_LSU_DISAMBIG);
 
 	// Check if the load is logically at the head of the SQ, i.e., no prior stores.
 	if ((sq_index == sq_head) && (sq_index_phase == sq_head_phase)) {
@@ -108,6 +109,14 @@ void lsu::set_l2_cache(CacheClass* l2_dc){
 	DC->set_nextLevel(l2_dc);
 }
 
+// Use another SMT thread's D$, and its ports and banks, instead of this LSU's own.
+void lsu::share_dcache(lsu* owner){
+	if (dc_owner == this)
+		delete DC;
+	DC = owner->DC;
+	dc_owner = owner;
+}
+
 lsu::lsu(unsigned int lq_size, unsigned int sq_size, unsigned int Tid, mmu_t* _mmu, pipeline_t* _proc):
       proc(_proc),
       mmu(_mmu)
@@ -126,6 +135,18 @@ lsu::lsu(unsigned int lq_size, unsigned int sq_size, unsigned int Tid, mmu_t* _m
                         _proc,
                         "l1_dc",
                         _proc->L2C);
+	DC->set_prefetcher(new_prefetcher(L1_DC_PREFETCHER, L1_DC_PF_DEGREE, L1_DC_LINE_SIZE));
+	dc_owner = this;
+
+	TLB = (tlb_hierarchy_t *) NULL;
+
+	// D$ ports and banks.
+	dc_cycle = 0;
+	dc_rd_used = 0;
+	dc_wr_used = 0;
+	dc_bank_cycle.assign(L1_DC_BANKS, (cycle_t)-1);
+	dc_bank_line.assign(L1_DC_BANKS, 0);
+	dc_bank_write.assign(L1_DC_BANKS, false);
 
 	// LQ initialization.
 	this->lq_size = lq_size;
@@ -164,10 +185,15 @@ lsu::lsu(unsigned int lq_size, unsigned int sq_size, unsigned int Tid, mmu_t* _m
 	n_false_stall = 0;
 	n_load_violation = 0;
 	n_cpr_deadlock_kluge = 0;
+	n_port_stall_l = 0;
+	n_port_stall_s = 0;
+	n_bank_stall_l = 0;
+	n_bank_stall_s = 0;
 }
 
 lsu::~lsu(){
-  delete DC;
+  if (dc_owner == this)
+    delete DC;
 }
 
 bool lsu::stall(unsigned int bundle_load, unsigned int bundle_store) {
@@ -355,9 +381,15 @@ void lsu::store_addr(cycle_t cycle,
 
    if (!PERFECT_DCACHE) {
       bool hit;
-      SQ[sq_index].miss_resolve_cycle = DC->Access(Tid, cycle, addr, true, &hit);
+      // The D$ is accessed once the address is translated.
+      cycle_t ready = (TLB ? TLB->translate(cycle, addr, false) : cycle);
+      SQ[sq_index].miss_resolve_cycle = DC->Access(Tid, ready, addr, true, &hit, false, true, proc->PAY.buf[SQ[sq_index].pay_index].pc);
       SQ[sq_index].missed = !hit;
 
+      // Multi-core: the store also needs the line in M, like a read-for-ownership.
+      if (proc->COH && (SQ[sq_index].miss_resolve_cycle != -1))
+         SQ[sq_index].miss_resolve_cycle = MAX(SQ[sq_index].miss_resolve_cycle, proc->COH->write(Tid, ready, addr, SQ[sq_index].amo));
+
       if (!hit) inc_counter(spec_store_miss_count);
       if (SQ[sq_index].miss_resolve_cycle == -1) inc_counter(store_mhsr_miss_count);
    }
@@ -395,10 +427,18 @@ bool lsu::load_addr(cycle_t cycle,
     dump_lq(proc,lq_index,proc->lsu_log);
   #endif
 
-	if (!PERFECT_DCACHE) {
+	// The D$ is accessed once the address is translated.
+	cycle_t ready = (TLB ? TLB->translate(cycle, addr, false) : cycle);
+
+	if (!PERFECT_DCACHE && (ready == cycle) && !dc_port(cycle, addr, false)) {
+		// No D$ read port or bank this cycle: retry from load_unstall(), like a load that did not get an MHSR.
+		LQ[lq_index].miss_resolve_cycle = -1;
+		LQ[lq_index].missed = true;
+	}
+	else if (!PERFECT_DCACHE) {
 		bool hit;
-		LQ[lq_index].miss_resolve_cycle = DC->Access(Tid, cycle, addr, false, &hit);
-		LQ[lq_index].missed = !hit;
+		LQ[lq_index].miss_resolve_cycle = DC->Access(Tid, ready, addr, false, &hit, false, true, proc->PAY.buf[LQ[lq_index].pay_index].pc);
+		LQ[lq_index].missed = (!hit || (ready > cycle));
     if(!hit){
       inc_counter(spec_load_miss_count);
     }
@@ -407,6 +447,11 @@ bool lsu::load_addr(cycle_t cycle,
     }
 
 	}
+	else if (ready > cycle) {
+		// DTLB miss with a perfect D$.
+		LQ[lq_index].miss_resolve_cycle = ready;
+		LQ[lq_index].missed = true;
+	}
 
 	// Run the load through the load execution datapath.
 	execute_load(cycle, lq_index, lq_index_phase, sq_index, sq_index_phase);
@@ -424,10 +469,11 @@ bool lsu::load_unstall(cycle_t cycle, unsigned int& pay_index, reg_t& value) {
       assert(LQ[scan].valid);
       if (LQ[scan].addr_avail && !LQ[scan].value_avail) {
          // If this load did not get an MHSR during initial execution, access the D$ again.
-         if (!PERFECT_DCACHE && (LQ[scan].miss_resolve_cycle == -1)) {
+         if (!PERFECT_DCACHE && (LQ[scan].miss_resolve_cycle == -1) && dc_port(cycle, LQ[scan].addr, false)) {
             bool hit;
             assert(LQ[scan].addr_avail);
-            LQ[scan].miss_resolve_cycle = DC->Access(Tid, cycle, LQ[scan].addr, false, &hit);
+            cycle_t ready = (TLB ? TLB->translate(cycle, LQ[scan].addr, false) : cycle);
+            LQ[scan].miss_resolve_cycle = DC->Access(Tid, ready, LQ[scan].addr, false, &hit, false, true, proc->PAY.buf[LQ[scan].pay_index].pc);
             LQ[scan].missed = !hit;
          }
 
@@ -490,7 +536,17 @@ void lsu::execute_load(cycle_t cycle,
 	      // This should be rare, so rather than model the complexity of partial store-load forwarding,
 	      // let's "cheat" by using the actual load value from the functional simulator.
 	      // Count how often we had to do this to gauge simulation error.
-	      if (proc->PAY.buf[LQ[lq_index].pay_index].good_instruction) {
+	      if (!FUNCTIONAL_ORACLE) {
+	         // No functional simulator to cheat from: merge the store over committed memory instead.
+	         try {
+	            LQ[lq_index].value = partial_forward(lq_index, store_entry);
+	         }
+	         catch (mem_trap_t& t) {
+	            proc->set_exception(proc->PAY.buf[LQ[lq_index].pay_index].chkpt_id);
+	            proc->PAY.buf[LQ[lq_index].pay_index].trap.post(t);
+	         }
+	      }
+	      else if (proc->PAY.buf[LQ[lq_index].pay_index].good_instruction) {
                  db_t *actual = proc->get_pipe()->peek(proc->PAY.buf[LQ[lq_index].pay_index].db_index);
 	         LQ[lq_index].value = actual->a_rdst[0].value;
 	      }
@@ -605,6 +661,9 @@ void lsu::execute_load(cycle_t cycle,
 					assert(0);
 					break;
 			}
+			// Parallel host threads: this core's stores of the quantum are not in memory yet.
+			if (proc->QSTORES)
+				LQ[lq_index].value = proc->QSTORES->load(LQ[lq_index].addr, LQ[lq_index].size, LQ[lq_index].is_signed, LQ[lq_index].value);
     } 
     catch (mem_trap_t& t)
 	  {
@@ -630,6 +689,33 @@ void lsu::execute_load(cycle_t cycle,
 }
 
 
+reg_t lsu::partial_forward(unsigned int lq_index, unsigned int store_entry) {
+	reg_t value = 0;
+	reg_t byte;
+	reg_t addr;
+
+	for (unsigned int i = 0; i < LQ[lq_index].size; i++) {
+		addr = LQ[lq_index].addr + i;
+		if ((addr >= SQ[store_entry].addr) && (addr < (SQ[store_entry].addr + SQ[store_entry].size))) {
+			byte = ((SQ[store_entry].value >> ((addr - SQ[store_entry].addr) << 3)) & 0xff);
+		}
+		else {
+			byte = (reg_t)mmu->load_uint8(addr);   // May throw a mem_trap_t.
+			if (proc->QSTORES)
+				byte = proc->QSTORES->load(addr, 1, false, byte);
+		}
+		value |= (byte << (i << 3));
+	}
+
+	// Sign-extend.
+	if (LQ[lq_index].is_signed && (LQ[lq_index].size < 8)) {
+		unsigned int shamt = (64 - (LQ[lq_index].size << 3));
+		value = (reg_t)(((sreg_t)(value << shamt)) >> shamt);
+	}
+
+	return(value);
+}
+
 void lsu::checkpoint(unsigned int& chkpt_lq_tail, bool& chkpt_lq_tail_phase,
                      unsigned int& chkpt_sq_tail, bool& chkpt_sq_tail_phase) {
 	chkpt_lq_tail = lq_tail;
@@ -704,6 +790,66 @@ void lsu::restore(unsigned int recover_lq_tail, bool recover_lq_tail_phase,
 	}
 }
 
+bool lsu::warm(reg_t pc, reg_t addr, unsigned int size, bool load, bool store, uint64_t seq) {
+   bool trained = false;
+
+   if (TLB)
+      TLB->warm(addr, false);
+   if (!PERFECT_DCACHE) {
+      DC->Warm(Tid, addr, store);
+      if (store && proc->COH)
+         proc->COH->warm(Tid, addr, true);
+   }
+
+   if (load && SPEC_DISAMBIG && MEM_DEP_PRED) {
+      for (std::deque<warm_store_t>::reverse_iterator st = warm_stores.rbegin(); st != warm_stores.rend(); st++) {
+         if ((seq - st->seq) > ACTIVE_LIST_SIZE)
+            break;
+         if ((addr < (st->addr + st->size)) && (st->addr < (addr + size))) {
+            MDP[pc] = MDP_MAX;
+            trained = true;
+            break;
+         }
+      }
+   }
+
+   if (store) {
+      warm_store_t st = {addr, size, seq};
+      warm_stores.push_back(st);
+      if (warm_stores.size() > sq_size)
+         warm_stores.pop_front();
+   }
+
+   return(trained);
+}
+
+void lsu::save_warm(std::vector<warm_section_t>& sections) {
+   DC->save_warm(sections);
+
+   // The MDP: pairs of load PC and counter.
+   warm_section_t& s = new_warm_section(sections, "mdp");
+   for (std::map<uint64_t, uint64_t>::iterator it = MDP.begin(); it != MDP.end(); it++) {
+      s.data.push_back(it->first);
+      s.data.push_back(it->second);
+   }
+}
+
+bool lsu::restore_warm(const warm_section_t& s) {
+   if (s.name == DC->name())
+      return(DC->restore_warm(s));
+
+   if (s.name == "mdp") {
+      if (s.data.size() % 2)
+         return(false);
+      // Counters saturate at this configuration's maximum.
+      MDP.clear();
+      for (size_t i = 0; i < s.data.size(); i += 2)
+         MDP[s.data[i]] = ((s.data[i+1] > MDP_MAX) ? MDP_MAX : s.data[i+1]);
+      return(true);
+   }
+   return(false);
+}
+
 void lsu::train(bool load) {
    if (load) {
       // LQ should not be empty.
@@ -752,6 +898,57 @@ void lsu::train(bool load) {
    }
 }
 
+// D$ port and bank arbitration, for loads at execute and stores at commit (see lsu.h).
+bool lsu::dc_port(cycle_t cycle, reg_t addr, bool isStore) {
+   lsu* p = dc_owner;   // SMT threads sharing the D$ share its ports and banks
+
+   // New cycle: all ports are free.
+   if (cycle != p->dc_cycle) {
+      p->dc_cycle = cycle;
+      p->dc_rd_used = 0;
+      p->dc_wr_used = 0;
+   }
+
+   if (isStore ? (L1_DC_WR_PORTS && (p->dc_wr_used == L1_DC_WR_PORTS)) :
+                 (L1_DC_RD_PORTS && (p->dc_rd_used == L1_DC_RD_PORTS))) {
+      if (isStore)
+         n_port_stall_s++;
+      else
+         n_port_stall_l++;
+      return(false);
+   }
+
+   if (L1_DC_BANKS > 1) {
+      unsigned int bank = ((addr >> L1_DC_BANK_SIZE) % L1_DC_BANKS);
+      reg_t line = (addr >> L1_DC_LINE_SIZE);
+      if (p->dc_bank_cycle[bank] == cycle) {
+         if (isStore || p->dc_bank_write[bank] || (p->dc_bank_line[bank] != line)) {
+            if (isStore)
+               n_bank_stall_s++;
+            else
+               n_bank_stall_l++;
+            return(false);
+         }
+      }
+      p->dc_bank_cycle[bank] = cycle;
+      p->dc_bank_line[bank] = line;
+      p->dc_bank_write[bank] = isStore;
+   }
+
+   if (isStore)
+      p->dc_wr_used++;
+   else
+      p->dc_rd_used++;
+   return(true);
+}
+
+bool lsu::store_commit_port(cycle_t cycle) {
+   assert(sq_length > 0);
+   if (PERFECT_DCACHE)
+      return(true);
+   return(dc_port(cycle, SQ[sq_head].addr, true));
+}
+
 // Stores are written out to the cache/memory system at the time of commit
 bool lsu::commit(bool load, bool atomic_op) {
    bool atomic_success = true;
@@ -786,23 +983,27 @@ bool lsu::commit(bool load, bool atomic_op) {
       else {
          // Commit the store. There shouldn't be a store exception if we've reached this point (see catch() below).
          try {
-            // Commit store data.
-            switch (SQ[sq_head].size) {
-               case 1:
-                  mmu->store_uint8(SQ[sq_head].addr, SQ[sq_head].value);
-                  break;                            
-               case 2:                             
-                  mmu->store_uint16(SQ[sq_head].addr, SQ[sq_head].value);
-                  break;                            
-               case 4:                             
-                  mmu->store_uint32(SQ[sq_head].addr, SQ[sq_head].value);
-                  break;                            
-               case 8:                             
-                  mmu->store_uint64(SQ[sq_head].addr, SQ[sq_head].value);
-                  break;
-               default:
-                  assert(0);
-                  break;
+            // Commit store data (parallel host threads: to the quantum's stores).
+            if (proc->QSTORES)
+               proc->QSTORES->store(mmu, SQ[sq_head].addr, SQ[sq_head].size, SQ[sq_head].value);
+            else {
+               switch (SQ[sq_head].size) {
+                  case 1:
+                     mmu->store_uint8(SQ[sq_head].addr, SQ[sq_head].value);
+                     break;
+                  case 2:
+                     mmu->store_uint16(SQ[sq_head].addr, SQ[sq_head].value);
+                     break;
+                  case 4:
+                     mmu->store_uint32(SQ[sq_head].addr, SQ[sq_head].value);
+                     break;
+                  case 8:
+                     mmu->store_uint64(SQ[sq_head].addr, SQ[sq_head].value);
+                     break;
+                  default:
+                     assert(0);
+                     break;
+               }
             }
          } 
          catch (mem_trap_t& t) {
@@ -927,6 +1128,17 @@ void lsu::dump_stats(FILE* fp) {
 	fprintf(fp, "MDP quick stats\n");
 	fprintf(fp, "  false stalls     = %d\n", n_false_stall);
 	fprintf(fp, "  load violations  = %d\n", n_load_violation);
+
+	if (L1_DC_RD_PORTS || L1_DC_WR_PORTS || (L1_DC_BANKS > 1)) {
+		fprintf(fp, "D$ PORTS AND BANKS (deferred accesses)\n");
+		fprintf(fp, "  loads: no port   = %d\n", n_port_stall_l);
+		fprintf(fp, "  loads: bank conf.= %d\n", n_bank_stall_l);
+		fprintf(fp, "  stores: no port  = %d\n", n_port_stall_s);
+		fprintf(fp, "  stores: bank conf= %d\n", n_bank_stall_s);
+	}
+
+	if (dc_owner == this)
+		DC->dump_stats(fp);
 }
 
 
@@ -7,6 +7,7 @@
 // 3. Committed memory state.
 ///////////////////////////////////////////////////////////////
 //#include "CcacheClass.h"
+#include <deque>
 
 // Single entry in the load-store queue.
 typedef struct {
@@ -54,6 +55,7 @@ typedef struct {
 class mmu_t;
 class pipeline_t;
 class CacheClass;
+class tlb_hierarchy_t;
 class stats_t;
 
 class lsu {
@@ -93,13 +95,34 @@ private:
   // Data Cache
   //////////////////////////
   CacheClass* DC;
+  lsu* dc_owner;        // LSU whose DC this is: this, or another SMT thread's (see smt.h)
   unsigned int Tid;
 
+  // DTLB timing (NULL: translation is free).
+  tlb_hierarchy_t* TLB;
+
+  // D$ read/write ports and banks in use this cycle (see dc_port()).
+  // SMT threads sharing a D$ arbitrate for them in its owner's copy.
+  cycle_t dc_cycle;
+  unsigned int dc_rd_used;
+  unsigned int dc_wr_used;
+  std::vector<cycle_t> dc_bank_cycle;   // cycle in which the bank was last used
+  std::vector<reg_t> dc_bank_line;      // line it read or wrote in that cycle
+  std::vector<bool> dc_bank_write;
+
   /////////////////////////////////////////////////////////////
   // Memory dependence predictor (MDP)
   /////////////////////////////////////////////////////////////
   std::map<uint64_t, uint64_t> MDP;
 
+  // Functional warming (see warm()): the most recent stores, oldest first.
+  typedef struct {
+    reg_t addr;
+    unsigned int size;
+    uint64_t seq;       // instruction number
+  } warm_store_t;
+  std::deque<warm_store_t> warm_stores;
+
   //////////////////////////
   // Memory
   //////////////////////////
@@ -130,6 +153,12 @@ private:
   // Count how often there was a conflicting store and load, of different sizes, in the same checkpoint interval.
   unsigned int n_cpr_deadlock_kluge;
 
+  // D$ accesses by loads (l) or committing stores (s) deferred for lack of a port or by a bank conflict.
+  unsigned int n_port_stall_l;
+  unsigned int n_port_stall_s;
+  unsigned int n_bank_stall_l;
+  unsigned int n_bank_stall_s;
+
   //////////////////////////
   //  Private functions
   //////////////////////////
@@ -150,11 +179,21 @@ private:
                     unsigned int& store_entry,
 		    bool& partial);
 
+  // Arbitrate for a D$ read port (load) or write port (committing store) and the
+  // address's bank in this cycle. Returns false if the access must retry in a later cycle.
+  // Loads to the same line share a bank's read in the same cycle.
+  bool dc_port(cycle_t cycle, reg_t addr, bool isStore);
+
   // The load execution datapath.
   void execute_load(cycle_t cycle,
                     unsigned int lq_index, bool lq_index_phase,
                     unsigned int sq_index, bool sq_index_phase);
 
+  // Without the functional oracle: value of a load that partially overlaps an older
+  // store in the same checkpoint interval, formed by merging the store's bytes over
+  // committed memory.
+  reg_t partial_forward(unsigned int lq_index, unsigned int store_entry);
+
   // The path for stores to detect mispredicted loads.
   bool ld_violation(unsigned int sq_index,
                     unsigned int lq_index, bool lq_index_phase,
@@ -170,8 +209,13 @@ public:
   ~lsu();
 
   void set_l2_cache(CacheClass* l2_dc);
+  void share_dcache(lsu* owner);
+  CacheClass* get_dcache() { return DC; }
+  void set_tlb(tlb_hierarchy_t* tlb) { TLB = tlb; }
 
   bool stall(unsigned int bundle_load, unsigned int bundle_store);
+  unsigned int get_lq_length() { return lq_length; }
+  unsigned int get_sq_length() { return sq_length; }
 
   void dispatch(bool load, unsigned int size, bool left, bool right, bool is_signed, bool amo,
                 unsigned int pay_index,
@@ -198,6 +242,20 @@ public:
                unsigned int recover_sq_tail, bool recover_sq_tail_phase);
 
   void train(bool load);
+
+  // Functional warming during fast-skip (see pipeline_t::warm()): the DTLB, D$ and the
+  // levels behind them, and the MDP. 'seq' numbers the instructions. A load that reads
+  // bytes of one of the last SQ-size stores, within an Active List's worth of instructions,
+  // would likely have issued before the store in the timing model: the MDP learns it.
+  // Returns true if it trained the MDP.
+  bool warm(reg_t pc, reg_t addr, unsigned int size, bool load, bool store, uint64_t seq);
+
+  // Save or restore the warm state of the D$ and MDP (see warm_state.h).
+  // restore_warm() returns false if the section is not the LSU's, or its geometry differs.
+  void save_warm(std::vector<warm_section_t>& sections);
+  bool restore_warm(const warm_section_t& section);
+  // Returns false if the store at the head of the SQ cannot write the D$ this cycle.
+  bool store_commit_port(cycle_t cycle);
   bool commit(bool load, bool atomic_op);
 
   void flush();
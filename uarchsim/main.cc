@@ -13,23 +13,53 @@
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+#include <cinttypes>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "debug.h"
 #include "parameters.h"
+#include "prefetcher.h"
+#include "value_predictor.h"
+#include "smt.h"
+#include "pipeline.h"
+#include "trace_file.h"
+#include "synth.h"
+#include "snapshot.h"
 #include <signal.h>
+#include <math.h>
 
 static void help()
 {
-  fprintf(stderr, "usage: micros [host options] <target program> [target options]\n");
+  fprintf(stderr, "usage: micros [host options] <target program> [target options] [:: <target program> [target options] ...]\n");
+  fprintf(stderr, "       micros [host options] --synth=<knobs> -e<n>\n");
   fprintf(stderr, "Host Options:\n");
   fprintf(stderr, "  -c<gz_chkpt_file>  Start simulation from a .gz checkpoint file.\n");
   fprintf(stderr, "  -d                 Interactive debug mode\n");
   fprintf(stderr, "  -e<n>              End simulation after <n> instructions have been committed by microarchitectural simulation\n");
   fprintf(stderr, "  -g                 Track histogram of PCs\n");
+  fprintf(stderr, "  --histtop=<n>      Dump only the <n> hottest PCs and <n> most mispredicted branches (0: all, default 100)\n");
   fprintf(stderr, "  -h                 Print this help message\n");
   fprintf(stderr, "  -l<n>              Enable logging after <n> commits if compiled with support\n");
   fprintf(stderr, "  -m<n>              Provide <n> MB of target memory\n");
-  fprintf(stderr, "  -p<n>              Simulate <n> processors\n");
+  fprintf(stderr, "  -p<n>              Simulate <n> processors. The timing simulator's cores (2..%d, with --nooracle) have private L1 and L2 caches kept coherent by a MESI directory, and share core 0's L3 and DRAM\n", MC_MAX_CORES);
+  fprintf(stderr, "  --coh=<banks>,<busy>,<dir>,<hop>\tWith -p<n>: the shared L3 has <banks> banks, each busy <busy> cycles per access; a directory lookup takes <dir> cycles and an interconnect hop <hop> cycles\n");
+  fprintf(stderr, "  --parallel=<threads>[,<quantum>[,det|relaxed]]\tWith -p<n>: step the cores on <threads> host threads, synchronizing every <quantum> cycles (default 1000); relaxed: grow the quantum while the cores do not interact\n");
   fprintf(stderr, "  -s<n>              Fast skip <n> instructions before microarchitectural simulation\n");
+  fprintf(stderr, "  --warm=<n>         Functionally warm the caches, TLBs and predictors during the last <n> instructions of -s\n");
+  fprintf(stderr, "  --sweep=<file>[,<jobs>]\tAfter -s or -c, simulate the region once per line of <file> (options, e.g. --iq=32,4 --al=128),\n");
+  fprintf(stderr, "                     in <jobs> forked processes at a time (default: one per host CPU). The host must be able to\n");
+  fprintf(stderr, "                     commit the target memory (-m, default 4 GB) once more per process: a smaller -m helps\n");
+  fprintf(stderr, "  --trace=<file>     Record the functional simulator's instruction stream of the timing region in <file>\n");
+  fprintf(stderr, "  --replay=<file>    Feed the timing simulator's oracle from a trace recorded with the same -s/-c, instead of the functional simulator\n");
+  fprintf(stderr, "  --mkchkpt=<file>   After -s (and --warm), write a checkpoint with the warm caches and predictors to <file> and exit\n");
+  fprintf(stderr, "  --synth=<knobs>    Run a generated program instead of a target program (no HTIF; requires -e). <knobs> is a list of <key>=<value>:\n");
+  fprintf(stderr, "                     seed, code=<bytes>, data=<bytes>, dep=<distance>, ld/st/br/fp/call=<%%>, bias=<%% predictable branches>,\n");
+  fprintf(stderr, "                     addr=stride|random|chase, stride=<bytes> (see synth.h)\n");
   fprintf(stderr, "  --perf=<pbp>,<pdc>,<pic>,<ptc>\tEach of pbp (perf. branch pred.), pdc (perf. D$), pic (perf. I$), and ptc (perf. T$), are 0 or 1\n");
   fprintf(stderr, "  --cp=<n>           <n> branch checkpoints for mispredict recovery\n");
 
@@ -37,16 +67,23 @@ static void help()
   fprintf(stderr, "  --btbentries=<n>   BTB has a total of <n> entries\n");
   fprintf(stderr, "  --btbassoc=<n>     BTB has a set-associativity of <n>\n");
   fprintf(stderr, "  --ras=<n>          RAS has <n> entries\n");
+  fprintf(stderr, "  --ftq=<n>          Decouple the branch predictor with an <n>-bundle fetch target queue, and prefetch its targets into the I$ (FDIP); 0 to disable\n");
   fprintf(stderr, "  --mbp=<n>          The conditional branch predictor (whether real or perfect) can predict a maximum of <n> conditional branches per cycle\n");
   fprintf(stderr, "  --cbpPC=<n>        The gshare-indexed conditional branch predictor uses <n> bits of PC\n");
   fprintf(stderr, "  --cbpBHR=<n>       The gshare-indexed conditional branch predictor uses <n> bits of BHR\n");
   fprintf(stderr, "  --ibpPC=<n>        The gshare-indexed indirect branch predictor uses <n> bits of PC\n");
   fprintf(stderr, "  --ibpBHR=<n>       The gshare-indexed indirect branch predictor uses <n> bits of BHR\n");
   fprintf(stderr, "  -t                 Enable trace cache\n");
+  fprintf(stderr, "  --vp=<type>[,<entries>[,<conf>]]\tValue predictor: <type> is none, lvp (last value), stride, or vtage; <entries> per table; predict at confidence >= <conf> (1..%d)\n", VP_CONF_MAX);
+  fprintf(stderr, "  --vploads=<0|1>    1: predict only load values\n");
 
   fprintf(stderr, "  --fq=<n>           Fetch queue has <n> entries\n");
   fprintf(stderr, "  --al=<n>           Active List has <n> entries\n");
   fprintf(stderr, "  --prf=<n>          Physical Register File has <n> physical registers\n");
+  fprintf(stderr, "  --prfports=<r>,<w>[,<b>[,<bypass>]]\tPhysical Register File has <r> read and <w> write ports per cycle (0: unlimited, default) in each of <b> banks (default 1), and a bypass network holding the last <bypass> cycles of results (default 1)\n");
+  fprintf(stderr, "  --elim=<0|1>       1: eliminate register moves and zero idioms at rename (no IQ entry, lane, or new physical register)\n");
+  fprintf(stderr, "  --fusion=<policy>  Macro-op fusion of dependent ALU pairs at decode: none (default), idioms (lui+addi, auipc+addi, slli+srli/srai, slli+add), or any\n");
+  fprintf(stderr, "  --smt=<n>[,<policy>[,<f>[,<sharing>]]]\t<n>-way SMT (1..%d): one target program per thread, separated by \"::\" (the last one repeats). Fetch from <f> (default 1) threads per cycle chosen by <policy>: icount (default) or rr. <sharing> of the IQ, LQ/SQ and PRF: shared (default) or part (partitioned). Ends when any thread finishes.\n", SMT_MAX_THREADS);
   fprintf(stderr, "  --iq=<n>           Issue Queue has <n> entries\n");
   fprintf(stderr, "  --iqnp=<n>         Issue Queue has <n> partitions for round-robin partition-based priority adjustment\n");
   fprintf(stderr, "  -a                 Enable pre-steering in dispatch stage (override dynamic lane steering at issue stage)\n");
@@ -58,10 +95,28 @@ static void help()
   fprintf(stderr, "  --iw=<n>           <n> wide issue / <n> execution lanes\n");
   fprintf(stderr, "  --rw=<n>           <n> wide retire\n");
   fprintf(stderr, "  --phase=<n>        Phase interval is <n>\n");
+  fprintf(stderr, "  --phasestats=<fmt> Record counters every phase interval: off (default), text (phase.*.log), or bin (phase.*.bin, render with 721sim-phasedump)\n");
+  fprintf(stderr, "  --snapshot=<n>[,<k>]\tSnapshot the timing simulation every <n> cycles, keeping the <k> (default 4) most recent; on a failure (assertion or crash), resume the oldest with logging on\n");
+  fprintf(stderr, "  --hostprof         Measure the simulator's host time per pipeline stage and structure, and its speed (KIPS): in the stats log and host_* phase counters\n");
+  fprintf(stderr, "  --nooracle         Run without the functional simulator: disables the checker, perfect branch prediction, oracle disambiguation, and oracle CPR checkpoint placement\n");
+  fprintf(stderr, "  --bbv=<n>[,<k>]    Profile basic block vectors every <n> instructions in fast-skip mode, then pick at most <k> (default 10) simulation points for -s. No timing simulation. With --synth, profiles the first -e instructions.\n");
+  fprintf(stderr, "  --checker=<policy>[,<n>]\t<policy>: full (check every instruction), periodic (fully check every <n>th instruction), signature (compare rolling signatures every <n> instructions), or off. <n> defaults to the phase interval.\n");
+  fprintf(stderr, "                     Every policy still steps the functional simulator with each retired instruction, for the oracle: only --nooracle removes it\n");
   fprintf(stderr, "  --lane=<B>:<L>:<S>:<C>:<LFP>:<FP>:<MTF>\tEach of <X> is a bit vector indicating which lanes support that instruction type.\n");
   fprintf(stderr, "  --lat=<B>:<L>:<S>:<C>:<LFP>:<FP>:<MTF>\tEach of <X> is an unsigned integer indicating the latency of that instruction type.\n");
   fprintf(stderr, "  -u                 Shortcut to configure universal lanes. Equivalent to: --lane=0xffff:0xffff:0xffff:0xffff:0xffff:0xffff:0xffff --lat=1:1:1:1:1:1:1\n");
   fprintf(stderr, "  --L2L3exist=a,b\tEnable (a=1) or disable (a=0) the L2 cache. Enable (b=1) or disable (b=0) the L3 cache.\n");
+  fprintf(stderr, "  --DCports=<r>,<w>[,<b>[,<bytes>]]\tL1 D$ has <r> read ports (loads) and <w> write ports (committing stores) per cycle (0: unlimited, default), and <b> banks (default 1: no bank conflicts) interleaved every <bytes> (default 8)\n");
+  fprintf(stderr, "  --DCpf=<type>[,<d>]\tL1 D$ prefetcher: none (default), stride, nextline, or stream, with degree <d> (max. lines per trigger)\n");
+  fprintf(stderr, "  --L2pf=<type>[,<d>]\tL2$ prefetcher: none (default), stride, nextline, or stream, with degree <d>\n");
+  fprintf(stderr, "  --pfthrottle=<0|1>\tAdjust prefetch degrees from accuracy and pollution feedback (default 1)\n");
+  fprintf(stderr, "  --tlb=<i>:<ia>:<d>:<da>:<s>:<sa>\tModel TLB timing: ITLB, DTLB, and STLB entries and associativities. Page walks read the L2$.\n");
+  fprintf(stderr, "  --stlblat=<n>      STLB hit latency is <n> cycles (implies TLB timing)\n");
+  fprintf(stderr, "  --pwc=<n>          Page-walk cache has <n> entries per non-leaf level, 0 for none (implies TLB timing)\n");
+  fprintf(stderr, "  --dram=<c>,<r>,<b>,<row>\tModel DRAM behind the last-level cache instead of its flat miss latency: <c> channels, <r> ranks/channel, <b> banks/rank, <row> bytes/row\n");
+  fprintf(stderr, "  --dramtiming=<tRCD>,<tCAS>,<tRP>,<ctrl>\tDRAM timings and controller round-trip latency, in CPU cycles (implies DRAM)\n");
+  fprintf(stderr, "  --dramq=<rq>,<wq>  DRAM read and write queue entries per channel (implies DRAM)\n");
+  fprintf(stderr, "  --dramBW=<n>       DRAM data bus moves <n> bytes per CPU cycle per channel (implies DRAM)\n");
   fprintf(stderr, "  --IC=<SIZE>:<ASSOC>:<BLOCKSIZE>:<#MHSR>\tConfigure L1 I$. Derived # sets must be power-of-2. Block size must be power-of-2.\n");
   fprintf(stderr, "  --DC=<SIZE>:<ASSOC>:<BLOCKSIZE>:<#MHSR>\tConfigure L1 D$. Derived # sets must be power-of-2. Block size must be power-of-2.\n");
   fprintf(stderr, "  --L2=<SIZE>:<ASSOC>:<BLOCKSIZE>:<#MHSR>:<HITTIME>\tConfigure L2 $. Derived # sets must be power-of-2. Block size must be power-of-2.\n");
@@ -211,6 +266,180 @@ static void set_disambig_flags(const char* config) {
    }
 }
 
+static void set_checker_policy(const char* config) {
+   const char* policy_end = strchr(config, ',');
+   size_t policy_len = (policy_end ? (size_t)(policy_end - config) : strlen(config));
+
+   if ((policy_len == 4) && !strncmp(config, "full", 4))
+      CHECKER_POLICY = CHECKER_FULL;
+   else if ((policy_len == 8) && !strncmp(config, "periodic", 8))
+      CHECKER_POLICY = CHECKER_PERIODIC;
+   else if ((policy_len == 9) && !strncmp(config, "signature", 9))
+      CHECKER_POLICY = CHECKER_SIGNATURE;
+   else if ((policy_len == 3) && !strncmp(config, "off", 3))
+      CHECKER_POLICY = CHECKER_OFF;
+   else {
+      fprintf(stderr, "Incorrect usage of --checker=<policy>[,<n>]\n");
+      fprintf(stderr, "...where <policy> is full, periodic, signature, or off.\n");
+      exit(-1);
+   }
+
+   if (policy_end) {
+      if (sscanf(policy_end + 1, "%lu", &CHECKER_INTERVAL) != 1) {
+         fprintf(stderr, "Incorrect usage of --checker=<policy>[,<n>]\n");
+         fprintf(stderr, "...where <n> is the checking interval in instructions.\n");
+         exit(-1);
+      }
+   }
+}
+
+static void set_phase_stats(const char* config) {
+   if (!strcmp(config, "off"))
+      PHASE_STATS = PHASE_STATS_OFF;
+   else if (!strcmp(config, "text"))
+      PHASE_STATS = PHASE_STATS_TEXT;
+   else if (!strcmp(config, "bin"))
+      PHASE_STATS = PHASE_STATS_BINARY;
+   else {
+      fprintf(stderr, "Incorrect usage of --phasestats=<format>\n");
+      fprintf(stderr, "...where <format> is off, text, or bin.\n");
+      exit(-1);
+   }
+}
+
+static void set_bbv_flags(const char* config) {
+   int n = sscanf(config, "%lu,%u", &BBV_INTERVAL, &BBV_MAX_K);
+   if ((n < 1) || (BBV_INTERVAL == 0) || (BBV_MAX_K == 0)) {
+      fprintf(stderr, "Incorrect usage of --bbv=<interval>[,<maxk>]\n");
+      fprintf(stderr, "...where <interval> (instructions) and <maxk> (max. number of simulation points) are positive.\n");
+      exit(-1);
+   }
+}
+
+static void set_synth(const char* config) {
+   if (!SYNTH)
+      SYNTH = new synth_t();
+   if (!SYNTH->configure(config)) {
+      fprintf(stderr, "Incorrect usage of --synth=<key>=<value>,...\n");
+      fprintf(stderr, "...where the keys are seed, code (64 to 512K), data (a power of 2, 4K to 1G), dep (1 to 9),\n");
+      fprintf(stderr, "...ld, st, br, fp, call (percentages adding up to at most 100), bias (0 to 100), addr (stride, random or chase),\n");
+      fprintf(stderr, "...and stride (a multiple of 8, less than data).\n");
+      exit(-1);
+   }
+}
+
+static void set_value_predictor(const char* config) {
+   char name[16];
+   unsigned int entries = VP_ENTRIES;
+   unsigned int conf = VP_CONF;
+   int n = sscanf(config, "%15[a-z],%u,%u", name, &entries, &conf);
+   bool ok = (n >= 1) && (entries >= 1) && (conf >= 1) && (conf <= VP_CONF_MAX);
+   if (ok) {
+      if (!strcmp(name, "none"))
+         VP_TYPE = VP_NONE;
+      else if (!strcmp(name, "lvp"))
+         VP_TYPE = VP_LAST_VALUE;
+      else if (!strcmp(name, "stride"))
+         VP_TYPE = VP_STRIDE;
+      else if (!strcmp(name, "vtage"))
+         VP_TYPE = VP_VTAGE;
+      else
+         ok = false;
+   }
+   if (!ok) {
+      fprintf(stderr, "Incorrect usage of --vp=<type>[,<entries>[,<conf>]]\n");
+      fprintf(stderr, "...where <type> is none, lvp, stride, or vtage, <entries> >= 1, and 1 <= <conf> <= %d.\n", VP_CONF_MAX);
+      exit(-1);
+   }
+   VP_ENTRIES = entries;
+   VP_CONF = conf;
+}
+
+static void set_fusion(const char* config) {
+   if (!strcmp(config, "none"))
+      MACRO_FUSION = FUSION_NONE;
+   else if (!strcmp(config, "idioms"))
+      MACRO_FUSION = FUSION_IDIOMS;
+   else if (!strcmp(config, "any"))
+      MACRO_FUSION = FUSION_ANY;
+   else {
+      fprintf(stderr, "Incorrect usage of --fusion=<policy>\n");
+      fprintf(stderr, "...where <policy> is none, idioms, or any.\n");
+      exit(-1);
+   }
+}
+
+static void config_SMT(const char* config) {
+   char policy[16] = "icount";
+   char sharing[16] = "shared";
+   unsigned int fetch_threads = 1;
+   int n = sscanf(config, "%u,%15[^,],%u,%15s", &SMT_THREADS, policy, &fetch_threads, sharing);
+   if ((n < 1) || (SMT_THREADS < 1) || (SMT_THREADS > SMT_MAX_THREADS) || (fetch_threads < 1) ||
+       (strcmp(policy, "icount") && strcmp(policy, "rr")) ||
+       (strcmp(sharing, "shared") && strcmp(sharing, "part"))) {
+      fprintf(stderr, "Incorrect usage of --smt=<threads>[,<fetch policy>[,<fetch threads>[,<sharing>]]]\n");
+      fprintf(stderr, "...where <threads> is 1 to %d, <fetch policy> is icount or rr, and <sharing> is shared or part.\n", SMT_MAX_THREADS);
+      exit(-1);
+   }
+   SMT_FETCH_POLICY = (strcmp(policy, "rr") ? SMT_FETCH_ICOUNT : SMT_FETCH_RR);
+   SMT_FETCH_THREADS = fetch_threads;
+   SMT_SHARED = (strcmp(sharing, "shared") == 0);
+}
+
+static void config_coherence(const char* config) {
+   if ((sscanf(config, "%u,%u,%u,%u", &COH_L3_BANKS, &COH_BANK_BUSY, &COH_DIR_LATENCY, &COH_HOP_LATENCY) != 4) ||
+       (COH_L3_BANKS < 1) || (COH_BANK_BUSY < 1)) {
+      fprintf(stderr, "Incorrect usage of --coh=<L3 banks>,<bank busy cycles>,<directory latency>,<hop latency>\n");
+      fprintf(stderr, "...where <L3 banks> and <bank busy cycles> are at least 1.\n");
+      exit(-1);
+   }
+}
+
+static void config_parallel(const char* config) {
+   char mode[16] = "det";
+   int n = sscanf(config, "%u,%u,%15s", &PARALLEL_THREADS, &PARALLEL_QUANTUM, mode);
+   if ((n < 1) || (PARALLEL_THREADS < 1) || (PARALLEL_QUANTUM < 1) || (strcmp(mode, "det") && strcmp(mode, "relaxed"))) {
+      fprintf(stderr, "Incorrect usage of --parallel=<threads>[,<quantum>[,<mode>]]\n");
+      fprintf(stderr, "...where <threads> and <quantum> (cycles) are at least 1, and <mode> is det or relaxed.\n");
+      exit(-1);
+   }
+   PARALLEL_RELAXED = (strcmp(mode, "relaxed") == 0);
+}
+
+static void config_snapshot(const char* config) {
+   int n = sscanf(config, "%" SCNu64 ",%u", &SNAPSHOT_INTERVAL, &SNAPSHOT_COUNT);
+   if ((n < 1) || (SNAPSHOT_INTERVAL < 1) || (SNAPSHOT_COUNT < 1)) {
+      fprintf(stderr, "Incorrect usage of --snapshot=<cycles>[,<count>]\n");
+      fprintf(stderr, "...where <cycles> and <count> are at least 1.\n");
+      exit(-1);
+   }
+}
+
+static void set_prefetcher(const char* option, const char* config, prefetcher_e& type, unsigned int& degree) {
+   char name[16];
+   unsigned int d = degree;
+   int n = sscanf(config, "%15[a-z],%u", name, &d);
+   bool ok = (n >= 1) && (d >= 1) && (d <= PF_MAX_DEGREE);
+   if (ok) {
+      if (!strcmp(name, "none"))
+         type = PF_NONE;
+      else if (!strcmp(name, "stride"))
+         type = PF_STRIDE;
+      else if (!strcmp(name, "nextline"))
+         type = PF_NEXTLINE;
+      else if (!strcmp(name, "stream"))
+         type = PF_STREAM;
+      else
+         ok = false;
+   }
+   if (!ok) {
+      fprintf(stderr, "Incorrect usage of --%s=<type>[,<degree>]\n", option);
+      fprintf(stderr, "...where <type> is none, stride, nextline, or stream, and 1 <= <degree> <= %d.\n", PF_MAX_DEGREE);
+      exit(-1);
+   }
+   degree = d;
+}
+
 static void config_IC(const char* config) {
    unsigned int temp_size, temp_blocksize;
    if (sscanf(config, "%u:%u:%u:%u", &temp_size, &L1_IC_ASSOC, &temp_blocksize, &L1_IC_NUM_MHSRs) != 4) {
@@ -257,6 +486,26 @@ static void config_DC(const char* config) {
    }
 }
 
+static void config_DC_ports(const char* config) {
+   unsigned int bank_bytes = (1 << L1_DC_BANK_SIZE);
+   int n = sscanf(config, "%u,%u,%u,%u", &L1_DC_RD_PORTS, &L1_DC_WR_PORTS, &L1_DC_BANKS, &bank_bytes);
+   if ((n < 2) || (L1_DC_BANKS == 0) || !IsPow2(bank_bytes) || (bank_bytes < 8)) {
+      fprintf(stderr, "Incorrect usage of --DCports=<rd ports>,<wr ports>[,<banks>[,<bank bytes>]]\n");
+      fprintf(stderr, "...where 0 ports means unlimited, <banks> >= 1, and <bank bytes> is a power-of-2 >= 8.\n");
+      exit(-1);
+   }
+   L1_DC_BANK_SIZE = (unsigned int) log2((double)bank_bytes);
+}
+
+static void config_PRF_ports(const char* config) {
+   int n = sscanf(config, "%u,%u,%u,%u", &PRF_RD_PORTS, &PRF_WR_PORTS, &PRF_BANKS, &PRF_BYPASS);
+   if ((n < 2) || (PRF_BANKS == 0)) {
+      fprintf(stderr, "Incorrect usage of --prfports=<rd ports>,<wr ports>[,<banks>[,<bypass cycles>]]\n");
+      fprintf(stderr, "...where 0 ports means unlimited, and <banks> >= 1.\n");
+      exit(-1);
+   }
+}
+
 static void config_L2(const char* config) {
    unsigned int temp_size, temp_blocksize;
    if (sscanf(config, "%u:%u:%u:%u:%u", &temp_size, &L2_ASSOC, &temp_blocksize, &L2_NUM_MHSRs, &L2_HIT_LATENCY) != 5) {
@@ -303,6 +552,65 @@ static void config_L3(const char* config) {
    }
 }
 
+static void config_TLB(const char* config) {
+   if (sscanf(config, "%u:%u:%u:%u:%u:%u", &ITLB_ENTRIES, &ITLB_ASSOC, &DTLB_ENTRIES, &DTLB_ASSOC, &STLB_ENTRIES, &STLB_ASSOC) != 6) {
+      fprintf(stderr, "Incorrect usage of --tlb=<ITLB entries>:<ITLB assoc>:<DTLB entries>:<DTLB assoc>:<STLB entries>:<STLB assoc>\n");
+      exit(-1);
+   }
+   unsigned int entries[3] = {ITLB_ENTRIES, DTLB_ENTRIES, STLB_ENTRIES};
+   unsigned int assoc[3] = {ITLB_ASSOC, DTLB_ASSOC, STLB_ASSOC};
+   const char* name[3] = {"ITLB", "DTLB", "STLB"};
+   for (unsigned int i = 0; i < 3; i++) {
+      if (!assoc[i] || (entries[i] % assoc[i]) || !IsPow2(entries[i] / assoc[i])) {
+         fprintf(stderr, "--tlb: %s derived # sets (%u entries / %u ways) must be a power-of-2.\n", name[i], entries[i], assoc[i]);
+         exit(-1);
+      }
+   }
+   TLB_PRESENT = true;
+}
+
+static void config_DRAM(const char* config) {
+   if (sscanf(config, "%u,%u,%u,%u", &DRAM_CHANNELS, &DRAM_RANKS, &DRAM_BANKS, &DRAM_ROW_SIZE) != 4) {
+      fprintf(stderr, "Incorrect usage of --dram=<channels>,<ranks>,<banks>,<row bytes>\n");
+      exit(-1);
+   }
+   if (!DRAM_CHANNELS || !DRAM_RANKS || !DRAM_BANKS) {
+      fprintf(stderr, "--dram: channels, ranks, and banks must be positive.\n");
+      exit(-1);
+   }
+   if (!IsPow2(DRAM_ROW_SIZE) || (DRAM_ROW_SIZE < 1024)) {
+      fprintf(stderr, "--dram: row size (%u) must be a power-of-2 of at least 1024 bytes.\n", DRAM_ROW_SIZE);
+      exit(-1);
+   }
+   DRAM_PRESENT = true;
+}
+
+static void config_DRAM_timing(const char* config) {
+   if (sscanf(config, "%u,%u,%u,%u", &DRAM_tRCD, &DRAM_tCAS, &DRAM_tRP, &DRAM_CTRL_LATENCY) != 4) {
+      fprintf(stderr, "Incorrect usage of --dramtiming=<tRCD>,<tCAS>,<tRP>,<ctrl>\n");
+      fprintf(stderr, "...where all are in CPU cycles.\n");
+      exit(-1);
+   }
+   DRAM_PRESENT = true;
+}
+
+static void config_DRAM_queues(const char* config) {
+   if ((sscanf(config, "%u,%u", &DRAM_RQ_SIZE, &DRAM_WQ_SIZE) != 2) || (DRAM_RQ_SIZE < 1) || (DRAM_WQ_SIZE < 2)) {
+      fprintf(stderr, "Incorrect usage of --dramq=<rq>,<wq>\n");
+      fprintf(stderr, "...where <rq> >= 1 and <wq> >= 2.\n");
+      exit(-1);
+   }
+   DRAM_PRESENT = true;
+}
+
+static void config_DRAM_bandwidth(const char* config) {
+   if ((sscanf(config, "%u", &DRAM_BUS_BYTES) != 1) || (DRAM_BUS_BYTES == 0)) {
+      fprintf(stderr, "Incorrect usage of --dramBW=<bytes per cycle>\n");
+      exit(-1);
+   }
+   DRAM_PRESENT = true;
+}
+
 static void config_L2L3present(const char* config) {
    int a, b;
    if (sscanf(config, "%d,%d", &a, &b) != 2) {
@@ -315,19 +623,184 @@ static void config_L2L3present(const char* config) {
    }
 }
 
+static void config_sweep(const char* config, std::string& file, unsigned int& jobs) {
+   char name[1024];
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   jobs = ((cpus > 0) ? (unsigned int)cpus : 1);
+   int n = sscanf(config, "%1023[^,],%u", name, &jobs);
+   if ((n < 1) || (jobs == 0)) {
+      fprintf(stderr, "Incorrect usage of --sweep=<file>[,<jobs>]\n");
+      fprintf(stderr, "...where <jobs> (simultaneous configurations) is positive.\n");
+      exit(-1);
+   }
+   file = name;
+}
+
+// The sweep file has one configuration per line: options, as on the command line.
+// '#' starts a comment.
+static std::vector<std::string> read_sweep_file(const std::string& file) {
+   std::vector<std::string> configs;
+   std::ifstream in(file.c_str());
+   std::string line;
+
+   if (!in) {
+      fprintf(stderr, "Cannot open the sweep file %s\n", file.c_str());
+      exit(-1);
+   }
+   while (std::getline(in, line)) {
+      size_t first, last;
+      line = line.substr(0, line.find('#'));
+      first = line.find_first_not_of(" \t\r");
+      if (first == std::string::npos)
+         continue;
+      last = line.find_last_not_of(" \t\r");
+      configs.push_back(line.substr(first, (last - first + 1)));
+   }
+   if (configs.empty()) {
+      fprintf(stderr, "The sweep file %s has no configurations\n", file.c_str());
+      exit(-1);
+   }
+   return(configs);
+}
+
+// Fork one child per configuration, at most 'jobs' at a time. The children share the
+// parent's memory (copy-on-write), including the simulators that reached the region.
+// Returns in each child: its configuration (1, 2, ...), with 'result' open to report
+// its results to the parent. Returns 0 in the parent, once all children are done and
+// their results summarized; 'status' is 0 if they all succeeded.
+static unsigned int fork_sweep(const std::vector<std::string>& configs, unsigned int jobs, FILE*& result, int& status) {
+   size_t n = configs.size();
+   std::vector<pid_t> pid(n, 0);
+   std::vector<int> fd(n, -1);
+   std::vector<int> code(n, -1);
+   size_t next = 0, done = 0;
+   unsigned int running = 0;
+
+   while (done < n) {
+      if ((next < n) && (running < jobs)) {
+         int p[2];
+         if (pipe(p) != 0) {
+            perror("--sweep: pipe");
+            exit(-1);
+         }
+         fflush(NULL);   // else the child repeats the parent's buffered output
+         pid_t child = fork();
+         if ((child < 0) && ((errno == ENOMEM) || (errno == EAGAIN)) && (running > 0)) {
+            // The host cannot commit memory for another copy: run fewer configurations at a time.
+            fprintf(stderr, "--sweep: fork: %s: running at most %u configurations at a time\n", strerror(errno), running);
+            close(p[0]);
+            close(p[1]);
+            jobs = running;
+            continue;
+         }
+         if (child < 0) {
+            perror("--sweep: fork");
+            if ((errno == ENOMEM) || (errno == EAGAIN))
+               fprintf(stderr, "...each configuration's process may need as much memory as the target memory (-m): try a smaller -m\n");
+            exit(-1);
+         }
+         if (child == 0) {
+            for (size_t i = 0; i < next; i++)
+               close(fd[i]);
+            close(p[0]);
+            result = fdopen(p[1], "w");
+            return((unsigned int)(next + 1));
+         }
+         close(p[1]);
+         pid[next] = child;
+         fd[next] = p[0];
+         fprintf(stderr, "Sweep: configuration %lu (%s) is process %d\n", (next + 1), configs[next].c_str(), (int)child);
+         running++;
+         next++;
+      }
+      else {
+         int s;
+         pid_t child = wait(&s);
+         if (child < 0) {
+            perror("--sweep: wait");
+            exit(-1);
+         }
+         for (size_t i = 0; i < next; i++) {
+            if (pid[i] == child) {
+               code[i] = (WIFEXITED(s) ? WEXITSTATUS(s) : -1);
+               running--;
+               done++;
+            }
+         }
+      }
+   }
+
+   status = 0;
+   fprintf(stderr, "\nSweep results:\n");
+   fprintf(stderr, "  config  exit     instructions           cycles     IPC  stats log\n");
+   for (size_t i = 0; i < n; i++) {
+      FILE* fp = fdopen(fd[i], "r");
+      char stats_file[1024];
+      uint64_t insn, cycles;
+      if (fp && (fscanf(fp, "%1023s %" SCNu64 " %" SCNu64, stats_file, &insn, &cycles) == 3))
+         fprintf(stderr, "  %6lu  %4d  %15" PRIu64 "  %15" PRIu64 "  %6.3f  %s\n", (i + 1), code[i], insn, cycles,
+                 (cycles ? ((double)insn / (double)cycles) : 0.0), stats_file);
+      else
+         fprintf(stderr, "  %6lu  %4d  (no results)\n", (i + 1), code[i]);
+      if (fp)
+         fclose(fp);
+      if (code[i] != 0)
+         status = 1;
+   }
+   return(0);
+}
+
+// Replaying a trace: the full and periodic checkers need the state it may not have.
+static void check_trace_state(trace_reader_t* trace) {
+  if (!trace->has_state() && ((CHECKER_POLICY == CHECKER_FULL) || (CHECKER_POLICY == CHECKER_PERIODIC))) {
+    fprintf(stderr, "The trace was recorded without the architectural state the full and periodic checkers compare.\n");
+    fprintf(stderr, "...replay it with --checker=sig or --checker=off, or record it with --checker=full or --checker=periodic.\n");
+    exit(-1);
+  }
+}
+
+// Oracle features are unavailable without the functional simulator.
+static void check_oracle_features() {
+  if (!FUNCTIONAL_ORACLE) {
+    if (PERFECT_BRANCH_PRED) {
+      fprintf(stderr, "Perfect branch prediction requires the functional simulator: using the real branch predictor.\n");
+      PERFECT_BRANCH_PRED = false;
+    }
+    if (ORACLE_DISAMBIG) {
+      fprintf(stderr, "Oracle disambiguation requires the functional simulator: always predicting conflict instead.\n");
+      ORACLE_DISAMBIG = false;
+    }
+    CHECKER_POLICY = CHECKER_OFF;
+  }
+}
+
 /* exit when this becomes non-zero */
 //int sim_exit_now = FALSE;
 // Should be global variables for access from all DPI functions
-debug_buffer_t* DB;
-sim_t*  s_isa;
-sim_t*  s_micro;
+// Indexed by SMT thread (only [0] without SMT).
+debug_buffer_t* DB[SMT_MAX_THREADS];
+sim_t*  s_isa[SMT_MAX_THREADS];
+sim_t*  s_micro[SMT_MAX_THREADS];
+smt_t*  smt;
 
 static void endSimulation(int signal)
 {
   //*** Must delete the simulator instances in order to dump stats ***
   // Stats are dumped in the destructor for the processor instances.
-  delete s_isa;
-  delete s_micro;
+  // Thread 0 owns the shared memory hierarchy, so it goes last.
+  for (int t = (SMT_MAX_THREADS - 1); t >= 0; t--) {
+    delete s_isa[t];
+    delete s_micro[t];
+    s_isa[t] = s_micro[t] = (sim_t *) NULL;
+    // Finishes the trace being recorded, if any.
+    delete DB[t];
+    DB[t] = (debug_buffer_t *) NULL;
+  }
+  delete smt;
+  smt = (smt_t *) NULL;
+  // The snapshots exit (after thread 0's stats log lists them).
+  delete SNAPSHOT;
+  SNAPSHOT = (snapshot_t *) NULL;
 }  
 
 
@@ -346,23 +819,47 @@ int main(int argc, char** argv)
   bool skip_enable = false;   /////////////
 
   std::string checkpoint_file = "";
+  std::string mkchkpt_file = "";
+  std::string sweep_file = "";
+  unsigned int sweep_jobs = 1;
+  FILE* sweep_result = (FILE *) NULL;
+  std::string trace_file = "";
+  std::string replay_file = "";
 
   option_parser_t parser;
   parser.help(&help);
   parser.option('h', 0, 0, [&](const char* s){help();});
   parser.option('d', 0, 0, [&](const char* s){debug = true;});
   parser.option('g', 0, 0, [&](const char* s){histogram = true;});
+  parser.option(0, "histtop", 1, [&](const char* s){HISTOGRAM_TOP_N = atoll(s);});
   parser.option('l', 0, 1, [&](const char* s){logging_on_at = atoll(s);});
   parser.option('p', 0, 1, [&](const char* s){nprocs = atoi(s);});
   parser.option('m', 0, 1, [&](const char* s){mem_mb = atoi(s);});
   parser.option('s', 0, 1, [&](const char* s){skip_amt = atoll(s); skip_enable = true;});
+  parser.option(0, "warm", 1, [&](const char* s){WARM_AMT = atoll(s);});
   parser.option('e', 0, 1, [&](const char* s){stop_amt = atoll(s); use_stop_amt = true;});
   parser.option('c', 0, 1, [&](const char* s){checkpoint_file = s;});
+  parser.option(0, "mkchkpt", 1, [&](const char* s){mkchkpt_file = s;});
+  parser.option(0, "trace", 1, [&](const char* s){trace_file = s;});
+  parser.option(0, "replay", 1, [&](const char* s){replay_file = s;});
+  parser.option(0, "sweep", 1, [&](const char* s){config_sweep(s, sweep_file, sweep_jobs);});
+  parser.option(0, "synth", 1, [&](const char* s){set_synth(s);});
   parser.option(0, "IC", 1, [&](const char* s){config_IC(s);});
   parser.option(0, "DC", 1, [&](const char* s){config_DC(s);});
   parser.option(0, "L2", 1, [&](const char* s){config_L2(s);});
   parser.option(0, "L3", 1, [&](const char* s){config_L3(s);});
   parser.option(0, "L2L3exist", 1, [&](const char* s){config_L2L3present(s);});
+  parser.option(0, "DCports", 1, [&](const char* s){config_DC_ports(s);});
+  parser.option(0, "DCpf", 1, [&](const char* s){set_prefetcher("DCpf", s, L1_DC_PREFETCHER, L1_DC_PF_DEGREE);});
+  parser.option(0, "L2pf", 1, [&](const char* s){set_prefetcher("L2pf", s, L2_PREFETCHER, L2_PF_DEGREE);});
+  parser.option(0, "pfthrottle", 1, [&](const char* s){PF_THROTTLE = (atoi(s) ? true : false);});
+  parser.option(0, "tlb", 1, [&](const char* s){config_TLB(s);});
+  parser.option(0, "stlblat", 1, [&](const char* s){STLB_LATENCY = atoi(s); TLB_PRESENT = true;});
+  parser.option(0, "pwc", 1, [&](const char* s){PWC_ENTRIES = atoi(s); TLB_PRESENT = true;});
+  parser.option(0, "dram", 1, [&](const char* s){config_DRAM(s);});
+  parser.option(0, "dramtiming", 1, [&](const char* s){config_DRAM_timing(s);});
+  parser.option(0, "dramq", 1, [&](const char* s){config_DRAM_queues(s);});
+  parser.option(0, "dramBW", 1, [&](const char* s){config_DRAM_bandwidth(s);});
   parser.option(0, "MEMLAT", 1, [&](const char* s){L1_IC_MISS_LATENCY = L1_DC_MISS_LATENCY = L2_MISS_LATENCY = atoi(s);});
   parser.option(0, "perf", 1, [&](const char* s){set_perfect_flags(s);});
   parser.option(0, "cp"  , 1, [&](const char* s){NUM_CHECKPOINTS = atoi(s);});
@@ -371,16 +868,25 @@ int main(int argc, char** argv)
   parser.option(0, "btbentries", 1, [&](const char* s){BTB_ENTRIES = atoi(s);});
   parser.option(0, "btbassoc", 1, [&](const char* s){BTB_ASSOC = atoi(s);});
   parser.option(0, "ras", 1, [&](const char* s){RAS_SIZE = atoi(s);});
+  parser.option(0, "ftq", 1, [&](const char* s){FTQ_SIZE = atoi(s);});
   parser.option(0, "mbp", 1, [&](const char* s){COND_BRANCH_PRED_PER_CYCLE = atoi(s);});
   parser.option(0, "cbpPC", 1, [&](const char* s){CBP_PC_LENGTH = atoi(s);});
   parser.option(0, "cbpBHR", 1, [&](const char* s){CBP_BHR_LENGTH = atoi(s);});
   parser.option(0, "ibpPC", 1, [&](const char* s){IBP_PC_LENGTH = atoi(s);});
   parser.option(0, "ibpBHR", 1, [&](const char* s){IBP_BHR_LENGTH = atoi(s);});
   parser.option('t', 0, 0, [&](const char* s){ENABLE_TRACE_CACHE = true;});
+  parser.option(0, "vp", 1, [&](const char* s){set_value_predictor(s);});
+  parser.option(0, "vploads", 1, [&](const char* s){VP_LOADS_ONLY = (atoi(s) != 0);});
 
   parser.option(0, "fq"  , 1, [&](const char* s){FETCH_QUEUE_SIZE = atoi(s);});
   parser.option(0, "al"  , 1, [&](const char* s){ACTIVE_LIST_SIZE = atoi(s);});
   parser.option(0, "prf"  , 1, [&](const char* s){PRF_SIZE = atoi(s); AUTO_PRF_SIZE = false;});
+  parser.option(0, "prfports", 1, [&](const char* s){config_PRF_ports(s);});
+  parser.option(0, "elim", 1, [&](const char* s){MOVE_ELIMINATION = (atoi(s) != 0);});
+  parser.option(0, "fusion", 1, [&](const char* s){set_fusion(s);});
+  parser.option(0, "smt" , 1, [&](const char* s){config_SMT(s);});
+  parser.option(0, "coh" , 1, [&](const char* s){config_coherence(s);});
+  parser.option(0, "parallel", 1, [&](const char* s){config_parallel(s);});
   parser.option(0, "iq"  , 1, [&](const char* s){ISSUE_QUEUE_SIZE = atoi(s);});
   parser.option(0, "iqnp", 1, [&](const char* s){ISSUE_QUEUE_NUM_PARTS = atoi(s);});
   parser.option('a', 0, 0, [&](const char* s){PRESTEER = true;});
@@ -392,32 +898,167 @@ int main(int argc, char** argv)
   parser.option(0, "iw"  , 1, [&](const char* s){ISSUE_WIDTH = atoi(s);});
   parser.option(0, "rw"  , 1, [&](const char* s){RETIRE_WIDTH = atoi(s);});
   parser.option(0, "phase",1, [&](const char *s){phase_interval = atoll(s);});
+  parser.option(0, "phasestats",1, [&](const char *s){set_phase_stats(s);});
+  parser.option(0, "snapshot", 1, [&](const char* s){config_snapshot(s);});
+  parser.option(0, "hostprof",0, [&](const char *s){if (!HOST_PROF) HOST_PROF_THREAD = HOST_PROF = new host_prof_t();});
+  parser.option(0, "checker",1, [&](const char *s){set_checker_policy(s);});
+  parser.option(0, "nooracle",0, [&](const char *s){FUNCTIONAL_ORACLE = false;});
+  parser.option(0, "bbv",1, [&](const char *s){set_bbv_flags(s);});
   parser.option(0, "lane" ,1, [&](const char *s){set_lane_matrix(s);});
   parser.option(0, "lat"  ,1, [&](const char *s){set_lane_latencies(s);});
   parser.option('u', 0, 0, [&](const char* s){set_lane_matrix("0xffff:0xffff:0xffff:0xffff:0xffff:0xffff:0xffff"); set_lane_latencies("1:1:1:1:1:1:1");});
 
   auto argv1 = parser.parse(argv);
-  if (!*argv1)
+  if (!*argv1 && !SYNTH)
     help();
   std::vector<std::string> htif_args(argv1, (const char*const*)argv + argc);
 
-  #ifdef RISCV_MICRO_CHECKER
-  s_isa = new sim_t(nprocs, mem_mb, htif_args, ISA_SIM);
-  #endif
+  // SMT: the threads' programs are separated by "::". The last one repeats for the remaining threads.
+  std::vector<std::vector<std::string> > thread_args(1);
+  for (size_t a = 0; a < htif_args.size(); a++) {
+    if (htif_args[a] == "::")
+      thread_args.push_back(std::vector<std::string>());
+    else
+      thread_args.back().push_back(htif_args[a]);
+  }
+  for (size_t t = 0; t < thread_args.size(); t++) {
+    if (thread_args[t].empty() && !SYNTH)
+      help();
+  }
+  if (thread_args.size() > SMT_THREADS) {
+    fprintf(stderr, "%lu target programs were given for %u thread(s): use --smt.\n", thread_args.size(), SMT_THREADS);
+    exit(-1);
+  }
+  while (thread_args.size() < SMT_THREADS)
+    thread_args.push_back(thread_args.back());
 
-  s_micro = new sim_t(nprocs, mem_mb, htif_args, MICRO_SIM);
+  if (SMT_THREADS > 1) {
+    if ((checkpoint_file != "") || (mkchkpt_file != "") || (sweep_file != "") || (trace_file != "") || (replay_file != "") ||
+        BBV_INTERVAL || debug || (nprocs > 1)) {
+      fprintf(stderr, "SMT does not support -c, --mkchkpt, --sweep, --trace, --replay, -d, -p or --bbv.\n");
+      exit(-1);
+    }
+    if (!SMT_SHARED && ((smt_partition(ISSUE_QUEUE_SIZE) % ISSUE_QUEUE_NUM_PARTS) || !smt_partition(LQ_SIZE) || !smt_partition(SQ_SIZE) ||
+                        !smt_partition(ACTIVE_LIST_SIZE))) {
+      fprintf(stderr, "Partitioned SMT: the IQ (a multiple of %u partitions), LQ, SQ and Active List must have at least one entry per thread.\n", ISSUE_QUEUE_NUM_PARTS);
+      exit(-1);
+    }
+  }
 
-  s_micro->set_debug(debug);
-  s_micro->set_histogram(histogram);
+  // A synthetic program loops forever, and has no HTIF to checkpoint.
+  if (SYNTH && (!htif_args.empty() || !use_stop_amt || (checkpoint_file != "") || (mkchkpt_file != "") || debug)) {
+    fprintf(stderr, "Incorrect usage of --synth: it replaces the target program, requires -e, and cannot be combined with -c, --mkchkpt or -d.\n");
+    exit(-1);
+  }
 
-  #ifdef RISCV_MICRO_CHECKER
-    DB = new debug_buffer_t(PIPE_QUEUE_SIZE);
+  // Multi-core timing simulation (see coherence.h). One functional simulator cannot follow
+  // cores whose interleaving of accesses to the shared memory is decided by timing.
+  if (nprocs > 1) {
+    if (FUNCTIONAL_ORACLE || !L2_PRESENT || !L3_PRESENT || (nprocs > MC_MAX_CORES) || (checkpoint_file != "") || (mkchkpt_file != "") ||
+        (sweep_file != "") || (trace_file != "") || (replay_file != "") || BBV_INTERVAL || debug) {
+      fprintf(stderr, "Incorrect usage of -p<n>: 2 to %d cores need --nooracle and the L2 and L3 caches,\n", MC_MAX_CORES);
+      fprintf(stderr, "...and cannot be combined with -c, --mkchkpt, --sweep, --trace, --replay, --bbv or -d.\n");
+      exit(-1);
+    }
+    MC_CORES = nprocs;
+  }
 
-    DB->set_isa_sim(s_isa);
+  // Parallel host threads (see parallel.h): at most one per core.
+  if (PARALLEL_THREADS) {
+    if (nprocs < 2) {
+      fprintf(stderr, "Incorrect usage of --parallel: it runs the cores of -p<n> (2 or more) on host threads.\n");
+      exit(-1);
+    }
+    PARALLEL_THREADS = std::min(PARALLEL_THREADS, (unsigned int)nprocs);
+  }
 
-    s_isa->set_procs_pipe(DB);
-    s_micro->set_procs_pipe(DB);
-  #endif
+  // Snapshots fork the simulator (see snapshot.h): the fork would not have the parallel host threads.
+  if (SNAPSHOT_INTERVAL) {
+    if (PARALLEL_THREADS) {
+      fprintf(stderr, "Incorrect usage of --snapshot: it cannot be combined with --parallel.\n");
+      exit(-1);
+    }
+    SNAPSHOT = new snapshot_t(SNAPSHOT_INTERVAL, SNAPSHOT_COUNT);
+  }
+
+  // BBV profiling runs the program only through the fast-skip path of the timing simulator.
+  if (BBV_INTERVAL)
+    FUNCTIONAL_ORACLE = false;
+
+  // Warming is part of fast-skip.
+  if (WARM_AMT && (!skip_enable || (checkpoint_file != "") || BBV_INTERVAL)) {
+    fprintf(stderr, "--warm only applies to fast-skip (-s): no warming.\n");
+    WARM_AMT = 0;
+  }
+  else if (WARM_AMT > skip_amt) {
+    fprintf(stderr, "--warm=%lu exceeds -s: warming all %lu skipped instructions.\n", WARM_AMT, skip_amt);
+    WARM_AMT = skip_amt;
+  }
+
+  // A checkpoint is made at the end of fast-skip.
+  if ((mkchkpt_file != "") && (!skip_enable || (checkpoint_file != "") || BBV_INTERVAL)) {
+    fprintf(stderr, "Incorrect usage of --mkchkpt=<file>: it requires -s, and cannot be combined with -c or --bbv.\n");
+    exit(-1);
+  }
+
+  // A sweep starts from the region reached by -s or -c.
+  if ((sweep_file != "") && ((!skip_enable && (checkpoint_file == "")) || (mkchkpt_file != "") || BBV_INTERVAL || debug)) {
+    fprintf(stderr, "Incorrect usage of --sweep=<file>: it requires -s or -c, and cannot be combined with --mkchkpt, --bbv or -d.\n");
+    exit(-1);
+  }
+
+  // Traces are of the timing region: recorded from, or replayed instead of, the functional simulator.
+  if ((trace_file != "") || (replay_file != "")) {
+    if (((trace_file != "") && (replay_file != "")) || (mkchkpt_file != "") || BBV_INTERVAL || !FUNCTIONAL_ORACLE ||
+        ((trace_file != "") && (sweep_file != ""))) {
+      fprintf(stderr, "Incorrect usage of --trace=<file> or --replay=<file>: they need the functional oracle (no --nooracle),\n");
+      fprintf(stderr, "...cannot be combined with each other, --mkchkpt or --bbv, and --trace cannot be combined with --sweep.\n");
+      exit(-1);
+    }
+  }
+
+  check_oracle_features();
+
+  // Each SMT thread has its own functional and timing simulators, and debug buffer.
+  for (unsigned int t = 0; t < SMT_THREADS; t++) {
+    #ifdef RISCV_MICRO_CHECKER
+    if (FUNCTIONAL_ORACLE && (replay_file == ""))
+      s_isa[t] = new sim_t(nprocs, mem_mb, thread_args[t], ISA_SIM);
+    #endif
+
+    s_micro[t] = new sim_t(nprocs, mem_mb, thread_args[t], MICRO_SIM, t);
+
+    s_micro[t]->set_debug(debug);
+    s_micro[t]->set_histogram(histogram);
+
+    #ifdef RISCV_MICRO_CHECKER
+    if (FUNCTIONAL_ORACLE) {
+      DB[t] = new debug_buffer_t(PIPE_QUEUE_SIZE);
+
+      // Only the full and periodic checkers compare architectural state.
+      DB[t]->set_capture_state((CHECKER_POLICY == CHECKER_FULL) || (CHECKER_POLICY == CHECKER_PERIODIC));
+
+      if (replay_file != "") {
+        trace_reader_t* trace = new trace_reader_t(replay_file.c_str());
+        check_trace_state(trace);
+        DB[t]->set_trace_in(trace);
+      }
+      else {
+        DB[t]->set_isa_sim(s_isa[t]);
+        s_isa[t]->set_procs_pipe(DB[t]);
+        if (trace_file != "")
+          DB[t]->set_trace_out(new trace_writer_t(trace_file.c_str(), ((CHECKER_POLICY == CHECKER_FULL) || (CHECKER_POLICY == CHECKER_PERIODIC))));
+      }
+      s_micro[t]->set_procs_pipe(DB[t]);
+    }
+    #endif
+  }
+
+  if (SMT_THREADS > 1) {
+    smt = new smt_t();
+    for (unsigned int t = 0; t < SMT_THREADS; t++)
+      smt->add_thread(s_micro[t]);
+  }
 
   int i, exit_code, exec_index;
   char c, *all_options;
@@ -518,58 +1159,173 @@ int main(int argc, char** argv)
     logging_on = true;
 
   #ifdef RISCV_MICRO_CHECKER
-    s_isa->boot();
+  if (FUNCTIONAL_ORACLE && (replay_file == "")) {
+    for (unsigned int t = 0; t < SMT_THREADS; t++) {
+      if (SYNTH)
+        s_isa[t]->boot_synth(SYNTH);
+      else
+        s_isa[t]->boot();
+
+      if (checkpoint_file != "")
+      {
+        fprintf(stderr, "Restoring checkpoint from %s\n",checkpoint_file.c_str());
+        s_isa[t]->restore_checkpoint(checkpoint_file);
+      }
+      else if (skip_enable) {
+        // If skip amount is provided, fast skip in the ISA sim
+        //s_isa->init_checkpoint("isa_checkpoint");
+        fprintf(stderr, "Fast skipping Spike for %lu instructions\n",skip_amt);
+        htif_code = s_isa[t]->run_fast(skip_amt);
+        //htif_code = s_isa->create_checkpoint();
+      }
 
-    if (checkpoint_file != "")
-    {
-      fprintf(stderr, "Restoring checkpoint from %s\n",checkpoint_file.c_str());
-      s_isa->restore_checkpoint(checkpoint_file);
-    }
-    else if (skip_enable) {
-      // If skip amount is provided, fast skip in the ISA sim
-      //s_isa->init_checkpoint("isa_checkpoint");
-      fprintf(stderr, "Fast skipping Spike for %lu instructions\n",skip_amt);
-      htif_code = s_isa->run_fast(skip_amt);
-      //htif_code = s_isa->create_checkpoint();
+      // Fill the debug buffer
+      DB[t]->run_ahead();
     }
-
-    // Fill the debug buffer
-    DB->run_ahead();
+  }
   #endif
 
 
-  s_micro->boot();
+  // HTIF traffic is logged into the checkpoint from boot on.
+  if (mkchkpt_file != "")
+    s_micro[0]->init_checkpoint(mkchkpt_file);
+
+  for (unsigned int t = 0; t < SMT_THREADS; t++) {
+    if (SYNTH)
+      s_micro[t]->boot_synth(SYNTH);
+    else
+      s_micro[t]->boot();
+  }
   //exit(0);
 
+  if (BBV_INTERVAL) {
+    if ((checkpoint_file != "") || skip_enable)
+      fprintf(stderr, "BBV profiling starts at the beginning of the program: ignoring -c/-s.\n");
+
+    // Name the profile after the target program.
+    const char* program = "synth";
+    if (!SYNTH) {
+      program = strrchr(htif_args[0].c_str(), '/');
+      program = (program ? program + 1 : htif_args[0].c_str());
+    }
+
+    // A synthetic program never exits: profile it for -e instructions (required with --synth).
+    fprintf(stderr, "Profiling basic block vectors every %lu instructions\n", BBV_INTERVAL);
+    s_micro[0]->set_simpoint(true, BBV_INTERVAL, program);
+    s_micro[0]->run_fast(SYNTH ? (size_t)stop_amt : (size_t)-1);
+    s_micro[0]->finish_simpoint(BBV_MAX_K);
+    s_micro[0]->set_simpoint(false, 0, program);
+
+    delete s_micro[0];
+    return 0;
+  }
+
   if (checkpoint_file != "")
   {
       fprintf(stderr, "Restoring checkpoint from %s\n",checkpoint_file.c_str());
-      s_micro->restore_checkpoint(checkpoint_file);
+      s_micro[0]->restore_checkpoint(checkpoint_file);
   }
   else if (skip_enable) {
       // If skip amount is provided, fast skip in the MICROS sim
-      fprintf(stderr, "Fast skipping MICROS for %lu instructions\n",skip_amt);
-      htif_code = s_micro->run_fast(skip_amt);
-      // Stop simulation if HTIF returns non-zero code
-      if(!htif_code) return htif_code;
+      for (unsigned int t = 0; t < SMT_THREADS; t++) {
+        fprintf(stderr, "Fast skipping MICROS for %lu instructions\n",skip_amt);
+        if (WARM_AMT)
+          fprintf(stderr, "Warming MICROS during the last %lu instructions\n", WARM_AMT);
+        htif_code = s_micro[t]->run_fast(skip_amt, WARM_AMT);
+        // Stop simulation if HTIF returns non-zero code
+        if(!htif_code) return htif_code;
+      }
   }
 
   //htif_code = s_micro->create_checkpoint();
   // Stop simulation if HTIF returns non-zero code
   //if(!htif_code) return htif_code;
 
+  // The trace replaces the functional simulator from the start of the timing region.
+  #ifdef RISCV_MICRO_CHECKER
+  if (replay_file != "") {
+    fprintf(stderr, "Replaying trace %s\n", replay_file.c_str());
+    DB[0]->run_ahead();
+    reg_t pc = s_micro[0]->get_core(0)->get_state()->pc;
+    if (DB[0]->empty() || (DB[0]->head_pc() != pc)) {
+      fprintf(stderr, "The trace does not start where the timing simulator does (pc 0x%" PRIx64 "): record it with the same -s or -c.\n", pc);
+      exit(-1);
+    }
+  }
+  #endif
+
+  if (mkchkpt_file != "") {
+    s_micro[0]->create_checkpoint();
+    endSimulation(0);
+    return 0;
+  }
+
+  if (sweep_file != "") {
+    std::vector<std::string> configs = read_sweep_file(sweep_file);
+    int sweep_status;
+
+    SWEEP_ID = fork_sweep(configs, sweep_jobs, sweep_result, sweep_status);
+    if (!SWEEP_ID) {
+      endSimulation(0);
+      return sweep_status;
+    }
+
+    // This child's options. They configure the timing simulator, not the region.
+    SWEEP_CONFIG = configs[SWEEP_ID - 1].c_str();
+    std::istringstream words(configs[SWEEP_ID - 1]);
+    std::vector<std::string> options;
+    std::vector<const char*> sweep_argv(1, "--sweep");
+    std::string word;
+    while (words >> word)
+      options.push_back(word);
+    for (size_t o = 0; o < options.size(); o++)
+      sweep_argv.push_back(options[o].c_str());
+    sweep_argv.push_back((const char *) NULL);
+
+    auto region = [&]() {
+      return std::make_tuple(skip_amt, skip_enable, checkpoint_file, mkchkpt_file, sweep_file, trace_file, replay_file,
+                             WARM_AMT, BBV_INTERVAL, nprocs, mem_mb, debug, SMT_THREADS, FUNCTIONAL_ORACLE);
+    };
+    auto before = region();
+    if (*parser.parse(&sweep_argv[0]) || (region() != before)) {
+      fprintf(stderr, "Sweep configuration %u (%s): only timing simulator options can be swept (not -s, -c, --warm, --replay, -p, -m, -d, --smt, --nooracle, ...).\n",
+              SWEEP_ID, SWEEP_CONFIG);
+      exit(-1);
+    }
+    check_oracle_features();
+
+    s_micro[0]->reconfigure();
+    #ifdef RISCV_MICRO_CHECKER
+    if (FUNCTIONAL_ORACLE)
+      DB[0]->set_capture_state((CHECKER_POLICY == CHECKER_FULL) || (CHECKER_POLICY == CHECKER_PERIODIC));
+    if (replay_file != "") {
+      DB[0]->reopen_trace();
+      check_trace_state(DB[0]->get_trace_in());
+    }
+    #endif
+  }
+
   // Turn on logging if user requested logging from the start of timing simulation.
   if(logging_on_at == 0)
     logging_on = true;
 
   fprintf(stderr, "Starting MICROS\n");
-  htif_code = s_micro->run();
+  if (smt)
+    htif_code = smt->run();
+  else
+    htif_code = s_micro[0]->run();
   fprintf(stderr, "Stopping MICROS: HTIF Exit Code %d\n",htif_code);
 
+  // A sweep child reports its results to the parent.
+  if (sweep_result) {
+    pipeline_t* p = (pipeline_t*) s_micro[0]->get_core(0);
+    fprintf(sweep_result, "%s %" PRIu64 " %" PRIu64 "\n", p->stats_file.c_str(), p->num_insn, (uint64_t)p->cycle);
+    fclose(sweep_result);
+  }
+
   //*** Must delete the simulator instances in order to dump stats ***
   // Stats are dumped in the destructor for the processor instances.
-  delete s_isa;
-  delete s_micro;
+  endSimulation(0);
 
   return htif_code;
 }
@@ -0,0 +1,217 @@
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+
+#include "parallel.h"
+#include "pipeline.h"
+#include "mmu.h"
+#include "coherence.h"
+#include "host_prof.h"
+
+
+void quantum_stores_t::store(mmu_t* mmu, reg_t addr, unsigned int size, reg_t value) {
+	switch (size) {
+		case 1:
+			mmu->store_translate_uint8(addr);
+			break;
+		case 2:
+			mmu->store_translate_uint16(addr);
+			break;
+		case 4:
+			mmu->store_translate_uint32(addr);
+			break;
+		case 8:
+			mmu->store_translate_uint64(addr);
+			break;
+		default:
+			assert(0);
+			break;
+	}
+
+	// Aligned (else the translation trapped): within one doubleword.
+	word_t& w = words[addr >> 3];
+	unsigned int offset = (unsigned int)(addr & 7);
+	for (unsigned int i = 0; i < size; i++) {
+		unsigned int b = (offset + i);
+		w.data = ((w.data & ~((uint64_t)0xff << (b << 3))) | (((value >> (i << 3)) & 0xff) << (b << 3)));
+		w.mask |= (1 << b);
+	}
+}
+
+reg_t quantum_stores_t::load(reg_t addr, unsigned int size, bool is_signed, reg_t value) {
+	if (words.empty())
+		return(value);
+	auto it = words.find(addr >> 3);
+	if (it == words.end())
+		return(value);
+
+	// Aligned (else the load trapped): within one doubleword.
+	unsigned int offset = (unsigned int)(addr & 7);
+	for (unsigned int i = 0; i < size; i++) {
+		unsigned int b = (offset + i);
+		if (it->second.mask & (1 << b)) {
+			value &= ~((reg_t)0xff << (i << 3));
+			value |= (((it->second.data >> (b << 3)) & 0xff) << (i << 3));
+		}
+	}
+
+	// Extend.
+	if (size < 8) {
+		unsigned int shamt = (64 - (size << 3));
+		value = (is_signed ? (reg_t)(((sreg_t)(value << shamt)) >> shamt) : ((value << shamt) >> shamt));
+	}
+	return(value);
+}
+
+void quantum_stores_t::drain(mmu_t* mmu) {
+	for (auto& it : words) {
+		reg_t addr = (it.first << 3);
+		if (it.second.mask == 0xff) {
+			mmu->store_uint64(addr, it.second.data);
+		}
+		else {
+			for (unsigned int b = 0; b < 8; b++)
+				if (it.second.mask & (1 << b))
+					mmu->store_uint8(addr + b, (uint8_t)(it.second.data >> (b << 3)));
+		}
+	}
+	words.clear();
+}
+
+
+parallel_t::parallel_t(const std::vector<pipeline_t*>& cores, directory_t* dir, unsigned int threads, unsigned int quantum, bool relaxed)
+	: cores(cores), dir(dir), threads(std::max(1U, std::min(threads, (unsigned int)cores.size()))),
+	  base_quantum(std::max(1U, quantum)), quantum(std::max(1U, quantum)), relaxed(relaxed),
+	  retired(cores.size(), 0), stopped(cores.size(), 0), prof(this->threads, (host_prof_t*)NULL),
+	  generation(0), pending(0), quit(false),
+	  n_quanta(0), n_cycles(0), n_quiet(0), n_messages(0), n_drained(0), busy(this->threads, 0.0), wall(0.0) {
+	dir->set_buffered(true);
+	for (size_t c = 0; c < cores.size(); c++)
+		cores[c]->QSTORES = new quantum_stores_t;
+
+	for (unsigned int t = 1; t < this->threads; t++) {
+		if (HOST_PROF)
+			prof[t] = new host_prof_t();
+		pool.push_back(std::thread(&parallel_t::worker, this, t));
+	}
+}
+
+parallel_t::~parallel_t() {
+	{
+		std::unique_lock<std::mutex> l(lock);
+		quit = true;
+	}
+	start_cv.notify_all();
+	for (auto& t : pool)
+		t.join();
+
+	for (size_t t = 0; t < prof.size(); t++)
+		delete prof[t];
+	for (size_t c = 0; c < cores.size(); c++) {
+		delete cores[c]->QSTORES;
+		cores[c]->QSTORES = (quantum_stores_t *) NULL;
+	}
+	dir->set_buffered(false);
+}
+
+void parallel_t::worker(unsigned int t) {
+	uint64_t seen = 0;
+
+	HOST_PROF_THREAD = prof[t];
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> l(lock);
+			start_cv.wait(l, [&]{ return(quit || (generation != seen)); });
+			if (quit)
+				return;
+			seen = generation;
+		}
+		step_cores(t);
+		{
+			std::unique_lock<std::mutex> l(lock);
+			if (--pending == 0)
+				done_cv.notify_one();
+		}
+	}
+}
+
+void parallel_t::step_cores(unsigned int t) {
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t c = t; c < cores.size(); c += threads) {
+		retired[c] = 0;
+		for (uint64_t i = 0; (i < quantum) && !stopped[c]; i++) {
+			size_t instret = 0;
+			stopped[c] = cores[c]->step_micro((size_t)-1, instret);
+			retired[c] += instret;
+		}
+	}
+
+	busy[t] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool parallel_t::run_quantum(size_t& instret) {
+	auto start = std::chrono::steady_clock::now();
+	bool stop = false;
+
+	{
+		std::unique_lock<std::mutex> l(lock);
+		pending = (threads - 1);
+		generation++;
+	}
+	start_cv.notify_all();
+	step_cores(0);
+	{
+		std::unique_lock<std::mutex> l(lock);
+		done_cv.wait(l, [&]{ return(pending == 0); });
+	}
+
+	synchronize();
+
+	instret = 0;
+	for (size_t c = 0; c < cores.size(); c++) {
+		instret += retired[c];
+		stop = (stop || stopped[c]);
+	}
+	wall += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return(stop);
+}
+
+// At the barrier: only the main thread runs.
+void parallel_t::synchronize() {
+	uint64_t messages = dir->apply();
+
+	for (size_t c = 0; c < cores.size(); c++) {
+		if (!cores[c]->QSTORES->empty()) {
+			n_drained += cores[c]->QSTORES->size();
+			cores[c]->QSTORES->drain(cores[c]->get_mmu());
+		}
+	}
+	if (HOST_PROF) {
+		for (unsigned int t = 1; t < threads; t++)
+			HOST_PROF->absorb(*prof[t]);
+	}
+
+	n_quanta++;
+	n_cycles += quantum;
+	n_messages += messages;
+	if (!messages)
+		n_quiet++;
+
+	if (relaxed)
+		quantum = (messages ? base_quantum : std::min((quantum << 1), (base_quantum * PARALLEL_RELAXED_MAX)));
+}
+
+void parallel_t::dump_stats(FILE* fp) {
+	fprintf(fp, "PARALLEL MEASUREMENTS------------------------------\n");
+	fprintf(fp, "  host threads     = %u, for %u cores\n", threads, (unsigned int)cores.size());
+	fprintf(fp, "  quanta           = %" PRIu64 " (%s, %" PRIu64 " cycles%s)\n", n_quanta, (relaxed ? "relaxed" : "deterministic"),
+	        base_quantum, (relaxed ? " or more" : ""));
+	fprintf(fp, "     mean quantum  = %.1f cycles\n", (n_quanta ? ((double)n_cycles / (double)n_quanta) : 0.0));
+	fprintf(fp, "     quiet         = %" PRIu64 " (no invalidations or forwards)\n", n_quiet);
+	fprintf(fp, "  messages         = %" PRIu64 " (invalidations and forwards)\n", n_messages);
+	fprintf(fp, "  drained          = %" PRIu64 " doublewords of stores\n", n_drained);
+	fprintf(fp, "  host time        = %.3f s\n", wall);
+	for (unsigned int t = 0; t < threads; t++)
+		fprintf(fp, "     thread %-6u = %.3f s stepping (%5.2f%%)\n", t, busy[t], (wall ? (100.0 * busy[t] / wall) : 0.0));
+}
@@ -0,0 +1,126 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstdio>
+#include <cinttypes>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "decode.h"
+#include "parameters.h"
+
+/*--------------------------------------------------------------------------*\
+ | parallel.h
+ |
+ | Parallel host threads for multi-core timing simulation (--parallel, with
+ | -p<n>; see coherence.h).
+ |
+ | The cores are divided among PARALLEL_THREADS host threads (core c runs on
+ | thread c % PARALLEL_THREADS; thread 0 is the main thread). Each thread
+ | steps its cores, one after the other, for a quantum of cycles; then all
+ | threads wait at a barrier, where the main thread synchronizes the cores:
+ |
+ | - The coherence directory applies the quantum's requests of all cores, in
+ |   cycle order (see directory_t::apply()). During the quantum, a core's
+ |   L2 misses and write permissions were timed from the directory's state
+ |   at the quantum's start: another core's interference is seen one
+ |   quantum late.
+ | - Each core's stores of the quantum (stores, SCs and AMOs, at retire) are
+ |   buffered in its quantum_stores_t, and its own loads see them. They are
+ |   written to the shared memory image, in core order. Other cores see them
+ |   at the next quantum, so atomicity of AMOs and LR/SC between cores holds
+ |   only at quantum granularity.
+ | - The HTIF ticks for the instructions retired in the quantum.
+ |
+ | The cores interact only at the barrier, in an order that does not depend
+ | on the host threads: results are repeatable and the same for any number
+ | of threads (but differ from the lockstep simulation without --parallel).
+ |
+ | In relaxed mode, the quantum doubles, up to PARALLEL_RELAXED_MAX times
+ | PARALLEL_QUANTUM, after every quantum without invalidations or forwards
+ | between cores, and returns to PARALLEL_QUANTUM after one with them: fewer
+ | barriers while the cores do not interact, at some cost in accuracy when
+ | they start to. It is just as repeatable.
+\*--------------------------------------------------------------------------*/
+
+class mmu_t;
+class pipeline_t;
+class directory_t;
+class host_prof_t;
+
+// One core's stores of a quantum, by aligned doubleword.
+class quantum_stores_t {
+public:
+	// Buffer a store of 'size' bytes. Translates 'addr' first: throws its mem_trap_t, if any.
+	void store(mmu_t* mmu, reg_t addr, unsigned int size, reg_t value);
+
+	// 'value', loaded from memory at 'addr', with the bytes of the buffered stores.
+	reg_t load(reg_t addr, unsigned int size, bool is_signed, reg_t value);
+
+	// Write the buffered stores to memory, and clear them.
+	void drain(mmu_t* mmu);
+
+	bool empty() { return(words.empty()); }
+	size_t size() { return(words.size()); }   // doublewords
+
+private:
+	typedef struct {
+		uint64_t data;
+		uint8_t mask;    // bytes written
+	} word_t;
+
+	std::unordered_map<reg_t, word_t> words;
+};
+
+class parallel_t {
+public:
+	// Run 'cores' on 'threads' host threads (at most one per core), synchronizing
+	// every 'quantum' cycles. Buffers 'dir' and the cores' stores.
+	parallel_t(const std::vector<pipeline_t*>& cores, directory_t* dir, unsigned int threads, unsigned int quantum, bool relaxed);
+	~parallel_t();
+
+	// Step all cores for one quantum, and synchronize them. 'instret' is passed back:
+	// the instructions they retired. Returns true if a core stopped (it reached -e).
+	bool run_quantum(size_t& instret);
+
+	// "PARALLEL MEASUREMENTS".
+	void dump_stats(FILE* fp);
+
+private:
+	void worker(unsigned int t);
+	void step_cores(unsigned int t);   // host thread t's share of the quantum
+	void synchronize();
+
+	std::vector<pipeline_t*> cores;
+	directory_t* dir;
+	unsigned int threads;
+	uint64_t base_quantum;
+	uint64_t quantum;
+	bool relaxed;
+
+	std::vector<size_t> retired;            // per core, this quantum
+	std::vector<unsigned char> stopped;     // per core
+	std::vector<host_prof_t*> prof;         // per host thread (--hostprof), other than the main thread
+
+	// Barrier.
+	std::vector<std::thread> pool;
+	std::mutex lock;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+	uint64_t generation;                    // quanta started
+	unsigned int pending;                   // worker threads still stepping
+	bool quit;
+
+	// Stats.
+	uint64_t n_quanta;
+	uint64_t n_cycles;
+	uint64_t n_quiet;                       // quanta without messages between cores
+	uint64_t n_messages;                    // invalidations and forwards
+	uint64_t n_drained;                     // doublewords written at barriers
+	std::vector<double> busy;               // host seconds stepping, per host thread
+	double wall;                            // host seconds in run_quantum()
+};
+
+#endif //PARALLEL_H
@@ -1,10 +1,40 @@
 #include <cinttypes>
 #include "fu.h"
+#include "parameters.h"
 
 // Pipe control
 uint32_t PIPE_QUEUE_SIZE  = 8192;
 
+// Checker control.
+checker_policy_e CHECKER_POLICY = CHECKER_FULL;
+uint64_t CHECKER_INTERVAL       = 0;
 
+// Basic block vector profiling.
+uint64_t BBV_INTERVAL           = 0;
+unsigned int BBV_MAX_K          = 10;
+
+// Functional warming.
+uint64_t WARM_AMT               = 0;
+
+// Configuration sweep.
+unsigned int SWEEP_ID           = 0;
+const char* SWEEP_CONFIG        = "";
+
+// Snapshots.
+uint64_t SNAPSHOT_INTERVAL      = 0;
+unsigned int SNAPSHOT_COUNT     = 4;
+
+// Histograms.
+uint64_t HISTOGRAM_TOP_N        = 100;
+
+
+
+// Functional oracle.
+#ifdef RISCV_MICRO_CHECKER
+bool FUNCTIONAL_ORACLE = true;
+#else
+bool FUNCTIONAL_ORACLE = false;	// the functional simulator is not built in
+#endif
 
 // Oracle controls.
 bool PERFECT_BRANCH_PRED	= false;
@@ -19,6 +49,11 @@ uint32_t NUM_CHECKPOINTS	= 32;
 uint32_t ACTIVE_LIST_SIZE	= 256;
 bool AUTO_PRF_SIZE		= true;
 uint32_t PRF_SIZE		= 320;
+bool MOVE_ELIMINATION		= false;
+uint32_t PRF_RD_PORTS		= 0;
+uint32_t PRF_WR_PORTS		= 0;
+uint32_t PRF_BANKS		= 1;
+uint32_t PRF_BYPASS		= 1;
 uint32_t ISSUE_QUEUE_SIZE	= 32;
 uint32_t ISSUE_QUEUE_NUM_PARTS	= 4;
 uint32_t LQ_SIZE		      = 32;
@@ -81,6 +116,10 @@ unsigned int L1_DC_MISS_LATENCY     = 100; // Used only when no L2 cache
 unsigned int L1_DC_NUM_MHSRs        = 128; 
 unsigned int L1_DC_MISS_SRV_PORTS   = 128;
 unsigned int L1_DC_MISS_SRV_LATENCY = 1;
+unsigned int L1_DC_RD_PORTS         = 0;  // unlimited
+unsigned int L1_DC_WR_PORTS         = 0;  // unlimited
+unsigned int L1_DC_BANKS            = 1;  // not banked
+unsigned int L1_DC_BANK_SIZE        = 3;  // 2^BANK_SIZE bytes: banks interleaved on doublewords
 
 // L1 Instruction Cache.
 unsigned int L1_IC_SETS             = 128;
@@ -114,12 +153,73 @@ unsigned int L3_NUM_MHSRs         = 128;
 unsigned int L3_MISS_SRV_PORTS    = 128;
 unsigned int L3_MISS_SRV_LATENCY  = 1;
 
+// TLB hierarchy and page walker.
+bool         TLB_PRESENT          = false;
+unsigned int ITLB_ENTRIES         = 64;
+unsigned int ITLB_ASSOC           = 4;
+unsigned int DTLB_ENTRIES         = 64;
+unsigned int DTLB_ASSOC           = 4;
+unsigned int STLB_ENTRIES         = 1024;
+unsigned int STLB_ASSOC           = 8;
+unsigned int STLB_LATENCY         = 8;
+unsigned int PWC_ENTRIES          = 16;
+
+// DRAM behind the last-level cache.
+// Defaults: one DDR4-2400 channel (17-17-17) under a 3.2 GHz core.
+bool         DRAM_PRESENT         = false;
+unsigned int DRAM_CHANNELS        = 1;
+unsigned int DRAM_RANKS           = 1;
+unsigned int DRAM_BANKS           = 16;
+unsigned int DRAM_ROW_SIZE        = 8192;
+unsigned int DRAM_tRCD            = 45;
+unsigned int DRAM_tCAS            = 45;
+unsigned int DRAM_tRP             = 45;
+unsigned int DRAM_BUS_BYTES       = 6;
+unsigned int DRAM_RQ_SIZE         = 32;
+unsigned int DRAM_WQ_SIZE         = 32;
+unsigned int DRAM_CTRL_LATENCY    = 30;
+
+// Hardware prefetchers.
+prefetcher_e L1_DC_PREFETCHER     = PF_NONE;
+unsigned int L1_DC_PF_DEGREE      = 2;
+prefetcher_e L2_PREFETCHER        = PF_NONE;
+unsigned int L2_PF_DEGREE         = 4;
+bool         PF_THROTTLE          = true;
+
+// Value prediction.
+vp_e         VP_TYPE              = VP_NONE;
+unsigned int VP_ENTRIES           = 4096;
+unsigned int VP_CONF              = 7;
+bool         VP_LOADS_ONLY        = false;
+
+// Macro-op fusion.
+fusion_e     MACRO_FUSION         = FUSION_NONE;
+
+// Simultaneous multithreading.
+unsigned int SMT_THREADS          = 1;
+smt_fetch_e  SMT_FETCH_POLICY     = SMT_FETCH_ICOUNT;
+unsigned int SMT_FETCH_THREADS    = 1;
+bool         SMT_SHARED           = true;
+
+// Multi-core timing simulation.
+unsigned int MC_CORES             = 1;
+unsigned int COH_L3_BANKS         = 4;
+unsigned int COH_BANK_BUSY        = 2;
+unsigned int COH_DIR_LATENCY      = 4;
+unsigned int COH_HOP_LATENCY      = 8;
+
+// Parallel host threads for the cores.
+unsigned int PARALLEL_THREADS     = 0;
+unsigned int PARALLEL_QUANTUM     = 1000;
+bool         PARALLEL_RELAXED     = false;
+
 // Branch prediction unit
 bool AUTO_BQ_SIZE = true;
 unsigned int BQ_SIZE = 512;
 unsigned int BTB_ENTRIES = 8192;
 unsigned int BTB_ASSOC = 4;
 unsigned int RAS_SIZE = 64;
+unsigned int FTQ_SIZE = 0;
 unsigned int COND_BRANCH_PRED_PER_CYCLE = 3;
 unsigned int CBP_PC_LENGTH = 20;
 unsigned int CBP_BHR_LENGTH = 16;
@@ -135,4 +235,5 @@ bool use_stop_amt                   = false;
 uint64_t stop_amt                   = 0xffffffffffffffff;
 
 uint64_t phase_interval             = 10000;
+phase_stats_e PHASE_STATS           = PHASE_STATS_OFF;
 uint64_t verbose_phase_counters     = true;
@@ -5,6 +5,42 @@
 // Pipe control
 extern unsigned int PIPE_QUEUE_SIZE;
 
+// Checker control.
+typedef enum {
+   CHECKER_FULL,        // check every retired instruction against the functional simulator
+   CHECKER_PERIODIC,    // fully check one retired instruction every CHECKER_INTERVAL instructions
+   CHECKER_SIGNATURE,   // compare rolling signatures of retired instructions every CHECKER_INTERVAL instructions
+   CHECKER_OFF          // no checking
+} checker_policy_e;
+
+extern checker_policy_e CHECKER_POLICY;
+extern uint64_t CHECKER_INTERVAL;   // 0: use the phase interval
+
+// Functional oracle.
+// If false, no functional simulator or debug buffer is created, and all
+// features that consult them (checker, perfect branch prediction, oracle
+// memory disambiguation, oracle CPR checkpoint placement) are disabled.
+extern bool FUNCTIONAL_ORACLE;
+
+// Basic block vector profiling (SimPoint).
+extern uint64_t BBV_INTERVAL;       // 0: no profiling, otherwise the profiling interval in instructions
+extern unsigned int BBV_MAX_K;      // maximum number of phases (simulation points)
+
+// Functional warming: the last WARM_AMT instructions of fast-skip (-s) warm the
+// caches, TLBs, branch predictors, MDP and value predictor.
+extern uint64_t WARM_AMT;
+
+// Configuration sweep (--sweep): after -s or -c, one child process per line of the
+// sweep file simulates the region with that line's options.
+extern unsigned int SWEEP_ID;       // the child's configuration (1, 2, ...), 0: not a sweep child
+extern const char* SWEEP_CONFIG;    // ...and its options
+
+// Snapshots for rewinding to shortly before a failure (--snapshot; see snapshot.h).
+extern uint64_t SNAPSHOT_INTERVAL;  // 0: no snapshots, otherwise cycles between them
+extern unsigned int SNAPSHOT_COUNT; // most recent snapshots kept (the oldest is resumed)
+
+// Histograms (-g).
+extern uint64_t HISTOGRAM_TOP_N;    // number of hottest PCs / most mispredicted branches dumped, 0: all
 
 // Oracle controls.
 extern bool PERFECT_BRANCH_PRED;
@@ -19,6 +55,11 @@ extern unsigned int NUM_CHECKPOINTS;
 extern unsigned int ACTIVE_LIST_SIZE;
 extern bool AUTO_PRF_SIZE;
 extern unsigned int PRF_SIZE;
+extern bool         MOVE_ELIMINATION;  // eliminate register moves and zero idioms at rename
+extern unsigned int PRF_RD_PORTS;      // PRF read ports per bank per cycle (0: unlimited)
+extern unsigned int PRF_WR_PORTS;      // PRF write ports per bank per cycle (0: unlimited)
+extern unsigned int PRF_BANKS;         // PRF banks, interleaved on the physical register number
+extern unsigned int PRF_BYPASS;        // cycles a result stays on the bypass network (0: no bypass)
 extern unsigned int ISSUE_QUEUE_SIZE;
 extern unsigned int ISSUE_QUEUE_NUM_PARTS;
 extern unsigned int LQ_SIZE;
@@ -48,6 +89,10 @@ extern unsigned int L1_DC_MISS_LATENCY;
 extern unsigned int L1_DC_NUM_MHSRs;
 extern unsigned int L1_DC_MISS_SRV_PORTS;
 extern unsigned int L1_DC_MISS_SRV_LATENCY;
+extern unsigned int L1_DC_RD_PORTS;     // loads that can access the D$ per cycle (0: unlimited)
+extern unsigned int L1_DC_WR_PORTS;     // committing stores that can write the D$ per cycle (0: unlimited)
+extern unsigned int L1_DC_BANKS;        // address-interleaved banks (1: no bank conflicts)
+extern unsigned int L1_DC_BANK_SIZE;    // 2^BANK_SIZE bytes per bank interleave unit
 
 // L1 Instruction Cache.
 extern unsigned int L1_IC_SETS;
@@ -81,12 +126,103 @@ extern unsigned int L3_NUM_MHSRs;
 extern unsigned int L3_MISS_SRV_PORTS;
 extern unsigned int L3_MISS_SRV_LATENCY;
 
+// TLB hierarchy and page walker (see tlb.h).
+extern bool         TLB_PRESENT;        // false: address translation takes no time
+extern unsigned int ITLB_ENTRIES;
+extern unsigned int ITLB_ASSOC;
+extern unsigned int DTLB_ENTRIES;
+extern unsigned int DTLB_ASSOC;
+extern unsigned int STLB_ENTRIES;       // unified second-level TLB
+extern unsigned int STLB_ASSOC;
+extern unsigned int STLB_LATENCY;
+extern unsigned int PWC_ENTRIES;        // page-walk cache entries per non-leaf level (0: no PWC)
+
+// DRAM behind the last-level cache (see dram.h).
+extern bool         DRAM_PRESENT;       // false: the last level's flat miss latency
+extern unsigned int DRAM_CHANNELS;
+extern unsigned int DRAM_RANKS;         // per channel
+extern unsigned int DRAM_BANKS;         // per rank
+extern unsigned int DRAM_ROW_SIZE;      // bytes per row buffer (per bank)
+extern unsigned int DRAM_tRCD;          // in CPU cycles
+extern unsigned int DRAM_tCAS;
+extern unsigned int DRAM_tRP;
+extern unsigned int DRAM_BUS_BYTES;     // data bus bytes per CPU cycle, per channel (bandwidth cap)
+extern unsigned int DRAM_RQ_SIZE;       // read queue entries, per channel
+extern unsigned int DRAM_WQ_SIZE;       // write queue entries, per channel
+extern unsigned int DRAM_CTRL_LATENCY;  // LLC to controller and back
+
+// Hardware prefetchers.
+typedef enum {
+   PF_NONE,
+   PF_STRIDE,     // PC-indexed stride (reference prediction table)
+   PF_NEXTLINE,   // next-N-line on a miss
+   PF_STREAM      // stream detection with run-ahead distance
+} prefetcher_e;
+
+extern prefetcher_e L1_DC_PREFETCHER;
+extern unsigned int L1_DC_PF_DEGREE;
+extern prefetcher_e L2_PREFETCHER;
+extern unsigned int L2_PF_DEGREE;
+extern bool         PF_THROTTLE;  // adjust the degree from accuracy and pollution feedback
+
+// Value prediction.
+typedef enum {
+   VP_NONE,
+   VP_LAST_VALUE,  // last value
+   VP_STRIDE,      // last value plus stride
+   VP_VTAGE        // branch-history-tagged last values (VTAGE)
+} vp_e;
+
+extern vp_e         VP_TYPE;
+extern unsigned int VP_ENTRIES;        // entries per predictor table
+extern unsigned int VP_CONF;           // confidence (1-7) needed to use a prediction
+extern bool         VP_LOADS_ONLY;     // predict loads only (otherwise loads and integer ALU ops)
+
+// Macro-op fusion.
+typedef enum {
+   FUSION_NONE,
+   FUSION_IDIOMS,  // known idioms: lui+addi(w), auipc+addi, slli+srli/srai, slli+add
+   FUSION_ANY      // any dependent pair of simple integer ALU ops
+} fusion_e;
+
+extern fusion_e     MACRO_FUSION;
+
+// Simultaneous multithreading (see smt.h).
+#define SMT_MAX_THREADS 4
+
+typedef enum {
+   SMT_FETCH_ICOUNT,   // fetch from the threads with the fewest instructions in decode, rename, dispatch and the IQ
+   SMT_FETCH_RR        // round-robin
+} smt_fetch_e;
+
+extern unsigned int SMT_THREADS;       // hardware threads (1: no SMT)
+extern smt_fetch_e  SMT_FETCH_POLICY;
+extern unsigned int SMT_FETCH_THREADS; // threads that fetch per cycle
+extern bool         SMT_SHARED;        // true: IQ/LQ/SQ/PRF are shared by all threads; false: partitioned equally
+
+// Multi-core timing simulation (see coherence.h).
+#define MC_MAX_CORES 16                // CacheClass folds the thread or core id into 4 bits of the line address
+
+extern unsigned int MC_CORES;          // timing-simulated cores (-p; 1: single core)
+extern unsigned int COH_L3_BANKS;      // shared L3 banks, interleaved by line
+extern unsigned int COH_BANK_BUSY;     // cycles an L3 bank is busy per access
+extern unsigned int COH_DIR_LATENCY;   // directory lookup
+extern unsigned int COH_HOP_LATENCY;   // one interconnect hop between a core and the directory or another core
+
+// Parallel host threads for the cores (see parallel.h).
+#define PARALLEL_RELAXED_MAX 16        // relaxed mode: the quantum grows to at most this many times --parallel's
+
+extern unsigned int PARALLEL_THREADS;  // host threads (0: the cores are stepped in lockstep, on the main thread)
+extern unsigned int PARALLEL_QUANTUM;  // cycles between synchronizations of the cores
+extern bool         PARALLEL_RELAXED;  // grow the quantum while the cores do not interact
+
 // Branch prediction unit
 extern bool AUTO_BQ_SIZE;
 extern unsigned int BQ_SIZE;
 extern unsigned int BTB_ENTRIES;
 extern unsigned int BTB_ASSOC;
 extern unsigned int RAS_SIZE;
+extern unsigned int FTQ_SIZE;          // fetch target queue for FDIP (0: coupled front end)
 extern unsigned int COND_BRANCH_PRED_PER_CYCLE;
 extern unsigned int CBP_PC_LENGTH;
 extern unsigned int CBP_BHR_LENGTH;
@@ -102,6 +238,14 @@ extern bool use_stop_amt;
 extern uint64_t stop_amt;
 
 extern uint64_t phase_interval;
+
+typedef enum {
+   PHASE_STATS_OFF,     // no phase statistics
+   PHASE_STATS_TEXT,    // formatted counters and rates in phase.<date>.log
+   PHASE_STATS_BINARY   // fixed-schema records in phase.<date>.bin (see phase_stream.h)
+} phase_stats_e;
+
+extern phase_stats_e PHASE_STATS;
 extern uint64_t verbose_phase_counters;
 
 #endif //PARAMETERS_H
@@ -173,6 +173,13 @@ void payload::map_to_actual(pipeline_t* proc, unsigned int index) {
 	prev_index = MOD((index + PAYLOAD_BUFFER_SIZE - 2), PAYLOAD_BUFFER_SIZE);
 	first = (index == head);
 
+	// Without the functional simulator, no instruction is linked to an actual instruction.
+	if (!FUNCTIONAL_ORACLE) {
+		buf[index].good_instruction = false;
+		buf[index].db_index = DEBUG_INDEX_INVALID;
+		return;
+	}
+
 	////////////////////////////
 	// Calculate and set state.
 	////////////////////////////
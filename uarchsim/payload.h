@@ -14,6 +14,22 @@ enum {
    SEL_IQ_NONE,	// Skip IQ, mark completed right away. Set this if detected any exceptions before the DISPATCH stage.
 } sel_iq;
 
+typedef
+enum {
+   ELIM_NONE,		// Not eliminated.
+   ELIM_MOVE,		// Register move: the destination shares the source's physical register.
+   ELIM_ZERO,		// Zero idiom: the destination shares x0's physical register.
+} elim_kind;
+
+typedef enum {
+   FUSE_NONE,		// Not fused.
+   FUSE_LUI_ADDI,	// lui+addi(w): 32-bit constant.
+   FUSE_AUIPC_ADDI,	// auipc+addi: PC-relative address.
+   FUSE_SHIFT_PAIR,	// slli+srli/srai: zero/sign extension or bit-field extract.
+   FUSE_SHIFT_ADD,	// slli+add: scaled index.
+   FUSE_DEPENDENT_ALU,	// Any other dependent pair of simple integer ALU ops.
+} fuse_kind;
+
 union union64_t {
    reg_t dw;
    sreg_t sdw;
@@ -151,6 +167,24 @@ typedef struct {
                                 // (The 'sel_iq' enumerated type is also
                                 // defined in this file.)
 
+   // Move elimination (MOVE_ELIMINATION).
+   elim_kind elim;              // If not ELIM_NONE, the Rename Stage maps the
+                                // destination register to the physical
+                                // register of logical register 'elim_log_reg'
+                                // and the instruction skips the IQ.
+   unsigned int elim_log_reg;
+
+   // Macro-op fusion (MACRO_FUSION).
+   fuse_kind fused;             // If not FUSE_NONE, this instruction is the head
+                                // of a fused pair: the next instruction in PAY
+                                // (the tail) is renamed, issued, and executed
+                                // with it as one operation, whose result is the
+                                // tail's. Register B is the tail's other source.
+   bool fused_tail;             // If 'true', this instruction is the tail of a
+                                // fused pair. It only retires, after its head.
+   reg_t fused_value;           // The head's own result (set by Execute Stage),
+                                // for the checker.
+
    uint64_t CSR_addr;           // System register address, for privileged
                                 // instructions that reference and/or modify
                                 // a specified system register.
@@ -187,6 +221,14 @@ typedef struct {
 
    // P4-D
    uint64_t chkpt_id;
+   bool ends_interval;          // A checkpoint was placed after this instruction.
+
+   // Value prediction.
+   bool vp_lookup;              // The instruction looked up the value predictor.
+   bool vp_predicted;           // The instruction's destination value was predicted.
+   uint64_t vp_value;           // Predicted value.
+   uint64_t vp_hist;            // Branch history at rename, prior to this instruction.
+   bool vp_misp;                // Set at writeback: the predicted value was wrong.
 
    ////////////////////////
    // Set by Dispatch Stage.
@@ -0,0 +1,38 @@
+#ifndef PHASE_STREAM_H
+#define PHASE_STREAM_H
+
+#include <cinttypes>
+
+// Binary phase-statistics stream (--phasestats=bin).
+//
+// The file starts with a header that fixes the schema: the names of all
+// counters, and the rates defined over them (as counter indices). The header
+// is followed by one fixed-size record per phase:
+//
+//    uint64_t phase_id;
+//    uint64_t phase_count[num_counters];   // in schema order
+//
+// All fields are little-endian (host order). Rates are not stored: they are
+// computed from the counters by the offline renderer (721sim-phasedump).
+
+#define PHASE_STREAM_MAGIC   0x4553414850313237ULL   // "721PHASE"
+#define PHASE_STREAM_VERSION 1
+
+// Records buffered in memory between writes.
+#define PHASE_STREAM_BUF_RECORDS 1024
+
+typedef struct phase_stream_header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t num_counters;
+  uint32_t num_rates;
+  uint32_t reserved;
+  uint64_t phase_interval;
+  // Followed by, for each counter:
+  //    uint16_t name_length; char name[name_length];
+  // and, for each rate:
+  //    uint16_t name_length; char name[name_length];
+  //    uint32_t numerator; uint32_t denominator; double multiplier;
+} phase_stream_header_t;
+
+#endif //PHASE_STREAM_H
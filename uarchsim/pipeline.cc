@@ -16,7 +16,9 @@
 #include <algorithm>
 #include <sys/stat.h>
 #include "parameters.h"
+#include "synth.h"
 #include <ctime>
+#include <sstream>
 
 #undef STATE
 #define STATE state
@@ -58,6 +60,7 @@ pipeline_t::pipeline_t(
     sim_t*    _sim,
     mmu_t*    _mmu,
     uint32_t  _id,
+    uint32_t  _tid,
     uint32_t  fq_size,
     uint32_t  num_chkpts,
     uint32_t  rob_size,
@@ -78,12 +81,21 @@ pipeline_t::pipeline_t(
   PAY(2*fetch_width + fq_size /* FETCH2, DECODE, FQ */ + 2*dispatch_width + rob_size /* RENAME2, DISPATCH, ROB */),
   FQ(fq_size,this),
   IQ(iq_size,iq_num_parts,this),
-  LSU(lq_size, sq_size, Tid, _mmu, this)
+  LSU(lq_size, sq_size, _tid, _mmu, this)
 {
   unsigned int i, j, ex_depth;
 
   // Initialize the thread id.
-  this->Tid = _id;
+  this->Tid = _tid;
+  SMT = (smt_t *) NULL;
+  shared_memory = false;
+  COH = (directory_t *) NULL;
+  shared_l3 = false;
+  coh_amo_ready = -1;
+  PARALLEL = (parallel_t *) NULL;
+  QSTORES = (quantum_stores_t *) NULL;
+  num_insn_last_beat = 0;
+  warm_n_insn = warm_n_load = warm_n_store = warm_n_mdp = 0;
 
   // Initialize simulator time:
   cycle = 0;
@@ -96,6 +108,22 @@ pipeline_t::pipeline_t(
   // ---------------------------------- //
   instr_renamed_since_last_checkpoint = 0;
   // ---------------------------------- //
+  precise_exception_pending = false;
+  precise_exception_pc = 0;
+
+  // Retirement starts idle, at the oldest checkpoint.
+  memset(&RETSTATE, 0, sizeof(RETSTATE));
+  RETSTATE.state = retire_state_e::RETIRE_IDLE;
+
+  // Value prediction.
+  VP = new_value_predictor(VP_TYPE, VP_ENTRIES, VP_CONF);
+  vp_ghist = vp_ghist_commit = 0;
+  vp_n_eligible = vp_n_predicted = vp_n_misp = vp_n_misp_detected = 0;
+
+  // Retire-signature checker.
+  chk_sig_micro = chk_sig_isa = CHECKER_SIG_BASIS;
+  chk_sig_count = 0;
+  chk_sig_start = 0;
 
   /////////////////////////////////////////////////////////////
   // Pipeline widths.
@@ -130,16 +158,57 @@ pipeline_t::pipeline_t(
 
   // stats must be constructed first as other classes use them
   this->stats = &statsModule;
-  #define OPEN_LOG_FILE(x) (sprintf(tempstr, "%s.%d-%02d-%02d.%02d:%02d:%02d.log", (x),               \
+  #define OPEN_LOG_FILE(x,ext,mode) (sprintf(tempstr, "%s.%d-%02d-%02d.%02d:%02d:%02d.%s", (x),     \
                                              (ltm->tm_year - 100), (1 + ltm->tm_mon), (ltm->tm_mday), \
-                                             (ltm->tm_hour), (ltm->tm_min), (ltm->tm_sec)),           \
-                                             fopen(tempstr, "w"))
-  this->stats_log = OPEN_LOG_FILE("stats");
-  //this->phase_log = OPEN_LOG_FILE("phase");
-  this->phase_log = (FILE *)NULL;
+                                             (ltm->tm_hour), (ltm->tm_min), (ltm->tm_sec), (ext)),    \
+                                             fopen(tempstr, (mode)))
+  // With SMT, each thread has its own logs: stats.t<tid>.<date>.log, etc.
+  // With multiple cores, each core has its own logs: stats.c<core>.<date>.log, etc.
+  // Each configuration of a sweep has its own logs: stats.sweep<n>.<date>.log, etc.
+  char stats_name[32], phase_name[32];
+  if (SWEEP_ID) {
+    sprintf(stats_name, "stats.sweep%u", SWEEP_ID);
+    sprintf(phase_name, "phase.sweep%u", SWEEP_ID);
+  }
+  else if (MC_CORES > 1) {
+    sprintf(stats_name, "stats.c%u", Tid);
+    sprintf(phase_name, "phase.c%u", Tid);
+  }
+  else {
+    sprintf(stats_name, ((SMT_THREADS > 1) ? "stats.t%u" : "stats"), Tid);
+    sprintf(phase_name, ((SMT_THREADS > 1) ? "phase.t%u" : "phase"), Tid);
+  }
+  this->stats_log = OPEN_LOG_FILE(stats_name, "log", "w");
+  this->stats_file = tempstr;
+  if (PHASE_STATS == PHASE_STATS_TEXT)
+    this->phase_log = OPEN_LOG_FILE(phase_name, "log", "w");
+  else if (PHASE_STATS == PHASE_STATS_BINARY)
+    this->phase_log = OPEN_LOG_FILE(phase_name, "bin", "wb");
+  else
+    this->phase_log = (FILE *)NULL;
   #undef OPEN_LOG_FILE
   stats->set_log_files(stats_log, phase_log);
-  //stats->set_phase_interval("commit_count", phase_interval);
+  if (phase_log) {
+    stats->set_phase_binary(PHASE_STATS == PHASE_STATS_BINARY);
+    stats->set_phase_interval("commit_count", phase_interval);
+    // With SMT, the threads' host time is accounted together: it goes in thread 0's phases.
+    if (HOST_PROF && (Tid == 0))
+      HOST_PROF->register_phase_stats(stats);
+  }
+
+  /////////////////////////////////////////////////////////////
+  // DRAM behind the last-level cache.
+  /////////////////////////////////////////////////////////////
+
+  if (DRAM_PRESENT) {
+    unsigned int llc_line_size = (L2_PRESENT ? (L3_PRESENT ? L3_LINE_SIZE : L2_LINE_SIZE) : L1_DC_LINE_SIZE);
+    DRAM = new dram_t(DRAM_CHANNELS, DRAM_RANKS, DRAM_BANKS, DRAM_ROW_SIZE, (1 << llc_line_size),
+                      DRAM_tRCD, DRAM_tCAS, DRAM_tRP, DRAM_BUS_BYTES,
+                      DRAM_RQ_SIZE, DRAM_WQ_SIZE, DRAM_CTRL_LATENCY);
+  }
+  else {
+    DRAM = (dram_t *) NULL;
+  }
 
   /////////////////////////////////////////////////////////////
   // Unified L2 and L3 caches.
@@ -174,12 +243,30 @@ pipeline_t::pipeline_t(
                          this,
                          "l2_c",
                          L3C);
+    L2C->set_prefetcher(new_prefetcher(L2_PREFETCHER, L2_PF_DEGREE, L2_LINE_SIZE));
   }
   else {
      L2C = (CacheClass *) NULL;
      L3C = (CacheClass *) NULL;
   }
 
+  /////////////////////////////////////////////////////////////
+  // TLB hierarchy. Page walks read the L2 cache.
+  /////////////////////////////////////////////////////////////
+
+  if (TLB_PRESENT) {
+    TLB = new tlb_hierarchy_t(_mmu,
+                              ITLB_ENTRIES, ITLB_ASSOC,
+                              DTLB_ENTRIES, DTLB_ASSOC,
+                              STLB_ENTRIES, STLB_ASSOC,
+                              STLB_LATENCY,
+                              PWC_ENTRIES);
+    TLB->set_memory(L2C, DRAM, L1_DC_MISS_LATENCY, Tid);
+  }
+  else {
+    TLB = (tlb_hierarchy_t *) NULL;
+  }
+
   /////////////////////////////////////////////////////////////
   // Fetch unit.
   /////////////////////////////////////////////////////////////
@@ -199,6 +286,7 @@ pipeline_t::pipeline_t(
 			      IBP_PC_LENGTH, IBP_BHR_LENGTH,
 			      RAS_SIZE,
 			      BQ_SIZE,
+			      FTQ_SIZE,
 			      ENABLE_TRACE_CACHE,
 			      PERFECT_TRACE_CACHE,
 			      PERFECT_BRANCH_PRED,
@@ -215,6 +303,7 @@ pipeline_t::pipeline_t(
 			      _mmu,  // pointer to mmu
 			      this,  // pointer to pipeline_t
 			      &PAY); // pointer to PAY
+  FetchUnit->set_tlb(TLB);
 
   /////////////////////////////////////////////////////////////
   // Pipeline register between the Fetch and Decode Stages.
@@ -231,6 +320,10 @@ pipeline_t::pipeline_t(
   // Set up the register renaming modules.
   ////////////////////////////////////////////////////////////
   REN = new renamer(NXPR+NFPR, prf_size, num_chkpts, rob_size);
+  if (PRF_RD_PORTS || PRF_WR_PORTS)
+    PRF_PORTS = new prf_ports_t(prf_size, PRF_RD_PORTS, PRF_WR_PORTS, PRF_BANKS, PRF_BYPASS);
+  else
+    PRF_PORTS = (prf_ports_t *) NULL;
 
   /////////////////////////////////////////////////////////////
   // Pipeline register between the Rename and Dispatch Stages.
@@ -276,6 +369,7 @@ pipeline_t::pipeline_t(
   /////////////////////////////////////////////////////////////
 
   LSU.set_l2_cache(L2C);
+  LSU.set_tlb(TLB);
 
 
   // Declare and set the various knobs in the knobs database.
@@ -290,12 +384,46 @@ pipeline_t::pipeline_t(
   fprintf(stats_log, "PERFECT_TRACE_CACHE = %d\n", (PERFECT_TRACE_CACHE ? 1 : 0));
   fprintf(stats_log, "ORACLE_DISAMBIG     = %d\n", (ORACLE_DISAMBIG ? 1 : 0));
 
+  fprintf(stats_log, "FUNCTIONAL_ORACLE   = %d\n", (FUNCTIONAL_ORACLE ? 1 : 0));
+  fprintf(stats_log, "SYNTHETIC_WORKLOAD  = %s\n", (SYNTH ? SYNTH->describe().c_str() : "none"));
+
+  fprintf(stats_log, "\n=== CHECKER =====================================================================\n\n");
+  fprintf(stats_log, "CHECKER_POLICY      = %s\n", ((CHECKER_POLICY == CHECKER_FULL) ? "full" :
+                                                   (CHECKER_POLICY == CHECKER_PERIODIC) ? "periodic" :
+                                                   (CHECKER_POLICY == CHECKER_SIGNATURE) ? "signature" : "off"));
+  if ((CHECKER_POLICY == CHECKER_PERIODIC) || (CHECKER_POLICY == CHECKER_SIGNATURE))
+     fprintf(stats_log, "CHECKER_INTERVAL    = %lu (%s)\n", (CHECKER_INTERVAL ? CHECKER_INTERVAL : phase_interval), (CHECKER_INTERVAL ? "user-specified" : "phase interval"));
+
   fprintf(stats_log, "\n=== STRUCTURES AND POLICIES =====================================================\n\n");
+  if (SMT_THREADS > 1) {
+    fprintf(stats_log, "SMT:\n");
+    fprintf(stats_log, "   THREADS = %u (this is thread %u)\n", SMT_THREADS, Tid);
+    fprintf(stats_log, "   FETCH POLICY = %s, %u thread(s) per cycle\n", ((SMT_FETCH_POLICY == SMT_FETCH_RR) ? "round-robin" : "ICOUNT"), SMT_FETCH_THREADS);
+    fprintf(stats_log, "   IQ, LQ/SQ, PRF = %s (sizes below are per thread)\n", (SMT_SHARED ? "shared" : "partitioned"));
+  }
+  if (MC_CORES > 1) {
+    fprintf(stats_log, "CORES:\n");
+    fprintf(stats_log, "   CORES = %u (this is core %u), private L1 I$, L1 D$ and L2$, shared L3$ and DRAM\n", MC_CORES, Tid);
+    fprintf(stats_log, "   L3$ BANKS = %u, each busy %u cycles per access\n", COH_L3_BANKS, COH_BANK_BUSY);
+    fprintf(stats_log, "   DIRECTORY = MESI, full-map, %u-cycle lookup, %u cycles per hop\n", COH_DIR_LATENCY, COH_HOP_LATENCY);
+    if (PARALLEL_THREADS)
+      fprintf(stats_log, "   PARALLEL = %u host threads, %u-cycle quantum (%s)\n", PARALLEL_THREADS, PARALLEL_QUANTUM,
+              (PARALLEL_RELAXED ? "relaxed: grows while the cores do not interact" : "deterministic"));
+    else
+      fprintf(stats_log, "   PARALLEL = none (the cores are stepped in lockstep)\n");
+  }
   fprintf(stats_log, "FETCH QUEUE = %d\n", fq_size);
   fprintf(stats_log, "RENAMER:\n");
   fprintf(stats_log, "   ACTIVE LIST = %d\n", rob_size);
   fprintf(stats_log, "   PHYSICAL REGISTER FILE = %d (%s)\n", prf_size, (AUTO_PRF_SIZE ? "auto-sized w.r.t. Active List" : "user-specified"));
   fprintf(stats_log, "   BRANCH CHECKPOINTS = %d\n", num_chkpts);
+  fprintf(stats_log, "   MOVE ELIMINATION = %d\n", (MOVE_ELIMINATION ? 1 : 0));
+  fprintf(stats_log, "   PRF PORTS = ");
+  if (PRF_RD_PORTS) fprintf(stats_log, "%u read, ", PRF_RD_PORTS); else fprintf(stats_log, "unlimited read, ");
+  if (PRF_WR_PORTS) fprintf(stats_log, "%u write", PRF_WR_PORTS); else fprintf(stats_log, "unlimited write");
+  if (PRF_BANKS > 1) fprintf(stats_log, " per bank, %u banks", PRF_BANKS);
+  fprintf(stats_log, ", %u-cycle bypass\n", PRF_BYPASS);
+  fprintf(stats_log, "   MACRO-OP FUSION = %s\n", ((MACRO_FUSION == FUSION_ANY) ? "any" : ((MACRO_FUSION == FUSION_IDIOMS) ? "idioms" : "none")));
   fprintf(stats_log, "SCHEDULER:\n");
   fprintf(stats_log, "   ISSUE QUEUE = %d\n", iq_size);
   fprintf(stats_log, "   PARTITIONS = %d\n", iq_num_parts);
@@ -339,30 +467,55 @@ pipeline_t::pipeline_t(
 
   fprintf(stats_log, "L1 I$:\n");
   print_cache_config(stats_log, L1_IC_SETS, L1_IC_ASSOC, (1<<L1_IC_LINE_SIZE), L1_IC_HIT_LATENCY, L1_IC_NUM_MHSRs, "(superseded by fetch unit's pipeline depth)");
-  if (!L2_PRESENT) fprintf(stats_log, "   miss latency = %d cycles\n", L1_IC_MISS_LATENCY);
+  if (!L2_PRESENT && !DRAM_PRESENT) fprintf(stats_log, "   miss latency = %d cycles\n", L1_IC_MISS_LATENCY);
 
   fprintf(stats_log, "L1 D$:\n");
   print_cache_config(stats_log, L1_DC_SETS, L1_DC_ASSOC, (1<<L1_DC_LINE_SIZE), L1_DC_HIT_LATENCY, L1_DC_NUM_MHSRs, "(superseded by load/store lane's pipeline depth)");
-  if (!L2_PRESENT) fprintf(stats_log, "   miss latency = %d cycles\n", L1_DC_MISS_LATENCY);
+  if (!L2_PRESENT && !DRAM_PRESENT) fprintf(stats_log, "   miss latency = %d cycles\n", L1_DC_MISS_LATENCY);
+  fprintf(stats_log, "   ports = ");
+  if (L1_DC_RD_PORTS) fprintf(stats_log, "%u read, ", L1_DC_RD_PORTS); else fprintf(stats_log, "unlimited read, ");
+  if (L1_DC_WR_PORTS) fprintf(stats_log, "%u write", L1_DC_WR_PORTS); else fprintf(stats_log, "unlimited write");
+  if (L1_DC_BANKS > 1) fprintf(stats_log, ", %u banks interleaved every %u B\n", L1_DC_BANKS, (1 << L1_DC_BANK_SIZE)); else fprintf(stats_log, ", not banked\n");
+  fprintf(stats_log, "   prefetcher = %s", prefetcher_name(L1_DC_PREFETCHER));
+  if (L1_DC_PREFETCHER != PF_NONE) fprintf(stats_log, " (degree %u, %s)", L1_DC_PF_DEGREE, (PF_THROTTLE ? "throttled" : "unthrottled"));
+  fprintf(stats_log, "\n");
 
   if (L2_PRESENT) {
      fprintf(stats_log, "L2$:\n");
      print_cache_config(stats_log, L2_SETS, L2_ASSOC, (1<<L2_LINE_SIZE), L2_HIT_LATENCY, L2_NUM_MHSRs, "");
-     if (!L3_PRESENT) fprintf(stats_log, "   miss latency = %d cycles\n", L2_MISS_LATENCY);
+     if (!L3_PRESENT && !DRAM_PRESENT) fprintf(stats_log, "   miss latency = %d cycles\n", L2_MISS_LATENCY);
+     fprintf(stats_log, "   prefetcher = %s", prefetcher_name(L2_PREFETCHER));
+     if (L2_PREFETCHER != PF_NONE) fprintf(stats_log, " (degree %u, %s)", L2_PF_DEGREE, (PF_THROTTLE ? "throttled" : "unthrottled"));
+     fprintf(stats_log, "\n");
 
      if (L3_PRESENT) {
         fprintf(stats_log, "L3$:\n");
         print_cache_config(stats_log, L3_SETS, L3_ASSOC, (1<<L3_LINE_SIZE), L3_HIT_LATENCY, L3_NUM_MHSRs, "");
-        fprintf(stats_log, "   miss latency = %d cycles\n", L3_MISS_LATENCY);
+        if (!DRAM_PRESENT) fprintf(stats_log, "   miss latency = %d cycles\n", L3_MISS_LATENCY);
      }
   }
 
+  if (TLB_PRESENT) {
+     fprintf(stats_log, "TLBs:\n");
+     fprintf(stats_log, "   ITLB = %u entries, %u-way; DTLB = %u entries, %u-way\n", ITLB_ENTRIES, ITLB_ASSOC, DTLB_ENTRIES, DTLB_ASSOC);
+     fprintf(stats_log, "   STLB = %u entries, %u-way, %u cycles\n", STLB_ENTRIES, STLB_ASSOC, STLB_LATENCY);
+     fprintf(stats_log, "   page-walk cache = %u entries per level, walks read the %s\n", PWC_ENTRIES, (L2_PRESENT ? "L2$" : "memory"));
+  }
+
+  if (DRAM_PRESENT) {
+     fprintf(stats_log, "DRAM:\n");
+     fprintf(stats_log, "   %u channel(s) x %u rank(s) x %u banks, %u B rows (open page)\n", DRAM_CHANNELS, DRAM_RANKS, DRAM_BANKS, DRAM_ROW_SIZE);
+     fprintf(stats_log, "   tRCD-tCAS-tRP = %u-%u-%u cycles, controller latency = %u cycles\n", DRAM_tRCD, DRAM_tCAS, DRAM_tRP, DRAM_CTRL_LATENCY);
+     fprintf(stats_log, "   bus = %u B/cycle per channel, read queue = %u, write queue = %u (FR-FCFS drain)\n", DRAM_BUS_BYTES, DRAM_RQ_SIZE, DRAM_WQ_SIZE);
+  }
+
   fprintf(stats_log, "\n=== BRANCH PREDICTOR ============================================================\n\n");
 
   fprintf(stats_log, "BQ_SIZE = %d (%s)\n", BQ_SIZE, (AUTO_BQ_SIZE ? "auto-sized" : "user-specified"));
   fprintf(stats_log, "BTB_ENTRIES = %d\n", BTB_ENTRIES);
   fprintf(stats_log, "BTB_ASSOC = %d\n", BTB_ASSOC);
   fprintf(stats_log, "RAS_SIZE = %d\n", RAS_SIZE);
+  fprintf(stats_log, "FTQ_SIZE = %d (%s)\n", FTQ_SIZE, ((FTQ_SIZE == 0) ? "coupled front end" : (PERFECT_BRANCH_PRED ? "disabled by perfect branch prediction" : "fetch-directed I$ prefetching")));
   fprintf(stats_log, "COND_BRANCH_PRED_PER_CYCLE = %d\n", COND_BRANCH_PRED_PER_CYCLE);
   fprintf(stats_log, "CBP_PC_LENGTH = %d\n", CBP_PC_LENGTH);
   fprintf(stats_log, "CBP_BHR_LENGTH = %d\n", CBP_BHR_LENGTH);
@@ -370,9 +523,34 @@ pipeline_t::pipeline_t(
   fprintf(stats_log, "IBP_BHR_LENGTH = %d\n", IBP_BHR_LENGTH);
   fprintf(stats_log, "ENABLE_TRACE_CACHE = %d\n", (ENABLE_TRACE_CACHE ? 1 : 0));
 
+  fprintf(stats_log, "\n=== VALUE PREDICTOR =============================================================\n\n");
+
+  fprintf(stats_log, "VP_TYPE = %s\n", value_predictor_name(VP_TYPE));
+  if (VP) {
+     fprintf(stats_log, "VP_ENTRIES = %u (per table)\n", VP_ENTRIES);
+     fprintf(stats_log, "VP_CONF = %u (of %d)\n", VP_CONF, VP_CONF_MAX);
+     fprintf(stats_log, "VP_LOADS_ONLY = %d\n", (VP_LOADS_ONLY ? 1 : 0));
+  }
+
+  fprintf(stats_log, "\n=== FUNCTIONAL WARMING ==========================================================\n\n");
+
+  fprintf(stats_log, "WARM_AMT = %" PRIu64 " (last fast-skip instructions that warm the caches and predictors)\n", WARM_AMT);
+
+  if (SWEEP_ID) {
+    fprintf(stats_log, "\n=== CONFIGURATION SWEEP =========================================================\n\n");
+    fprintf(stats_log, "SWEEP_ID     = %u\n", SWEEP_ID);
+    fprintf(stats_log, "SWEEP_CONFIG = %s\n", SWEEP_CONFIG);
+  }
+
   fprintf(stats_log, "\n=== INTERNAL SIMULATOR STRUCTURES ===============================================\n\n");
 
   fprintf(stats_log, "PAYLOAD_BUFFER_SIZE = %d\n", PAY.get_size());
+  fprintf(stats_log, "HOST_PROFILE = %d (host time per stage and structure, in HOST TIME MEASUREMENTS%s)\n",
+          (HOST_PROF ? 1 : 0), (phase_log ? " and the host_* phase counters" : ""));
+  if (SNAPSHOT)
+    fprintf(stats_log, "SNAPSHOTS = every %" PRIu64 " cycles, %u kept (on a failure, the oldest resumes)\n", SNAPSHOT->get_interval(), SNAPSHOT->get_count());
+  else
+    fprintf(stats_log, "SNAPSHOTS = none\n");
 
   fprintf(stats_log, "\n=== END CONFIGURATION ===========================================================\n\n");
 
@@ -400,6 +578,14 @@ pipeline_t::pipeline_t(
 
 pipeline_t::~pipeline_t()
 {
+  // Compare the signatures of the last, partial checking window.
+  if (CHECKER_POLICY == CHECKER_SIGNATURE)
+    check_signature();
+
+  // Account for the host time of the last, partial phase.
+  if (HOST_PROF && (Tid == 0) && phase_log)
+    HOST_PROF->flush_phase(stats);
+
   //stats->dump_knobs();
   stats->dump_counters();
   stats->update_rates();	// Need to call this before dump_rates() to ensure most up-to-date rates.
@@ -410,14 +596,64 @@ pipeline_t::~pipeline_t()
   if (histogram_enabled)
   {
     ifprintf(logging_on,stderr, "PC Histogram size:%lu\n", pc_histogram.size());
-    for(auto iterator = pc_histogram.begin(); iterator != pc_histogram.end(); ++iterator) {
-      ifprintf(logging_on,stderr, "%0lx %lu\n", (iterator->first << 2), iterator->second);
-    }
+    if (logging_on)
+      pc_histogram.dump(stderr, HISTOGRAM_TOP_N, false);
   }
 #endif
 
   FetchUnit->output(stats->get_counter("commit_count"), stats->get_counter("cycle_count"), stats_log);
   LSU.dump_stats(stats_log);
+  if (L2C && !shared_memory) L2C->dump_stats(stats_log);
+  if (L3C && !shared_memory && !shared_l3) L3C->dump_stats(stats_log);
+  if (TLB) {
+    TLB->dump_stats(stats_log);
+    delete TLB;
+  }
+  if (PRF_PORTS) {
+    PRF_PORTS->dump_stats(stats_log, stats->get_counter("cycle_count"));
+    delete PRF_PORTS;
+  }
+  if (DRAM && !shared_memory && !shared_l3) {
+    DRAM->dump_stats(stats_log, stats->get_counter("cycle_count"));
+    delete DRAM;
+  }
+  if (SMT)
+    SMT->dump_stats(Tid, stats_log);
+  if (COH) {
+    COH->dump_core_stats(Tid, stats_log);
+    if (Tid == 0)
+      COH->dump_stats(stats_log);
+  }
+  if (PARALLEL && (Tid == 0))
+    PARALLEL->dump_stats(stats_log);
+  if (SNAPSHOT && (Tid == 0))
+    SNAPSHOT->dump_stats(stats_log);
+  if (WARM_AMT) {
+    fprintf(stats_log, "WARMING MEASUREMENTS-------------------------------\n");
+    fprintf(stats_log, "  instructions     = %" PRIu64 "\n", warm_n_insn);
+    fprintf(stats_log, "  loads            = %" PRIu64 "\n", warm_n_load);
+    fprintf(stats_log, "  stores           = %" PRIu64 "\n", warm_n_store);
+    fprintf(stats_log, "  MDP trained      = %" PRIu64 "\n", warm_n_mdp);
+  }
+  if (VP) {
+    uint64_t n_used = (vp_n_predicted + vp_n_misp);
+    fprintf(stats_log, "VALUE PREDICTION MEASUREMENTS----------------------\n");
+    fprintf(stats_log, "  eligible         = %" PRIu64 "\n", vp_n_eligible);
+    fprintf(stats_log, "  correct          = %" PRIu64 " (coverage %.2f%%)\n", vp_n_predicted,
+            (vp_n_eligible ? 100.0*(double)vp_n_predicted/(double)vp_n_eligible : 0.0));
+    fprintf(stats_log, "  mispredicted     = %" PRIu64 " (accuracy %.2f%%)\n", vp_n_misp,
+            (n_used ? 100.0*(double)vp_n_predicted/(double)n_used : 0.0));
+    fprintf(stats_log, "     detected      = %" PRIu64 " (including wrong-path)\n", vp_n_misp_detected);
+    delete VP;
+  }
+  if (HOST_PROF && (Tid == 0)) {
+    HOST_PROF->dump_stats(stats_log, stats->get_counter("commit_count"), stats->get_counter("cycle_count"));
+    if (SMT)
+      fprintf(stats_log, "  (host time of all threads, instructions of thread 0)\n");
+    else if (COH)
+      fprintf(stats_log, "  (host time of all cores, instructions of core 0)\n");
+    HOST_PROF->print_summary(stats->get_counter("commit_count"), stats->get_counter("cycle_count"));
+  }
 
   #ifdef RISCV_MICRO_DEBUG
     fclose(this->fetch_log    );
@@ -435,14 +671,16 @@ pipeline_t::~pipeline_t()
   #endif
 
   fclose(this->stats_log   );
-  //fclose(this->phase_log   );
+  if (this->phase_log) {
+    stats->flush_phase_stream();
+    fclose(this->phase_log );
+  }
 }
 
 inline void pipeline_t::update_histogram(size_t pc)
 {
 #ifdef RISCV_ENABLE_HISTOGRAM
-  size_t idx = pc >> 2;
-  pc_histogram[idx]++;
+  pc_histogram.inc(pc);
 #endif
 }
 
@@ -490,6 +728,10 @@ bool pipeline_t::step_micro(size_t instret_limit, size_t& instret)
   }
   instret_limit = std::min(instret_limit, next_timer(&state) | 1U);
 
+  // Snapshots for rewinding (see snapshot.h), at the start of core or thread 0's cycle.
+  if (SNAPSHOT && (Tid == 0))
+    SNAPSHOT->tick(cycle, num_insn);
+
   try
   {
     take_interrupt();
@@ -538,7 +780,10 @@ bool pipeline_t::step_micro(size_t instret_limit, size_t& instret)
         }*/
         // P4-D replaced retirement unit above with new retire function below
         //printf("Retire command - %llu %llu\n", instret, instret_limit);
-        retire(instret, instret_limit);
+        {
+          HOST_PROF_SCOPE(HP_RETIRE);
+          retire(instret, instret_limit);
+        }
         // Stop simulation if the instruction limit is reached.
         if ((counter(commit_count) >= stop_amt) && use_stop_amt) {
          return true;
@@ -548,27 +793,55 @@ bool pipeline_t::step_micro(size_t instret_limit, size_t& instret)
           inc_counter(retired_bundle_count);
 
         //REN_INT->dump_al(this,PAY,2,regread_log);
-        for (lane_number = 0; lane_number < ISSUE_WIDTH; lane_number++) {
-          writeback(lane_number);    // Writeback Stage
+        // (With --hostprof, each stage's host time is accumulated: see host_prof.h.)
+        {
+          HOST_PROF_SCOPE(HP_WRITEBACK);
+          for (lane_number = 0; lane_number < ISSUE_WIDTH; lane_number++) {
+            writeback(lane_number);    // Writeback Stage
+          }
+        }
+        {
+          HOST_PROF_SCOPE(HP_LOAD_REPLAY);
+          load_replay();
+        }
+        {
+          HOST_PROF_SCOPE(HP_EXECUTE);
+          for (lane_number = 0; lane_number < ISSUE_WIDTH; lane_number++) {
+            execute(lane_number);    // Execute Stage
+          }
+        }
+        {
+          HOST_PROF_SCOPE(HP_REGISTER_READ);
+          for (lane_number = 0; lane_number < ISSUE_WIDTH; lane_number++) {
+            register_read(lane_number);    // Register Read Stage
+          }
+        }
+        {
+          HOST_PROF_SCOPE(HP_SCHEDULE);
+          schedule();           // Schedule Stage
+        }
+        {
+          HOST_PROF_SCOPE(HP_DISPATCH);
+          dispatch();           // Dispatch Stage
         }
-        load_replay();
-        for (lane_number = 0; lane_number < ISSUE_WIDTH; lane_number++) {
-          execute(lane_number);    // Execute Stage
+        {
+          HOST_PROF_SCOPE(HP_RENAME);
+          rename2();            // Rename Stage
+          rename1();            // Rename Stage
         }
-        for (lane_number = 0; lane_number < ISSUE_WIDTH; lane_number++) {
-          register_read(lane_number);    // Register Read Stage
+        {
+          HOST_PROF_SCOPE(HP_DECODE);
+          decode();             // Decode Stage
         }
-        schedule();           // Schedule Stage
-        dispatch();           // Dispatch Stage
-        rename2();            // Rename Stage
-        rename1();            // Rename Stage
-        decode();             // Decode Stage
         //// FETCH will insert NOPs instead of fetching real instructions
         //// from cache if a fetch_exception is pending. This is to make
         //// dispatch never gets stalled due to the absense of a full bundle
         //// in the FETCH QUEUS.his is sort of like a stall.
         //if(!fetch_exception){
+        {
+          HOST_PROF_SCOPE(HP_FETCH);
           fetch();            // Fetch Stage
+        }
         //}
 
         /////////////////////////////////////////////////////////////
@@ -583,8 +856,9 @@ bool pipeline_t::step_micro(size_t instret_limit, size_t& instret)
         if(cycle > (uint64_t)logging_on_at)
           logging_on = true;
 
+	// (Only core 0 reports: with parallel host threads, the other cores run on other threads.)
 	static uint64_t grading_plateau = 1000;
-	if (num_insn >= grading_plateau) {
+	if ((Tid == 0) && (num_insn >= grading_plateau)) {
 	   INFO("GRADING PLATEAU: %lu", grading_plateau);
 	   grading_plateau *= 10;
 	}
@@ -598,7 +872,6 @@ bool pipeline_t::step_micro(size_t instret_limit, size_t& instret)
           //stats->dump_counters();
           //stats->dump_rates();
 
-	  static uint64_t num_insn_last_beat = 0;
 	  if (num_insn == num_insn_last_beat) {
 	     INFO("DEADLOCK.");
 	     assert(0);
@@ -711,12 +984,180 @@ void pipeline_t::copy_state_to_micro() {
    FetchUnit->setPC(get_state()->pc);
 }
 
+void pipeline_t::warm(reg_t pc, insn_t insn, reg_t npc, reg_t addr) {
+   bool load = false;
+   bool store = false;
+
+   warm_n_insn++;
+
+   // Fetch unit: I$, ITLB, BTB, branch predictors and RAS.
+   FetchUnit->warm(pc, insn, npc);
+
+   // Load/store unit: DTLB, D$ (and the L2$, L3$ behind it) and MDP.
+   switch (insn.opcode()) {
+      case OP_LOAD:
+      case OP_LOAD_FP:
+         load = true;
+         break;
+      case OP_STORE:
+      case OP_STORE_FP:
+         store = true;
+         break;
+      case OP_AMO:
+         load = true;
+         store = true;
+         break;
+      default:
+         break;
+   }
+   if (load || store) {
+      if (LSU.warm(pc, addr, (1 << (insn.funct3() & 3)), load, store, warm_n_insn))
+         warm_n_mdp++;
+      if (load)
+         warm_n_load++;
+      if (store)
+         warm_n_store++;
+   }
+
+   // Value predictor: integer results, in program order, with the committed branch history.
+   if (VP && (insn.rd() > 0)) {
+      bool eligible;
+      switch (insn.opcode()) {
+         case OP_LOAD:
+            eligible = true;
+            break;
+         case OP_OP:
+         case OP_OP_32:
+         case OP_OP_IMM:
+         case OP_OP_IMM_32:
+         case OP_LUI:
+         case OP_AUIPC:
+            eligible = !VP_LOADS_ONLY;
+            break;
+         default:
+            eligible = false;
+            break;
+      }
+      if (eligible)
+         VP->train(pc, vp_ghist_commit, get_state()->XPR[insn.rd()]);
+   }
+   if (insn.opcode() == OP_BRANCH)
+      vp_ghist = vp_ghist_commit = ((vp_ghist_commit << 1) | (npc != INCREMENT_PC(pc)));
+}
+
+void pipeline_t::save_warm_state(std::ostream& os) {
+   std::vector<warm_section_t> sections;
+
+   FetchUnit->save_warm(sections);
+   LSU.save_warm(sections);
+   if (L2C) L2C->save_warm(sections);
+   if (L3C) L3C->save_warm(sections);
+   write_warm_state(os, sections);
+}
+
+void pipeline_t::restore_warm_state(std::istream& is) {
+   std::vector<warm_section_t> sections;
+
+   if (!read_warm_state(is, sections)) {
+      fprintf(stderr, "Checkpoint has no warm state: caches and predictors start cold\n");
+      return;
+   }
+
+   for (size_t i = 0; i < sections.size(); i++) {
+      warm_section_t& s = sections[i];
+      bool restored = (FetchUnit->restore_warm(s) || LSU.restore_warm(s) ||
+                       (L2C && (s.name == L2C->name()) && L2C->restore_warm(s)) ||
+                       (L3C && (s.name == L3C->name()) && L3C->restore_warm(s)));
+      fprintf(stderr, "Warm state %-10s: %s\n", s.name.c_str(), (restored ? "restored" : "cold (not in this configuration)"));
+   }
+}
+
+void pipeline_t::take_over(pipeline_t* from) {
+   std::stringstream warm_state;
+
+   reset(false);
+   state = from->state;
+   set_pcr(CSR_STATUS, state.sr);
+   copy_state_to_micro();
+
+   from->save_warm_state(warm_state);
+   restore_warm_state(warm_state);
+   warm_n_insn = from->warm_n_insn;
+   warm_n_load = from->warm_n_load;
+   warm_n_store = from->warm_n_store;
+   warm_n_mdp = from->warm_n_mdp;
+}
+
 uint64_t pipeline_t::get_arch_reg_value(int reg_id) { 
 
     return REN->read(REN->rename_rsrc(reg_id));
 }
 
 
+void pipeline_t::set_smt(smt_t* smt, pipeline_t* owner) {
+   SMT = smt;
+   if (owner == this)
+      return;
+
+   // Use the owner's caches and DRAM instead of this thread's.
+   delete L2C;
+   delete L3C;
+   delete DRAM;
+   L2C = owner->L2C;
+   L3C = owner->L3C;
+   DRAM = owner->DRAM;
+   shared_memory = true;
+
+   LSU.share_dcache(&owner->LSU);
+   FetchUnit->share_icache(owner->FetchUnit->get_icache(), L2C, Tid);
+   if (TLB)
+      TLB->set_memory(L2C, DRAM, L1_DC_MISS_LATENCY, Tid);
+}
+
+void pipeline_t::set_coherence(directory_t* dir, pipeline_t* owner) {
+   COH = dir;
+   L2C->set_coherence(dir, Tid);
+   if (owner == this)
+      return;
+
+   // Use the owner's L3 and DRAM instead of this core's.
+   delete L3C;
+   delete DRAM;
+   L3C = owner->L3C;
+   DRAM = owner->DRAM;
+   shared_l3 = true;
+
+   L2C->set_nextLevel(L3C);
+   if (TLB)
+      TLB->set_memory(L2C, DRAM, L1_DC_MISS_LATENCY, Tid);
+}
+
+void pipeline_t::coherence_invalidate(reg_t addr, unsigned int bytes) {
+   LSU.get_dcache()->Invalidate(Tid, addr, bytes);
+   L2C->Invalidate(Tid, addr, bytes);
+
+   // Another core's write to the reserved line: this core's SC fails.
+   reg_t rsv = state.load_reservation;
+   if ((rsv != (reg_t)-1) && (rsv >= addr) && (rsv < (addr + bytes))) {
+      state.load_reservation = (reg_t)-1;
+      COH->lost_reservation(Tid);
+   }
+}
+
+void pipeline_t::coherence_downgrade(reg_t addr, unsigned int bytes) {
+   LSU.get_dcache()->Clean(Tid, addr, bytes);
+   L2C->Clean(Tid, addr, bytes);
+}
+
+unsigned int pipeline_t::icount() {
+   unsigned int n = (FQ.get_length() + IQ.get_length());
+   for (unsigned int i = 0; i < fetch_width; i++)
+      n += (DECODE[i].valid ? 1 : 0);
+   for (unsigned int i = 0; i < dispatch_width; i++)
+      n += ((RENAME2[i].valid ? 1 : 0) + (DISPATCH[i].valid ? 1 : 0));
+   return(n);
+}
+
 uint32_t pipeline_t::get_instruction(uint64_t inst_pc){
   //TODO: handle fetch exceptions
   insn_fetch_t inst_raw = mmu->load_insn(inst_pc);
@@ -735,6 +1176,6 @@ void pipeline_t::set_branch_misprediction(unsigned int al_index) {
    REN->set_branch_misprediction(al_index);
 }
 
-void pipeline_t::set_value_misprediction(unsigned int al_index) {
-   REN->set_value_misprediction(al_index);
+void pipeline_t::set_value_misprediction(unsigned int chkpt_id) {
+   REN->set_value_misprediction(chkpt_id);
 }
@@ -24,6 +24,13 @@
 
 #include "pipeline_register.h"	// PIPELINE REGISTERS
 
+#include "tlb.h"		// TLB hierarchy and page walker timing
+#include "prf_ports.h"		// PRF read/write ports and bypass network timing
+#include "value_predictor.h"	// value predictors
+#include "smt.h"		// simultaneous multithreading
+#include "coherence.h"		// multi-core: shared L3 and coherence directory
+#include "parallel.h"		// multi-core: parallel host threads
+#include "dram.h"		// memory controller and DRAM behind the last-level cache
 #include "CacheClass.h"		// generic cache class used for instr. cache in FetchUnit, data cache in LSU, and unified L2 cache
 
 #include "fetchunit.h"		// FETCH UNIT
@@ -42,6 +49,9 @@
 
 #include "stats.h"
 
+#include "host_prof.h"	// host time self-profiling (--hostprof)
+#include "snapshot.h"	// snapshots for rewinding to shortly before a failure (--snapshot)
+
 #include "alu_ops.h"
 
 //////////////////////////////////////////////////////////////////////////////
@@ -83,6 +93,9 @@
 #define SET_BIT(x,i)		  (x |= (((unsigned long long)1) << i))
 #define CLEAR_BIT(x,i)		(x &= ~(((unsigned long long)1) << i))
 
+// Initial value of the retire-signature checker's rolling signatures.
+#define CHECKER_SIG_BASIS	0xcbf29ce484222325ULL
+
 //////////////////////////////////////////////////////////////////////////////
 
 #define SOURCE1(in)		(in.rs1())
@@ -173,6 +186,7 @@ public:
 	    sim_t*    _sim,
 	    mmu_t*    _mmu,
 	    uint32_t  _id,
+	    uint32_t  _tid,
 	    uint32_t  fq_size,
 	    uint32_t  num_chkpts,
 	    uint32_t  rob_size,
@@ -202,7 +216,7 @@ public:
      // function.
      uint64_t chkpt_id;
      uint64_t num_loads_left, num_stores_left, num_branches_left;
-     bool amo, csr, exception;
+     bool amo, csr, exception, val_misp;
      // Keep track of the next logical register to process in the 
      // oldest checkpoint.
      uint64_t log_reg;
@@ -214,6 +228,21 @@ public:
 	// P4 - instr_renamed_since_last_checkpoint
 	uint64_t  instr_renamed_since_last_checkpoint;
 
+	// Without the functional oracle: PC of an instruction that excepted in the middle of
+	// its checkpoint interval. The interval is re-executed with a checkpoint placed before it.
+	bool      precise_exception_pending;
+	reg_t     precise_exception_pc;
+
+	// Value prediction (NULL: off). See value_predictor.h.
+	// vp_ghist: conditional branch history at rename (vp_ghist_commit: at retire).
+	value_predictor_t* VP;
+	uint64_t  vp_ghist;
+	uint64_t  vp_ghist_commit;
+	uint64_t  vp_n_eligible;	// retired instructions that looked up the predictor
+	uint64_t  vp_n_predicted;	// ...and used a (correct) prediction
+	uint64_t  vp_n_misp;		// value misprediction recoveries
+	uint64_t  vp_n_misp_detected;	// mispredictions detected at writeback, including on the wrong path
+
 //	void set_debug(bool value);
 //	void set_histogram(bool value);
 	bool get_histogram(){return histogram_enabled;}
@@ -252,6 +281,19 @@ public:
   // Copy registers from fast skip state to pipeline register file.
   // Also reset the AMT.
   void copy_state_to_micro();
+  // Functional warming during fast-skip (see processor_t::warm()): the caches,
+  // TLBs, branch predictors, MDP and value predictor learn from each instruction
+  // of the fast-skip stream, without cycle-level simulation.
+  virtual void warm(reg_t pc, insn_t insn, reg_t npc, reg_t addr);
+
+  // Save or restore the warm state of the caches and predictors in a checkpoint (see warm_state.h).
+  void save_warm_state(std::ostream& os);
+  void restore_warm_state(std::istream& is);
+
+  // Continue from where another timing simulator (of a different configuration) stopped:
+  // take its architectural state, and its warm caches and predictors where they fit.
+  void take_over(pipeline_t* from);
+
   uint64_t get_arch_reg_value(int reg_id); 
   uint64_t get_pc(){return get_state()->pc;}
   uint32_t get_instruction(uint64_t inst_pc);
@@ -288,6 +330,9 @@ private:
   friend class issue_queue;
   friend class lsu;
   friend class CacheClass;
+  friend class smt_t;
+  friend class parallel_t;
+  friend class bench_t;		// tools/bench.cc
 
 
 	//void build_opcode_map();
@@ -397,6 +442,51 @@ private:
 	CacheClass* L2C;
 	CacheClass* L3C;
 
+	/////////////////////////////////////////////////////////////
+	// DRAM behind the last-level cache (NULL: flat miss latency).
+	/////////////////////////////////////////////////////////////
+	dram_t* DRAM;
+
+	/////////////////////////////////////////////////////////////
+	// TLB hierarchy (NULL: translation is free).
+	/////////////////////////////////////////////////////////////
+	tlb_hierarchy_t* TLB;
+
+	/////////////////////////////////////////////////////////////
+	// PRF ports (NULL: unlimited ports).
+	/////////////////////////////////////////////////////////////
+	prf_ports_t* PRF_PORTS;
+
+	/////////////////////////////////////////////////////////////
+	// SMT (NULL: single thread). If shared_memory, the caches and
+	// DRAM belong to another thread.
+	/////////////////////////////////////////////////////////////
+	smt_t* SMT;
+	bool shared_memory;
+
+	/////////////////////////////////////////////////////////////
+	// Multi-core (NULL: single core). The L2 is kept coherent by the
+	// directory. If shared_l3, the L3 and DRAM belong to core 0.
+	/////////////////////////////////////////////////////////////
+	directory_t* COH;
+	bool shared_l3;
+	cycle_t coh_amo_ready;	// cycle the AMO at the head has its line in M (-1: not requested yet)
+
+	/////////////////////////////////////////////////////////////
+	// Parallel host threads (NULL: none; see parallel.h). Retired stores
+	// go to QSTORES until the end of the quantum.
+	/////////////////////////////////////////////////////////////
+	parallel_t* PARALLEL;
+	quantum_stores_t* QSTORES;
+
+	uint64_t num_insn_last_beat;	// for deadlock detection
+
+	// Functional warming measurements.
+	uint64_t warm_n_insn;
+	uint64_t warm_n_load;
+	uint64_t warm_n_store;
+	uint64_t warm_n_mdp;		// loads that trained the MDP
+
 	//////////////////////
 	// PRIVATE FUNCTIONS
 	//////////////////////
@@ -410,6 +500,16 @@ private:
 	void check_single(reg_t micro, reg_t isa, db_t* actual, const char *desc);
 	void check_double(reg_t micro0, reg_t micro1, reg_t isa0, reg_t isa1, const char *desc);
   void check_state(state_t* micro_state, state_t* isa_state, db_t* actual);
+  bool check_sample();
+  void check_signature_fold(db_t* actual);
+  void check_signature();
+
+  // Retire-signature checker state (CHECKER_SIGNATURE).
+  // Both signatures fold the same operands that the full checker compares.
+  uint64_t chk_sig_micro;
+  uint64_t chk_sig_isa;
+  uint64_t chk_sig_count;     // instructions folded since the last comparison
+  uint64_t chk_sig_start;     // num_insn of the first instruction folded since the last comparison
 
   void phase_stats();
 
@@ -421,6 +521,20 @@ public:
 	// The thread id.
 	unsigned int Tid;
 
+	// Join the SMT threads of 'smt', sharing the memory hierarchy of thread 'owner'.
+	void set_smt(smt_t* smt, pipeline_t* owner);
+
+	// Join the cores of directory 'dir', sharing the L3 and DRAM of core 'owner'.
+	void set_coherence(directory_t* dir, pipeline_t* owner);
+
+	// Directory requests (see coherence.h): remove the line of [addr, addr+bytes) from
+	// the L1 D$ and L2, or write it back and keep a clean copy.
+	void coherence_invalidate(reg_t addr, unsigned int bytes);
+	void coherence_downgrade(reg_t addr, unsigned int bytes);
+
+	// Instructions in decode, rename, dispatch and the IQ (for the ICOUNT fetch policy).
+	unsigned int icount();
+
 	// The simulator cycle.
 	cycle_t cycle;
 
@@ -428,12 +542,16 @@ public:
 	uint64_t num_insn;
 	uint64_t num_insn_split;
 
+	// Name of the stats log.
+	std::string stats_file;
+
 
 	// Functions for pipeline stages.
 	void fetch();
 	void decode();
 	void rename1();
 	void rename2();
+	void checkpoint_hints(unsigned int index, bool &exception_flag, bool &mispredictedBranch_flag);
 	void dispatch();
 	void schedule();
 	void register_read(unsigned int lane_number);
@@ -447,7 +565,7 @@ public:
 	void set_exception(unsigned int chkpt_id);
 	void set_load_violation(unsigned int al_index);
 	void set_branch_misprediction(unsigned int al_index);
-	void set_value_misprediction(unsigned int al_index);
+	void set_value_misprediction(unsigned int chkpt_id);
 
   //TODO: Implement these functions
 	// Miscellaneous other functions.
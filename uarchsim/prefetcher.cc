@@ -0,0 +1,200 @@
+/*--------------------------------------------------------------------------*\
+ | prefetcher.cc
+ |
+ | Stride, next-line and stream prefetchers for CacheClass.
+\*--------------------------------------------------------------------------*/
+
+#include <cstdlib>
+#include <cassert>
+
+#include "prefetcher.h"
+
+/////////////////////////////////////////////////////////////
+// Stride prefetcher.
+/////////////////////////////////////////////////////////////
+
+stride_prefetcher_t::stride_prefetcher_t(unsigned int _degree, unsigned int _lineSize)
+	: prefetcher_t(_degree, _lineSize)
+{
+	for (unsigned int i = 0; i < PF_STRIDE_TABLE_SIZE; i++) {
+		table[i].tag = 0;
+		table[i].last_addr = 0;
+		table[i].stride = 0;
+		table[i].conf = 0;
+	}
+}
+
+void stride_prefetcher_t::train(reg_t pc, reg_t addr, bool isStore, bool hit, std::vector<reg_t>& lines)
+{
+	// Only instructions can be tracked.
+	if (pc == 0)
+		return;
+
+	rpt_entry_t* e = &table[(pc >> 2) % PF_STRIDE_TABLE_SIZE];
+
+	if (e->tag != pc) {
+		e->tag = pc;
+		e->last_addr = addr;
+		e->stride = 0;
+		e->conf = 0;
+		return;
+	}
+
+	// Re-access of the same address (e.g., a load retrying for an MHSR).
+	if (addr == e->last_addr)
+		return;
+
+	int64_t stride = (int64_t)(addr - e->last_addr);
+	if (stride == e->stride) {
+		if (e->conf < PF_STRIDE_CONF_MAX)
+			e->conf++;
+	}
+	else {
+		if (e->conf > 0)
+			e->conf--;
+		if (e->conf < PF_STRIDE_CONF_PREDICT)
+			e->stride = stride;
+	}
+	e->last_addr = addr;
+
+	if ((e->conf >= PF_STRIDE_CONF_PREDICT) && (e->stride != 0)) {
+		// Prefetch the next 'degree' distinct lines along the stride.
+		// Strides shorter than a line walk through consecutive lines.
+		reg_t line = (addr >> lineSize);
+		bool small = (llabs(e->stride) < (1LL << lineSize));
+		for (unsigned int i = 1; i <= degree; i++) {
+			if (small)
+				lines.push_back(line + ((e->stride > 0) ? i : -(int64_t)i));
+			else
+				lines.push_back((addr + e->stride * (int64_t)i) >> lineSize);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Next-N-line prefetcher.
+/////////////////////////////////////////////////////////////
+
+void nextline_prefetcher_t::train(reg_t pc, reg_t addr, bool isStore, bool hit, std::vector<reg_t>& lines)
+{
+	if (isStore || hit)
+		return;
+
+	reg_t line = (addr >> lineSize);
+	for (unsigned int i = 1; i <= degree; i++)
+		lines.push_back(line + i);
+}
+
+/////////////////////////////////////////////////////////////
+// Stream prefetcher.
+/////////////////////////////////////////////////////////////
+
+stream_prefetcher_t::stream_prefetcher_t(unsigned int _degree, unsigned int _lineSize)
+	: prefetcher_t(_degree, _lineSize)
+{
+	for (unsigned int i = 0; i < PF_STREAM_NUM_STREAMS; i++) {
+		streams[i].valid = false;
+		streams[i].trained = false;
+		streams[i].dir = 1;
+		streams[i].last = 0;
+		streams[i].next = 0;
+		streams[i].lru = 0;
+	}
+	timestamp = 0;
+}
+
+void stream_prefetcher_t::train(reg_t pc, reg_t addr, bool isStore, bool hit, std::vector<reg_t>& lines)
+{
+	// Writebacks from the previous level do not indicate a stream.
+	if (isStore)
+		return;
+
+	reg_t line = (addr >> lineSize);
+	timestamp++;
+
+	// Find the stream this access belongs to.
+	stream_t* s = NULL;
+	for (unsigned int i = 0; i < PF_STREAM_NUM_STREAMS; i++) {
+		if (streams[i].valid) {
+			int64_t delta = (int64_t)(line - streams[i].last);
+			if ((delta != 0) && (llabs(delta) <= PF_STREAM_WINDOW) &&
+			    (!streams[i].trained || ((delta > 0) == (streams[i].dir > 0)))) {
+				s = &streams[i];
+				break;
+			}
+			if (delta == 0)
+				return;   // same line again
+		}
+	}
+
+	// Allocate a new stream on a miss, replacing the LRU stream.
+	if (s == NULL) {
+		if (hit)
+			return;
+		s = &streams[0];
+		for (unsigned int i = 1; i < PF_STREAM_NUM_STREAMS; i++) {
+			if (!streams[i].valid) {
+				s = &streams[i];
+				break;
+			}
+			if (streams[i].lru < s->lru)
+				s = &streams[i];
+		}
+		s->valid = true;
+		s->trained = false;
+		s->last = line;
+		s->lru = timestamp;
+		return;
+	}
+
+	// Second access confirms the direction.
+	if (!s->trained) {
+		s->trained = true;
+		s->dir = (line > s->last) ? 1 : -1;
+		s->next = line + s->dir;
+	}
+
+	// Keep up to PF_STREAM_DISTANCE lines ahead of the demand stream,
+	// issuing at most 'degree' of them per access.
+	if ((int64_t)(s->next - line) * s->dir <= 0)
+		s->next = line + s->dir;
+	for (unsigned int i = 0; (i < degree) && ((int64_t)(s->next - line) * s->dir <= PF_STREAM_DISTANCE); i++) {
+		lines.push_back(s->next);
+		s->next += s->dir;
+	}
+
+	s->last = line;
+	s->lru = timestamp;
+}
+
+/////////////////////////////////////////////////////////////
+// Factory.
+/////////////////////////////////////////////////////////////
+
+prefetcher_t* new_prefetcher(prefetcher_e type, unsigned int degree, unsigned int lineSize)
+{
+	switch (type) {
+		case PF_STRIDE:
+			return(new stride_prefetcher_t(degree, lineSize));
+		case PF_NEXTLINE:
+			return(new nextline_prefetcher_t(degree, lineSize));
+		case PF_STREAM:
+			return(new stream_prefetcher_t(degree, lineSize));
+		default:
+			return((prefetcher_t *) NULL);
+	}
+}
+
+const char* prefetcher_name(prefetcher_e type)
+{
+	switch (type) {
+		case PF_STRIDE:
+			return("stride");
+		case PF_NEXTLINE:
+			return("nextline");
+		case PF_STREAM:
+			return("stream");
+		default:
+			return("none");
+	}
+}
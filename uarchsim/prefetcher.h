@@ -0,0 +1,106 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <vector>
+#include "decode.h"
+#include "parameters.h"
+
+/*--------------------------------------------------------------------------*\
+ | Hardware prefetchers, attached to a CacheClass.
+ |
+ | A prefetcher is trained with the demand accesses of its cache and returns
+ | candidate line addresses (in units of the cache's line size). The cache
+ | issues each candidate that is not already present or in flight, using an
+ | MHSR and a miss service port just like a demand miss.
+ |
+ | The degree (candidates per trigger) is adjusted by the cache's throttle.
+\*--------------------------------------------------------------------------*/
+
+// PC-indexed stride prefetcher (reference prediction table).
+#define PF_STRIDE_TABLE_SIZE   256
+#define PF_STRIDE_CONF_MAX     3
+#define PF_STRIDE_CONF_PREDICT 2
+
+// Stream prefetcher.
+#define PF_STREAM_NUM_STREAMS  16
+#define PF_STREAM_WINDOW       16     // lines: accesses this close to a stream's last access belong to it
+#define PF_STREAM_DISTANCE     16     // lines: how far ahead of the demand stream to run
+
+#define PF_MAX_DEGREE          16
+
+class prefetcher_t {
+public:
+	prefetcher_t(unsigned int _degree, unsigned int _lineSize) : degree(_degree), lineSize(_lineSize) {}
+	virtual ~prefetcher_t() {}
+
+	virtual const char* name() = 0;
+
+	/*------------------------------------------------------------------------*\
+	 | Train on a demand access and append prefetch candidates (line
+	 | addresses, i.e., byte address >> lineSize) to 'lines'.
+	 |
+	 |  pc       PC of the instruction (0 if unknown, e.g., a writeback or
+	 |            an access from the previous cache level).
+	 |  addr     Byte address accessed.
+	 |  isStore  Access is a store or a writeback from the previous level.
+	 |  hit      Line was present (or already being loaded).
+	\*------------------------------------------------------------------------*/
+	virtual void train(reg_t pc, reg_t addr, bool isStore, bool hit, std::vector<reg_t>& lines) = 0;
+
+	unsigned int get_degree() { return degree; }
+	void set_degree(unsigned int d) { degree = d; }
+
+protected:
+	unsigned int degree;
+	unsigned int lineSize;   // log2 of the line size in bytes
+};
+
+class stride_prefetcher_t : public prefetcher_t {
+public:
+	stride_prefetcher_t(unsigned int _degree, unsigned int _lineSize);
+	const char* name() { return "stride"; }
+	void train(reg_t pc, reg_t addr, bool isStore, bool hit, std::vector<reg_t>& lines);
+
+private:
+	typedef struct {
+		reg_t tag;           // PC
+		reg_t last_addr;
+		int64_t stride;
+		unsigned int conf;
+	} rpt_entry_t;
+
+	rpt_entry_t table[PF_STRIDE_TABLE_SIZE];
+};
+
+class nextline_prefetcher_t : public prefetcher_t {
+public:
+	nextline_prefetcher_t(unsigned int _degree, unsigned int _lineSize) : prefetcher_t(_degree, _lineSize) {}
+	const char* name() { return "nextline"; }
+	void train(reg_t pc, reg_t addr, bool isStore, bool hit, std::vector<reg_t>& lines);
+};
+
+class stream_prefetcher_t : public prefetcher_t {
+public:
+	stream_prefetcher_t(unsigned int _degree, unsigned int _lineSize);
+	const char* name() { return "stream"; }
+	void train(reg_t pc, reg_t addr, bool isStore, bool hit, std::vector<reg_t>& lines);
+
+private:
+	typedef struct {
+		bool valid;
+		bool trained;        // direction known
+		int64_t dir;         // +1 or -1
+		reg_t last;          // last line accessed
+		reg_t next;          // next line to prefetch
+		uint64_t lru;
+	} stream_t;
+
+	stream_t streams[PF_STREAM_NUM_STREAMS];
+	uint64_t timestamp;
+};
+
+// Returns NULL for PF_NONE.
+prefetcher_t* new_prefetcher(prefetcher_e type, unsigned int degree, unsigned int lineSize);
+const char* prefetcher_name(prefetcher_e type);
+
+#endif //PREFETCHER_H
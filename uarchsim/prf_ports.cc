@@ -0,0 +1,119 @@
+#include <cinttypes>
+#include <cassert>
+
+#include "prf_ports.h"
+
+
+prf_ports_t::prf_ports_t(unsigned int prf_size, unsigned int rd_ports, unsigned int wr_ports,
+                         unsigned int banks, unsigned int bypass) {
+	assert(banks > 0);
+	this->rd_ports = rd_ports;
+	this->wr_ports = wr_ports;
+	this->banks = banks;
+	this->bypass = bypass;
+
+	write_cycle.assign(prf_size, 0);
+	rd_use.cycle = 0;
+	rd_use.n.assign(banks, 0);
+	for (unsigned int i = 0; i < PRF_WR_WINDOW; i++) {
+		wr_use[i].cycle = 0;
+		wr_use[i].n.assign(banks, 0);
+	}
+	rd_need.assign(banks, 0);
+
+	n_reads = 0;
+	n_bypassed = 0;
+	n_writes = 0;
+	n_rd_stalls = 0;
+	n_wr_stalls = 0;
+	n_bank_stalls = 0;
+}
+
+prf_ports_t::~prf_ports_t() {
+}
+
+prf_ports_t::port_use_t& prf_ports_t::use(port_use_t& u, cycle_t cycle) {
+	if (u.cycle != cycle) {
+		u.cycle = cycle;
+		for (unsigned int b = 0; b < banks; b++)
+			u.n[b] = 0;
+	}
+	return(u);
+}
+
+bool prf_ports_t::arbitrate(cycle_t cycle, const unsigned int* src, unsigned int n_src,
+                            bool has_dst, unsigned int dst, unsigned int lat) {
+	port_use_t& r = use(rd_use, cycle);
+	unsigned int n_need = 0;
+	unsigned int n_used = 0;
+	bool rd_ok = true;
+
+	// Read ports, for the sources that are not on the bypass network.
+	for (unsigned int b = 0; b < banks; b++)
+		rd_need[b] = 0;
+	for (unsigned int i = 0; i < n_src; i++) {
+		cycle_t w = write_cycle[src[i]];
+		if ((w > 0) && ((w - 1) <= cycle) && (cycle < (w - 1 + bypass)))
+			continue;
+		rd_need[bank(src[i])]++;
+		n_need++;
+	}
+	if (rd_ports) {
+		for (unsigned int b = 0; b < banks; b++) {
+			n_used += r.n[b];
+			if ((r.n[b] + rd_need[b]) > rd_ports)
+				rd_ok = false;
+		}
+	}
+
+	// Write port, in the cycle the destination is written.
+	assert(lat < PRF_WR_WINDOW);
+	port_use_t& w = use(wr_use[(cycle + lat) % PRF_WR_WINDOW], (cycle + lat));
+	bool wr_ok = (!has_dst || !wr_ports || (w.n[bank(dst)] < wr_ports));
+
+	if (!rd_ok || !wr_ok) {
+		if (!rd_ok) {
+			n_rd_stalls++;
+			if ((n_used + n_need) <= (rd_ports * banks))
+				n_bank_stalls++;
+		}
+		else {
+			n_wr_stalls++;
+		}
+		return(false);
+	}
+
+	for (unsigned int b = 0; b < banks; b++)
+		r.n[b] += rd_need[b];
+	n_reads += n_need;
+	n_bypassed += (n_src - n_need);
+	if (has_dst) {
+		w.n[bank(dst)]++;
+		n_writes++;
+		write_cycle[dst] = (cycle + lat + 1);
+	}
+	return(true);
+}
+
+void prf_ports_t::written(cycle_t cycle, unsigned int phys_reg) {
+	write_cycle[phys_reg] = (cycle + 1);
+}
+
+void prf_ports_t::dump_stats(FILE* fp, cycle_t cycles) {
+	uint64_t n_src = (n_reads + n_bypassed);
+
+	fprintf(fp, "PRF PORT MEASUREMENTS------------------------------\n");
+	fprintf(fp, "  source operands  = %" PRIu64 "\n", n_src);
+	fprintf(fp, "     read ports    = %" PRIu64 "\n", n_reads);
+	fprintf(fp, "     bypassed      = %" PRIu64 " (%.2f%%)\n", n_bypassed,
+	        (n_src ? 100.0*(double)n_bypassed/(double)n_src : 0.0));
+	fprintf(fp, "  writes           = %" PRIu64 "\n", n_writes);
+	if (rd_ports)
+		fprintf(fp, "  read port util.  = %.2f%%\n",
+		        (cycles ? 100.0*(double)n_reads/((double)cycles*(double)(rd_ports*banks)) : 0.0));
+	if (wr_ports)
+		fprintf(fp, "  write port util. = %.2f%%\n",
+		        (cycles ? 100.0*(double)n_writes/((double)cycles*(double)(wr_ports*banks)) : 0.0));
+	fprintf(fp, "  read port stalls = %" PRIu64 " (bank conflicts: %" PRIu64 ")\n", n_rd_stalls, n_bank_stalls);
+	fprintf(fp, "  write port stalls = %" PRIu64 "\n", n_wr_stalls);
+}
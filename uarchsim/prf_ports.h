@@ -0,0 +1,78 @@
+#ifndef PRF_PORTS_H
+#define PRF_PORTS_H
+
+#include <cstdio>
+#include <vector>
+#include "decode.h"
+
+/*--------------------------------------------------------------------------*\
+ | prf_ports.h
+ |
+ | Timing model of the Physical Register File's read and write ports.
+ |
+ | The PRF is split into banks, interleaved on the physical register number;
+ | each bank has its own read and write ports. An instruction arbitrates for
+ | ports in the Register Read Stage: one read port per source operand that
+ | is not on the bypass network, and one write port for its destination in
+ | the cycle it will write it (the Register Read cycle plus the lane's
+ | execute depth). If it doesn't get them all, it stays in the Register Read
+ | Stage and retries next cycle; it does not wake up its dependents until it
+ | leaves. Lanes arbitrate in order, so lower lanes have priority.
+ |
+ | The bypass network holds the results written in the last 'bypass' cycles
+ | (1: only the results of the current cycle, i.e., back-to-back dependent
+ | instructions; 0: no bypass network). Sources it holds need no read port.
+ |
+ | Loads reserve their write port for a hit. The write of a load that missed
+ | is not arbitrated (the fill path has its own port).
+\*--------------------------------------------------------------------------*/
+
+#define PRF_WR_WINDOW          64    // how far ahead write ports can be reserved (max. lane depth)
+
+class prf_ports_t {
+public:
+	prf_ports_t(unsigned int prf_size, unsigned int rd_ports, unsigned int wr_ports,
+	            unsigned int banks, unsigned int bypass);
+	~prf_ports_t();
+
+	// Arbitrate for the ports of an instruction in the Register Read Stage.
+	// src[0..n_src-1] are its source physical registers. If has_dst, it writes
+	// physical register 'dst' at cycle 'cycle + lat'. Returns false (and
+	// allocates nothing) if a port is not available.
+	bool arbitrate(cycle_t cycle, const unsigned int* src, unsigned int n_src,
+	               bool has_dst, unsigned int dst, unsigned int lat);
+
+	// A value was written outside of arbitration (e.g., a load that missed).
+	void written(cycle_t cycle, unsigned int phys_reg);
+
+	void dump_stats(FILE* fp, cycle_t cycles);
+
+private:
+	typedef struct {
+		cycle_t cycle;                // cycle these counts are for
+		std::vector<unsigned int> n;  // ports in use, per bank
+	} port_use_t;
+
+	unsigned int bank(unsigned int phys_reg) { return(phys_reg % banks); }
+	port_use_t& use(port_use_t& u, cycle_t cycle);
+
+	unsigned int rd_ports;     // per bank per cycle (0: unlimited)
+	unsigned int wr_ports;     // per bank per cycle (0: unlimited)
+	unsigned int banks;
+	unsigned int bypass;       // cycles a result stays on the bypass network
+
+	std::vector<cycle_t> write_cycle;     // per physical register: cycle of its last write (+1; 0: never)
+	port_use_t rd_use;
+	port_use_t wr_use[PRF_WR_WINDOW];     // indexed by write cycle
+	std::vector<unsigned int> rd_need;    // scratch: read ports needed per bank
+
+	// Stats.
+	uint64_t n_reads;                // register reads through a port
+	uint64_t n_bypassed;             // source operands taken from the bypass network
+	uint64_t n_writes;               // write ports allocated
+	uint64_t n_rd_stalls;            // Register Read stalls for a read port
+	uint64_t n_wr_stalls;            // ...for a write port
+	uint64_t n_bank_stalls;          // ...of which the ports were free in another bank
+};
+
+#endif //PRF_PORTS_H
@@ -1,4 +1,5 @@
 #include <cinttypes>
+#include "warm_state.h"
 #include "ras.h"
 
 ras_t::ras_t(uint64_t size) {
@@ -40,3 +41,21 @@ void ras_t::set_tos(uint64_t tos) {
    this->tos = tos;
 }
 
+// Save or restore the stack and TOS (see warm_state.h).
+
+void ras_t::save_warm(std::vector<warm_section_t>& sections) {
+   warm_section_t& s = new_warm_section(sections, "ras");
+   s.geometry.push_back(size);
+   s.data.push_back(tos);
+   for (uint64_t i = 0; i < size; i++)
+      s.data.push_back(ras[i]);
+}
+
+bool ras_t::restore_warm(const warm_section_t& s) {
+   if ((s.geometry.size() != 1) || (s.geometry[0] != size) || (s.data.size() != (size + 1)))
+      return(false);
+   tos = s.data[0];
+   for (uint64_t i = 0; i < size; i++)
+      ras[i] = s.data[i + 1];
+   return(true);
+}
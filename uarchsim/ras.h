@@ -15,4 +15,8 @@ public:
 	// Functions to get and set the top-of-stack index, e.g., for checkpoint/restore purposes.
 	uint64_t get_tos();
 	void set_tos(uint64_t tos);
+
+	// Save or restore the stack and TOS (see warm_state.h).
+	void save_warm(std::vector<warm_section_t>& sections);
+	bool restore_warm(const warm_section_t& section);
 };
@@ -12,6 +12,25 @@ void pipeline_t::register_read(unsigned int lane_number) {
       //////////////////////////////////////////////////////////////////////////////////////////////////////////
       index = Execution_Lanes[lane_number].rr.index;
 
+      unsigned int lat = Execution_Lanes[lane_number].ex_depth;
+
+      // PRF ports (see prf_ports.h): an instruction that doesn't get the ports it needs
+      // stays in the Register Read Stage, so nothing else can issue to this lane.
+      if (PRF_PORTS) {
+         unsigned int src[3];
+         unsigned int n_src = 0;
+         if (PAY.buf[index].A_valid)
+            src[n_src++] = PAY.buf[index].A_phys_reg;
+         if (PAY.buf[index].B_valid)
+            src[n_src++] = PAY.buf[index].B_phys_reg;
+         if (PAY.buf[index].D_valid)
+            src[n_src++] = PAY.buf[index].D_phys_reg;
+         // AMO and CSR instructions write their destination at retire.
+         bool has_dst = (PAY.buf[index].C_valid && !IS_AMO(PAY.buf[index].flags) && !IS_CSR(PAY.buf[index].flags));
+         if (!PRF_PORTS->arbitrate(cycle, src, n_src, has_dst, PAY.buf[index].C_phys_reg, lat))
+            return;
+      }
+
       //////////////////////////////////////////////////////////////////////////////////////////////////////////
       // FIX_ME #11a
       // If the instruction has a destination register AND its latency is 1-cycle AND it is not a load AND it is not an AMO instruction:
@@ -44,12 +63,11 @@ void pipeline_t::register_read(unsigned int lane_number) {
       //    b. Set the destination register's ready bit.
       //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-      unsigned int lat = Execution_Lanes[lane_number].ex_depth;
-
       // FIX_ME #11a BEGIN
       if ( PAY.buf[index].C_valid && (lat == 1) && !(IS_LOAD(PAY.buf[index].flags)) && !(IS_AMO(PAY.buf[index].flags)) )
       {
-         IQ.wakeup(PAY.buf[index].C_phys_reg);
+         if (!PAY.buf[index].vp_predicted)   // consumers were dispatched ready
+            IQ.wakeup(PAY.buf[index].C_phys_reg);
          REN->set_ready(PAY.buf[index].C_phys_reg);
       }
       // FIX_ME #11a END
@@ -49,6 +49,35 @@ void pipeline_t::rename1() {
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+// CPR checkpoint placement hints for the instruction at PAY.buf[index].
+//
+// exception_flag: the instruction will raise an exception, so it must begin a
+// checkpoint interval (a checkpoint is placed before it).
+// mispredictedBranch_flag: the instruction is a branch that may be mispredicted,
+// so it must end a checkpoint interval (a checkpoint is placed after it).
+//
+// With the functional oracle, both are known exactly from the debug buffer.
+// Without it, every branch is treated as possibly mispredicted, and only an
+// instruction that already excepted once, and whose checkpoint interval is being
+// re-executed (see retire), is known to except.
+////////////////////////////////////////////////////////////////////////////////////
+void pipeline_t::checkpoint_hints(unsigned int index, bool &exception_flag, bool &mispredictedBranch_flag) {
+   bool is_branch = (PAY.buf[index].inst.opcode() == OP_JAL || PAY.buf[index].inst.opcode() == OP_JALR || PAY.buf[index].inst.opcode() == OP_BRANCH);
+
+   if (!FUNCTIONAL_ORACLE) {
+      exception_flag = (precise_exception_pending && (PAY.buf[index].pc == precise_exception_pc));
+      mispredictedBranch_flag = (!exception_flag && is_branch);
+   }
+   else if (PAY.buf[index].good_instruction) {
+      db_t *actual = get_pipe()->peek(PAY.buf[index].db_index);
+      if (actual->a_exception)
+         exception_flag = true;
+      else if (is_branch && (PAY.buf[index].next_pc != actual->a_next_pc))
+         mispredictedBranch_flag = true;
+   }
+}
+
 void pipeline_t::rename2() {
    //printf("rename2 func called\n");
    unsigned int i;
@@ -89,7 +118,6 @@ void pipeline_t::rename2() {
    instrucs_w_valid_regs = 0;
    int temp_instr_renamed_since_last_checkpoint = instr_renamed_since_last_checkpoint;
 
-   db_t * actual;
    for (i = 0; i < dispatch_width; i++) {
       if (!RENAME2[i].valid)
          break;			// Not a valid instruction: Reached the end of the rename bundle so exit loop.
@@ -113,7 +141,7 @@ void pipeline_t::rename2() {
       // FIX_ME #1 BEGIN
       if (PAY.buf[index].checkpoint)
          bundle_branch++;
-      if (PAY.buf[index].C_valid)
+      if (PAY.buf[index].C_valid && (PAY.buf[index].elim == ELIM_NONE))   // Eliminated moves don't need a free register.
          bundle_dst++;
       // FIX_ME #1 END
       // P4 - bundle_chkpts
@@ -121,24 +149,7 @@ void pipeline_t::rename2() {
       mispredictedBranch_flag = false;
       exception_flag = false;
       exception_checkpoint_placed_before = false;
-      if (PAY.buf[index].good_instruction)
-      {
-         actual = get_pipe()->peek(PAY.buf[index].db_index);
-         if (actual->a_exception)
-         {
-            exception_flag = true;
-         }
-         else
-         {
-            if (PAY.buf[index].inst.opcode() == OP_JAL || PAY.buf[index].inst.opcode() == OP_JALR || PAY.buf[index].inst.opcode() == OP_BRANCH)
-            {
-               if (PAY.buf[index].next_pc != actual->a_next_pc)
-               {
-                  mispredictedBranch_flag = true;
-               }
-            }
-         }
-      }
+      checkpoint_hints(index, exception_flag, mispredictedBranch_flag);
       serializing_flag = PAY.buf[index].inst.opcode() == OP_AMO || PAY.buf[index].inst.opcode() == OP_SYSTEM;
 
       if (temp_instr_renamed_since_last_checkpoint > 0)
@@ -190,7 +201,8 @@ void pipeline_t::rename2() {
    // This is achieved by doing nothing and proceeding to the next statements.
 
    // FIX_ME #2 BEGIN
-   if ((REN->stall_reg(bundle_dst) == true) || (REN->stall_checkpoint(bundle_chkpts) == true))
+   if ((REN->stall_reg(bundle_dst) == true) || (REN->stall_checkpoint(bundle_chkpts) == true) ||
+       (SMT && SMT->stall_reg(Tid, bundle_dst)))
    {
       //std::cout << "No of Free Regs = " << REN->noOfFreeRegistersInFreeList() << '\n';
       //REN->printMappedRegs();
@@ -221,24 +233,7 @@ void pipeline_t::rename2() {
       mispredictedBranch_flag = false;
       exception_flag = false;
       exception_checkpoint_placed_before = false;
-      if (PAY.buf[index].good_instruction)
-      {
-         actual = get_pipe()->peek(PAY.buf[index].db_index);
-         if (actual->a_exception)
-         {
-            exception_flag = true;
-         }
-         else
-         {
-            if (PAY.buf[index].inst.opcode() == OP_JAL || PAY.buf[index].inst.opcode() == OP_JALR || PAY.buf[index].inst.opcode() == OP_BRANCH)
-            {
-               if (PAY.buf[index].next_pc != actual->a_next_pc)
-               {
-                  mispredictedBranch_flag = true;
-               }
-            }
-         }
-      }
+      checkpoint_hints(index, exception_flag, mispredictedBranch_flag);
       serializing_flag = PAY.buf[index].inst.opcode() == OP_AMO || PAY.buf[index].inst.opcode() == OP_SYSTEM;
 
       //printf("exception_flag=%d, mispredictedBranch_flag=%d, serializing_flag=%d, instr_renamed_since_last_checkpoint=%llu\n", exception_flag, mispredictedBranch_flag, serializing_flag, instr_renamed_since_last_checkpoint);
@@ -271,6 +266,10 @@ void pipeline_t::rename2() {
             exception_checkpoint_placed_before = true;
          }
       }
+      // The excepting instruction of a re-executed checkpoint interval now starts its own interval.
+      if (exception_flag && !FUNCTIONAL_ORACLE)
+         precise_exception_pending = false;
+
       // FIX_ME #3
       // Rename source registers (first) and destination register (second).
       //
@@ -285,6 +284,16 @@ void pipeline_t::rename2() {
       //    so that the physical register specifier can be used in subsequent pipeline stages.
 
       // FIX_ME #3 BEGIN
+      if (PAY.buf[index].elim != ELIM_NONE) {
+         // Move elimination: map the destination to the source's physical register.
+         // The instruction has no operands left to read or write, so it skips the IQ
+         // and is completed in the Dispatch Stage, like a NOP.
+         PAY.buf[index].C_phys_reg = REN->rename_move(PAY.buf[index].C_log_reg, PAY.buf[index].elim_log_reg);
+         PAY.buf[index].A_valid = false;
+         PAY.buf[index].B_valid = false;
+         PAY.buf[index].C_valid = false;
+         PAY.buf[index].iq = SEL_IQ_NONE;
+      }
       if (PAY.buf[index].A_valid)
          PAY.buf[index].A_phys_reg = REN->rename_rsrc(PAY.buf[index].A_log_reg);
       if (PAY.buf[index].B_valid)
@@ -294,11 +303,25 @@ void pipeline_t::rename2() {
       if (PAY.buf[index].C_valid)
          PAY.buf[index].C_phys_reg = REN->rename_rdst(PAY.buf[index].C_log_reg);
       // FIX_ME #3 END
+
+      // Value prediction: look up the predictor for instructions with an integer destination.
+      PAY.buf[index].vp_lookup = false;
+      PAY.buf[index].vp_predicted = false;
+      PAY.buf[index].vp_misp = false;
+      PAY.buf[index].vp_hist = vp_ghist;
+      if (VP && PAY.buf[index].C_valid && (PAY.buf[index].C_log_reg > 0) && (PAY.buf[index].C_log_reg < NXPR) &&
+          !PAY.buf[index].split && !branch_flag && !amo_flag && !csr_flag && (load_flag || !VP_LOADS_ONLY)) {
+         PAY.buf[index].vp_lookup = true;
+         PAY.buf[index].vp_predicted = VP->predict(PAY.buf[index].pc, vp_ghist, PAY.buf[index].vp_value);
+      }
+      if (PAY.buf[index].inst.opcode() == OP_BRANCH)
+         vp_ghist = ((vp_ghist << 1) | (PAY.buf[index].next_pc != INCREMENT_PC(PAY.buf[index].pc)));
       //if (PAY.buf[index].A_valid || PAY.buf[index].B_valid || PAY.buf[index].D_valid || PAY.buf[index].C_valid)
          instr_renamed_since_last_checkpoint++;
       //printf("instr_renamed_since_last_checkpoint=%llu\n", instr_renamed_since_last_checkpoint);
 
       // P4 - Inserting a checkpoint AFTER the instruction is renamed
+      PAY.buf[index].ends_interval = false;
       if (serializing_flag)
       {
          // place a checkpoint before and after a serializing instruction
@@ -308,6 +331,7 @@ void pipeline_t::rename2() {
          //printf("place a checkpoint after a serializing instruction: chkpt_id=%llu and index=%llu\n",PAY.buf[index].chkpt_id, index);
          REN->checkpoint();
          instr_renamed_since_last_checkpoint = 0;
+         PAY.buf[index].ends_interval = true;
       }
       else if ((mispredictedBranch_flag == true) || (instr_renamed_since_last_checkpoint == REN->get_max_instr_bw_checkpoints()))
       {
@@ -325,6 +349,7 @@ void pipeline_t::rename2() {
          }
          REN->checkpoint();
          instr_renamed_since_last_checkpoint = 0;
+         PAY.buf[index].ends_interval = true;
       }
       else if (exception_flag == false)
       {
@@ -341,6 +366,10 @@ void pipeline_t::rename2() {
          //printf("no checkpoint exception is the first instruc after max_instr_bw_checkpoints: chkpt_id=%llu and index=%llu\n",PAY.buf[index].chkpt_id, index);
       }
 
+      // The tail of a fused pair is never renamed: it retires with its head.
+      if (PAY.buf[index].fused != FUSE_NONE)
+         PAY.buf[MOD_S(index + 2, PAY.get_size())].chkpt_id = PAY.buf[index].chkpt_id;
+
       // FIX_ME #4
       // Get the instruction's branch mask.
       //
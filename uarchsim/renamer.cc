@@ -22,6 +22,7 @@ renamer::renamer(uint64_t n_log_regs, uint64_t n_phys_regs, uint64_t n_branches,
     initializePRFReadyBits(n_phys_regs);
     initializeCPR(n_phys_regs, n_log_regs);
     initializecheckPointBuffer(n_phys_regs, n_log_regs, n_branches, n_active);
+    countMappings();
     //printf("* Completed renamer()\n");
     //printDetailedStates();
     //printCheckpointBufferState();
@@ -64,17 +65,35 @@ uint64_t renamer::rename_rsrc(uint64_t log_reg)
 uint64_t renamer::rename_rdst(uint64_t log_reg)
 {
     uint64_t old_phys_reg = RMT.entry[log_reg];
-    unmap(old_phys_reg);
 
     uint64_t new_phys_reg = popRegisterFromFreeList();
     RMT.entry[log_reg] = new_phys_reg;
     //printf("* Completed rename_rdst() Renaming of Destination Register r%llu to p%llu in RMT\n", log_reg, new_phys_reg);
     inc_usage_counter(new_phys_reg);
     map(new_phys_reg);
+    unmap(old_phys_reg);
         
     return new_phys_reg;
 }
 
+/////////////////////////////////////////////////////////////////////
+// This function renames a destination register to an existing
+// physical register (move elimination).
+/////////////////////////////////////////////////////////////////////
+uint64_t renamer::rename_move(uint64_t log_reg, uint64_t src_log_reg)
+{
+    uint64_t old_phys_reg = RMT.entry[log_reg];
+    uint64_t phys_reg = RMT.entry[src_log_reg];
+
+    // The RMT mapping itself keeps phys_reg allocated (see mapCount), so there is
+    // no usage counter to bump: there is no write, and no reader, to wait for.
+    RMT.entry[log_reg] = phys_reg;
+    map(phys_reg);
+    unmap(old_phys_reg);
+    //printf("* Completed rename_move() Renaming of Destination Register r%llu to shared p%llu in RMT\n", log_reg, phys_reg);
+    return phys_reg;
+}
+
 /////////////////////////////////////////////////////////////////////
 // This function creates a new branch checkpoint.
 /////////////////////////////////////////////////////////////////////
@@ -353,6 +372,11 @@ void renamer::write(uint64_t phys_reg, uint64_t value)
     PRF.entry[phys_reg] = value;
 }
 
+void renamer::write_predicted(uint64_t phys_reg, uint64_t value)
+{
+    PRF.entry[phys_reg] = value;
+}
+
 /////////////////////////////////////////////////////////////////////
 // Set the completed bit of the indicated entry in the Active List.
 /////////////////////////////////////////////////////////////////////
@@ -382,9 +406,10 @@ uint64_t renamer::rollback(uint64_t chkpt_id, bool next, uint64_t &total_loads,
     {
         if (checkPointBuffer.RMT[chkpt_id].entry[i] != RMT.entry[i])
         {
-            unmap(RMT.entry[i]);
-            map(checkPointBuffer.RMT[chkpt_id].entry[i]);
+            uint64_t old_phys_reg = RMT.entry[i];
             RMT.entry[i] = checkPointBuffer.RMT[chkpt_id].entry[i];
+            map(RMT.entry[i]);
+            unmap(old_phys_reg);
         }
     }
     
@@ -392,6 +417,7 @@ uint64_t renamer::rollback(uint64_t chkpt_id, bool next, uint64_t &total_loads,
     checkPointBuffer.CPR[chkpt_id].amoFlag = 0;
     checkPointBuffer.CPR[chkpt_id].csrFlag = 0;
     checkPointBuffer.CPR[chkpt_id].exceptionBit = 0;
+    checkPointBuffer.CPR[chkpt_id].valueMispredictionBit = 0;
     checkPointBuffer.CPR[chkpt_id].uncomp_instr = 0;
     checkPointBuffer.CPR[chkpt_id].load_count = 0;
     checkPointBuffer.CPR[chkpt_id].store_count = 0;
@@ -481,7 +507,7 @@ uint64_t renamer::rollback(uint64_t chkpt_id, bool next, uint64_t &total_loads,
 // of the Active List.
 ///////////////////////////////////////////////////////////////////
 // P4-D
-bool renamer::precommit(uint64_t &chkpt_id, uint64_t &num_loads, uint64_t &num_stores, uint64_t &num_branches, bool &amo, bool &csr, bool &exception)
+bool renamer::precommit(uint64_t &chkpt_id, uint64_t &num_loads, uint64_t &num_stores, uint64_t &num_branches, bool &amo, bool &csr, bool &exception, bool &val_misp)
 {
     //assert(checkPointBuffer.head <= chkpt_id);
     //assert(checkPointBuffer.tail > chkpt_id);
@@ -494,6 +520,7 @@ bool renamer::precommit(uint64_t &chkpt_id, uint64_t &num_loads, uint64_t &num_s
     amo = checkPointBuffer.CPR[chkpt_id].amoFlag;
     csr = checkPointBuffer.CPR[chkpt_id].csrFlag;
     exception = checkPointBuffer.CPR[chkpt_id].exceptionBit;
+    val_misp = checkPointBuffer.CPR[chkpt_id].valueMispredictionBit;
 
     uint64_t next_oldest_chkpt_id;
     if (oldest_chkpt_id < checkPointBuffer.size - 1)
@@ -511,6 +538,11 @@ bool renamer::precommit(uint64_t &chkpt_id, uint64_t &num_loads, uint64_t &num_s
     {
         return true;
     }
+    else if (val_misp)
+    {
+        // Recover right away: the rest of the interval is squashed anyway.
+        return true;
+    }
     else
     {
         return false;
@@ -539,14 +571,16 @@ void renamer::squash()
    //printf("* Started squash() of the pipeline\n");
     uint64_t chkpt_id = checkPointBuffer.head;
     RMT = checkPointBuffer.RMT[chkpt_id];
+    countMappings();
 
     for(uint64_t i = 0; i< RMT.size; i++) 
     {
         if (checkPointBuffer.RMT[chkpt_id].entry[i] != RMT.entry[i])
         {
-            unmap(RMT.entry[i]);
-            map(checkPointBuffer.RMT[chkpt_id].entry[i]);
+            uint64_t old_phys_reg = RMT.entry[i];
             RMT.entry[i] = checkPointBuffer.RMT[chkpt_id].entry[i];
+            map(RMT.entry[i]);
+            unmap(old_phys_reg);
         }
     }
 
@@ -554,6 +588,7 @@ void renamer::squash()
     checkPointBuffer.CPR[chkpt_id].amoFlag = 0;
     checkPointBuffer.CPR[chkpt_id].csrFlag = 0;
     checkPointBuffer.CPR[chkpt_id].exceptionBit = 0;
+    checkPointBuffer.CPR[chkpt_id].valueMispredictionBit = 0;
     checkPointBuffer.CPR[chkpt_id].uncomp_instr = 0;
     checkPointBuffer.CPR[chkpt_id].load_count = 0;
     checkPointBuffer.CPR[chkpt_id].store_count = 0;
@@ -574,18 +609,8 @@ void renamer::squash()
     }
 
     // rollback tail to oldest chkpt_id + 1
-    bool chkpt_id_phase = false;
-    if(checkPointBuffer.headPhase == checkPointBuffer.tailPhase) {
-        chkpt_id_phase = checkPointBuffer.headPhase; 
-    }
-    else {
-        if (chkpt_id > checkPointBuffer.head){
-            chkpt_id_phase = checkPointBuffer.headPhase;
-        }
-        else {
-            chkpt_id_phase = !(checkPointBuffer.headPhase);
-        }
-    }
+    // (chkpt_id is the head, so it has the head's phase, whether or not the tail had wrapped around)
+    bool chkpt_id_phase = checkPointBuffer.headPhase;
     checkPointBuffer.tail = (chkpt_id + 1) % checkPointBuffer.size;
     if (checkPointBuffer.tail == 0)
     {
@@ -618,10 +643,10 @@ void renamer::set_branch_misprediction(uint64_t AL_index)
     //printf("* Completed set_branch_misprediction() AL_index=%llu\n", AL_index);
 }
 
-void renamer::set_value_misprediction(uint64_t AL_index)
+void renamer::set_value_misprediction(uint64_t chkpt_id)
 {
-    activeList.entry[AL_index].valueMispredictionBit = 1;
-    //printf("* Completed set_value_misprediction() AL_index=%llu\n", AL_index);
+    checkPointBuffer.CPR[chkpt_id].valueMispredictionBit = 1;
+    //printf("* Completed set_value_misprediction() chkpt_id=%llu\n", chkpt_id);
 }
 
 /////////////////////////////////////////////////////////////////////
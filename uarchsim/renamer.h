@@ -67,17 +67,20 @@ private:
 
 	void initializeFreeList(uint64_t n_phys_regs, uint64_t n_log_regs)
 	{
-		freeList.size = n_phys_regs - n_log_regs;
+		// Room for every physical register: once moves have been eliminated, logical
+		// registers may share physical registers, leaving more than n_phys_regs - n_log_regs free.
+		freeList.size = n_phys_regs;
 
 		// PRF numbers that are not in AMT/RMT
 		// Assigning Physical Registers i = Total_Logical_Registers to Total_Physical_Registers - 1
 		for (uint64_t i = RMT.size ; i < n_phys_regs; i++)
 			freeList.entry.push_back(i);
+		freeList.entry.resize(freeList.size, 0);
 		
 		freeList.head = 0;
 		freeList.headPhase = 0;
-		freeList.tail = 0;
-		freeList.tailPhase = 1;
+		freeList.tail = (n_phys_regs - n_log_regs);
+		freeList.tailPhase = 0;
 	}
 
 	uint64_t popRegisterFromFreeList()
@@ -186,6 +189,7 @@ private:
 		bool amoFlag;
 		bool csrFlag;
 		bool exceptionBit;
+		bool valueMispredictionBit;
 		
 		uint64_t  uncomp_instr;
 	    uint64_t  load_count;
@@ -195,6 +199,18 @@ private:
 
 	vector <uint64_t> usageCounter;
 
+	// Number of RMT entries mapping each physical register. Once moves have been
+	// eliminated, it may be more than one: the register is unmapped with the last.
+	vector <uint64_t> mapCount;
+
+	// Recount the mappings, after the whole RMT was replaced.
+	void countMappings()
+	{
+		mapCount.assign(CPR.size, 0);
+		for (uint64_t i = 0; i < RMT.size; i++)
+			mapCount[RMT.entry[i]]++;
+	}
+
 	void initializeCPR(uint64_t n_phys_regs, uint64_t n_log_regs)
 	{
 		CPR.size = n_phys_regs;
@@ -215,6 +231,8 @@ private:
 			}
 		}
 
+		CPR.exceptionBit = 0;
+		CPR.valueMispredictionBit = 0;
 		CPR.uncomp_instr = 0;
 		CPR.load_count = 0;
 	    CPR.store_count = 0;
@@ -457,8 +475,11 @@ public:
 			pushRegisterToFreeList(phys_reg);
 	}
 
-	void unmap(uint64_t phys_reg)	// no longer in RMT
+	void unmap(uint64_t phys_reg)	// no longer in RMT (call after updating the RMT)
 	{
+		assert(mapCount[phys_reg] > 0);
+		if (--mapCount[phys_reg] > 0)
+			return;	// still mapped by another logical register (see mapCount)
 		CPR.unmappedBit[phys_reg] = 1;
 		//printf("Unmapped Bit = %llu and Usage Counter = %llu of p%llu\n", CPR.unmappedBit[phys_reg], usageCounter[phys_reg], phys_reg);
 		// If a phys_reg's usage counter is 0 and it is not present in RMT then push it to Free list
@@ -467,6 +488,7 @@ public:
 	}
 	void map(uint64_t phys_reg)	// While adding physical reg to RMT
 	{
+		mapCount[phys_reg]++;
 		CPR.unmappedBit[phys_reg] = 0;
 	}
 
@@ -736,6 +758,19 @@ public:
 	/////////////////////////////////////////////////////////////////////
 	uint64_t rename_rdst(uint64_t log_reg);
 
+	/////////////////////////////////////////////////////////////////////
+	// Move elimination: rename a destination register to the physical
+	// register of a source register (the move's source, or x0 for a zero
+	// idiom), which is then shared by both logical registers.
+	//
+	// Inputs:
+	// 1. log_reg: the logical register to rename
+	// 2. src_log_reg: the logical register whose mapping it copies
+	//
+	// Return value: physical register name
+	/////////////////////////////////////////////////////////////////////
+	uint64_t rename_move(uint64_t log_reg, uint64_t src_log_reg);
+
 	/////////////////////////////////////////////////////////////////////
 	// This function creates a new branch checkpoint.
 	//
@@ -856,6 +891,13 @@ public:
 	/////////////////////////////////////////////////////////////////////
 	void write(uint64_t phys_reg, uint64_t value);
 
+	/////////////////////////////////////////////////////////////////////
+	// Write a predicted value into the indicated physical register, at
+	// Dispatch (value prediction). Unlike write(), the usage counter is
+	// left alone: the instruction's own write() still releases it.
+	/////////////////////////////////////////////////////////////////////
+	void write_predicted(uint64_t phys_reg, uint64_t value);
+
 	/////////////////////////////////////////////////////////////////////
 	// Set the completed bit of the indicated entry in the Active List.
 	/////////////////////////////////////////////////////////////////////
@@ -948,8 +990,10 @@ public:
 	//bool precommit(bool &completed, bool &exception, bool &load_viol, bool &br_misp, bool &val_misp,
 	//               bool &load, bool &store, bool &branch, bool &amo, bool &csr, uint64_t &PC);
     // P4-D
+    // val_misp: an instruction in the oldest checkpoint's interval used a mispredicted value,
+    // and the interval must be squashed and re-executed.
     bool precommit(uint64_t &chkpt_id, uint64_t &num_loads, uint64_t &num_stores, 
-                   uint64_t &num_branches, bool &amo, bool &csr, bool &exception);
+                   uint64_t &num_branches, bool &amo, bool &csr, bool &exception, bool &val_misp);
 
 	/////////////////////////////////////////////////////////////////////
 	// This function commits the instruction at the head of the Active List.
@@ -998,7 +1042,8 @@ public:
 	void set_exception(uint64_t chkpt_id);
 	void set_load_violation(uint64_t AL_index);
 	void set_branch_misprediction(uint64_t AL_index);
-	void set_value_misprediction(uint64_t AL_index);
+	// CPR: the value misprediction bit is kept per checkpoint.
+	void set_value_misprediction(uint64_t chkpt_id);
 
 	/////////////////////////////////////////////////////////////////////
 	// Query the exception bit of the indicated entry in the Active List.
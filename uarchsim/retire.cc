@@ -15,11 +15,30 @@ void pipeline_t::retire(size_t& instret, size_t instret_limit) {
    //RETSTATE.state = retire_state_e::RETIRE_IDLE;
    if (RETSTATE.state == retire_state_e::RETIRE_IDLE)
    {
-      bool proceed = REN->precommit(RETSTATE.chkpt_id, RETSTATE.num_loads_left, RETSTATE.num_stores_left, RETSTATE.num_branches_left, RETSTATE.amo, RETSTATE.csr, RETSTATE.exception);
+      bool proceed = REN->precommit(RETSTATE.chkpt_id, RETSTATE.num_loads_left, RETSTATE.num_stores_left, RETSTATE.num_branches_left, RETSTATE.amo, RETSTATE.csr, RETSTATE.exception, RETSTATE.val_misp);
       //printf("RETSTATE.chkpt_id=%llu and proceed=%d and RETSTATE.exception=%d\n", RETSTATE.chkpt_id, proceed, RETSTATE.exception);
       if(proceed == false) {
          return;
       }
+      else if (RETSTATE.val_misp) {
+         // An instruction in the interval used a wrong predicted value. Reset the confidence
+         // of the oldest such instruction's prediction, so that it is not predicted again,
+         // then squash and re-execute the interval from its start. The predictor is trained
+         // with its value when the re-executed instruction retires.
+         unsigned int scan = PAY.head;
+         while (!PAY.buf[scan].vp_misp) {
+            scan = MOD((scan + 2), PAY.get_size());
+            assert((scan != PAY.tail) && (PAY.buf[scan].chkpt_id == RETSTATE.chkpt_id));
+         }
+         VP->reset_conf(PAY.buf[scan].pc, PAY.buf[scan].vp_hist);
+         vp_n_misp++;
+
+         squash_complete(PAY.buf[PAY.head].pc);
+         inc_counter(recovery_count);
+         PAY.clear();
+         RETSTATE.state = retire_state_e::RETIRE_IDLE;
+         return;
+      }
       else if(proceed) {
          // Sanity checks of the 'amo' and 'csr' flags.
          assert(!RETSTATE.amo || IS_AMO(PAY.buf[PAY.head].flags));
@@ -37,6 +56,14 @@ void pipeline_t::retire(size_t& instret, size_t instret_limit) {
          }
          if (!RETSTATE.exception) {
             if (RETSTATE.amo && !(load || store)) { // amo, excluding load-with-reservation (LR) and store-conditional (SC)
+               // Multi-core: the AMO waits at the head until its line is in M.
+               if (COH) {
+                  if (coh_amo_ready == -1)
+                     coh_amo_ready = COH->write(Tid, cycle, PAY.buf[PAY.head].A_value.dw, true);
+                  if (cycle < coh_amo_ready)
+                     return;
+                  coh_amo_ready = -1;
+               }
                RETSTATE.exception = execute_amo();
             }
             else if (RETSTATE.csr) {
@@ -48,7 +75,27 @@ void pipeline_t::retire(size_t& instret, size_t instret_limit) {
                REN->set_exception(RETSTATE.chkpt_id);
          }
 
-         if (RETSTATE.exception)   // exception is true
+         if (RETSTATE.exception && !FUNCTIONAL_ORACLE && !PAY.buf[PAY.head].trap.valid())
+         {
+            // Without the functional oracle, rename2 could not place a checkpoint before the
+            // excepting instruction, so it is somewhere in the middle of the checkpoint interval.
+            // Squash and re-execute the interval from its start, this time with a checkpoint
+            // placed before the excepting instruction, so the exception is taken precisely.
+            unsigned int scan = PAY.head;
+            while (!PAY.buf[scan].trap.valid()) {
+               scan = MOD((scan + 2), PAY.get_size());   // Each instruction occupies two PAY entries.
+               assert((scan != PAY.tail) && (PAY.buf[scan].chkpt_id == RETSTATE.chkpt_id));
+            }
+            precise_exception_pending = true;
+            precise_exception_pc = PAY.buf[scan].pc;
+
+            squash_complete(PAY.buf[PAY.head].pc);
+            inc_counter(exception_reexec_count);
+            PAY.clear();
+            RETSTATE.state = retire_state_e::RETIRE_IDLE;
+            return;
+         }
+         else if (RETSTATE.exception)   // exception is true
          {
             trap = PAY.buf[PAY.head].trap.get();
             // CSR exceptions are micro-architectural exceptions and are
@@ -106,6 +153,9 @@ void pipeline_t::retire(size_t& instret, size_t instret_limit) {
       }
       for (unsigned int x = 0; x<RETIRE_WIDTH; x++) {
          if(RETSTATE.num_stores_left != 0){
+            // The store writes the D$ now: wait for a write port and its bank.
+            if (!LSU.store_commit_port(cycle))
+               break;
             LSU.train(false);
             amo_success = LSU.commit(false,RETSTATE.amo);
             RETSTATE.num_stores_left--;
@@ -151,12 +201,40 @@ void pipeline_t::retire(size_t& instret, size_t instret_limit) {
          // Check results.
          checker();
 
+         // Train the value predictor in program order.
+         if (PAY.buf[PAY.head].vp_lookup) {
+            VP->train(PAY.buf[PAY.head].pc, PAY.buf[PAY.head].vp_hist, PAY.buf[PAY.head].C_value.dw);
+            vp_n_eligible++;
+            if (PAY.buf[PAY.head].vp_predicted)
+               vp_n_predicted++;
+         }
+         if (PAY.buf[PAY.head].inst.opcode() == OP_BRANCH)
+            vp_ghist_commit = ((vp_ghist_commit << 1) | (PAY.buf[PAY.head].c_next_pc != INCREMENT_PC(PAY.buf[PAY.head].pc)));
+
          // Keep track of the number of retired instructions.
          num_insn++;
          instret++;
          inc_counter(commit_count);
          if (PAY.buf[PAY.head].split && PAY.buf[PAY.head].upper)
             num_insn_split++;
+         if (PAY.buf[PAY.head].elim == ELIM_MOVE)
+            inc_counter(elim_move_count);
+         else if (PAY.buf[PAY.head].elim == ELIM_ZERO)
+            inc_counter(elim_zero_count);
+         switch (PAY.buf[PAY.head].fused) {
+            case FUSE_LUI_ADDI:      inc_counter(fusion_lui_addi_count); break;
+            case FUSE_AUIPC_ADDI:    inc_counter(fusion_auipc_addi_count); break;
+            case FUSE_SHIFT_PAIR:    inc_counter(fusion_shift_pair_count); break;
+            case FUSE_SHIFT_ADD:     inc_counter(fusion_shift_add_count); break;
+            case FUSE_DEPENDENT_ALU: inc_counter(fusion_dependent_alu_count); break;
+            default: break;
+         }
+
+         if (histogram_enabled) {
+            stats->update_pc_histogram(PAY.buf[PAY.head].pc);
+            if (IS_BRANCH(PAY.buf[PAY.head].flags))
+               stats->update_br_histogram(PAY.buf[PAY.head].pc, (PAY.buf[PAY.head].next_pc != PAY.buf[PAY.head].c_next_pc));
+         }
 
          if (RETSTATE.amo || RETSTATE.csr) {   // Resume the stalled fetch unit after committing a serializing instruction.
             assert(!RETSTATE.amo || IS_AMO(PAY.buf[PAY.head].flags));
@@ -200,6 +278,8 @@ bool pipeline_t::execute_amo() {
    try {
       if (inst.funct3() == FN3_AMO_W) {
          read_amo_value = mmu->load_int32(PAY.buf[index].A_value.dw);
+         if (QSTORES)
+            read_amo_value = QSTORES->load(PAY.buf[index].A_value.dw, 4, true, read_amo_value);
          uint32_t write_amo_value;
          switch (inst.funct5()) {
             case FN5_AMO_SWAP:
@@ -233,10 +313,15 @@ bool pipeline_t::execute_amo() {
                assert(0);
                break;
          }
-         mmu->store_uint32(PAY.buf[index].A_value.dw, write_amo_value);
+         if (QSTORES)
+            QSTORES->store(mmu, PAY.buf[index].A_value.dw, 4, write_amo_value);
+         else
+            mmu->store_uint32(PAY.buf[index].A_value.dw, write_amo_value);
       }
       else if (inst.funct3() == FN3_AMO_D) {
          read_amo_value = mmu->load_int64(PAY.buf[index].A_value.dw);
+         if (QSTORES)
+            read_amo_value = QSTORES->load(PAY.buf[index].A_value.dw, 8, true, read_amo_value);
          reg_t write_amo_value;
          switch (inst.funct5()) {
             case FN5_AMO_SWAP:
@@ -270,7 +355,10 @@ bool pipeline_t::execute_amo() {
                assert(0);
                break;
          }
-         mmu->store_uint64(PAY.buf[index].A_value.dw, write_amo_value);
+         if (QSTORES)
+            QSTORES->store(mmu, PAY.buf[index].A_value.dw, 8, write_amo_value);
+         else
+            mmu->store_uint64(PAY.buf[index].A_value.dw, write_amo_value);
       }
       else {
          assert(0);
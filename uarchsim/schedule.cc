@@ -2,5 +2,8 @@
 
 
 void pipeline_t::schedule() {
-   IQ.select_and_issue(issue_width, Execution_Lanes);	// Issue instructions from unified IQ to the Execution Lanes.
+   if (SMT)
+      SMT->issued(IQ.select_and_issue(issue_width, Execution_Lanes, SMT->busy_lanes()));	// Execution Lanes are shared by the SMT threads.
+   else
+      IQ.select_and_issue(issue_width, Execution_Lanes, 0);	// Issue instructions from unified IQ to the Execution Lanes.
 }
@@ -12,6 +12,9 @@
 #include <fstream>
 #include <gzstream.h>
 #include "pipeline.h"
+#include "synth.h"
+#include "coherence.h"
+#include "parallel.h"
 
 volatile bool ctrlc_pressed = false;
 static void handle_signal(int sig)
@@ -23,8 +26,8 @@ static void handle_signal(int sig)
 	signal(sig, &handle_signal);
 }
 
-sim_t::sim_t(size_t nprocs, size_t mem_mb, const std::vector<std::string>& args, proc_type_t _proc_type)
-	: htif(new htif_isasim_t(this, args)), procs(std::max(nprocs, size_t(1))),
+sim_t::sim_t(size_t nprocs, size_t mem_mb, const std::vector<std::string>& args, proc_type_t _proc_type, unsigned int _tid)
+	: htif(new htif_isasim_t(this, args)), procs(std::max(nprocs, size_t(1))), tid(_tid), synthetic(false),
 	  current_step(0), idle_cycles(0), current_proc(0), debug(false), checkpointing_enabled(false)
 {
 	signal(SIGINT, &handle_signal);
@@ -58,32 +61,84 @@ sim_t::sim_t(size_t nprocs, size_t mem_mb, const std::vector<std::string>& args,
 		  procs[i]->set_proc_type("ISA_SIM");
     }
     else{
-		  procs[i] = new pipeline_t(
-		      this,
-          // Set this as MICRO_MMU so that mem operations
-          // do not push to debug buffer. This is necessary
-          // as we use the same class as ISA sim to instantiate
-          // the mmu.
-		      new mmu_t(mem, memsz, MICRO_MMU),  
-		      i,
-		      FETCH_QUEUE_SIZE,
-		      NUM_CHECKPOINTS,
-		      ACTIVE_LIST_SIZE,
-		      (AUTO_PRF_SIZE ? (NXPR + NFPR + ACTIVE_LIST_SIZE) : PRF_SIZE),
-		      ISSUE_QUEUE_SIZE,
-		      ISSUE_QUEUE_NUM_PARTS,
-		      LQ_SIZE,
-		      SQ_SIZE,
-		      FETCH_WIDTH,
-		      DISPATCH_WIDTH,
-		      ISSUE_WIDTH,
-		      RETIRE_WIDTH,
-		      FU_LANE_MATRIX,
-		      FU_LAT);
-		  procs[i]->set_proc_type("MICRO_SIM");
+		  procs[i] = new_micro(i);
     }
 	}
 
+	// Multi-core timing simulation: the cores share core 0's L3 and DRAM, and
+	// their L2s are kept coherent by a directory (see coherence.h).
+	coherence = (directory_t *) NULL;
+	if ((_proc_type == MICRO_SIM) && (procs.size() > 1)) {
+		pipeline_t* owner = (pipeline_t*)procs[0];
+		coherence = new directory_t(owner->L3C, L3_LINE_SIZE);
+		for (size_t i = 0; i < procs.size(); i++) {
+			coherence->add_core((pipeline_t*)procs[i]);
+			((pipeline_t*)procs[i])->set_coherence(coherence, owner);
+		}
+	}
+
+	// The cores on parallel host threads (see parallel.h).
+	parallel = (parallel_t *) NULL;
+	if (coherence && PARALLEL_THREADS) {
+		std::vector<pipeline_t*> cores;
+		for (size_t i = 0; i < procs.size(); i++)
+			cores.push_back((pipeline_t*)procs[i]);
+		parallel = new parallel_t(cores, coherence, PARALLEL_THREADS, PARALLEL_QUANTUM, PARALLEL_RELAXED);
+		for (size_t i = 0; i < procs.size(); i++)
+			((pipeline_t*)procs[i])->PARALLEL = parallel;
+	}
+}
+
+// Construct timing simulator processor i from the current configuration.
+processor_t* sim_t::new_micro(size_t i)
+{
+  // With partitioned SMT resources, each thread gets its share of the IQ, LQ/SQ,
+  // Active List and rename registers (see smt.h).
+  unsigned int prf_size = (AUTO_PRF_SIZE ? (NXPR + NFPR + ACTIVE_LIST_SIZE) : PRF_SIZE);
+  processor_t* p = new pipeline_t(
+      this,
+      // Set this as MICRO_MMU so that mem operations
+      // do not push to debug buffer. This is necessary
+      // as we use the same class as ISA sim to instantiate
+      // the mmu.
+      new mmu_t(mem, memsz, MICRO_MMU),
+      i,
+      (i + tid),
+      FETCH_QUEUE_SIZE,
+      NUM_CHECKPOINTS,
+      smt_partition(ACTIVE_LIST_SIZE),
+      ((NXPR + NFPR) + smt_partition(prf_size - (NXPR + NFPR))),
+      smt_partition(ISSUE_QUEUE_SIZE),
+      ISSUE_QUEUE_NUM_PARTS,
+      smt_partition(LQ_SIZE),
+      smt_partition(SQ_SIZE),
+      FETCH_WIDTH,
+      DISPATCH_WIDTH,
+      ISSUE_WIDTH,
+      RETIRE_WIDTH,
+      FU_LANE_MATRIX,
+      FU_LAT);
+  p->set_proc_type("MICRO_SIM");
+  return p;
+}
+
+void sim_t::reconfigure()
+{
+  assert(proc_type == MICRO_SIM);
+  for (size_t i = 0; i < procs.size(); i++) {
+    processor_t* old = procs[i];
+    processor_t* p = new_micro(i);
+
+    ((pipeline_t*)p)->take_over((pipeline_t*)old);
+    p->set_debug(old->debug);
+    p->set_checker(old->checker);
+    p->set_histogram(old->histogram_enabled);
+    p->set_pipe(old->pipe);
+    procs[i] = p;
+
+    // The old processor is not deleted: its destructor would dump its stats
+    // into a stats log that belongs to the process that reached the region.
+  }
 }
 
 sim_t::~sim_t()
@@ -94,6 +149,8 @@ sim_t::~sim_t()
 		delete procs[i];
 		delete pmmu;
 	}
+	delete parallel;
+	delete coherence;
 	delete debug_mmu;
 	free(mem);
 }
@@ -125,6 +182,27 @@ void sim_t::boot()
 
 }
 
+void sim_t::boot_synth(synth_t* synth)
+{
+	if (!synth->load(mem, memsz)) {
+		fprintf(stderr, "The synthetic program does not fit in %lu MB of target memory: use -m.\n", (unsigned long)(memsz >> 20));
+		exit(-1);
+	}
+	synthetic = true;
+
+	for (size_t i = 0; i < procs.size(); i++) {
+		procs[i]->reset(false);
+		procs[i]->set_pcr(CSR_STATUS, procs[i]->state.sr | SR_EF);
+		procs[i]->state.pc = synth->entry();
+		for (int r = 1; r < NXPR; r++)
+			procs[i]->state.XPR.write(r, synth->xpr(r));
+		for (int r = 0; r < NFPR; r++)
+			procs[i]->state.FPR.write(r, synth->fpr(r));
+		if (proc_type == MICRO_SIM)
+			((pipeline_t*)procs[i])->copy_state_to_micro();
+	}
+}
+
 int sim_t::run() {
    bool htif_return = true;
    while (htif_return) {
@@ -139,9 +217,43 @@ int sim_t::run() {
 bool sim_t::step() {
    bool htif_return = true;
    bool stop_simulation = false;
+   host_prof_scope_t total(HP_TOTAL, (get_proc_type() == MICRO_SIM));
 
    size_t instret = 0;
-   if (get_proc_type() == ISA_SIM) {
+   if (parallel) {
+      // Parallel host threads: every core steps one quantum. HTIF ticks for
+      // every INTERLEAVE instructions retired by the cores.
+      if (parallel->run_quantum(instret))
+         return 0;
+      current_step += instret;
+      while (current_step >= INTERLEAVE) {
+         current_step -= INTERLEAVE;
+         host_prof_scope_t tick(HP_HTIF, true);
+         if (!synthetic && htif_return)
+            htif_return = htif->tick();
+      }
+      return htif_return;
+   }
+   else if (coherence) {
+      // Multi-core: every core steps one cycle. HTIF ticks every INTERLEAVE
+      // instructions, retired by any of the cores.
+      for (size_t i = 0; i < procs.size(); i++) {
+         instret = 0;
+         stop_simulation = ((pipeline_t*)procs[i])->step_micro((INTERLEAVE - current_step), instret);
+         if (stop_simulation)
+            return 0;
+         current_step += instret;
+         assert(current_step <= INTERLEAVE);
+         if (current_step == INTERLEAVE) {
+            current_step = 0;
+            host_prof_scope_t tick(HP_HTIF, true);
+            if (!synthetic && htif_return)
+               htif_return = htif->tick();
+         }
+      }
+      return htif_return;
+   }
+   else if (get_proc_type() == ISA_SIM) {
       procs[current_proc]->step(1, instret);
       assert(instret == 1);
    }
@@ -173,14 +285,16 @@ bool sim_t::step() {
          current_proc = 0;
 
       // If HTIF is done, this will return false
-      htif_return = htif->tick();
+      host_prof_scope_t tick(HP_HTIF, (get_proc_type() == MICRO_SIM));
+      if (!synthetic)
+         htif_return = htif->tick();
    }
 
    return htif_return;
 }
 
 // Currently supports only one core - can be easily extended to all cores
-bool sim_t::run_fast(size_t n)
+bool sim_t::run_fast(size_t n, size_t warm)
 {
   bool old_debug = get_procs_debug();
   bool old_checker = get_procs_checker();
@@ -190,11 +304,19 @@ bool sim_t::run_fast(size_t n)
   bool htif_return = true;
   size_t total_retired = 0;
   size_t steps = 0;
+  if (warm > n)
+    warm = n;
   while(total_retired < n && htif_return)
 	{
     size_t instret = 0;
 		steps = std::min(n - total_retired, INTERLEAVE - current_step);
 
+    // Start warming exactly "warm" instructions before the end.
+    if (total_retired < (n - warm))
+      steps = std::min(steps, (n - warm) - total_retired);
+    else if (warm)
+      set_procs_warming(true);
+
     // This function continues until it has retired "steps" instructions
     // or it encounters a cycle with 0 retired instructions.
   	procs[current_proc]->step(steps,instret);
@@ -221,7 +343,8 @@ bool sim_t::run_fast(size_t n)
 			}
 
       // If HTIF is done, this will return false
-			htif_return = htif->tick();
+			if (!synthetic)
+				htif_return = htif->tick();
 		}
 	}
 
@@ -229,7 +352,13 @@ bool sim_t::run_fast(size_t n)
   // Also reset the AMT.
   if(proc_type == MICRO_SIM){
     ifprintf(logging_on,stderr,"Copying state after skipping %lu instructions\n",total_retired);
-    ((pipeline_t*)procs[current_proc])->copy_state_to_micro();
+    if (coherence) {
+      for (size_t i = 0; i < procs.size(); i++)
+        ((pipeline_t*)procs[i])->copy_state_to_micro();
+    }
+    else {
+      ((pipeline_t*)procs[current_proc])->copy_state_to_micro();
+    }
   }
 
   //fprintf(stderr,"State for %s:\n",proc_type == MICRO_SIM ? "micro_sim" : "isa_sim");
@@ -237,6 +366,7 @@ bool sim_t::run_fast(size_t n)
 
   set_procs_debug(old_debug);
   set_procs_checker(old_checker);
+  set_procs_warming(false);
   return htif_return;
 }
 
@@ -248,7 +378,8 @@ void sim_t::step_till_pc(reg_t break_pc,unsigned int proc_n)
   size_t instret = 0;
   while (procs[proc_n]->get_pc() != break_pc){
     procs[proc_n]->step(1,instret);
-    htif->tick();
+    if (!synthetic)
+      htif->tick();
   }
   procs[proc_n]->set_checker(checker);
 }
@@ -283,10 +414,18 @@ void sim_t::set_histogram(bool value)
 }
 
 #ifdef RISCV_ENABLE_SIMPOINT
-void sim_t::set_simpoint(bool enable, size_t interval)
+void sim_t::set_simpoint(bool enable, size_t interval, const char* name)
+{
+  for (size_t i = 0; i < procs.size(); i++) {
+    std::string proc_name = (i ? (std::string(name) + "." + std::to_string(i)) : std::string(name));
+    procs[i]->set_simpoint(enable, interval, proc_name.c_str());
+  }
+}
+
+void sim_t::finish_simpoint(unsigned int max_k)
 {
   for (size_t i = 0; i < procs.size(); i++) {
-    procs[i]->set_simpoint(enable, interval);
+    procs[i]->finish_simpoint(max_k);
   }
 }
 #endif
@@ -324,6 +463,13 @@ bool sim_t::create_checkpoint()
   fprintf(stderr,"Checkpointed register state\n");
   fflush(0);
 
+  // The timing simulator also checkpoints its caches and predictors.
+  if(proc_type == MICRO_SIM){
+    ((pipeline_t*)procs[current_proc])->save_warm_state(proc_chkpt);
+    fprintf(stderr,"Checkpointed microarchitectural warm state\n");
+    fflush(0);
+  }
+
   proc_chkpt.close();
   std::cerr << "Created processor checkpoint to " << checkpoint_file << std::endl;
   return htif_return;
@@ -400,6 +546,7 @@ void sim_t::restore_proc_checkpoint(std::istream& proc_chkpt)
   if(proc_type == MICRO_SIM){
     ifprintf(logging_on,stderr,"Copying state after restoring checkpoint\n");
     ((pipeline_t*)procs[current_proc])->copy_state_to_micro();
+    ((pipeline_t*)procs[current_proc])->restore_warm_state(proc_chkpt);
   }
 
   //fprintf(stderr,"State for %s:\n",proc_type == MICRO_SIM ? "micro_sim" : "isa_sim");
@@ -439,6 +586,13 @@ void sim_t::set_procs_checker(bool value)
 	}
 }
 
+void sim_t::set_procs_warming(bool value)
+{
+	for (size_t i=0; i< procs.size(); i++) {
+		procs[i]->set_warming(value);
+	}
+}
+
 bool sim_t::get_procs_checker()
 {
 	for (size_t i=0; i< procs.size(); i++) {
@@ -18,16 +18,23 @@ enum proc_type_t {ISA_SIM,MICRO_SIM};
 
 class htif_isasim_t;
 class debug_buffer_t;
+class synth_t;
+class directory_t;
+class parallel_t;
 
 // this class encapsulates the processors and memory in a RISC-V machine.
 class sim_t
 {
 public:
-	sim_t(size_t _nprocs, size_t mem_mb, const std::vector<std::string>& htif_args, proc_type_t _proc_type);
+	// _tid: SMT thread id of the timing simulator's processor (see smt.h).
+	sim_t(size_t _nprocs, size_t mem_mb, const std::vector<std::string>& htif_args, proc_type_t _proc_type, unsigned int _tid = 0);
 	~sim_t();
 
 	// run the simulation to completion
 	void boot();
+	// Instead of boot(): start the processors on a synthetic program (see synth.h),
+	// without HTIF.
+	void boot_synth(synth_t* synth);
 	int run();
 	bool running();
 	void stop();
@@ -35,6 +42,7 @@ public:
 	void set_histogram(bool value);
 	void set_procs_debug(bool value);
 	void set_procs_checker(bool value);
+	void set_procs_warming(bool value);
 	bool get_procs_debug();
 	bool get_procs_checker();
 	htif_isasim_t* get_htif() {
@@ -42,7 +50,8 @@ public:
 	}
 
 #ifdef RISCV_ENABLE_SIMPOINT
-  void set_simpoint(bool enable, size_t interval);
+  void set_simpoint(bool enable, size_t interval, const char* name);
+  void finish_simpoint(unsigned int max_k);
 #endif
 
 	// deliver an IPI to a specific processor
@@ -68,7 +77,13 @@ public:
 
   void step_till_pc(reg_t break_pc,unsigned int proc_n);
 
-  bool run_fast(size_t n);
+  // Fast-skip n instructions. The last 'warm' of them functionally warm the
+  // timing model (see processor_t::warm()).
+  bool run_fast(size_t n, size_t warm = 0);
+
+  // Replace the timing simulator's processors with ones built from the current
+  // (changed) configuration. They continue from the old ones' state (see pipeline_t::take_over()).
+  void reconfigure();
 
   proc_type_t get_proc_type(){return proc_type;}
 
@@ -79,6 +94,12 @@ private:
 	size_t memsz; // memory size in bytes
 	mmu_t* debug_mmu;  // debug port into main memory
 	std::vector<processor_t*> procs;
+	unsigned int tid;  // SMT thread id of the timing simulator's processor 0
+	bool synthetic;    // running a synthetic program: no HTIF
+	directory_t* coherence;  // multi-core timing simulation (see coherence.h), NULL: one core
+	parallel_t* parallel;    // ...on parallel host threads (see parallel.h), NULL: in lockstep
+
+	processor_t* new_micro(size_t i);
 
 	bool step(); // Step 1 cycle.
 	static const size_t INTERLEAVE = 64;
@@ -126,6 +147,7 @@ private:
 
 	friend class htif_isasim_t;
   friend class debug_buffer_t;
+  friend class smt_t;
 };
 
 extern volatile bool ctrlc_pressed;
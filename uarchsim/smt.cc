@@ -0,0 +1,149 @@
+#include <cinttypes>
+#include <cassert>
+#include <algorithm>
+
+#include "sim.h"
+#include "htif.h"
+#include "pipeline.h"
+#include "smt.h"
+
+
+smt_t::smt_t() {
+	first = 0;
+	fetch_rr = 0;
+	fetch_grant = 0;
+	lanes_issued = 0;
+
+	for (unsigned int t = 0; t < SMT_MAX_THREADS; t++) {
+		n_fetch_grants[t] = 0;
+		n_iq_stalls[t] = 0;
+		n_lsq_stalls[t] = 0;
+		n_prf_stalls[t] = 0;
+	}
+}
+
+smt_t::~smt_t() {
+}
+
+void smt_t::add_thread(sim_t* sim) {
+	assert(threads.size() < SMT_MAX_THREADS);
+	assert(sim->get_proc_type() == MICRO_SIM);
+
+	pipeline_t* p = (pipeline_t*) sim->get_core(0);
+	assert(p->Tid == threads.size());
+	p->set_smt(this, (threads.empty() ? p : threads[0]));
+
+	sims.push_back(sim);
+	threads.push_back(p);
+}
+
+void smt_t::begin_cycle() {
+	unsigned int n = threads.size();
+	unsigned int n_fetch = std::min(SMT_FETCH_THREADS, n);
+	unsigned int count[SMT_MAX_THREADS];
+	unsigned int t;
+
+	fetch_grant = 0;
+	lanes_issued = 0;
+
+	if (SMT_FETCH_POLICY == SMT_FETCH_RR) {
+		for (unsigned int i = 0; i < n_fetch; i++)
+			fetch_grant |= (1U << ((fetch_rr + i) % n));
+	}
+	else {
+		// ICOUNT: the threads with the fewest instructions in the front end and IQ.
+		// Ties go to the thread that is next in round-robin order.
+		for (t = 0; t < n; t++)
+			count[t] = threads[t]->icount();
+		for (unsigned int i = 0; i < n_fetch; i++) {
+			int best = -1;
+			for (unsigned int j = 0; j < n; j++) {
+				t = ((fetch_rr + j) % n);
+				if (!(fetch_grant & (1U << t)) && ((best < 0) || (count[t] < count[best])))
+					best = t;
+			}
+			fetch_grant |= (1U << best);
+		}
+	}
+	fetch_rr = ((fetch_rr + 1) % n);
+
+	for (t = 0; t < n; t++) {
+		if (fetch_grant & (1U << t))
+			n_fetch_grants[t]++;
+	}
+}
+
+int smt_t::run() {
+	unsigned int n = threads.size();
+	int done = -1;
+
+	assert(n > 0);
+	while (done < 0) {
+		begin_cycle();
+
+		// Step each thread one cycle. They take turns going first,
+		// which gives them turns at priority for the Execution Lanes.
+		for (unsigned int i = 0; (i < n) && (done < 0); i++) {
+			unsigned int t = ((first + i) % n);
+			if (!sims[t]->step())
+				done = t;
+		}
+		first = ((first + 1) % n);
+	}
+
+	fprintf(stderr, "SMT: thread %d finished\n", done);
+	return(sims[done]->get_htif()->exit_code());
+}
+
+bool smt_t::stall_reg(unsigned int tid, unsigned int bundle_dst) {
+	if (!SMT_SHARED)
+		return(false);
+
+	// Each thread's renamer has all the rename registers; together they have one pool.
+	uint64_t prf_size = (AUTO_PRF_SIZE ? (NXPR + NFPR + ACTIVE_LIST_SIZE) : PRF_SIZE);
+	uint64_t limit = ((threads.size() - 1) * (NXPR + NFPR)) + prf_size;
+	uint64_t in_use = 0;
+	for (unsigned int t = 0; t < threads.size(); t++)
+		in_use += (prf_size - threads[t]->REN->noOfFreeRegistersInFreeList());
+
+	if ((in_use + bundle_dst) > limit) {
+		n_prf_stalls[tid]++;
+		return(true);
+	}
+	return(false);
+}
+
+bool smt_t::stall_dispatch(unsigned int tid, unsigned int bundle_inst, unsigned int bundle_load, unsigned int bundle_store) {
+	if (!SMT_SHARED)
+		return(false);
+
+	unsigned int iq = 0, lq = 0, sq = 0;
+	for (unsigned int t = 0; t < threads.size(); t++) {
+		iq += threads[t]->IQ.get_length();
+		lq += threads[t]->LSU.get_lq_length();
+		sq += threads[t]->LSU.get_sq_length();
+	}
+
+	if ((iq + bundle_inst) > ISSUE_QUEUE_SIZE) {
+		n_iq_stalls[tid]++;
+		return(true);
+	}
+	if (((lq + bundle_load) > LQ_SIZE) || ((sq + bundle_store) > SQ_SIZE)) {
+		n_lsq_stalls[tid]++;
+		return(true);
+	}
+	return(false);
+}
+
+void smt_t::dump_stats(unsigned int tid, FILE* fp) {
+	fprintf(fp, "SMT MEASUREMENTS-----------------------------------\n");
+	fprintf(fp, "  thread           = %u of %u\n", tid, (unsigned int)threads.size());
+	fprintf(fp, "  fetch cycles     = %" PRIu64 "\n", n_fetch_grants[tid]);
+	if (SMT_SHARED) {
+		fprintf(fp, "  shared IQ stalls = %" PRIu64 "\n", n_iq_stalls[tid]);
+		fprintf(fp, "  shared LSQ stalls= %" PRIu64 "\n", n_lsq_stalls[tid]);
+		fprintf(fp, "  shared PRF stalls= %" PRIu64 "\n", n_prf_stalls[tid]);
+	}
+	if (tid > 0)
+		fprintf(fp, "  (caches and DRAM are shared: see thread 0)\n");
+}
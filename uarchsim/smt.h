@@ -0,0 +1,87 @@
+#ifndef SMT_H
+#define SMT_H
+
+#include <cstdio>
+#include <vector>
+#include "decode.h"
+#include "parameters.h"
+
+/*--------------------------------------------------------------------------*\
+ | smt.h
+ |
+ | Simultaneous multithreading.
+ |
+ | Each hardware thread is a pipeline_t, driven by its own sim_t (its own
+ | program, memory image and HTIF). A thread therefore has its own fetch
+ | unit and PC, branch predictor, RMT/AMT and CPR checkpoints, Fetch Queue,
+ | IQ, LQ/SQ, retire state, checker and stats log. The smt_t steps all the
+ | threads in lockstep, one cycle at a time, and arbitrates for what they
+ | share:
+ |
+ | - Fetch: SMT_FETCH_THREADS threads fetch per cycle, chosen by ICOUNT (the
+ |   fewest instructions in decode, rename, dispatch and the IQ) or
+ |   round-robin. The other threads' Fetch1 stages are not clocked.
+ | - Execution Lanes: a lane takes one instruction per cycle, from any
+ |   thread. Threads take turns going first.
+ | - IQ, LQ/SQ and PRF: if SMT_SHARED, each thread's structures are full-size
+ |   and dispatch/rename also stall when the threads' combined occupancy
+ |   would exceed the structure's size (the PRF: the threads' architectural
+ |   registers plus one shared pool of rename registers). Otherwise each
+ |   thread gets an equal partition (see smt_partition()).
+ | - Memory hierarchy: all threads use thread 0's L1 I$, L1 D$, L2, L3 and
+ |   DRAM, with the thread id folded into the line address. Their stats are
+ |   in thread 0's stats log. TLBs are per thread.
+ |
+ | CPR has no ROB: the in-flight window of a thread is bounded by its
+ | checkpoints and physical registers.
+\*--------------------------------------------------------------------------*/
+
+class sim_t;
+class pipeline_t;
+
+// Size of one thread's share of a structure with 'size' entries.
+static inline unsigned int smt_partition(unsigned int size) {
+	return((SMT_SHARED || (SMT_THREADS <= 1)) ? size : (size / SMT_THREADS));
+}
+
+class smt_t {
+public:
+	smt_t();
+	~smt_t();
+
+	// Add the next hardware thread: the timing simulator of 'sim'.
+	// Threads after the first share the first thread's memory hierarchy.
+	void add_thread(sim_t* sim);
+
+	// Run all threads until one of them finishes (its program exits or it
+	// reaches the -e limit). Returns that thread's HTIF exit code.
+	int run();
+
+	// Arbitration, consulted by the threads' pipeline stages.
+	bool may_fetch(unsigned int tid) { return((fetch_grant & (1U << tid)) != 0); }
+	unsigned int busy_lanes() { return(lanes_issued); }
+	void issued(unsigned int lanes) { lanes_issued |= lanes; }
+	bool stall_reg(unsigned int tid, unsigned int bundle_dst);
+	bool stall_dispatch(unsigned int tid, unsigned int bundle_inst, unsigned int bundle_load, unsigned int bundle_store);
+
+	void dump_stats(unsigned int tid, FILE* fp);
+
+private:
+	void begin_cycle();
+
+	std::vector<sim_t*> sims;
+	std::vector<pipeline_t*> threads;
+
+	unsigned int first;          // thread that goes first this cycle
+	unsigned int fetch_rr;       // next thread for round-robin fetch
+	unsigned int fetch_grant;    // bit vector: threads that fetch this cycle
+	unsigned int lanes_issued;   // bit vector: lanes issued to this cycle
+
+	// Stats, per thread.
+	uint64_t n_fetch_grants[SMT_MAX_THREADS];   // cycles the thread was allowed to fetch
+	uint64_t n_iq_stalls[SMT_MAX_THREADS];      // dispatch stalls for the shared IQ
+	uint64_t n_lsq_stalls[SMT_MAX_THREADS];     // ...for the shared LQ/SQ
+	uint64_t n_prf_stalls[SMT_MAX_THREADS];     // rename stalls for the shared PRF
+};
+
+#endif //SMT_H
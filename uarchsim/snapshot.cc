@@ -0,0 +1,173 @@
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "sim.h"
+
+
+snapshot_t* SNAPSHOT = NULL;
+
+extern bool logging_on;
+
+#define NUM_FAILURE_SIGNALS 5
+static const int failure_signal[NUM_FAILURE_SIGNALS] = {SIGABRT, SIGSEGV, SIGBUS, SIGFPE, SIGILL};
+static struct sigaction previous_action[NUM_FAILURE_SIGNALS];
+
+// Then the previous handler (e.g., the HTIF's, for SIGABRT), or the default action.
+static void handle_failure(int sig)
+{
+	if (SNAPSHOT)
+		SNAPSHOT->rewind();
+	for (unsigned int i = 0; i < NUM_FAILURE_SIGNALS; i++)
+		if (failure_signal[i] == sig)
+			sigaction(sig, &previous_action[i], NULL);
+	raise(sig);
+}
+
+// Whether 'fd' is stdout or stderr, or the same file (e.g., the HTIF's duplicates of them).
+// Their offsets are not restored: the failing process's output stays, followed by the snapshot's.
+static bool is_output(int fd)
+{
+	struct stat st, out;
+
+	if (fstat(fd, &st) != 0)
+		return(false);
+	for (int o = STDOUT_FILENO; o <= STDERR_FILENO; o++)
+		if ((fstat(o, &out) == 0) && (st.st_dev == out.st_dev) && (st.st_ino == out.st_ino))
+			return(true);
+	return(false);
+}
+
+// At the first snapshot, after the simulators (and their HTIFs) have installed theirs.
+static void install_failure_handlers()
+{
+	struct sigaction action;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = &handle_failure;
+	sigemptyset(&action.sa_mask);
+	for (unsigned int i = 0; i < NUM_FAILURE_SIGNALS; i++)
+		sigaction(failure_signal[i], &action, &previous_action[i]);
+}
+
+snapshot_t::snapshot_t(uint64_t interval, unsigned int count)
+	: interval(interval), count((count > 0) ? count : 1), next(interval), offsets(SNAPSHOT_MAX_FD, -1),
+	  n_taken(0), rewound(false), rewound_cycle(0), rewound_insn(0) {
+}
+
+snapshot_t::~snapshot_t() {
+	for (snap_t& s : ring) {
+		close(s.fd);
+		waitpid(s.pid, NULL, 0);
+	}
+	ring.clear();
+}
+
+void snapshot_t::take(cycle_t cycle, uint64_t insn) {
+	int p[2];
+	pid_t child;
+
+	next = (cycle + interval);
+
+	// The snapshot shares the open files: it restores their offsets when it resumes.
+	fflush(NULL);   // else the snapshot repeats the buffered output
+	for (int fd = 0; fd < SNAPSHOT_MAX_FD; fd++) {
+		offsets[fd] = lseek(fd, 0, SEEK_CUR);
+		if ((offsets[fd] >= 0) && is_output(fd))
+			offsets[fd] = -1;
+	}
+
+	if (pipe(p) != 0) {
+		perror("--snapshot: pipe");
+		return;
+	}
+	child = fork();
+	if (child < 0) {
+		perror("--snapshot: fork");
+		close(p[0]);
+		close(p[1]);
+		return;
+	}
+	if (child == 0) {
+		close(p[1]);
+		for (snap_t& s : ring)
+			close(s.fd);
+		ring.clear();
+		wait_resume(p[0], cycle, insn);
+		return;
+	}
+
+	close(p[0]);
+	ring.push_back({child, p[1], cycle, insn});
+	if (n_taken++ == 0)
+		install_failure_handlers();
+	if (ring.size() > count) {
+		close(ring.front().fd);
+		waitpid(ring.front().pid, NULL, 0);
+		ring.pop_front();
+	}
+}
+
+void snapshot_t::wait_resume(int fd, cycle_t cycle, uint64_t insn) {
+	char c = 0;
+	ssize_t n;
+
+	do {
+		n = read(fd, &c, 1);
+	} while ((n < 0) && (errno == EINTR));
+	if ((n != 1) || (c != 'r'))
+		_exit(0);   // dropped from the ring, or the simulation is over: no stats, no flushing
+	close(fd);
+
+	for (int f = 0; f < SNAPSHOT_MAX_FD; f++)
+		if (offsets[f] >= 0)
+			lseek(f, offsets[f], SEEK_SET);
+
+	// One rewind: no further snapshots.
+	next = (cycle_t)-1;
+	rewound = true;
+	rewound_cycle = cycle;
+	rewound_insn = insn;
+	ctrlc_pressed = false;
+	logging_on = true;
+	fprintf(stderr, "Rewound to the snapshot at cycle %" PRIcycle " (instruction %" PRIu64 "): resuming with logging on.\n", cycle, insn);
+}
+
+void snapshot_t::rewind() {
+	static const char msg[] = "Failure: resuming the oldest snapshot (see --snapshot).\n";
+	int status;
+
+	// A resumed snapshot failing again: keep its logs (best effort: stdio is not async-signal-safe).
+	if (rewound) {
+		fflush(NULL);
+		return;
+	}
+	if (ring.empty())
+		return;
+	for (size_t i = 1; i < ring.size(); i++)
+		close(ring[i].fd);
+	if (write(2, msg, sizeof(msg) - 1) < 0) {
+		// Nothing to do: the snapshot resumes regardless.
+	}
+	if (write(ring[0].fd, "r", 1) == 1)
+		while ((waitpid(ring[0].pid, &status, 0) < 0) && (errno == EINTR));
+}
+
+void snapshot_t::dump_stats(FILE* fp) {
+	fprintf(fp, "SNAPSHOT MEASUREMENTS------------------------------\n");
+	fprintf(fp, "  interval         = %" PRIu64 " cycles, %u kept\n", interval, count);
+	if (rewound) {
+		fprintf(fp, "  rewound          = yes: resumed the snapshot at cycle %" PRIcycle " (instruction %" PRIu64 ")\n",
+		        rewound_cycle, rewound_insn);
+	}
+	else {
+		fprintf(fp, "  snapshots        = %" PRIu64 "\n", n_taken);
+		for (snap_t& s : ring)
+			fprintf(fp, "     at cycle      = %" PRIcycle " (instruction %" PRIu64 ")\n", s.cycle, s.insn);
+	}
+}
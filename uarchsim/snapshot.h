@@ -0,0 +1,92 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdio>
+#include <cinttypes>
+#include <deque>
+#include <vector>
+#include <sys/types.h>
+#include "decode.h"
+
+/*--------------------------------------------------------------------------*\
+ | snapshot.h
+ |
+ | Snapshots of the timing simulation, for rewinding to shortly before a
+ | failure (--snapshot=<cycles>[,<count>]).
+ |
+ | Every <cycles> cycles (of core or thread 0), the simulator forks. The
+ | child is the snapshot: the whole simulator, target memory and HTIF, as
+ | they were at that cycle. It waits, blocked on a pipe. The <count> most
+ | recent snapshots are kept; older ones exit.
+ |
+ | On a failure (an assertion, e.g., a checker mismatch or DEADLOCK, or a
+ | crash), the failing process resumes the oldest snapshot and waits for
+ | it. The snapshot continues the simulation from its cycle with logging
+ | on, repeating the same cycles up to the failure. Since it is a copy of
+ | the process, it repeats them bit-identically. It takes no further
+ | snapshots, and flushes its logs when it fails in turn.
+ |
+ | Open host files (stats logs, traces, the target program's files) are
+ | shared with the snapshot. Their offsets at the snapshot are restored
+ | when it resumes, so that it rereads and rewrites the same bytes. Except
+ | stdout and stderr (and other descriptors of the same files): the
+ | snapshot's output follows the failing process's.
+ |
+ | Snapshots only exist while the process runs: they are not saved to
+ | disk. Stdio buffers are flushed at every snapshot.
+\*--------------------------------------------------------------------------*/
+
+#define SNAPSHOT_MAX_FD   1024   // host file descriptors whose offsets are restored
+
+class snapshot_t {
+public:
+	// Take a snapshot every 'interval' cycles, and keep the 'count' most recent.
+	// The first one installs the failure handlers (SIGABRT, SIGSEGV, SIGBUS,
+	// SIGFPE, SIGILL), which then call the ones they replaced.
+	snapshot_t(uint64_t interval, unsigned int count);
+	~snapshot_t();   // the snapshots exit
+
+	// Core or thread 0, every cycle.
+	inline void tick(cycle_t cycle, uint64_t insn) {
+		if (cycle >= next)
+			take(cycle, insn);
+	}
+
+	// On a failure: resume the oldest snapshot, and wait for it to finish.
+	// Returns at once if there is none. Async-signal-safe, except in a
+	// resumed snapshot, where it flushes the logs.
+	void rewind();
+
+	// "SNAPSHOT MEASUREMENTS".
+	void dump_stats(FILE* fp);
+
+	uint64_t get_interval() { return(interval); }
+	unsigned int get_count() { return(count); }
+
+private:
+	typedef struct {
+		pid_t pid;
+		int fd;           // the pipe's write end: 'r' to resume, EOF to exit
+		cycle_t cycle;
+		uint64_t insn;
+	} snap_t;
+
+	void take(cycle_t cycle, uint64_t insn);
+	void wait_resume(int fd, cycle_t cycle, uint64_t insn);   // in the snapshot
+
+	uint64_t interval;
+	unsigned int count;
+	cycle_t next;                    // cycle of the next snapshot
+	std::deque<snap_t> ring;         // oldest first
+	std::vector<off_t> offsets;      // host file offsets at the snapshot, by descriptor (-1: none)
+
+	// Stats.
+	uint64_t n_taken;
+	bool rewound;                    // this process is a resumed snapshot
+	cycle_t rewound_cycle;
+	uint64_t rewound_insn;
+};
+
+extern snapshot_t* SNAPSHOT;   // NULL: no snapshots
+
+#endif //SNAPSHOT_H
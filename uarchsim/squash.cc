@@ -102,6 +102,11 @@ void pipeline_t::squash_complete(reg_t jump_PC) {
 	}
 
 	LSU.flush();
+
+	// Value predictor.
+	if (VP)
+		VP->flush();
+	vp_ghist = vp_ghist_commit;
 }
 
 
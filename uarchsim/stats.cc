@@ -1,14 +1,30 @@
 #include "stats.h"
 #include "pipeline.h"
 #include "parameters.h"
+#include "phase_stream.h"
 
 stats_t::stats_t(pipeline_t* _proc){
 
   this->proc = _proc;
+  this->stats_log = NULL;
+  this->phase_log = NULL;
+  this->phase_counter = NULL;
+  this->phase_hook = NULL;
+  this->phase_binary = false;
 
   DECLARE_COUNTER(this, cycle_count               ,proc);
   DECLARE_COUNTER(this, commit_count              ,proc);
   DECLARE_COUNTER(this, ld_vio_count              ,proc);
+  DECLARE_COUNTER(this, checker_full_count        ,proc);
+  DECLARE_COUNTER(this, checker_signature_count   ,proc);
+  DECLARE_COUNTER(this, exception_reexec_count    ,proc);
+  DECLARE_COUNTER(this, elim_move_count           ,proc);
+  DECLARE_COUNTER(this, elim_zero_count           ,proc);
+  DECLARE_COUNTER(this, fusion_lui_addi_count     ,proc);
+  DECLARE_COUNTER(this, fusion_auipc_addi_count   ,proc);
+  DECLARE_COUNTER(this, fusion_shift_pair_count   ,proc);
+  DECLARE_COUNTER(this, fusion_shift_add_count    ,proc);
+  DECLARE_COUNTER(this, fusion_dependent_alu_count,proc);
 #if 0
   DECLARE_COUNTER(this, load_count                ,proc);
   DECLARE_COUNTER(this, store_count               ,proc);
@@ -154,10 +170,83 @@ void stats_t::set_log_files(FILE* _stats_log,FILE* _phase_log){
   this->phase_log = _phase_log;
 }
 
+void stats_t::set_phase_binary(bool binary){
+  this->phase_binary = binary;
+}
+
+// The schema is every counter declared when the first record is written,
+// in counter_map order, plus the rates over them.
+void stats_t::write_phase_header(){
+  std::map<std::string, counter_t*, ltstr>::iterator ctr_iter;
+  std::map<std::string, rate_t*, ltstr>::iterator rate_iter;
+  std::map<std::string, uint32_t> index;
+
+  phase_schema.clear();
+  for(ctr_iter = counter_map.begin();ctr_iter != counter_map.end(); ctr_iter++){
+    index[ctr_iter->first] = phase_schema.size();
+    phase_schema.push_back(ctr_iter->second);
+  }
+
+  std::vector<rate_t*> rates;
+  for(rate_iter = rate_map.begin();rate_iter != rate_map.end(); rate_iter++){
+    if((index.find(rate_iter->second->numerator) != index.end()) && (index.find(rate_iter->second->denominator) != index.end()))
+      rates.push_back(rate_iter->second);
+  }
+
+  phase_stream_header_t header;
+  header.magic = PHASE_STREAM_MAGIC;
+  header.version = PHASE_STREAM_VERSION;
+  header.num_counters = phase_schema.size();
+  header.num_rates = rates.size();
+  header.reserved = 0;
+  header.phase_interval = phase_interval;
+  fwrite(&header, sizeof(header), 1, phase_log);
+
+  for(size_t i = 0; i < phase_schema.size(); i++){
+    uint16_t len = strlen(phase_schema[i]->name);
+    fwrite(&len, sizeof(len), 1, phase_log);
+    fwrite(phase_schema[i]->name, 1, len, phase_log);
+  }
+  for(size_t i = 0; i < rates.size(); i++){
+    uint16_t len = strlen(rates[i]->name);
+    uint32_t numerator = index[rates[i]->numerator];
+    uint32_t denominator = index[rates[i]->denominator];
+    fwrite(&len, sizeof(len), 1, phase_log);
+    fwrite(rates[i]->name, 1, len, phase_log);
+    fwrite(&numerator, sizeof(numerator), 1, phase_log);
+    fwrite(&denominator, sizeof(denominator), 1, phase_log);
+    fwrite(&rates[i]->multiplier, sizeof(double), 1, phase_log);
+  }
+
+  phase_buf.reserve(PHASE_STREAM_BUF_RECORDS * (1 + phase_schema.size()));
+}
+
+void stats_t::write_phase_record(){
+  if(phase_schema.empty())
+    write_phase_header();
+
+  phase_buf.push_back(phase_id);
+  for(size_t i = 0; i < phase_schema.size(); i++){
+    phase_buf.push_back(phase_schema[i]->phase_count);
+    phase_schema[i]->phase_count = 0;
+  }
+
+  if(phase_buf.size() >= PHASE_STREAM_BUF_RECORDS * (1 + phase_schema.size()))
+    flush_phase_stream();
+}
+
+void stats_t::flush_phase_stream(){
+  if(phase_log && !phase_buf.empty()){
+    fwrite(phase_buf.data(), sizeof(uint64_t), phase_buf.size(), phase_log);
+    phase_buf.clear();
+  }
+}
+
 void stats_t::set_phase_interval(const char* name,uint64_t interval)
 {
   std::strcpy(phase_counter_name,name);
   phase_interval = interval;
+  phase_counter = ((counter_map.find(name) != counter_map.end()) ? counter_map[name] : NULL);
   ifprintf(logging_on,stderr,"Setting phase interval to %s = %lu\n",phase_counter_name,interval);
 }
 
@@ -197,6 +286,8 @@ void stats_t::register_phase_counter(const char* name, const char* hierarchy){
   // If it does not exist, declare it and mark it as a phase counter
   else {
     counter_t* c    = new counter_t;
+    c->count        = 0;
+    c->phase_count  = 0;
     c->name         = new char[strlen(name)+1];
     c->hierarchy    = new char[strlen(hierarchy)+1];
     c->valid_phase_counter  = true;
@@ -257,9 +348,10 @@ void stats_t::register_knob(const char* name, const char* hierarchy, unsigned in
 
 void stats_t::update_counter(const char* name,unsigned int inc){
   // If the counter has been declared and initialized
-  if(counter_map.find(name) != counter_map.end()){
-    counter_map[name]->count++;
-    counter_map[name]->phase_count++;
+  auto ctr_iter = counter_map.find(name);
+  if(ctr_iter != counter_map.end()){
+    ctr_iter->second->count++;
+    ctr_iter->second->phase_count++;
   }
   // Tick the phase check mechanism if updating the 
   // counter on which phases are based on. Normally this
@@ -269,6 +361,14 @@ void stats_t::update_counter(const char* name,unsigned int inc){
   }
 }
 
+void stats_t::add_counter(const char* name,uint64_t inc){
+  auto ctr_iter = counter_map.find(name);
+  if(ctr_iter != counter_map.end()){
+    ctr_iter->second->count += inc;
+    ctr_iter->second->phase_count += inc;
+  }
+}
+
 uint64_t stats_t::get_counter(const char* name){
   return counter_map[name]->count;
 }
@@ -278,8 +378,15 @@ unsigned int stats_t::get_knob(const char* name){
 }
 
 void stats_t::phase_tick(){
-  if(counter_map[phase_counter_name]->phase_count >= phase_interval){
+  if(phase_counter && (phase_counter->phase_count >= phase_interval)){
     phase_id++;
+    if(phase_hook)
+      phase_hook(this);
+    if(phase_binary){
+      // No formatting and no flushing: the record is buffered.
+      write_phase_record();
+      return;
+    }
     update_rates();
     dump_phase_counters();
     dump_phase_rates();
@@ -355,25 +462,19 @@ void stats_t::dump_knobs(){
 
 
 void stats_t::update_pc_histogram(size_t pc){
-  // If the counter has been declared and initialized
-  pc_histogram[pc >> 2]++;
+  pc_histogram.inc(pc);
 }
 
 void stats_t::update_br_histogram(size_t pc,bool misp){
-  // If the counter has been declared and initialized
-  br_histogram[pc >> 2].executed++;
-  if(misp)
-    br_histogram[pc >> 2].mispredicted ++;
+  br_histogram.inc_branch(pc, misp);
 }
 
 void stats_t::dump_pc_histogram(){
   if (proc->get_histogram())
   {
     fprintf(stderr, "PC Histogram size:%lu\n", pc_histogram.size());
-    fprintf(stats_log, "-------PC Histogram-------\n");
-    for(auto iterator = pc_histogram.begin(); iterator != pc_histogram.end(); ++iterator) {
-      fprintf(stats_log, "%0lx %lu\n", (iterator->first << 2), iterator->second);
-    }
+    fprintf(stats_log, "-------PC Histogram (hottest %s)-------\n", (HISTOGRAM_TOP_N ? std::to_string(HISTOGRAM_TOP_N).c_str() : "all"));
+    pc_histogram.dump(stats_log, HISTOGRAM_TOP_N, false);
   }
 }
 
@@ -381,9 +482,7 @@ void stats_t::dump_br_histogram(){
   if (proc->get_histogram())
   {
     fprintf(stderr, "BR Histogram size:%lu\n", br_histogram.size());
-    fprintf(stats_log, "-------BR Histogram-------\n");
-    for(auto iterator = br_histogram.begin(); iterator != br_histogram.end(); ++iterator) {
-      fprintf(stats_log, "%0lx %lu %lu\n", (iterator->first << 2), iterator->second.executed, iterator->second.mispredicted);
-    }
+    fprintf(stats_log, "-------BR Histogram (most mispredicted %s)-------\n", (HISTOGRAM_TOP_N ? std::to_string(HISTOGRAM_TOP_N).c_str() : "all"));
+    br_histogram.dump(stats_log, HISTOGRAM_TOP_N, true);
   }
 }
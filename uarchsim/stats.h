@@ -6,6 +6,8 @@
 #include <map>
 #include <cstdio>
 #include <string>
+#include <vector>
+#include "pchist.h"
 
 
 // Statistics related variables and funcions
@@ -81,12 +83,6 @@ typedef struct knob {
   char* hierarchy;
 } knob_t;
 
-typedef struct branch {
-  size_t pc;
-  size_t executed;
-  size_t mispredicted;
-} branch_t;
-
 //Forward declaring classes
 class pipeline_t;
 
@@ -97,6 +93,7 @@ public:
   ~stats_t(){}
   void set_phase_interval(const char* name,uint64_t interval);
   void update_counter(const char* name,unsigned int inc=1);
+  void add_counter(const char* name,uint64_t inc);   // unlike update_counter(), adds 'inc'; does not tick the phase
   void update_pc_histogram(size_t pc);
   void update_br_histogram(size_t pc,bool misp);
   uint64_t get_counter(const char* name);
@@ -107,6 +104,9 @@ public:
   void register_phase_rate(const char* name, const char* hierarchy, const char* numerator, const char* denominator, double multiplier);
   void register_knob(const char* name, const char* hierarchy, unsigned int value);
   void set_log_files(FILE* _stats_log, FILE* _phase_log);
+  void set_phase_binary(bool binary);
+  void flush_phase_stream();
+  void set_phase_hook(void (*hook)(stats_t*)) { phase_hook = hook; }   // called at the end of each phase, before recording it
 
   void reset_counters();
   void reset_phase_counters();
@@ -127,12 +127,19 @@ private:
   std::map<std::string, rate_t*, ltstr> rate_map;
   //map<const char*, counter_t*, ltstr> phase_counter_map;
   std::map<std::string, knob_t*, ltstr> knob_map;
-  std::map<size_t,size_t> pc_histogram;
-  std::map<size_t,branch_t> br_histogram;
+  pc_histogram_t pc_histogram;
+  pc_histogram_t br_histogram;
 
   uint64_t phase_id;
   uint64_t phase_interval;
   char phase_counter_name[16];
+  counter_t* phase_counter;   // counter named phase_counter_name, NULL if none
+  void (*phase_hook)(stats_t*);
+
+  // Binary phase stream (see phase_stream.h).
+  bool phase_binary;
+  std::vector<counter_t*> phase_schema;   // counters in record order, fixed by the first record
+  std::vector<uint64_t> phase_buf;        // buffered records
   FILE* stats_log;
   FILE* phase_log;
 
@@ -140,6 +147,8 @@ private:
   //bool histogram_enabled;
 
   void phase_tick();
+  void write_phase_header();
+  void write_phase_record();
 };
 
 #endif //STATS_H
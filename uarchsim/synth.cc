@@ -0,0 +1,482 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "synth.h"
+#include "encoding.h"
+
+
+synth_t* SYNTH = NULL;
+
+// Registers the program reserves; all others but x0, sp, gp and tp are
+// allocated round-robin to integer destinations.
+#define R_RA       1
+#define R_T0       5
+#define R_A_BASE   8      // s0: region A
+#define R_MASK     9      // s1: data - 8
+#define R_OFFSET   18     // s2: window offset in the data, advanced by the stride
+#define R_A_WIN    19     // s3: region A window (s0 + s2)
+#define R_CHASE    20     // s4: pointer chain
+#define R_B_WIN    21     // s5: region B window (s3 + s6)
+#define R_B_DIST   22     // s6: region B - region A
+#define R_STRIDE   23     // s7
+
+static const unsigned int int_pool[] = {6, 7, 10, 11, 12, 13, 14, 15, 16, 17, 24, 25, 26, 27, 28, 29, 30, 31};
+#define INT_POOL   (sizeof(int_pool) / sizeof(int_pool[0]))
+
+#define SYNTH_GUARD         4096      // bytes past the data covered by a window (displacements < 2048)
+#define SYNTH_HIST          64
+#define SYNTH_FUNCTIONS     8
+
+// Instruction formats.
+static uint32_t r_type(uint32_t match, unsigned int rd, unsigned int rs1, unsigned int rs2) {
+	return(match | (rd << 7) | (rs1 << 15) | (rs2 << 20));
+}
+
+static uint32_t r4_type(uint32_t match, unsigned int rd, unsigned int rs1, unsigned int rs2, unsigned int rs3) {
+	return(r_type(match, rd, rs1, rs2) | (rs3 << 27));
+}
+
+static uint32_t i_type(uint32_t match, unsigned int rd, unsigned int rs1, int32_t imm) {
+	return(match | (rd << 7) | (rs1 << 15) | (((uint32_t)imm & 0xfff) << 20));
+}
+
+static uint32_t s_type(uint32_t match, unsigned int rs1, unsigned int rs2, int32_t imm) {
+	return(match | (((uint32_t)imm & 0x1f) << 7) | (rs1 << 15) | (rs2 << 20) | ((((uint32_t)imm >> 5) & 0x7f) << 25));
+}
+
+static uint32_t b_imm(int32_t off) {
+	uint32_t o = (uint32_t)off;
+	return((((o >> 11) & 0x1) << 7) | (((o >> 1) & 0xf) << 8) | (((o >> 5) & 0x3f) << 25) | (((o >> 12) & 0x1) << 31));
+}
+
+static uint32_t j_imm(int32_t off) {
+	uint32_t o = (uint32_t)off;
+	return((((o >> 12) & 0xff) << 12) | (((o >> 11) & 0x1) << 20) | (((o >> 1) & 0x3ff) << 21) | (((o >> 20) & 0x1) << 31));
+}
+
+// xorshift64*
+static uint64_t xorshift(uint64_t& x) {
+	x ^= (x >> 12);
+	x ^= (x << 25);
+	x ^= (x >> 27);
+	return(x * 0x2545f4914f6cdd1dULL);
+}
+
+static bool parse_size(const char* s, uint64_t& value) {
+	char* end;
+	value = strtoull(s, &end, 0);
+	if (end == s)
+		return(false);
+	if ((*end == 'K') || (*end == 'k'))
+		value <<= 10, end++;
+	else if ((*end == 'M') || (*end == 'm'))
+		value <<= 20, end++;
+	else if ((*end == 'G') || (*end == 'g'))
+		value <<= 30, end++;
+	return(*end == '\0');
+}
+
+synth_t::synth_t() {
+	seed = 1;
+	code_bytes = (16 << 10);
+	data_bytes = (1 << 20);
+	dep = 4;
+	pct_ld = 25;
+	pct_st = 10;
+	pct_br = 12;
+	pct_fp = 10;
+	pct_call = 1;
+	bias = 90;
+	addr = SYNTH_STRIDE;
+	stride = 64;
+
+	generated = false;
+}
+
+bool synth_t::configure(const char* config) {
+	std::string s(config);
+	size_t pos = 0;
+
+	while (pos < s.size()) {
+		size_t comma = s.find(',', pos);
+		std::string item = s.substr(pos, (comma == std::string::npos) ? std::string::npos : (comma - pos));
+		size_t eq = item.find('=');
+		uint64_t value = 0;
+
+		pos = ((comma == std::string::npos) ? s.size() : (comma + 1));
+		if (eq == std::string::npos)
+			return(false);
+		std::string key = item.substr(0, eq);
+		std::string val = item.substr(eq + 1);
+
+		if (key == "addr") {
+			if (val == "stride")
+				addr = SYNTH_STRIDE;
+			else if (val == "random")
+				addr = SYNTH_RANDOM;
+			else if (val == "chase")
+				addr = SYNTH_CHASE;
+			else
+				return(false);
+			continue;
+		}
+		if (!parse_size(val.c_str(), value))
+			return(false);
+		if (key == "seed")
+			seed = value;
+		else if (key == "code")
+			code_bytes = value;
+		else if (key == "data")
+			data_bytes = value;
+		else if (key == "stride")
+			stride = value;
+		else if (value > 100)
+			return(false);
+		else if (key == "dep")
+			dep = value;
+		else if (key == "ld")
+			pct_ld = value;
+		else if (key == "st")
+			pct_st = value;
+		else if (key == "br")
+			pct_br = value;
+		else if (key == "fp")
+			pct_fp = value;
+		else if (key == "call")
+			pct_call = value;
+		else if (key == "bias")
+			bias = value;
+		else
+			return(false);
+	}
+
+	return((code_bytes >= 64) && (code_bytes <= (512 << 10)) &&
+	       (data_bytes >= 4096) && (data_bytes <= (1 << 30)) && !(data_bytes & (data_bytes - 1)) &&
+	       (dep >= 1) && (dep <= 9) &&
+	       ((pct_ld + pct_st + pct_br + pct_fp + pct_call) <= 100) &&
+	       !(stride % 8) && (stride < data_bytes));
+}
+
+std::string synth_t::describe() {
+	static const char* addr_name[] = {"stride", "random", "chase"};
+	char buf[256];
+
+	snprintf(buf, sizeof(buf), "seed=%" PRIu64 ",code=%" PRIu64 ",data=%" PRIu64 ",dep=%u,ld=%u,st=%u,br=%u,fp=%u,call=%u,bias=%u,addr=%s,stride=%" PRIu64,
+	         seed, code_bytes, data_bytes, dep, pct_ld, pct_st, pct_br, pct_fp, pct_call, bias, addr_name[addr], stride);
+	return(std::string(buf));
+}
+
+uint64_t synth_t::rng() {
+	return(xorshift(rng_state));
+}
+
+
+/////////////////////////////////////////////////////////////
+// Register allocation.
+/////////////////////////////////////////////////////////////
+
+unsigned int synth_t::int_dst() {
+	unsigned int r = int_pool[int_next++ % INT_POOL];
+
+	int_hist.push_back(r);
+	if (int_hist.size() > SYNTH_HIST)
+		int_hist.erase(int_hist.begin());
+	return(r);
+}
+
+unsigned int synth_t::int_src() {
+	unsigned int d = (1 + rng(2 * dep - 1));
+
+	if (int_hist.size() >= d)
+		return(int_hist[int_hist.size() - d]);
+	return(int_pool[rng(INT_POOL)]);
+}
+
+unsigned int synth_t::fp_dst() {
+	unsigned int r = (fp_next++ % 32);
+
+	fp_hist.push_back(r);
+	if (fp_hist.size() > SYNTH_HIST)
+		fp_hist.erase(fp_hist.begin());
+	return(r);
+}
+
+unsigned int synth_t::fp_src() {
+	unsigned int d = (1 + rng(2 * dep - 1));
+
+	if (fp_hist.size() >= d)
+		return(fp_hist[fp_hist.size() - d]);
+	return(rng(32));
+}
+
+
+/////////////////////////////////////////////////////////////
+// Instructions.
+/////////////////////////////////////////////////////////////
+
+// Start a sequence: it is the target of the branches that skipped enough sequences.
+void synth_t::sequence() {
+	size_t i = 0;
+
+	while (i < fixups.size()) {
+		if (fixups[i].second == 0) {
+			patch(fixups[i].first, code.size());
+			fixups.erase(fixups.begin() + i);
+		}
+		else {
+			fixups[i].second--;
+			i++;
+		}
+	}
+}
+
+void synth_t::patch(size_t at, size_t target) {
+	int32_t off = (4 * ((int32_t)target - (int32_t)at));
+
+	if ((code[at] & 0x7f) == MATCH_JAL)
+		code[at] |= j_imm(off);
+	else
+		code[at] |= b_imm(off);
+}
+
+void synth_t::emit(uint32_t insn) {
+	code.push_back(insn);
+}
+
+void synth_t::emit_alu() {
+	unsigned int rs1 = int_src();
+	unsigned int rs2 = int_src();
+	unsigned int op = rng(16);
+
+	n_alu++;
+	switch (op) {
+		case 0:  emit(r_type(MATCH_MUL, int_dst(), rs1, rs2)); break;
+		case 1:  emit(r_type(MATCH_SUB, int_dst(), rs1, rs2)); break;
+		case 2:  emit(r_type(MATCH_XOR, int_dst(), rs1, rs2)); break;
+		case 3:  emit(r_type(MATCH_OR, int_dst(), rs1, rs2)); break;
+		case 4:  emit(r_type(MATCH_AND, int_dst(), rs1, rs2)); break;
+		case 5:
+		case 6:  emit(i_type(MATCH_SLLI, int_dst(), rs1, 1 + rng(8))); break;
+		case 7:
+		case 8:  emit(i_type(MATCH_SRLI, int_dst(), rs1, 1 + rng(8))); break;
+		case 9:
+		case 10:
+		case 11: emit(i_type(MATCH_ADDI, int_dst(), rs1, (int32_t)rng(2048) - 1024)); break;
+		default: emit(r_type(MATCH_ADD, int_dst(), rs1, rs2)); break;
+	}
+}
+
+void synth_t::emit_fp() {
+	unsigned int rs1 = fp_src();
+	unsigned int rs2 = fp_src();
+
+	n_fp++;
+	switch (rng(4)) {
+		case 0:  emit(r_type(MATCH_FMUL_D, fp_dst(), rs1, rs2)); break;
+		case 1:  emit(r4_type(MATCH_FMADD_D, fp_dst(), rs1, rs2, fp_src())); break;
+		default: emit(r_type(MATCH_FADD_D, fp_dst(), rs1, rs2)); break;
+	}
+}
+
+// Displacements in a window cycle through 0..2040.
+#define NEXT_DISP(o)   (((o) += 8) %= 2048)
+
+void synth_t::emit_load() {
+	n_ld++;
+	switch (addr) {
+		case SYNTH_CHASE:
+			emit(i_type(MATCH_LD, R_CHASE, R_CHASE, 0));
+			break;
+
+		case SYNTH_RANDOM:
+			emit(i_type(MATCH_LD, R_T0, R_A_WIN, (int32_t)a_offset));
+			NEXT_DISP(a_offset);
+			emit(i_type(MATCH_LD, int_dst(), R_T0, 0));
+			n_ld++;
+			break;
+
+		default:
+			// Sometimes read back the last store (store-to-load forwarding).
+			if ((last_store >= 0) && (rng(4) == 0)) {
+				emit(i_type(MATCH_LD, int_dst(), R_B_WIN, (int32_t)last_store));
+			}
+			else {
+				emit(i_type(MATCH_LD, int_dst(), R_A_WIN, (int32_t)a_offset));
+				NEXT_DISP(a_offset);
+			}
+			break;
+	}
+}
+
+void synth_t::emit_store() {
+	unsigned int rs = int_src();
+
+	n_st++;
+	if (addr == SYNTH_RANDOM) {
+		emit(i_type(MATCH_LD, R_T0, R_A_WIN, (int32_t)a_offset));
+		NEXT_DISP(a_offset);
+		emit(r_type(MATCH_ADD, R_T0, R_T0, R_B_DIST));
+		emit(s_type(MATCH_SD, R_T0, rs, 0));
+		n_ld++;
+		n_alu++;
+	}
+	else {
+		emit(s_type(MATCH_SD, R_B_WIN, rs, (int32_t)b_offset));
+		last_store = (int64_t)b_offset;
+		NEXT_DISP(b_offset);
+	}
+}
+
+// A forward branch over 1..4 sequences.
+void synth_t::emit_branch() {
+	unsigned int skip = (1 + rng(4));
+
+	if (rng(8) == 0) {
+		n_jmp++;
+		fixups.push_back(std::make_pair(code.size(), skip));
+		emit(MATCH_JAL);
+	}
+	else if (rng(100) < bias) {
+		// Always or never taken.
+		n_br++;
+		fixups.push_back(std::make_pair(code.size(), skip));
+		emit(r_type(rng(2) ? MATCH_BEQ : MATCH_BNE, 0, 0, 0));
+	}
+	else {
+		// Taken if bit 3 of a random pointer is set.
+		n_br++;
+		n_ld++;
+		n_alu++;
+		emit(i_type(MATCH_LD, R_T0, R_A_WIN, (int32_t)a_offset));
+		NEXT_DISP(a_offset);
+		emit(i_type(MATCH_ANDI, R_T0, R_T0, 8));
+		fixups.push_back(std::make_pair(code.size(), skip));
+		emit(r_type(MATCH_BNE, 0, R_T0, 0));
+	}
+}
+
+void synth_t::emit_call() {
+	n_call++;
+	calls.push_back(std::make_pair(code.size(), rng(SYNTH_FUNCTIONS)));
+	emit(MATCH_JAL | (R_RA << 7));
+}
+
+void synth_t::generate() {
+	size_t body = (code_bytes / 4);
+	size_t function[SYNTH_FUNCTIONS];
+	size_t i;
+
+	rng_state = (seed ? seed : 1);
+	int_next = 0;
+	fp_next = 0;
+	a_offset = 0;
+	b_offset = 0;
+	last_store = -1;
+	n_alu = n_fp = n_ld = n_st = n_br = n_jmp = n_call = 0;
+
+	// Loop body.
+	while (code.size() < body) {
+		unsigned int r = rng(100);
+
+		sequence();
+		if (r < pct_ld)
+			emit_load();
+		else if ((r -= pct_ld) < pct_st)
+			emit_store();
+		else if ((r -= pct_st) < pct_br)
+			emit_branch();
+		else if ((r -= pct_br) < pct_fp)
+			emit_fp();
+		else if ((r -= pct_fp) < pct_call)
+			emit_call();
+		else
+			emit_alu();
+	}
+
+	// Back-edge: the branches still pending land here. Advance the windows and loop.
+	for (i = 0; i < fixups.size(); i++)
+		patch(fixups[i].first, code.size());
+	fixups.clear();
+	emit(r_type(MATCH_ADD, R_OFFSET, R_OFFSET, R_STRIDE));
+	emit(r_type(MATCH_AND, R_OFFSET, R_OFFSET, R_MASK));
+	emit(r_type(MATCH_ADD, R_A_WIN, R_A_BASE, R_OFFSET));
+	emit(r_type(MATCH_ADD, R_B_WIN, R_A_WIN, R_B_DIST));
+	emit(MATCH_JAL);
+	patch(code.size() - 1, 0);
+	n_alu += 4;
+	n_jmp++;
+
+	// Leaf functions.
+	for (i = 0; i < SYNTH_FUNCTIONS; i++) {
+		function[i] = code.size();
+		for (unsigned int j = (2 + rng(6)); j > 0; j--)
+			emit_alu();
+		emit(i_type(MATCH_JALR, 0, R_RA, 0));
+		n_jmp++;
+	}
+	for (i = 0; i < calls.size(); i++)
+		patch(calls[i].first, function[calls[i].second]);
+
+	// Data: region A, then region B.
+	a_base = (((SYNTH_CODE_BASE + (4 * code.size())) + 0xfff) & ~(uint64_t)0xfff);
+	b_base = (a_base + data_bytes + SYNTH_GUARD);
+
+	// Initial registers.
+	for (i = 0; i < 32; i++) {
+		double d = (1.0 + ((double)i / 8.0));
+		init_xpr[i] = 0;
+		memcpy(&init_fpr[i], &d, sizeof(d));
+	}
+	for (i = 0; i < INT_POOL; i++)
+		init_xpr[int_pool[i]] = (rng() >> 16);
+	init_xpr[R_A_BASE] = a_base;
+	init_xpr[R_MASK] = (data_bytes - 8);
+	init_xpr[R_OFFSET] = 0;
+	init_xpr[R_A_WIN] = a_base;
+	init_xpr[R_CHASE] = a_base;
+	init_xpr[R_B_WIN] = b_base;
+	init_xpr[R_B_DIST] = (b_base - a_base);
+	init_xpr[R_STRIDE] = stride;
+
+	fprintf(stderr, "Synthetic program: %lu instructions (loop body %lu), %" PRIu64 " bytes of data\n",
+	        code.size(), body, data_bytes);
+	fprintf(stderr, "...static mix: %" PRIu64 " ALU, %" PRIu64 " FP, %" PRIu64 " loads, %" PRIu64 " stores, %" PRIu64 " branches, %" PRIu64 " jumps, %" PRIu64 " calls\n",
+	        n_alu, n_fp, n_ld, n_st, n_br, n_jmp, n_call);
+	generated = true;
+}
+
+bool synth_t::load(char* mem, size_t memsz) {
+	uint64_t n = (data_bytes / 8);
+	uint64_t* table;
+	uint64_t x = (seed ^ 0x9e3779b97f4a7c15ULL);
+	uint64_t i;
+
+	if (!generated)
+		generate();
+	if ((b_base + data_bytes + SYNTH_GUARD) > memsz)
+		return(false);
+
+	memcpy(mem + SYNTH_CODE_BASE, &code[0], (4 * code.size()));
+
+	// Region A is a table of pointers into itself that forms a single random
+	// cycle (Sattolo's algorithm), so that a chase visits every word. The
+	// guard past the end repeats the start of the table.
+	table = (uint64_t*)(mem + a_base);
+	for (i = 0; i < n; i++)
+		table[i] = i;
+	for (i = (n - 1); i > 0; i--) {
+		uint64_t j = (xorshift(x) % i);
+		uint64_t t = table[i];
+		table[i] = table[j];
+		table[j] = t;
+	}
+	for (i = 0; i < n; i++)
+		table[i] = (a_base + (8 * table[i]));
+	for (i = 0; i < (SYNTH_GUARD / 8); i++)
+		table[n + i] = table[i % n];
+
+	// Region B starts out zero.
+	memset(mem + b_base, 0, (data_bytes + SYNTH_GUARD));
+	return(true);
+}
@@ -0,0 +1,123 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <cstdio>
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/*--------------------------------------------------------------------------*\
+ | synth.h
+ |
+ | Synthetic workloads (--synth): a generated instruction stream runs in
+ | place of a target program, for simulator-speed regression runs and for
+ | stress-testing structure sizes without a cross-compiled benchmark.
+ |
+ | The stream is materialized as a real RV64 program, written with its data
+ | straight into target memory (no ELF, no proxy kernel, no HTIF): a loop
+ | body of 'code' bytes whose instructions are drawn from the configured mix,
+ | followed by a few leaf functions for the calls. Both the functional
+ | simulator and the timing simulator run it from the same initial state, so
+ | the fetch unit, payload, oracle and checker are exercised unchanged.
+ |
+ | Knobs (--synth=<key>=<value>,...):
+ |   seed    generator seed
+ |   code    loop body size in bytes (K/M suffixes): the instruction footprint
+ |   data    data footprint in bytes, a power of 2 (K/M suffixes)
+ |   dep     mean dependence distance: a source is the destination written
+ |           1..2*dep-1 producers earlier (1: serial chains)
+ |   ld, st, br, fp, call
+ |           percentages of loads, stores, conditional branches, FP
+ |           arithmetic and calls; the rest is integer arithmetic
+ |   bias    percentage of branches that always go the same way; the others
+ |           test a data bit and are taken about half the time
+ |   addr    address pattern of loads and stores: stride (a window that moves
+ |           through the data by 'stride' bytes per iteration), random (an
+ |           indirection through a table of random pointers) or chase (loads
+ |           follow a serial pointer chain through the whole data)
+ |   stride  bytes per iteration, a multiple of 8
+\*--------------------------------------------------------------------------*/
+
+#define SYNTH_CODE_BASE        0x10000
+
+class synth_t {
+public:
+	synth_t();
+
+	// Parse a "key=value,..." list of knobs (see above). False if malformed.
+	bool configure(const char* config);
+	std::string describe();
+
+	// Write the program and its data into target memory. False if it does
+	// not fit. The program is generated once, on the first call.
+	bool load(char* mem, size_t memsz);
+
+	// Initial architectural state.
+	uint64_t entry() { return(SYNTH_CODE_BASE); }
+	uint64_t xpr(unsigned int i) { return(init_xpr[i]); }
+	uint64_t fpr(unsigned int i) { return(init_fpr[i]); }
+
+private:
+	typedef enum {SYNTH_STRIDE, SYNTH_RANDOM, SYNTH_CHASE} synth_addr_e;
+
+	// Knobs.
+	uint64_t seed;
+	uint64_t code_bytes;
+	uint64_t data_bytes;
+	unsigned int dep;
+	unsigned int pct_ld, pct_st, pct_br, pct_fp, pct_call;
+	unsigned int bias;
+	synth_addr_e addr;
+	uint64_t stride;
+
+	void generate();
+	uint64_t rng();
+	unsigned int rng(unsigned int n) { return((unsigned int)(rng() % n)); }
+
+	// Register allocation.
+	unsigned int int_dst();
+	unsigned int int_src();
+	unsigned int fp_dst();
+	unsigned int fp_src();
+
+	// Instructions. A sequence is one to three instructions that must run
+	// together (e.g., a table load and the access it feeds): branches skip
+	// whole sequences.
+	void sequence();
+	void patch(size_t at, size_t target);
+	void emit(uint32_t insn);
+	void emit_alu();
+	void emit_fp();
+	void emit_load();
+	void emit_store();
+	void emit_branch();
+	void emit_call();
+
+	bool generated;
+	uint64_t rng_state;
+
+	std::vector<uint32_t> code;      // at SYNTH_CODE_BASE
+	uint64_t a_base;                 // pointer table (region A)
+	uint64_t b_base;                 // store region (region B)
+	uint64_t a_offset;               // next displacement in the region A window
+	uint64_t b_offset;               // ...region B window
+	int64_t last_store;              // displacement of the last region B store, -1: none
+
+	std::vector<unsigned int> int_hist;   // destinations, oldest first
+	std::vector<unsigned int> fp_hist;
+	unsigned int int_next, fp_next;       // round-robin destination allocation
+
+	// Forward branches waiting for their target: (instruction, sequences to skip).
+	std::vector<std::pair<size_t, unsigned int> > fixups;
+	std::vector<std::pair<size_t, unsigned int> > calls;   // (jal instruction, leaf function)
+
+	uint64_t init_xpr[32];
+	uint64_t init_fpr[32];
+
+	// Static mix.
+	uint64_t n_alu, n_fp, n_ld, n_st, n_br, n_jmp, n_call;
+};
+
+extern synth_t* SYNTH;   // NULL: run the target program
+
+#endif //SYNTH_H
@@ -0,0 +1,244 @@
+#include <cinttypes>
+#include <cassert>
+
+#include "processor.h"
+#include "mmu.h"
+#include "decode.h"
+#include "config.h"
+
+#include "CacheClass.h"
+#include "dram.h"
+#include "tlb.h"
+
+
+/////////////////////////////////////////////////////////////
+// A single TLB.
+/////////////////////////////////////////////////////////////
+
+tlb_t::tlb_t(unsigned int entries, unsigned int assoc)
+	: array((entries / assoc), assoc) {
+	assert((assoc > 0) && ((entries % assoc) == 0));
+	accesses = 0;
+	misses = 0;
+}
+
+tlb_t::~tlb_t() {
+}
+
+bool tlb_t::lookup(reg_t vpn, cycle_t& ready) {
+	bool hit;
+	reg_t old_vpn;
+	tlb_entry_t* e = array.lookup(vpn, (tlb_entry_t*) NULL, &hit, &old_vpn, false);
+
+	accesses++;
+	if (!hit) {
+		misses++;
+		return(false);
+	}
+	ready = e->ready;
+	return(true);
+}
+
+void tlb_t::fill(reg_t vpn, cycle_t ready) {
+	bool hit;
+	reg_t old_vpn;
+	tlb_entry_t* e = new tlb_entry_t;
+	e->ready = ready;
+	tlb_entry_t* old = array.lookup(vpn, e, &hit, &old_vpn, true);
+	if (hit) {
+		// Already present (e.g., filled by the other L1 TLB's walk): update in place.
+		old->ready = ready;
+		delete e;
+	}
+	else {
+		delete old;
+	}
+}
+
+bool tlb_t::warm(reg_t vpn) {
+	bool hit;
+	reg_t old_vpn;
+	array.lookup(vpn, (tlb_entry_t*) NULL, &hit, &old_vpn, false);
+	if (!hit)
+		fill(vpn, 0);
+	return(hit);
+}
+
+
+/////////////////////////////////////////////////////////////
+// The TLB hierarchy and page walker.
+/////////////////////////////////////////////////////////////
+
+tlb_hierarchy_t::tlb_hierarchy_t(mmu_t* mmu,
+                                 unsigned int itlb_entries, unsigned int itlb_assoc,
+                                 unsigned int dtlb_entries, unsigned int dtlb_assoc,
+                                 unsigned int stlb_entries, unsigned int stlb_assoc,
+                                 unsigned int stlb_latency,
+                                 unsigned int pwc_entries)
+	: ITLB(itlb_entries, itlb_assoc),
+	  DTLB(dtlb_entries, dtlb_assoc),
+	  STLB(stlb_entries, stlb_assoc) {
+	this->mmu = mmu;
+	this->stlb_latency = stlb_latency;
+
+	// The PWC holds the non-leaf levels.
+	pwc_levels = ((pwc_entries > 0) ? (unsigned int)(LEVELS - 1) : 0);
+	if (pwc_levels > TLB_PWC_LEVELS)
+		pwc_levels = TLB_PWC_LEVELS;
+	for (unsigned int i = 0; i < pwc_levels; i++)
+		PWC[i] = new tlb_array_t(1, pwc_entries);
+
+	L2C = (CacheClass *) NULL;
+	DRAM = (dram_t *) NULL;
+	flat_latency = 0;
+	Tid = 0;
+
+	n_walks = 0;
+	n_walk_cycles = 0;
+	n_pte_reads = 0;
+	n_pwc_hits = 0;
+	n_itlb_stall_cycles = 0;
+	n_dtlb_stall_cycles = 0;
+}
+
+tlb_hierarchy_t::~tlb_hierarchy_t() {
+	for (unsigned int i = 0; i < pwc_levels; i++)
+		delete PWC[i];
+}
+
+void tlb_hierarchy_t::set_memory(CacheClass* L2C, dram_t* DRAM, unsigned int flat_latency, unsigned int Tid) {
+	this->L2C = L2C;
+	this->DRAM = DRAM;
+	this->flat_latency = flat_latency;
+	this->Tid = Tid;
+}
+
+cycle_t tlb_hierarchy_t::translate(cycle_t cycle, reg_t addr, bool fetch) {
+	reg_t vpn = (addr >> PGSHIFT);
+	tlb_t& L1 = (fetch ? ITLB : DTLB);
+	cycle_t ready;
+
+	if (L1.lookup(vpn, ready))
+		return((ready > cycle) ? ready : cycle);
+
+	if (STLB.lookup(vpn, ready)) {
+		if (ready < (cycle + stlb_latency))
+			ready = (cycle + stlb_latency);
+	}
+	else {
+		ready = walk(cycle + stlb_latency, addr);
+		STLB.fill(vpn, ready);
+	}
+	L1.fill(vpn, ready);
+
+	if (fetch)
+		n_itlb_stall_cycles += (ready - cycle);
+	else
+		n_dtlb_stall_cycles += (ready - cycle);
+	return(ready);
+}
+
+void tlb_hierarchy_t::warm(reg_t addr, bool fetch) {
+	reg_t vpn = (addr >> PGSHIFT);
+
+	if ((fetch ? ITLB : DTLB).warm(vpn) || STLB.warm(vpn))
+		return;
+
+	reg_t pte_addr[LEVELS];
+	size_t n = pte_addresses(addr, pte_addr);
+	for (size_t i = 0; i < n; i++) {
+		if (L2C)
+			L2C->Warm(Tid, pte_addr[i], false);
+		if (i < pwc_levels) {
+			bool hit;
+			reg_t old;
+			reg_t key = (addr >> (PGSHIFT + PTIDXBITS * (LEVELS - 1 - i)));
+			PWC[i]->lookup(key, (tlb_entry_t*) NULL, &hit, &old, true);
+		}
+	}
+}
+
+size_t tlb_hierarchy_t::pte_addresses(reg_t addr, reg_t* pte_addr) {
+	size_t n = mmu->walk_trace(addr, pte_addr);
+
+	if (n == 0) {
+		// Translation is off: walk a synthetic radix table. Level i is indexed by the
+		// top (i+1)*PTIDXBITS bits of the VPN.
+		n = LEVELS;
+		for (size_t i = 0; i < n; i++) {
+			reg_t prefix = ((addr >> PGSHIFT) >> (PTIDXBITS * (LEVELS - 1 - i)));
+			pte_addr[i] = TLB_SYNTH_PT_BASE + ((reg_t)i << 36) + prefix * sizeof(pte_t);
+		}
+	}
+	return(n);
+}
+
+cycle_t tlb_hierarchy_t::walk(cycle_t cycle, reg_t addr) {
+	reg_t pte_addr[LEVELS];
+	size_t n = pte_addresses(addr, pte_addr);
+
+	// Skip the levels whose non-leaf entries are in the PWC.
+	size_t start = 0;
+	for (size_t i = pwc_levels; i-- > 0; ) {
+		bool hit;
+		reg_t old;
+		reg_t key = (addr >> (PGSHIFT + PTIDXBITS * (LEVELS - 1 - i)));
+		PWC[i]->lookup(key, (tlb_entry_t*) NULL, &hit, &old, false);
+		if (hit) {
+			start = i + 1;
+			n_pwc_hits++;
+			break;
+		}
+	}
+	if (start > (n - 1))
+		start = (n - 1);
+
+	// Dependent reads, one per level.
+	cycle_t t = cycle;
+	for (size_t i = start; i < n; i++) {
+		t = read_pte(t, pte_addr[i]);
+		if (i < pwc_levels) {
+			bool hit;
+			reg_t old;
+			reg_t key = (addr >> (PGSHIFT + PTIDXBITS * (LEVELS - 1 - i)));
+			PWC[i]->lookup(key, (tlb_entry_t*) NULL, &hit, &old, true);
+		}
+	}
+
+	n_walks++;
+	n_walk_cycles += (t - cycle);
+	return(t);
+}
+
+cycle_t tlb_hierarchy_t::read_pte(cycle_t cycle, reg_t pte_addr) {
+	n_pte_reads++;
+	if (L2C) {
+		bool hit;
+		cycle_t done;
+		while ((done = L2C->Access(Tid, cycle, pte_addr, false, &hit)) == (cycle_t)-1)
+			cycle = L2C->NextFreeMHSR();
+		return(done);
+	}
+	else if (DRAM) {
+		return(DRAM->read(cycle, pte_addr));
+	}
+	else {
+		return(cycle + flat_latency);
+	}
+}
+
+void tlb_hierarchy_t::dump_stats(FILE* fp) {
+	fprintf(fp, "TLB MEASUREMENTS-----------------------------------\n");
+	fprintf(fp, "  ITLB misses      = %" PRIu64 " / %" PRIu64 " (%.2f%%)\n", ITLB.misses, ITLB.accesses,
+	        (ITLB.accesses ? 100.0*(double)ITLB.misses/(double)ITLB.accesses : 0.0));
+	fprintf(fp, "  DTLB misses      = %" PRIu64 " / %" PRIu64 " (%.2f%%)\n", DTLB.misses, DTLB.accesses,
+	        (DTLB.accesses ? 100.0*(double)DTLB.misses/(double)DTLB.accesses : 0.0));
+	fprintf(fp, "  STLB misses      = %" PRIu64 " / %" PRIu64 " (%.2f%%)\n", STLB.misses, STLB.accesses,
+	        (STLB.accesses ? 100.0*(double)STLB.misses/(double)STLB.accesses : 0.0));
+	fprintf(fp, "  page walks       = %" PRIu64 " (avg. %.2f cycles, %.2f PTE reads)\n", n_walks,
+	        (n_walks ? (double)n_walk_cycles/(double)n_walks : 0.0),
+	        (n_walks ? (double)n_pte_reads/(double)n_walks : 0.0));
+	fprintf(fp, "  PWC hits         = %" PRIu64 "\n", n_pwc_hits);
+	fprintf(fp, "  ITLB miss cycles = %" PRIu64 "\n", n_itlb_stall_cycles);
+	fprintf(fp, "  DTLB miss cycles = %" PRIu64 "\n", n_dtlb_stall_cycles);
+}
@@ -0,0 +1,116 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <cstdio>
+#include "decode.h"
+#include "cache.h"
+
+/*--------------------------------------------------------------------------*\
+ | tlb.h
+ |
+ | Timing model of the TLB hierarchy: split L1 TLBs (ITLB, DTLB) backed by a
+ | unified second-level TLB (STLB), and a hardware page table walker with a
+ | page-walk cache (PWC).
+ |
+ | Translation itself is done functionally by mmu_t; this model only charges
+ | its latency. L1 TLB hits are free (overlapped with the cache access). An
+ | STLB hit costs the STLB latency. An STLB miss walks the page table: each
+ | level's PTE is read through the L2 cache (or memory, without an L2), and
+ | the PWC, which holds recently used non-leaf entries, lets the walk skip
+ | the upper levels.
+ |
+ | Walks use the PTE addresses of the real page table (mmu_t::walk_trace()).
+ | When translation is off, they use a synthetic radix page table with the
+ | same geometry, so that TLB reach and walk locality are still modeled.
+ |
+ | Entries are filled when the miss is detected, and remember when their
+ | translation is ready: a hit to an entry that is still being filled waits
+ | for it.
+\*--------------------------------------------------------------------------*/
+
+#define TLB_PWC_LEVELS         4          // max. non-leaf levels held by the PWC
+#define TLB_SYNTH_PT_BASE      (1ULL << 40)   // synthetic page table location
+
+class mmu_t;
+class CacheClass;
+class dram_t;
+
+typedef struct {
+	cycle_t ready;    // cycle when the translation is available
+} tlb_entry_t;
+
+typedef cache<tlb_entry_t> tlb_array_t;
+
+class tlb_t {
+public:
+	tlb_t(unsigned int entries, unsigned int assoc);
+	~tlb_t();
+
+	// Returns true on a hit, and the cycle the entry's translation is ready.
+	bool lookup(reg_t vpn, cycle_t& ready);
+	void fill(reg_t vpn, cycle_t ready);
+
+	// Functional warming: returns true on a hit, else fills the entry (ready at once). No stats.
+	bool warm(reg_t vpn);
+
+	uint64_t accesses;
+	uint64_t misses;
+
+private:
+	tlb_array_t array;
+};
+
+class tlb_hierarchy_t {
+public:
+	tlb_hierarchy_t(mmu_t* mmu,
+	                unsigned int itlb_entries, unsigned int itlb_assoc,
+	                unsigned int dtlb_entries, unsigned int dtlb_assoc,
+	                unsigned int stlb_entries, unsigned int stlb_assoc,
+	                unsigned int stlb_latency,
+	                unsigned int pwc_entries);
+	~tlb_hierarchy_t();
+
+	// Attach the memory hierarchy that page walks read (either may be NULL).
+	// Tid: thread id of the walks' L2$ accesses (see smt.h).
+	void set_memory(CacheClass* L2C, dram_t* DRAM, unsigned int flat_latency, unsigned int Tid);
+
+	// Returns the cycle when the translation of addr is available
+	// (== cycle on an L1 TLB hit).
+	cycle_t translate(cycle_t cycle, reg_t addr, bool fetch);
+
+	// Functional warming during fast-skip: the TLBs, PWC and the L2$ lines
+	// of the PTEs are updated as by translate(), without timing or stats.
+	void warm(reg_t addr, bool fetch);
+
+	void dump_stats(FILE* fp);
+
+private:
+	size_t pte_addresses(reg_t addr, reg_t* pte_addr);
+	cycle_t walk(cycle_t cycle, reg_t addr);
+	cycle_t read_pte(cycle_t cycle, reg_t pte_addr);
+
+	mmu_t* mmu;
+	tlb_t ITLB;
+	tlb_t DTLB;
+	tlb_t STLB;
+	unsigned int stlb_latency;
+
+	// PWC: one small fully-associative array per non-leaf level.
+	unsigned int pwc_levels;
+	tlb_array_t* PWC[TLB_PWC_LEVELS];
+
+	CacheClass* L2C;
+	dram_t* DRAM;
+	unsigned int flat_latency;
+	unsigned int Tid;
+
+	// Stats.
+	uint64_t n_walks;
+	uint64_t n_walk_cycles;
+	uint64_t n_pte_reads;
+	uint64_t n_pwc_hits;
+	uint64_t n_itlb_stall_cycles;
+	uint64_t n_dtlb_stall_cycles;
+};
+
+#endif //TLB_H
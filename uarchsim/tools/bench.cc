@@ -0,0 +1,517 @@
+// Microbenchmarks of the simulator's hot structures, in isolation.
+//
+// usage: 721sim-bench [--json] [-n <ops>] [-r <repeats>] [-s <seed>] [<benchmark>...]
+//
+// Each benchmark drives one structure with a synthetic, reproducible input
+// (a fixed-seed generator) and reports its host time per operation: the best
+// of the repeats, so that a change to a structure can be measured without a
+// workload. The structures are built with the default configuration
+// (parameters.cc), the same as an unconfigured 721sim.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+#include "sim.h"
+#include "pipeline.h"
+
+// xorshift64*: the same sequence on every host.
+static uint64_t rng_state;
+
+static inline uint64_t rng()
+{
+  rng_state ^= (rng_state >> 12);
+  rng_state ^= (rng_state << 25);
+  rng_state ^= (rng_state >> 27);
+  return (rng_state * 0x2545F4914F6CDD1DULL);
+}
+
+static inline uint64_t rng(uint64_t n) { return (rng() % n); }
+
+static inline double now_ns()
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Results are folded into this, so that the compiler keeps the work.
+static volatile uint64_t sink;
+
+// The pipeline whose structures (IQ, LSU, Execution Lanes, stats) are benchmarked.
+static pipeline_t* proc;
+
+// Access to the pipeline's structures (a friend of pipeline_t).
+class bench_t {
+public:
+  static issue_queue& IQ() { return proc->IQ; }
+  static lane* Execution_Lanes() { return proc->Execution_Lanes; }
+  static lsu& LSU() { return proc->LSU; }
+  static payload& PAY() { return proc->PAY; }
+};
+
+
+/////////////////////////////////////////////////////////////
+// Benchmarks. Each one performs 'n' operations and returns
+// the host time they took, excluding setup.
+/////////////////////////////////////////////////////////////
+
+// Rename, complete and retire instructions. The renamer takes a checkpoint
+// every Active List / checkpoints instructions, retires the oldest checkpoint
+// when it runs out of registers or checkpoints, and rolls back to a random
+// live checkpoint every 64 instructions or so. With 'elim', one instruction
+// in four is an eliminated move (--elim=1), which shares its source's
+// physical register.
+// One operation: renaming one instruction (with its share of the above).
+static double renamer_loop(uint64_t n, bool elim)
+{
+  uint64_t n_log = (NXPR + NFPR);
+  uint64_t n_phys = (AUTO_PRF_SIZE ? (n_log + ACTIVE_LIST_SIZE) : PRF_SIZE);
+  uint64_t interval = (ACTIVE_LIST_SIZE / NUM_CHECKPOINTS);
+  renamer& ren = *new renamer(n_log, n_phys, NUM_CHECKPOINTS, ACTIVE_LIST_SIZE);   // not deleted: ~renamer() is not defined
+  std::deque<uint64_t> live(1, 0);   // checkpoints, oldest first
+  uint64_t since = 0;                // instructions since the last checkpoint
+  uint64_t chk = 0;
+  uint64_t id, loads, stores, branches;
+  bool amo, csr, exception, val_misp;
+
+  // Retire the oldest checkpoint (its instructions are complete).
+  auto retire = [&]() {
+    bool ok = ren.precommit(id, loads, stores, branches, amo, csr, exception, val_misp);
+    assert(ok && (id == live.front()));
+    (void)ok;
+    for (uint64_t r = 0; r < n_log; r++)
+      ren.commit(r);
+    ren.free_checkpoint();
+    live.pop_front();
+  };
+
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; i++) {
+    if ((live.size() > 2) && (rng(64) == 0)) {
+      uint64_t k = rng(live.size() - 1);
+      ren.rollback(live[k], true, loads, stores, branches);
+      live.resize(k + 2);
+      since = 0;
+    }
+    if (since >= interval) {
+      if (ren.stall_checkpoint(1))
+        retire();
+      ren.checkpoint();
+      live.push_back((live.back() + 1) % NUM_CHECKPOINTS);
+      since = 0;
+    }
+    if (elim && (rng(4) == 0)) {
+      chk += ren.rename_move(1 + rng(n_log - 1), rng(n_log));
+      id = ren.get_checkpoint_id(false, false, false, false, false);
+      ren.set_complete(id);
+      since++;
+      continue;
+    }
+    if (ren.stall_reg(1))
+      retire();
+
+    uint64_t a = ren.rename_rsrc(rng(n_log));
+    uint64_t b = ren.rename_rsrc(rng(n_log));
+    uint64_t d = ren.rename_rdst(1 + rng(n_log - 1));
+    id = ren.get_checkpoint_id(false, false, false, false, false);
+    ren.write(d, ren.read(a) + ren.read(b) + i);
+    ren.set_ready(d);
+    ren.set_complete(id);
+    chk += d;
+    since++;
+  }
+  double t1 = now_ns();
+  sink += chk;
+  return (t1 - t0);
+}
+
+static double bench_renamer(uint64_t n) { return renamer_loop(n, false); }
+static double bench_renamer_elim(uint64_t n) { return renamer_loop(n, true); }
+
+// Dispatch a dependent instruction stream into the Issue Queue, select and
+// issue it to the Execution Lanes, and wake up the issued instructions'
+// consumers. Each instruction has up to two producers among the 16 before it.
+// The IQ is drained at the end (its flush() would release the instructions'
+// registers in the pipeline's renamer).
+// One operation: one instruction issued.
+static double bench_issue_queue(uint64_t n)
+{
+  const unsigned int tags = 4096;
+  std::vector<bool> woken(tags, false);
+  unsigned int lanes = ((1U << ISSUE_WIDTH) - 1);
+  uint64_t next = 0, issued = 0;
+
+  double t0 = now_ns();
+  while (issued < n) {
+    for (unsigned int w = 0; (w < DISPATCH_WIDTH) && (next < n) && !bench_t::IQ().stall(1); w++, next++) {
+      unsigned int tag = (next % tags);
+      uint64_t da = (1 + rng(16)), db = (1 + rng(16));
+      bool a = ((next >= da) && (rng(4) != 0));
+      bool b = ((next >= db) && (rng(2) != 0));
+      unsigned int a_tag = ((next - da) % tags), b_tag = ((next - db) % tags);
+      woken[tag] = false;
+      bench_t::IQ().dispatch(tag, 0, lanes,
+                        a, (a ? (bool)woken[a_tag] : false), a_tag,
+                        b, (b ? (bool)woken[b_tag] : false), b_tag,
+                        false, false, 0);
+    }
+    unsigned int sel = bench_t::IQ().select_and_issue(ISSUE_WIDTH, bench_t::Execution_Lanes(), 0);
+    for (unsigned int l = 0; l < ISSUE_WIDTH; l++) {
+      if (sel & (1U << l)) {
+        unsigned int tag = bench_t::Execution_Lanes()[l].rr.index;
+        bench_t::Execution_Lanes()[l].rr.valid = false;
+        bench_t::IQ().wakeup(tag);
+        woken[tag] = true;
+        issued++;
+      }
+    }
+  }
+  double t1 = now_ns();
+  sink += next;
+  return (t1 - t0);
+}
+
+// Groups of one store and three loads through the LSU, keeping the LQ and SQ
+// as full as they allow. A group's first load reads the store's address after
+// it (store-load forwarding), its second reads another address (the D$), and
+// its third, one time in eight, reads the store's address before the store's
+// address is known (it stalls, and is replayed by load_unstall()). Addresses
+// are in a 64 KB region of the target memory.
+// One operation: one load or store, from dispatch to commit.
+static double bench_lsu(uint64_t n)
+{
+  unsigned int dummy;
+  bool dummy_phase;
+  unsigned int pay = 0;
+  uint64_t groups = 0, committed = 0;
+  reg_t value;
+  cycle_t cycle = 0;
+
+  auto new_pay = [&]() {
+    pay = ((pay + 1) % 256);
+    bench_t::PAY().buf[pay].pc = (0x1000 + 4 * pay);
+    bench_t::PAY().buf[pay].good_instruction = false;
+    bench_t::PAY().buf[pay].AL_index = 0;
+    bench_t::PAY().buf[pay].chkpt_id = 0;
+    return pay;
+  };
+
+  double t0 = now_ns();
+  while (committed < n) {
+    while ((bench_t::LSU().stall(3, 1) || (committed + 4 * groups >= n)) && (groups > 0)) {
+      bench_t::LSU().commit(false, false);
+      for (unsigned int l = 0; l < 3; l++)
+        bench_t::LSU().commit(true, false);
+      groups--;
+      committed += 4;
+    }
+
+    reg_t st = (0x10000 + 8 * rng(8192));
+    reg_t ld = (0x10000 + 8 * rng(8192));
+    bool early = (rng(8) == 0);
+    unsigned int s_sq, s_lq, l_lq[3], l_sq[3];
+    bool s_lq_phase, l_lq_phase[3], l_sq_phase[3];
+
+    bench_t::LSU().dispatch(false, 8, false, false, false, false, new_pay(), s_lq, s_lq_phase, s_sq, dummy_phase);
+    for (unsigned int l = 0; l < 3; l++)
+      bench_t::LSU().dispatch(true, 8, false, false, false, false, new_pay(), l_lq[l], l_lq_phase[l], l_sq[l], l_sq_phase[l]);
+
+    if (early)
+      bench_t::LSU().load_addr(cycle, st, l_lq[2], l_lq_phase[2], l_sq[2], l_sq_phase[2], value);
+    bench_t::LSU().store_addr(cycle, st, s_sq, s_lq, s_lq_phase);
+    bench_t::LSU().store_value(s_sq, st);
+    bench_t::LSU().load_addr(cycle, st, l_lq[0], l_lq_phase[0], l_sq[0], l_sq_phase[0], value);
+    bench_t::LSU().load_addr(cycle, ld, l_lq[1], l_lq_phase[1], l_sq[1], l_sq_phase[1], value);
+    if (!early)
+      bench_t::LSU().load_addr(cycle, ld + 8, l_lq[2], l_lq_phase[2], l_sq[2], l_sq_phase[2], value);
+    sink += value;
+
+    // Loads that missed or stalled complete in a later cycle.
+    cycle++;
+    while (bench_t::LSU().load_unstall(cycle, dummy, value))
+      ;
+    groups++;
+  }
+  double t1 = now_ns();
+  return (t1 - t0);
+}
+
+// The generic cache<T> (the TLBs' and other tag stores'): lookups of 4K ids,
+// 3/4 of them among 256 hot ids, replacing on a miss.
+// One operation: one lookup.
+static double bench_cache_lookup(uint64_t n)
+{
+  cache<uint64_t> c(256, 4);
+  std::vector<uint64_t> contents(1);
+  bool hit;
+  reg_t old_id;
+  uint64_t hits = 0;
+
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; i++) {
+    reg_t id = ((rng(4) != 0) ? rng(256) : rng(4096));
+    c.lookup(id, &contents[0], &hit, &old_id, true);
+    hits += hit;
+  }
+  double t1 = now_ns();
+  sink += hits;
+  return (t1 - t0);
+}
+
+// CacheClass::Access() of an L1 D$ and an L2 with the configured geometries,
+// one access per cycle: 4/5 of them in a 16 KB hot region, the rest anywhere
+// in 64 MB; one in four is a store.
+// One operation: one access.
+static double bench_cacheclass(uint64_t n)
+{
+  CacheClass l2(L2_SETS, L2_ASSOC, L2_LINE_SIZE, L2_HIT_LATENCY, L2_MISS_LATENCY,
+                L2_NUM_MHSRs, L2_MISS_SRV_PORTS, L2_MISS_SRV_LATENCY, proc, "bench_l2");
+  CacheClass l1(L1_DC_SETS, L1_DC_ASSOC, L1_DC_LINE_SIZE, L1_DC_HIT_LATENCY, L1_DC_MISS_LATENCY,
+                L1_DC_NUM_MHSRs, L1_DC_MISS_SRV_PORTS, L1_DC_MISS_SRV_LATENCY, proc, "bench_l1", &l2);
+  cycle_t cycle = 0;
+  uint64_t done = 0;
+  bool hit;
+
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; i++) {
+    reg_t addr = ((rng(5) != 0) ? (8 * rng(2048)) : (8 * rng(8 << 20)));
+    done += l1.Access(0, cycle++, addr, (rng(4) == 0), &hit);
+  }
+  double t1 = now_ns();
+  sink += done;
+  return (t1 - t0);
+}
+
+// btb_t::lookup() of fetch bundles in a 256 KB text segment whose BTB holds
+// 4K branches: conditional branches, calls and returns (8:1:1).
+// One operation: one fetch bundle.
+static double bench_btb(uint64_t n)
+{
+  btb_t btb(BTB_ENTRIES, FETCH_WIDTH, BTB_ASSOC, COND_BRANCH_PRED_PER_CYCLE);
+  std::vector<fetch_bundle_t> bundle(FETCH_WIDTH);
+  spec_update_t update;
+  const uint64_t text = 0x10000, text_insn = (1 << 16);
+
+  std::set<uint64_t> branches;
+  while (branches.size() < 4096) {
+    uint64_t pc = (text + 4 * rng(text_insn));
+    if (!branches.insert(pc).second)
+      continue;
+    uint64_t kind = rng(10);
+    insn_t insn((kind < 8) ? 0x00208863 :      // beq x1, x2, +16
+                (kind == 8) ? 0x100000ef :     // jal x1, +256
+                0x00008067);                   // jalr x0, 0(x1)
+    btb.update(pc, 0, insn);
+  }
+
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; i++) {
+    uint64_t pc = (text + 4 * rng(text_insn));
+    btb.lookup(pc, rng(), 0x20000, 0x30000, &bundle[0], &update);
+    sink += update.next_pc;
+  }
+  double t1 = now_ns();
+  return (t1 - t0);
+}
+
+// gshare_index_t: index the predictor and shift the outcome into the BHR.
+// One operation: one conditional branch.
+static double bench_gshare(uint64_t n)
+{
+  gshare_index_t g(CBP_PC_LENGTH, CBP_BHR_LENGTH);
+  uint64_t sum = 0;
+
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; i++) {
+    sum += g.index(0x10000 + 4 * (i & 0xfff));
+    g.update_bhr((rng() & 3) != 0);
+  }
+  double t1 = now_ns();
+  sink += sum;
+  return (t1 - t0);
+}
+
+// bq_t: push branches, pop the oldest when full, and roll back to a random
+// outstanding branch one time in 32.
+// One operation: one push (with its share of pops and rollbacks).
+static double bench_bq(uint64_t n)
+{
+  bq_t bq(BQ_SIZE);
+  std::deque<std::pair<uint64_t, bool> > out;   // outstanding branches, oldest first
+  uint64_t tag;
+  bool phase;
+
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; i++) {
+    if (out.size() == BQ_SIZE) {
+      bq.pop(tag, phase);
+      out.pop_front();
+    }
+    bq.push(tag, phase);
+    out.push_back(std::make_pair(tag, phase));
+    if ((out.size() > 1) && (rng(32) == 0)) {
+      uint64_t k = rng(out.size());
+      bq.rollback(out[k].first, out[k].second, false);
+      out.resize(k + 1);
+    }
+  }
+  double t1 = now_ns();
+  sink += out.size();
+  return (t1 - t0);
+}
+
+// stats_t::update_counter() as the pipeline calls it: a mix of counters that
+// are registered and (like most inc_counter() calls) ones that are not.
+// One operation: one update.
+static double bench_stats(uint64_t n)
+{
+  static const char* names[] = {
+    "cycle_count", "commit_count", "wakeup_cam_read_count", "issued_inst_count",
+    "ld_vio_count", "spec_load_count", "dcache_access_count", "rename_count"
+  };
+  stats_t* stats = proc->get_stats();
+
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; i++)
+    stats->update_counter(names[i & 7]);
+  double t1 = now_ns();
+  sink += stats->get_counter("cycle_count");
+  return (t1 - t0);
+}
+
+// debug_buffer_t: fill it with instructions (as the functional simulator
+// does, without one) and pop them (as retirement does).
+// One operation: one instruction pushed and popped.
+static double bench_debug_buffer(uint64_t n)
+{
+  debug_buffer_t db(256);
+  reg_t pc = 0x10000;
+  insn_t add(0x002081b3);   // add x3, x1, x2
+
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; ) {
+    while (db.hungry()) {
+      db.start();
+      db.push_instr_actual(add, 0, 1, pc, pc + 4, 0, 0);
+      db.push_operand_actual(1, RSRC1_OPERAND, i, pc);
+      db.push_operand_actual(2, RSRC2_OPERAND, i, pc);
+      db.push_operand_actual(3, RDST_OPERAND, i, pc);
+      pc += 4;
+    }
+    while (!db.empty() && (i < n)) {
+      sink += db.pop(db.first(db.head_pc()))->a_rdst[0].value;
+      i++;
+    }
+  }
+  double t1 = now_ns();
+  return (t1 - t0);
+}
+
+
+typedef struct benchmark {
+  const char* name;
+  double (*run)(uint64_t n);
+} benchmark_t;
+
+static const benchmark_t benchmarks[] = {
+  { "renamer",      bench_renamer },
+  { "renamer_elim", bench_renamer_elim },
+  { "issue_queue",  bench_issue_queue },
+  { "lsu",          bench_lsu },
+  { "cache_lookup", bench_cache_lookup },
+  { "cacheclass",   bench_cacheclass },
+  { "btb",          bench_btb },
+  { "gshare",       bench_gshare },
+  { "bq",           bench_bq },
+  { "stats",        bench_stats },
+  { "debug_buffer", bench_debug_buffer },
+};
+static const unsigned int n_benchmarks = (sizeof(benchmarks) / sizeof(benchmarks[0]));
+
+static void usage()
+{
+  fprintf(stderr, "usage: 721sim-bench [--json] [-n <ops>] [-r <repeats>] [-s <seed>] [<benchmark>...]\n");
+  fprintf(stderr, "  Runs each benchmark (default: all) <repeats> times (default: 5) on <ops> operations\n");
+  fprintf(stderr, "  (default: 1000000) and prints one row (CSV, default) or object (JSON) per benchmark:\n");
+  fprintf(stderr, "  benchmark, ops, ns_per_op, ops_per_s, from its best repeat.\n");
+  fprintf(stderr, "  Benchmarks:");
+  for (unsigned int b = 0; b < n_benchmarks; b++)
+    fprintf(stderr, " %s", benchmarks[b].name);
+  fprintf(stderr, "\n");
+  exit(-1);
+}
+
+int main(int argc, char** argv)
+{
+  bool json = false;
+  uint64_t ops = 1000000;
+  unsigned int repeats = 5;
+  uint64_t seed = 1;
+  std::vector<const benchmark_t*> run;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--json"))
+      json = true;
+    else if (!strcmp(argv[i], "--csv"))
+      json = false;
+    else if (!strcmp(argv[i], "-n") && (i + 1 < argc))
+      ops = strtoull(argv[++i], NULL, 0);
+    else if (!strcmp(argv[i], "-r") && (i + 1 < argc))
+      repeats = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-s") && (i + 1 < argc))
+      seed = strtoull(argv[++i], NULL, 0);
+    else {
+      unsigned int b;
+      for (b = 0; (b < n_benchmarks) && strcmp(argv[i], benchmarks[b].name); b++)
+        ;
+      if (b == n_benchmarks)
+        usage();
+      run.push_back(&benchmarks[b]);
+    }
+  }
+  if ((ops == 0) || (repeats == 0) || (seed == 0))
+    usage();
+  if (run.empty()) {
+    for (unsigned int b = 0; b < n_benchmarks; b++)
+      run.push_back(&benchmarks[b]);
+  }
+
+  // A timing simulator with no program, for the structures that need their
+  // pipeline. It is never run, and its statistics are not wanted.
+  std::vector<std::string> args;
+  sim_t* sim = new sim_t(1, 64, args, MICRO_SIM);
+  proc = (pipeline_t*)sim->get_core(0);
+  proc->reset(false);   // boot state (virtual memory off), for the LSU's memory accesses
+  unlink(proc->stats_file.c_str());
+
+  if (json)
+    printf("[\n");
+  else
+    printf("benchmark,ops,ns_per_op,ops_per_s\n");
+  for (unsigned int i = 0; i < run.size(); i++) {
+    double best = 0.0;
+    for (unsigned int r = 0; r < repeats; r++) {
+      rng_state = seed;
+      double t = run[i]->run(ops);
+      if ((r == 0) || (t < best))
+        best = t;
+    }
+    double ns_per_op = (best / (double)ops);
+    double ops_per_s = ((best > 0.0) ? (1e9 * (double)ops / best) : 0.0);
+    if (json)
+      printf("  {\"benchmark\": \"%s\", \"ops\": %" PRIu64 ", \"ns_per_op\": %.3f, \"ops_per_s\": %.0f}%s\n",
+             run[i]->name, ops, ns_per_op, ops_per_s, ((i + 1 < run.size()) ? "," : ""));
+    else
+      printf("%s,%" PRIu64 ",%.3f,%.0f\n", run[i]->name, ops, ns_per_op, ops_per_s);
+    fflush(stdout);
+  }
+  if (json)
+    printf("]\n");
+
+  // The simulator is not deleted: its destructor would write statistics.
+  return 0;
+}
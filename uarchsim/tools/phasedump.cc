@@ -0,0 +1,136 @@
+// Renders a binary phase-statistics stream (--phasestats=bin) as CSV or JSON.
+//
+// usage: 721sim-phasedump [--json] <phase.bin>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "phase_stream.h"
+
+typedef struct phase_rate {
+  std::string name;
+  uint32_t numerator;
+  uint32_t denominator;
+  double multiplier;
+} phase_rate_t;
+
+static void usage()
+{
+  fprintf(stderr, "usage: 721sim-phasedump [--json] <phase.bin>\n");
+  fprintf(stderr, "  Prints one row (CSV, default) or object (JSON) per phase: phase_id, the\n");
+  fprintf(stderr, "  phase counts of all counters, and the phase rates computed from them.\n");
+  exit(-1);
+}
+
+static bool read_name(FILE* fp, std::string& name)
+{
+  uint16_t len;
+  if (fread(&len, sizeof(len), 1, fp) != 1)
+    return false;
+  name.resize(len);
+  return ((len == 0) || (fread(&name[0], 1, len, fp) == len));
+}
+
+int main(int argc, char** argv)
+{
+  bool json = false;
+  const char* file = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--json"))
+      json = true;
+    else if (!strcmp(argv[i], "--csv"))
+      json = false;
+    else if (!file)
+      file = argv[i];
+    else
+      usage();
+  }
+  if (!file)
+    usage();
+
+  FILE* fp = fopen(file, "rb");
+  if (!fp) {
+    fprintf(stderr, "Could not open %s\n", file);
+    exit(-1);
+  }
+
+  phase_stream_header_t header;
+  if ((fread(&header, sizeof(header), 1, fp) != 1) || (header.magic != PHASE_STREAM_MAGIC)) {
+    fprintf(stderr, "%s is not a phase statistics stream\n", file);
+    exit(-1);
+  }
+  if (header.version != PHASE_STREAM_VERSION) {
+    fprintf(stderr, "%s: unsupported version %u (expected %u)\n", file, header.version, PHASE_STREAM_VERSION);
+    exit(-1);
+  }
+
+  // Schema.
+  std::vector<std::string> counters(header.num_counters);
+  std::vector<phase_rate_t> rates(header.num_rates);
+  bool ok = true;
+  for (uint32_t i = 0; ok && (i < header.num_counters); i++)
+    ok = read_name(fp, counters[i]);
+  for (uint32_t i = 0; ok && (i < header.num_rates); i++) {
+    ok = read_name(fp, rates[i].name) &&
+         (fread(&rates[i].numerator, sizeof(uint32_t), 1, fp) == 1) &&
+         (fread(&rates[i].denominator, sizeof(uint32_t), 1, fp) == 1) &&
+         (fread(&rates[i].multiplier, sizeof(double), 1, fp) == 1) &&
+         (rates[i].numerator < header.num_counters) &&
+         (rates[i].denominator < header.num_counters);
+  }
+  if (!ok) {
+    fprintf(stderr, "%s: truncated or corrupt header\n", file);
+    exit(-1);
+  }
+
+  // Records.
+  if (json)
+    printf("{\"phase_interval\": %" PRIu64 ", \"phases\": [", header.phase_interval);
+  else {
+    printf("phase_id");
+    for (uint32_t i = 0; i < header.num_counters; i++)
+      printf(",%s", counters[i].c_str());
+    for (uint32_t i = 0; i < header.num_rates; i++)
+      printf(",%s", rates[i].name.c_str());
+    printf("\n");
+  }
+
+  std::vector<uint64_t> record(1 + header.num_counters);
+  uint64_t num_records = 0;
+  while (fread(record.data(), sizeof(uint64_t), record.size(), fp) == record.size()) {
+    const uint64_t* count = &record[1];
+
+    if (json)
+      printf("%s\n  {\"phase_id\": %" PRIu64, (num_records ? "," : ""), record[0]);
+    else
+      printf("%" PRIu64, record[0]);
+
+    for (uint32_t i = 0; i < header.num_counters; i++) {
+      if (json)
+        printf(", \"%s\": %" PRIu64, counters[i].c_str(), count[i]);
+      else
+        printf(",%" PRIu64, count[i]);
+    }
+
+    for (uint32_t i = 0; i < header.num_rates; i++) {
+      uint64_t denominator = count[rates[i].denominator];
+      double rate = (denominator ? (rates[i].multiplier * (double)count[rates[i].numerator] / (double)denominator) : 0.0);
+      if (json)
+        printf(", \"%s\": %.6f", rates[i].name.c_str(), rate);
+      else
+        printf(",%.6f", rate);
+    }
+
+    printf(json ? "}" : "\n");
+    num_records++;
+  }
+
+  if (json)
+    printf("\n]}\n");
+
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,299 @@
+#include <cassert>
+#include <cstdlib>
+#include <zlib.h>
+
+#include "trace_file.h"
+#include "processor.h"
+
+
+/////////////////////////////////////////////////////////////
+// Writer.
+/////////////////////////////////////////////////////////////
+
+trace_writer_t::trace_writer_t(const char* file, bool state) {
+	uint64_t magic = TRACE_MAGIC;
+	uint32_t version = TRACE_VERSION;
+	uint32_t flags = (state ? TRACE_HAS_STATE : 0);
+
+	this->file = file;
+	this->state = state;
+	fp = fopen(file, "wb");
+	if (!fp) {
+		fprintf(stderr, "Cannot create the trace file %s\n", file);
+		exit(-1);
+	}
+	fwrite(&magic, sizeof(magic), 1, fp);
+	fwrite(&version, sizeof(version), 1, fp);
+	fwrite(&flags, sizeof(flags), 1, fp);
+
+	block_records = 0;
+	next_pc = 0;
+	addr = 0;
+	n_records = 0;
+	n_raw_bytes = 0;
+	n_file_bytes = (sizeof(magic) + sizeof(version) + sizeof(flags));
+}
+
+trace_writer_t::~trace_writer_t() {
+	uint32_t end = 0;
+
+	write_block();
+	fwrite(&end, sizeof(end), 1, fp);
+	n_file_bytes += sizeof(end);
+	fclose(fp);
+
+	fprintf(stderr, "Trace %s: %" PRIu64 " instructions, %" PRIu64 " bytes (%.2f bytes/instruction, compressed %.1fx)\n",
+	        file.c_str(), n_records, n_file_bytes,
+	        (n_records ? ((double)n_file_bytes / (double)n_records) : 0.0),
+	        (n_file_bytes ? ((double)n_raw_bytes / (double)n_file_bytes) : 0.0));
+}
+
+void trace_writer_t::put(uint64_t value, unsigned int bytes) {
+	for (unsigned int i = 0; i < bytes; i++) {
+		raw.push_back((uint8_t)value);
+		value >>= 8;
+	}
+}
+
+// Zigzag, then 7 bits per byte: small deltas of either sign take one byte.
+void trace_writer_t::put_varint(int64_t value) {
+	uint64_t v = (((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+	while (v >= 0x80) {
+		raw.push_back((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	raw.push_back((uint8_t)v);
+}
+
+void trace_writer_t::write(db_t* e) {
+	uint8_t flags = 0;
+
+	if (e->a_exception)
+		flags |= TRACE_EXCEPTION;
+	if (e->a_next_pc != (e->a_pc + 4))
+		flags |= TRACE_JUMP;
+	if (e->a_addr != addr)
+		flags |= TRACE_ADDR;
+	for (unsigned int i = 0; i < 3; i++) {
+		if (e->a_rsrc[i].valid)
+			flags |= TRACE_RSRC(i);
+	}
+	if (e->a_num_rdst && e->a_rdst[0].valid)
+		flags |= TRACE_RDST;
+	if (state)
+		flags |= TRACE_STATE;
+
+	raw.push_back(flags);
+	put_varint((int64_t)(e->a_pc - next_pc));
+	put(e->a_inst.bits(), 4);
+	if (flags & TRACE_JUMP)
+		put_varint((int64_t)(e->a_next_pc - e->a_pc));
+	if (flags & TRACE_ADDR)
+		put_varint((int64_t)(e->a_addr - addr));
+	for (unsigned int i = 0; i < 3; i++) {
+		if (flags & TRACE_RSRC(i)) {
+			put(e->a_rsrc[i].n, 1);
+			put(e->a_rsrc[i].value, 8);
+		}
+	}
+	if (flags & TRACE_RDST) {
+		put(e->a_rdst[0].n, 1);
+		put(e->a_rdst[0].value, 8);
+	}
+	if (flags & TRACE_STATE) {
+		put(e->a_state->badvaddr, 8);
+		put(e->a_state->tohost, 8);
+		put(e->a_state->fromhost, 8);
+		put(e->a_state->count, 8);
+		put(e->a_state->sr, 8);
+		put(e->a_state->fflags, 8);
+		put(e->a_state->frm, 8);
+	}
+
+	next_pc = e->a_next_pc;
+	addr = e->a_addr;
+	n_records++;
+	if (++block_records == TRACE_BLOCK_RECORDS)
+		write_block();
+}
+
+void trace_writer_t::write_block() {
+	uint32_t header[3];
+	uLongf z_bytes;
+
+	if (block_records == 0)
+		return;
+
+	z.resize(compressBound(raw.size()));
+	z_bytes = z.size();
+	if (compress2(&z[0], &z_bytes, &raw[0], raw.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+		fprintf(stderr, "Cannot compress a block of the trace file %s\n", file.c_str());
+		exit(-1);
+	}
+
+	header[0] = block_records;
+	header[1] = raw.size();
+	header[2] = z_bytes;
+	if ((fwrite(header, sizeof(header), 1, fp) != 1) || (fwrite(&z[0], 1, z_bytes, fp) != z_bytes)) {
+		fprintf(stderr, "Cannot write the trace file %s\n", file.c_str());
+		exit(-1);
+	}
+	n_raw_bytes += raw.size();
+	n_file_bytes += (sizeof(header) + z_bytes);
+
+	// The next block starts over.
+	raw.clear();
+	block_records = 0;
+	next_pc = 0;
+	addr = 0;
+}
+
+
+/////////////////////////////////////////////////////////////
+// Reader.
+/////////////////////////////////////////////////////////////
+
+trace_reader_t::trace_reader_t(const char* file) {
+	uint64_t magic;
+	uint32_t version, flags;
+
+	this->file = file;
+	fp = fopen(file, "rb");
+	if (!fp) {
+		fprintf(stderr, "Cannot open the trace file %s\n", file);
+		exit(-1);
+	}
+	if ((fread(&magic, sizeof(magic), 1, fp) != 1) || (magic != TRACE_MAGIC) ||
+	    (fread(&version, sizeof(version), 1, fp) != 1) || (version != TRACE_VERSION) ||
+	    (fread(&flags, sizeof(flags), 1, fp) != 1)) {
+		fprintf(stderr, "%s is not a version %u trace file\n", file, TRACE_VERSION);
+		exit(-1);
+	}
+	state = ((flags & TRACE_HAS_STATE) != 0);
+	offset = ftell(fp);
+	done = false;
+
+	pos = 0;
+	block_records = 0;
+	next_pc = 0;
+	addr = 0;
+	n_records = 0;
+}
+
+trace_reader_t::~trace_reader_t() {
+	fclose(fp);
+}
+
+void trace_reader_t::reopen() {
+	fclose(fp);
+	fp = fopen(file.c_str(), "rb");
+	if (!fp || fseek(fp, offset, SEEK_SET)) {
+		fprintf(stderr, "Cannot reopen the trace file %s\n", file.c_str());
+		exit(-1);
+	}
+}
+
+bool trace_reader_t::read_block() {
+	uint32_t header[3];
+	uLongf raw_bytes;
+
+	if ((fread(&header[0], sizeof(header[0]), 1, fp) != 1) || (header[0] == 0)) {
+		done = true;
+		fprintf(stderr, "End of the trace %s after %" PRIu64 " instructions\n", file.c_str(), n_records);
+		return(false);
+	}
+	if (fread(&header[1], sizeof(header[1]), 2, fp) != 2)
+		header[2] = 0;
+	z.resize(header[2]);
+	raw.resize(header[1]);
+	raw_bytes = header[1];
+	if (!header[2] || (fread(&z[0], 1, header[2], fp) != header[2]) ||
+	    (uncompress(&raw[0], &raw_bytes, &z[0], header[2]) != Z_OK) || (raw_bytes != header[1])) {
+		fprintf(stderr, "The trace file %s is corrupt (block after %" PRIu64 " instructions)\n", file.c_str(), n_records);
+		exit(-1);
+	}
+	offset = ftell(fp);
+
+	pos = 0;
+	block_records = header[0];
+	next_pc = 0;
+	addr = 0;
+	return(true);
+}
+
+bool trace_reader_t::more() {
+	if (block_records)
+		return(true);
+	return(!done && read_block());
+}
+
+uint64_t trace_reader_t::get(unsigned int bytes) {
+	uint64_t value = 0;
+
+	if ((pos + bytes) > raw.size()) {
+		fprintf(stderr, "The trace file %s is corrupt (record %" PRIu64 ")\n", file.c_str(), n_records);
+		exit(-1);
+	}
+	for (unsigned int i = 0; i < bytes; i++)
+		value |= ((uint64_t)raw[pos++] << (8 * i));
+	return(value);
+}
+
+int64_t trace_reader_t::get_varint() {
+	uint64_t v = 0;
+	unsigned int shift = 0;
+	uint8_t b;
+
+	do {
+		b = get(1);
+		v |= ((uint64_t)(b & 0x7f) << shift);
+		shift += 7;
+	} while ((b & 0x80) && (shift < 64));
+	return((int64_t)((v >> 1) ^ (~(v & 1) + 1)));
+}
+
+void trace_reader_t::read(db_t* e) {
+	assert(block_records > 0);
+
+	uint8_t flags = get(1);
+	reg_t pc = (next_pc + get_varint());
+	insn_bits_t bits = (insn_bits_t)(int64_t)(int32_t)get(4);
+
+	e->a_pc = pc;
+	e->a_inst = insn_t(bits);
+	e->a_next_pc = ((flags & TRACE_JUMP) ? (pc + get_varint()) : (pc + 4));
+	e->a_exception = ((flags & TRACE_EXCEPTION) != 0);
+	e->a_flags = 0;
+	e->a_lat = 0;
+	if (flags & TRACE_ADDR)
+		addr += get_varint();
+	e->a_addr = addr;
+
+	for (unsigned int i = 0; i < 3; i++) {
+		if (flags & TRACE_RSRC(i)) {
+			e->a_rsrc[i].n = get(1);
+			e->a_rsrc[i].value = get(8);
+			e->a_rsrc[i].valid = true;
+			e->a_num_rsrc++;
+		}
+	}
+	if (flags & TRACE_RDST) {
+		e->a_rdst[0].n = get(1);
+		e->a_rdst[0].value = get(8);
+		e->a_rdst[0].valid = true;
+		e->a_num_rdst = 1;
+	}
+	if (flags & TRACE_STATE) {
+		e->a_state->badvaddr = get(8);
+		e->a_state->tohost = get(8);
+		e->a_state->fromhost = get(8);
+		e->a_state->count = get(8);
+		e->a_state->sr = get(8);
+		e->a_state->fflags = get(8);
+		e->a_state->frm = get(8);
+	}
+
+	next_pc = e->a_next_pc;
+	block_records--;
+	n_records++;
+}
@@ -0,0 +1,123 @@
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <cstdio>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include "debug.h"
+
+// Compressed instruction traces (--trace, --replay).
+//
+// A trace is the functional simulator's instruction stream, in program order,
+// as it is pushed into the debug buffer: each instruction's pc, instruction
+// bits, next pc (branch outcome or exception handler), memory address, source
+// and destination operands and, if the checker compared it when the trace was
+// recorded, the architectural state it checks. Replaying a trace fills the
+// debug buffer without running the functional simulator.
+//
+// The file is a header followed by blocks, each compressed separately (zlib):
+//
+//    uint64_t magic; uint32_t version; uint32_t flags;
+//    per block:  uint32_t records; uint32_t raw_bytes; uint32_t z_bytes; uint8_t z_data[z_bytes];
+//    end:        uint32_t records = 0;
+//
+// Records are variable-length. Within a block, pcs and addresses are deltas
+// against the previous record, so a block decodes on its own:
+//
+//    uint8_t  flags;                     // TRACE_*
+//    varint   pc - previous next pc;     // zigzag-encoded, 0 for sequential code
+//    uint32_t instruction bits;
+//    varint   next pc - pc;              // if TRACE_JUMP
+//    varint   addr - previous addr;      // if TRACE_ADDR
+//    uint8_t  n; uint64_t value;         // per source operand in the flags, then the destination
+//    uint64_t state[TRACE_STATE_WORDS];  // if TRACE_STATE
+//
+// All fields are little-endian (host order).
+
+#define TRACE_MAGIC           0x4543415254313237ULL   // "721TRACE"
+#define TRACE_VERSION         1
+#define TRACE_HAS_STATE       0x1                     // header flag: records carry the checked state
+
+#define TRACE_BLOCK_RECORDS   65536
+
+// Record flags.
+#define TRACE_EXCEPTION       0x01
+#define TRACE_JUMP            0x02   // next pc is not pc + 4
+#define TRACE_ADDR            0x04   // the address differs from the previous record's
+#define TRACE_RDST            0x08
+#define TRACE_STATE           0x10
+#define TRACE_RSRC(i)         (0x20 << (i))   // i = 0..2
+
+// badvaddr, tohost, fromhost, count, sr, fflags, frm (see pipeline_t::check_state()).
+#define TRACE_STATE_WORDS     7
+
+class trace_writer_t {
+public:
+	// 'state': also record the state the checker compares.
+	trace_writer_t(const char* file, bool state);
+	~trace_writer_t();   // writes the last block and the end of the trace
+
+	void write(db_t* e);
+	uint64_t records() { return(n_records); }
+
+private:
+	void put(uint64_t value, unsigned int bytes);
+	void put_varint(int64_t value);
+	void write_block();
+
+	std::string file;
+	FILE* fp;
+	bool state;
+
+	std::vector<uint8_t> raw;    // the block being filled
+	std::vector<uint8_t> z;      // ...compressed
+	uint32_t block_records;
+	reg_t next_pc;               // of the previous record in the block
+	reg_t addr;                  // ...
+
+	uint64_t n_records;
+	uint64_t n_raw_bytes;
+	uint64_t n_file_bytes;
+};
+
+class trace_reader_t {
+public:
+	trace_reader_t(const char* file);
+	~trace_reader_t();
+
+	bool has_state() { return(state); }
+
+	// Is there another record? Reads the next block if needed.
+	bool more();
+
+	// Fill a debug buffer entry (see debug_buffer_t::start()) from the next record.
+	void read(db_t* e);
+
+	// A forked process must not share the file position: reopen the file at it.
+	void reopen();
+
+	uint64_t records() { return(n_records); }
+
+private:
+	uint64_t get(unsigned int bytes);
+	int64_t get_varint();
+	bool read_block();
+
+	std::string file;
+	FILE* fp;
+	long offset;                 // of the next block
+	bool state;
+	bool done;
+
+	std::vector<uint8_t> raw;    // the current block
+	std::vector<uint8_t> z;
+	size_t pos;                  // in 'raw'
+	uint32_t block_records;      // left in the current block
+	reg_t next_pc;
+	reg_t addr;
+
+	uint64_t n_records;
+};
+
+#endif //TRACE_FILE_H
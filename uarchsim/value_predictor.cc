@@ -0,0 +1,282 @@
+/*--------------------------------------------------------------------------*\
+ | value_predictor.cc
+ |
+ | Last-value, stride and VTAGE value predictors.
+\*--------------------------------------------------------------------------*/
+
+#include <cassert>
+
+#include "value_predictor.h"
+
+/////////////////////////////////////////////////////////////
+// Last-value predictor.
+/////////////////////////////////////////////////////////////
+
+lvp_predictor_t::lvp_predictor_t(unsigned int _entries, unsigned int _conf)
+	: value_predictor_t(_entries, _conf)
+{
+	lvp_entry_t e = {0, 0, 0};
+	table.assign(entries, e);
+}
+
+bool lvp_predictor_t::predict(reg_t pc, uint64_t hist, uint64_t& value)
+{
+	lvp_entry_t* e = &table[(pc >> 2) % entries];
+	if ((e->tag != pc) || (e->conf < conf_threshold))
+		return(false);
+	value = e->value;
+	return(true);
+}
+
+void lvp_predictor_t::train(reg_t pc, uint64_t hist, uint64_t value)
+{
+	lvp_entry_t* e = &table[(pc >> 2) % entries];
+
+	if (e->tag != pc) {
+		e->tag = pc;
+		e->value = value;
+		e->conf = 0;
+	}
+	else if (e->value == value) {
+		if (e->conf < VP_CONF_MAX)
+			e->conf++;
+	}
+	else {
+		e->value = value;
+		e->conf = 0;
+	}
+}
+
+void lvp_predictor_t::reset_conf(reg_t pc, uint64_t hist)
+{
+	lvp_entry_t* e = &table[(pc >> 2) % entries];
+	if (e->tag == pc)
+		e->conf = 0;
+}
+
+/////////////////////////////////////////////////////////////
+// Stride predictor.
+/////////////////////////////////////////////////////////////
+
+stride_vp_t::stride_vp_t(unsigned int _entries, unsigned int _conf)
+	: value_predictor_t(_entries, _conf)
+{
+	stride_entry_t e = {0, 0, 0, 0, 0};
+	table.assign(entries, e);
+}
+
+bool stride_vp_t::predict(reg_t pc, uint64_t hist, uint64_t& value)
+{
+	stride_entry_t* e = &table[(pc >> 2) % entries];
+	if (e->tag != pc)
+		return(false);
+
+	// Older instances of the instruction may still be in flight: skip over their values.
+	e->inflight++;
+	if (e->conf < conf_threshold)
+		return(false);
+	value = e->last + (uint64_t)(e->stride * (int64_t)e->inflight);
+	return(true);
+}
+
+void stride_vp_t::train(reg_t pc, uint64_t hist, uint64_t value)
+{
+	stride_entry_t* e = &table[(pc >> 2) % entries];
+
+	if (e->tag != pc) {
+		e->tag = pc;
+		e->last = value;
+		e->stride = 0;
+		e->conf = 0;
+		e->inflight = 0;
+		return;
+	}
+
+	if (e->inflight > 0)
+		e->inflight--;
+
+	int64_t stride = (int64_t)(value - e->last);
+	if (stride == e->stride) {
+		if (e->conf < VP_CONF_MAX)
+			e->conf++;
+	}
+	else {
+		e->stride = stride;
+		e->conf = 0;
+	}
+	e->last = value;
+}
+
+void stride_vp_t::reset_conf(reg_t pc, uint64_t hist)
+{
+	stride_entry_t* e = &table[(pc >> 2) % entries];
+	if (e->tag == pc)
+		e->conf = 0;
+}
+
+void stride_vp_t::squash(reg_t pc)
+{
+	stride_entry_t* e = &table[(pc >> 2) % entries];
+	if ((e->tag == pc) && (e->inflight > 0))
+		e->inflight--;
+}
+
+void stride_vp_t::flush()
+{
+	for (unsigned int i = 0; i < entries; i++)
+		table[i].inflight = 0;
+}
+
+/////////////////////////////////////////////////////////////
+// VTAGE predictor.
+/////////////////////////////////////////////////////////////
+
+// Fold the low 'len' bits of the history into 'bits' bits.
+static uint64_t fold_history(uint64_t hist, unsigned int len, unsigned int bits)
+{
+	if (len < 64)
+		hist &= ((1ULL << len) - 1);
+	uint64_t folded = 0;
+	while (hist) {
+		folded ^= (hist & ((1ULL << bits) - 1));
+		hist >>= bits;
+	}
+	return(folded);
+}
+
+vtage_predictor_t::vtage_predictor_t(unsigned int _entries, unsigned int _conf)
+	: value_predictor_t(_entries, _conf)
+{
+	vtage_entry_t e = {0, 0, 0, false};
+	base.assign(entries, e);
+	for (unsigned int t = 0; t < VP_VTAGE_TABLES; t++) {
+		tagged[t].assign(entries, e);
+		hist_len[t] = (2 << t);   // 2, 4, 8, ..., 64
+	}
+}
+
+unsigned int vtage_predictor_t::index(unsigned int t, reg_t pc, uint64_t hist)
+{
+	return((unsigned int)(((pc >> 2) ^ fold_history(hist, hist_len[t], 16) ^ (t << 3)) % entries));
+}
+
+uint64_t vtage_predictor_t::tag(unsigned int t, reg_t pc, uint64_t hist)
+{
+	return(((pc >> 2) ^ (fold_history(hist, hist_len[t], VP_VTAGE_TAG_BITS - 1) << 1)) & ((1ULL << VP_VTAGE_TAG_BITS) - 1));
+}
+
+// Returns the providing tagged component, or -1 for the base component.
+int vtage_predictor_t::provider(reg_t pc, uint64_t hist, unsigned int* idx)
+{
+	for (int t = (VP_VTAGE_TABLES - 1); t >= 0; t--) {
+		idx[t] = index(t, pc, hist);
+		if (tagged[t][idx[t]].tag == tag(t, pc, hist))
+			return(t);
+	}
+	return(-1);
+}
+
+bool vtage_predictor_t::predict(reg_t pc, uint64_t hist, uint64_t& value)
+{
+	unsigned int idx[VP_VTAGE_TABLES];
+	int p = provider(pc, hist, idx);
+	vtage_entry_t* e;
+
+	if (p >= 0) {
+		e = &tagged[p][idx[p]];
+	}
+	else {
+		e = &base[(pc >> 2) % entries];
+		if (e->tag != pc)
+			return(false);
+	}
+
+	if (e->conf < conf_threshold)
+		return(false);
+	value = e->value;
+	return(true);
+}
+
+void vtage_predictor_t::train(reg_t pc, uint64_t hist, uint64_t value)
+{
+	unsigned int idx[VP_VTAGE_TABLES];
+	int p = provider(pc, hist, idx);
+	vtage_entry_t* e = ((p >= 0) ? &tagged[p][idx[p]] : &base[(pc >> 2) % entries]);
+	bool correct;
+
+	if ((p < 0) && (e->tag != pc)) {
+		// Base miss: allocate there only.
+		e->tag = pc;
+		e->value = value;
+		e->conf = 0;
+		return;
+	}
+	else if (e->value == value) {
+		if (e->conf < VP_CONF_MAX)
+			e->conf++;
+		e->useful = true;
+		correct = true;
+	}
+	else {
+		e->value = value;
+		e->conf = 0;
+		correct = false;
+	}
+
+	// On a wrong value, allocate an entry in one longer-history component,
+	// aging the useful entries that could not be replaced.
+	if (!correct) {
+		for (int t = (p + 1); t < VP_VTAGE_TABLES; t++) {
+			vtage_entry_t* a = &tagged[t][index(t, pc, hist)];
+			if (!a->useful) {
+				a->tag = tag(t, pc, hist);
+				a->value = value;
+				a->conf = 0;
+				break;
+			}
+			a->useful = false;
+		}
+	}
+}
+
+void vtage_predictor_t::reset_conf(reg_t pc, uint64_t hist)
+{
+	unsigned int idx[VP_VTAGE_TABLES];
+	int p = provider(pc, hist, idx);
+	vtage_entry_t* e = ((p >= 0) ? &tagged[p][idx[p]] : &base[(pc >> 2) % entries]);
+	if ((p >= 0) || (e->tag == pc))
+		e->conf = 0;
+}
+
+/////////////////////////////////////////////////////////////
+// Factory.
+/////////////////////////////////////////////////////////////
+
+value_predictor_t* new_value_predictor(vp_e type, unsigned int entries, unsigned int conf)
+{
+	assert((entries > 0) && (conf >= 1) && (conf <= VP_CONF_MAX));
+	switch (type) {
+		case VP_LAST_VALUE:
+			return(new lvp_predictor_t(entries, conf));
+		case VP_STRIDE:
+			return(new stride_vp_t(entries, conf));
+		case VP_VTAGE:
+			return(new vtage_predictor_t(entries, conf));
+		default:
+			return((value_predictor_t *) NULL);
+	}
+}
+
+const char* value_predictor_name(vp_e type)
+{
+	switch (type) {
+		case VP_LAST_VALUE:
+			return("last-value");
+		case VP_STRIDE:
+			return("stride");
+		case VP_VTAGE:
+			return("vtage");
+		default:
+			return("none");
+	}
+}
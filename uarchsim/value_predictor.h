@@ -0,0 +1,136 @@
+#ifndef VALUE_PREDICTOR_H
+#define VALUE_PREDICTOR_H
+
+#include <vector>
+#include "decode.h"
+#include "parameters.h"
+
+/*--------------------------------------------------------------------------*\
+ | Value predictors.
+ |
+ | An eligible instruction (one with an integer destination register) looks
+ | up the predictor at rename. If the predictor is confident, the predicted
+ | value is written to the destination physical register at dispatch, so
+ | that dependent instructions issue without waiting for it. The instruction
+ | still executes, and its result is compared with the prediction at
+ | writeback (see pipeline_t::writeback()). A misprediction is recovered by
+ | rolling back to the checkpoint before the instruction (see retire).
+ |
+ | Predictors are trained in program order, with the values of retired
+ | instructions. Confidence is a saturating counter that is reset by a wrong
+ | value; since recovery is expensive, it must reach the configured
+ | threshold before predictions are used.
+ |
+ | 'hist' is the global conditional branch history at rename (newest outcome
+ | in bit 0); only context-based predictors (VTAGE) use it.
+\*--------------------------------------------------------------------------*/
+
+#define VP_CONF_MAX            7
+
+// VTAGE: tagged components with geometric history lengths, plus a PC-indexed base.
+#define VP_VTAGE_TABLES        6
+#define VP_VTAGE_TAG_BITS      12
+
+class value_predictor_t {
+public:
+	value_predictor_t(unsigned int _entries, unsigned int _conf) : entries(_entries), conf_threshold(_conf) {}
+	virtual ~value_predictor_t() {}
+
+	virtual const char* name() = 0;
+
+	// Look up an instruction at rename. Returns true, and the value, if the prediction should be used.
+	virtual bool predict(reg_t pc, uint64_t hist, uint64_t& value) = 0;
+
+	// Train with a retired instruction's value (in program order).
+	virtual void train(reg_t pc, uint64_t hist, uint64_t value) = 0;
+
+	// A looked-up instruction used a wrong predicted value: reset the confidence of
+	// the entry that provided it, so that its re-execution is not predicted. It is
+	// trained when it retires.
+	virtual void reset_conf(reg_t pc, uint64_t hist) = 0;
+
+	// A looked-up instruction was squashed before retiring.
+	virtual void squash(reg_t pc) {}
+
+	// All in-flight instructions were squashed.
+	virtual void flush() {}
+
+protected:
+	unsigned int entries;          // per table
+	unsigned int conf_threshold;   // predict when conf >= conf_threshold
+};
+
+// Last value.
+class lvp_predictor_t : public value_predictor_t {
+public:
+	lvp_predictor_t(unsigned int _entries, unsigned int _conf);
+	const char* name() { return "last-value"; }
+	bool predict(reg_t pc, uint64_t hist, uint64_t& value);
+	void train(reg_t pc, uint64_t hist, uint64_t value);
+	void reset_conf(reg_t pc, uint64_t hist);
+
+private:
+	typedef struct {
+		reg_t tag;           // PC
+		uint64_t value;
+		unsigned int conf;
+	} lvp_entry_t;
+
+	std::vector<lvp_entry_t> table;
+};
+
+// Stride: last value plus stride, once per in-flight instance of the instruction.
+class stride_vp_t : public value_predictor_t {
+public:
+	stride_vp_t(unsigned int _entries, unsigned int _conf);
+	const char* name() { return "stride"; }
+	bool predict(reg_t pc, uint64_t hist, uint64_t& value);
+	void train(reg_t pc, uint64_t hist, uint64_t value);
+	void reset_conf(reg_t pc, uint64_t hist);
+	void squash(reg_t pc);
+	void flush();
+
+private:
+	typedef struct {
+		reg_t tag;           // PC
+		uint64_t last;       // value of the last retired instance
+		int64_t stride;
+		unsigned int conf;
+		unsigned int inflight;  // instances looked up but not yet retired
+	} stride_entry_t;
+
+	std::vector<stride_entry_t> table;
+};
+
+// VTAGE (Perais and Seznec, HPCA 2014): the longest-history tagged component
+// that hits provides the value, otherwise the base (last-value) component.
+class vtage_predictor_t : public value_predictor_t {
+public:
+	vtage_predictor_t(unsigned int _entries, unsigned int _conf);
+	const char* name() { return "vtage"; }
+	bool predict(reg_t pc, uint64_t hist, uint64_t& value);
+	void train(reg_t pc, uint64_t hist, uint64_t value);
+	void reset_conf(reg_t pc, uint64_t hist);
+
+private:
+	typedef struct {
+		uint64_t tag;
+		uint64_t value;
+		unsigned int conf;
+		bool useful;
+	} vtage_entry_t;
+
+	unsigned int index(unsigned int t, reg_t pc, uint64_t hist);
+	uint64_t tag(unsigned int t, reg_t pc, uint64_t hist);
+	int provider(reg_t pc, uint64_t hist, unsigned int* idx);
+
+	std::vector<vtage_entry_t> base;
+	std::vector<vtage_entry_t> tagged[VP_VTAGE_TABLES];
+	unsigned int hist_len[VP_VTAGE_TABLES];
+};
+
+// Returns NULL for VP_NONE.
+value_predictor_t* new_value_predictor(vp_e type, unsigned int entries, unsigned int conf);
+const char* value_predictor_name(vp_e type);
+
+#endif //VALUE_PREDICTOR_H
@@ -0,0 +1,61 @@
+#include "warm_state.h"
+
+
+static void write_word(std::ostream& os, uint64_t w) {
+	os.write((const char*)&w, sizeof(w));
+}
+
+static void write_words(std::ostream& os, const std::vector<uint64_t>& w) {
+	write_word(os, w.size());
+	if (!w.empty())
+		os.write((const char*)&w[0], (w.size() * sizeof(uint64_t)));
+}
+
+static bool read_word(std::istream& is, uint64_t& w) {
+	is.read((char*)&w, sizeof(w));
+	return(is.good());
+}
+
+static bool read_words(std::istream& is, std::vector<uint64_t>& w) {
+	uint64_t n;
+	if (!read_word(is, n))
+		return(false);
+	w.resize(n);
+	if (n)
+		is.read((char*)&w[0], (n * sizeof(uint64_t)));
+	return(is.good());
+}
+
+void write_warm_state(std::ostream& os, const std::vector<warm_section_t>& sections) {
+	write_word(os, WARM_STATE_SIGNATURE);
+	write_word(os, sections.size());
+	for (size_t i = 0; i < sections.size(); i++) {
+		write_word(os, sections[i].name.size());
+		os.write(sections[i].name.data(), sections[i].name.size());
+		write_words(os, sections[i].geometry);
+		write_words(os, sections[i].data);
+	}
+}
+
+bool read_warm_state(std::istream& is, std::vector<warm_section_t>& sections) {
+	uint64_t signature;
+	uint64_t n;
+
+	sections.clear();
+	if (!read_word(is, signature) || (signature != WARM_STATE_SIGNATURE) || !read_word(is, n))
+		return(false);
+
+	for (uint64_t i = 0; i < n; i++) {
+		uint64_t len;
+		warm_section_t s;
+		if (!read_word(is, len))
+			return(false);
+		s.name.resize(len);
+		if (len)
+			is.read(&s.name[0], len);
+		if (!read_words(is, s.geometry) || !read_words(is, s.data))
+			return(false);
+		sections.push_back(s);
+	}
+	return(true);
+}
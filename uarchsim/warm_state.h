@@ -0,0 +1,50 @@
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*--------------------------------------------------------------------------*\
+ | warm_state.h
+ |
+ | Microarchitectural warm state in checkpoints.
+ |
+ | A checkpoint of the timing simulator (see sim_t::create_checkpoint())
+ | ends with the warm state of its caches and predictors, after the HTIF,
+ | memory and register state. The warm state is a list of sections, one per
+ | structure: the structure's name, its geometry (the configuration that
+ | gives its contents their meaning, e.g., sets, associativity and line
+ | size) and its contents, all as 64-bit words.
+ |
+ | On restore, a structure reloads its section only if its geometry is the
+ | same; otherwise it starts cold. So a checkpoint taken with one machine
+ | configuration can still warm the structures that another configuration
+ | has in common with it. Checkpoints without warm state restore as before.
+ |
+ | Only state that persists across the pipeline being empty is saved: tags,
+ | LRU, dirty bits and predictor tables, but not MHSRs or queues.
+\*--------------------------------------------------------------------------*/
+
+#define WARM_STATE_SIGNATURE   0xfeedbaadbeefcafeULL
+
+typedef struct {
+	std::string name;
+	std::vector<uint64_t> geometry;
+	std::vector<uint64_t> data;
+} warm_section_t;
+
+void write_warm_state(std::ostream& os, const std::vector<warm_section_t>& sections);
+
+// Returns false if the stream has no warm state.
+bool read_warm_state(std::istream& is, std::vector<warm_section_t>& sections);
+
+// Start a section of the given name; the caller fills in its geometry and data.
+static inline warm_section_t& new_warm_section(std::vector<warm_section_t>& sections, const std::string& name) {
+	sections.push_back(warm_section_t());
+	sections.back().name = name;
+	return(sections.back());
+}
+
+#endif //WARM_STATE_H
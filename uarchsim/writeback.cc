@@ -38,7 +38,13 @@ void pipeline_t::writeback(unsigned int lane_number) {
 
       if (PAY.buf[index].checkpoint) {
 
-         if ((PAY.buf[index].next_pc != PAY.buf[index].c_next_pc) && (PAY.buf[index].good_instruction == true)) {
+         // Without the functional oracle every branch ends its checkpoint interval, so wrong-path
+         // branches (not known to be wrong-path) can be recovered the same way.
+         // With it, only the branches it knew were mispredicted end their intervals. Another one
+         // resolved with a wrong predicted value (--vp) is not recovered here: its interval is
+         // squashed and re-executed for the value misprediction (see retire).
+         if ((PAY.buf[index].next_pc != PAY.buf[index].c_next_pc) && ((PAY.buf[index].good_instruction == true) || !FUNCTIONAL_ORACLE) &&
+             PAY.buf[index].ends_interval) {
             // Branch was mispredicted.
             //printf("Branch Misprediction START\n");
             //REN->printUsageCounterState();
@@ -88,6 +94,18 @@ void pipeline_t::writeback(unsigned int lane_number) {
             selective_squash(squash_mask);
             // FIX_ME #15d END
 
+            // Repair the value predictor's in-flight state and branch history.
+            if (VP) {
+               for (unsigned int i = MOD((index + 2), PAY.get_size()); i != PAY.tail; i = MOD((i + 2), PAY.get_size())) {
+                  if (PAY.buf[i].vp_lookup)
+                     VP->squash(PAY.buf[i].pc);
+               }
+            }
+            if (PAY.buf[index].inst.opcode() == OP_BRANCH)
+               vp_ghist = ((PAY.buf[index].vp_hist << 1) | (PAY.buf[index].c_next_pc != INCREMENT_PC(PAY.buf[index].pc)));
+            else
+               vp_ghist = PAY.buf[index].vp_hist;
+
             // Rollback PAY to the point of the branch.
             //printf("Rollback\n");
             PAY.rollback(index);
@@ -104,6 +122,14 @@ void pipeline_t::writeback(unsigned int lane_number) {
       // 2. Set the completed bit for this instruction in the Active List.
       //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+      // Verify a predicted value. The misprediction is recovered when its checkpoint
+      // reaches the head (see retire).
+      if (PAY.buf[index].vp_predicted && (PAY.buf[index].C_value.dw != PAY.buf[index].vp_value)) {
+         PAY.buf[index].vp_misp = true;
+         REN->set_value_misprediction(PAY.buf[index].chkpt_id);
+         vp_n_misp_detected++;
+      }
+
       // FIX_ME #16 BEGIN
       //printf("set_complete from writeback: index=%llu and chkpt_id=%llu\n", index, PAY.buf[index].chkpt_id);
       REN->set_complete(PAY.buf[index].chkpt_id);